@@ -874,6 +874,192 @@ class RedfishAPI:
                 "timestamp": datetime.now().isoformat()
             }
 
+    # ---- R暫存器讀寫的 asyncio 版本 ----
+    # API 端點直接 await 這些方法：PLC 的讀寫交給 lib-cdu-hal 的非同步介面 (hal_submit)，
+    # 與背景擷取同時進行，等待回應期間不佔用 worker thread。驗證與回應格式與同步版本相同，
+    # 寫入經由 HAL 寫入佇列送出 (與其他設定值寫入依序合併)，送出後才回應。
+
+    async def write_r_register_async(self, register_address: int, value: int) -> Dict[str, Any]:
+        """寫入單個R暫存器 (asyncio)"""
+        try:
+            if not (10500 <= register_address <= 10700):
+                return {
+                    "success": False,
+                    "message": f"Register address {register_address} out of range (R10500-R10700)",
+                    "timestamp": datetime.now().isoformat()
+                }
+            if not (0 <= value <= 65535):
+                return {
+                    "success": False,
+                    "message": f"Value {value} out of range (0-65535)",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            mitsubishi_block = self._get_mitsubishi_plc_block()
+            if not mitsubishi_block:
+                return {
+                    "success": False,
+                    "message": "PLC block not found",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            success = await mitsubishi_block.write_r_registers_batch_async(register_address, [value])
+            return {
+                "success": success,
+                "message": f"Successfully wrote R{register_address} = {value}" if success
+                           else f"Failed to write R{register_address}",
+                "register_address": register_address,
+                "value": value,
+                "timestamp": datetime.now().isoformat()
+            }
+
+        except Exception as e:
+            logger.error(f"Error writing R{register_address}: {e}")
+            return {
+                "success": False,
+                "message": f"Error writing register: {str(e)}",
+                "timestamp": datetime.now().isoformat()
+            }
+
+    async def write_r_registers_batch_async(self, start_address: int, values: List[int]) -> Dict[str, Any]:
+        """批量寫入R暫存器 (asyncio)"""
+        try:
+            end_address = start_address + len(values) - 1
+            if not (10500 <= start_address <= 10700) or not (10500 <= end_address <= 10700):
+                return {
+                    "success": False,
+                    "message": f"Address range R{start_address}-R{end_address} out of range (R10500-R10700)",
+                    "timestamp": datetime.now().isoformat()
+                }
+            for i, value in enumerate(values):
+                if not (0 <= value <= 65535):
+                    return {
+                        "success": False,
+                        "message": f"Value {value} at index {i} out of range (0-65535)",
+                        "timestamp": datetime.now().isoformat()
+                    }
+
+            mitsubishi_block = self._get_mitsubishi_plc_block()
+            if not mitsubishi_block:
+                return {
+                    "success": False,
+                    "message": "PLC block not found",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            success = await mitsubishi_block.write_r_registers_batch_async(start_address, values)
+            return {
+                "success": success,
+                "message": f"Successfully wrote {len(values)} registers starting from R{start_address}" if success
+                           else f"Failed to write registers starting from R{start_address}",
+                "start_address": start_address,
+                "count": len(values),
+                "timestamp": datetime.now().isoformat()
+            }
+
+        except Exception as e:
+            logger.error(f"Error batch writing registers: {e}")
+            return {
+                "success": False,
+                "message": f"Error writing registers: {str(e)}",
+                "timestamp": datetime.now().isoformat()
+            }
+
+    async def read_single_r_register_async(self, register_address: int) -> Dict[str, Any]:
+        """讀取單個R暫存器 (asyncio)"""
+        try:
+            if not (10000 <= register_address <= 11000):
+                return {
+                    "success": False,
+                    "message": f"Register address R{register_address} out of range (R10000-R11000)",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            mitsubishi_block = self._get_mitsubishi_plc_block()
+            if not mitsubishi_block:
+                return {
+                    "success": False,
+                    "message": "PLC block not found",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            result = await mitsubishi_block.read_r_registers_batch_async(register_address, 1)
+            register = result["registers"].get(f"R{register_address}") if result else None
+            if register:
+                return {
+                    "success": True,
+                    "register_address": register["register"],
+                    "value": register["value"],
+                    "modbus_address": register["modbus_address"],
+                    "timestamp": datetime.now().isoformat(),
+                    "message": f"Successfully read R{register_address} = {register['value']}"
+                }
+            return {
+                "success": False,
+                "message": f"Failed to read R{register_address}",
+                "register_address": register_address,
+                "timestamp": datetime.now().isoformat()
+            }
+
+        except Exception as e:
+            logger.error(f"Error reading R{register_address}: {e}")
+            return {
+                "success": False,
+                "message": f"Error reading register: {str(e)}",
+                "timestamp": datetime.now().isoformat()
+            }
+
+    async def read_r_registers_batch_async(self, start_address: int, count: int) -> Dict[str, Any]:
+        """批量讀取R暫存器 (asyncio)"""
+        try:
+            end_address = start_address + count - 1
+            if not (10000 <= start_address <= 11000) or not (10000 <= end_address <= 11000):
+                return {
+                    "success": False,
+                    "message": f"Address range R{start_address}-R{end_address} out of range (R10000-R11000)",
+                    "timestamp": datetime.now().isoformat()
+                }
+            if count > 125:
+                return {
+                    "success": False,
+                    "message": f"Count {count} exceeds maximum (125)",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            mitsubishi_block = self._get_mitsubishi_plc_block()
+            if not mitsubishi_block:
+                return {
+                    "success": False,
+                    "message": "PLC block not found",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            result = await mitsubishi_block.read_r_registers_batch_async(start_address, count)
+            if result:
+                return {
+                    "success": True,
+                    "start_address": result["start_address"],
+                    "count": result["count"],
+                    "registers": result["registers"],
+                    "timestamp": datetime.now().isoformat(),
+                    "message": f"Successfully read {count} registers starting from R{start_address}"
+                }
+            return {
+                "success": False,
+                "message": f"Failed to read registers R{start_address}-R{end_address}",
+                "start_address": start_address,
+                "count": count,
+                "timestamp": datetime.now().isoformat()
+            }
+
+        except Exception as e:
+            logger.error(f"Error batch reading registers: {e}")
+            return {
+                "success": False,
+                "message": f"Error reading registers: {str(e)}",
+                "timestamp": datetime.now().isoformat()
+            }
+
     def get_cdu_status(self) -> Dict[str, Any]:
         """獲取CDU機組狀態 (基於R10000的16個bit位)"""
         try:
@@ -2552,6 +2738,45 @@ class RedfishAPI:
                 "timestamp": datetime.now().isoformat()
             }
 
+    def get_hal_bus_statistics(self, reset: bool = False) -> Dict[str, Any]:
+        """獲取HAL匯流排統計 (每個串口與slave的交易計數及延遲百分位數)"""
+        try:
+            from blocks import hal_bus
+
+            if not hal_bus.available():
+                return {
+                    "success": False,
+                    "message": "HAL函式庫不可用",
+                    "timestamp": datetime.now().isoformat()
+                }
+
+            ports = []
+            for entry in hal_bus.get_stats():
+                if entry["slave"] == -1:
+                    entry["slaves"] = []
+                    ports.append(entry)
+                elif ports and ports[-1]["device"] == entry["device"]:
+                    ports[-1]["slaves"].append(entry)
+
+            if reset:
+                hal_bus.reset_stats()
+
+            return {
+                "success": True,
+                "ports": ports,
+                "total_ports": len(ports),
+                "reset": reset,
+                "timestamp": datetime.now().isoformat()
+            }
+
+        except Exception as e:
+            logger.error(f"Error getting HAL bus statistics: {e}")
+            return {
+                "success": False,
+                "message": f"獲取匯流排統計失敗: {str(e)}",
+                "timestamp": datetime.now().isoformat()
+            }
+
     def _validate_machine_config(self, sensor_config: Dict[str, Any]) -> Dict[str, Any]:
         """驗證機種配置"""
         try:
@@ -3003,7 +3228,7 @@ async def write_r_register(system_id: str, request: RegisterWriteRequest):
     if system_id != "CDU1":
         raise HTTPException(status_code=404, detail="System not found")
 
-    result = redfish_api.write_r_register(request.register_address, request.value)
+    result = await redfish_api.write_r_register_async(request.register_address, request.value)
     if not result["success"]:
         raise HTTPException(status_code=400, detail=result["message"])
     return result
@@ -3014,7 +3239,7 @@ async def write_r_registers_batch(system_id: str, request: BatchRegisterWriteReq
     if system_id != "CDU1":
         raise HTTPException(status_code=404, detail="System not found")
 
-    result = redfish_api.write_r_registers_batch(request.start_address, request.values)
+    result = await redfish_api.write_r_registers_batch_async(request.start_address, request.values)
     if not result["success"]:
         raise HTTPException(status_code=400, detail=result["message"])
     return result
@@ -3026,7 +3251,7 @@ async def read_single_r_register(system_id: str, request: RegisterReadRequest):
     if system_id != "CDU1":
         raise HTTPException(status_code=404, detail="System not found")
 
-    result = redfish_api.read_single_r_register(request.register_address)
+    result = await redfish_api.read_single_r_register_async(request.register_address)
     if not result["success"]:
         raise HTTPException(status_code=400, detail=result["message"])
     return result
@@ -3037,7 +3262,7 @@ async def read_r_registers_batch(system_id: str, request: BatchRegisterReadReque
     if system_id != "CDU1":
         raise HTTPException(status_code=404, detail="System not found")
 
-    result = redfish_api.read_r_registers_batch(request.start_address, request.count)
+    result = await redfish_api.read_r_registers_batch_async(request.start_address, request.count)
     if not result["success"]:
         raise HTTPException(status_code=400, detail=result["message"])
     return result
@@ -3052,7 +3277,7 @@ async def get_single_r_register(system_id: str, register_address: int):
     if not (10000 <= register_address <= 11000):
         raise HTTPException(status_code=422, detail=f"Register address R{register_address} out of range (R10000-R11000)")
 
-    result = redfish_api.read_single_r_register(register_address)
+    result = await redfish_api.read_single_r_register_async(register_address)
     if not result["success"]:
         raise HTTPException(status_code=400, detail=result["message"])
     return result
@@ -3222,3 +3447,15 @@ async def delete_machine_config(system_id: str, machine_type: str):
     if not result["success"]:
         raise HTTPException(status_code=400, detail=result["message"])
     return result
+
+# HAL匯流排統計API端點
+@redfish_router.get('/Systems/{system_id}/Oem/CDU/HAL/BusStatistics')
+async def get_hal_bus_statistics(system_id: str, reset: bool = False):
+    """獲取HAL匯流排統計 (reset=true 時讀取後清除)"""
+    if system_id != "CDU1":
+        raise HTTPException(status_code=404, detail="System not found")
+
+    result = redfish_api.get_hal_bus_statistics(reset)
+    if not result["success"]:
+        raise HTTPException(status_code=503, detail=result["message"])
+    return result
@@ -0,0 +1,1506 @@
+"""
+HAL 匯流排排程器的 Python 介面
+Block 在初始化時透過 register_point() 註冊量測點，
+HAL 會把同一 slave 上相鄰的暫存器合併成最少的 FC03 frame。
+引擎啟動 start_acquisition() 後由 HAL 的串口執行緒在背景輪詢，
+Block 透過 read_point()/read_sample() 非阻塞地讀取快照表；
+未啟動背景擷取時，引擎在每個控制週期開始時呼叫一次 poll()。
+device 可為串口 (COM7、/dev/ttyTHS1) 或 Modbus TCP 端點 ("tcp://192.168.3.40:502")，
+後者的 slave 作為 MBAP unit identifier，同一連線上的讀取會同時在途。
+多個程序共用同一組匯流排時，只有擷取程序以 publish_snapshot() 發布共享記憶體快照表，
+其他程序呼叫 attach_snapshot() 後 register_*() 只在快照表中尋找量測點，不會開啟串口或連線 PLC。
+"""
+
+import asyncio
+import ctypes
+import logging
+import os
+import platform
+import threading
+
+# 暫存器資料型態 (對應 hal_modbus.h 的 hal_value_type_t)
+HAL_VALUE_U16 = 0
+HAL_VALUE_S16 = 1
+HAL_VALUE_U32 = 2
+HAL_VALUE_S32 = 3
+HAL_VALUE_F32 = 4
+
+# 日誌層級與輸出目的地 (對應 hal_log.h)
+HAL_LOG_LEVEL_TRACE = 0
+HAL_LOG_LEVEL_DEBUG = 1
+HAL_LOG_LEVEL_INFO = 2
+HAL_LOG_LEVEL_WARN = 3
+HAL_LOG_LEVEL_ERROR = 4
+HAL_LOG_SINK_STDOUT = 1
+HAL_LOG_SINK_RING = 2
+
+_LOG_LEVEL_MAP = {
+    'TRACE': logging.DEBUG,
+    'DEBUG': logging.DEBUG,
+    'INFO': logging.INFO,
+    'WARN': logging.WARNING,
+    'ERROR': logging.ERROR,
+}
+
+# 資料品質 (對應 hal_snapshot.h)
+HAL_QUALITY_NONE = 0
+HAL_QUALITY_GOOD = 1
+HAL_QUALITY_BAD = 2
+
+
+class HalSample(ctypes.Structure):
+    """對應 hal_snapshot.h 的 hal_sample_t"""
+    _fields_ = [
+        ('value', ctypes.c_float),
+        ('raw', ctypes.c_uint32),
+        ('quality', ctypes.c_uint32),
+        ('error_count', ctypes.c_uint32),
+        ('timestamp_us', ctypes.c_uint64),
+    ]
+
+class HalLatencySummary(ctypes.Structure):
+    """對應 hal_stats.h 的 hal_latency_summary_t"""
+    _fields_ = [
+        ('count', ctypes.c_uint64),
+        ('sum_us', ctypes.c_uint64),
+        ('min_us', ctypes.c_uint32),
+        ('max_us', ctypes.c_uint32),
+        ('p50_us', ctypes.c_uint32),
+        ('p90_us', ctypes.c_uint32),
+        ('p99_us', ctypes.c_uint32),
+        ('p999_us', ctypes.c_uint32),
+    ]
+
+
+class HalStats(ctypes.Structure):
+    """對應 hal_stats.h 的 hal_stats_t"""
+    _fields_ = [
+        ('device', ctypes.c_char * 64),
+        ('slave', ctypes.c_int32),
+        ('requests', ctypes.c_uint64),
+        ('responses', ctypes.c_uint64),
+        ('timeouts', ctypes.c_uint64),
+        ('crc_errors', ctypes.c_uint64),
+        ('exceptions', ctypes.c_uint64),
+        ('other_errors', ctypes.c_uint64),
+        ('bytes_out', ctypes.c_uint64),
+        ('bytes_in', ctypes.c_uint64),
+        ('latency', HalLatencySummary * 3),
+    ]
+
+class HalBatch(ctypes.Structure):
+    """對應 hal_snapshot.h 的 hal_batch_t"""
+    _fields_ = [
+        ('capacity', ctypes.c_int),
+        ('value', ctypes.POINTER(ctypes.c_float)),
+        ('raw', ctypes.POINTER(ctypes.c_uint32)),
+        ('quality', ctypes.POINTER(ctypes.c_uint32)),
+        ('timestamp_us', ctypes.POINTER(ctypes.c_uint64)),
+    ]
+
+class HalChange(ctypes.Structure):
+    """對應 hal_change.h 的 hal_change_t"""
+    _fields_ = [
+        ('handle', ctypes.c_int32),
+        ('quality', ctypes.c_uint32),
+        ('value', ctypes.c_float),
+        ('raw', ctypes.c_uint32),
+        ('timestamp_us', ctypes.c_uint64),
+    ]
+
+class HalHistorySample(ctypes.Structure):
+    """對應 hal_history.h 的 hal_history_sample_t"""
+    _fields_ = [
+        ('timestamp_us', ctypes.c_uint64),
+        ('value', ctypes.c_float),
+        ('quality', ctypes.c_uint32),
+    ]
+
+class HalHistoryBucket(ctypes.Structure):
+    """對應 hal_history.h 的 hal_history_bucket_t"""
+    _fields_ = [
+        ('timestamp_us', ctypes.c_uint64),
+        ('min', ctypes.c_float),
+        ('max', ctypes.c_float),
+        ('avg', ctypes.c_float),
+        ('good', ctypes.c_uint16),
+        ('bad', ctypes.c_uint16),
+    ]
+
+class HalFilterConfig(ctypes.Structure):
+    """對應 hal_filter.h 的 hal_filter_config_t"""
+    _fields_ = [
+        ('median', ctypes.c_int),
+        ('ema_alpha', ctypes.c_float),
+        ('max_rate', ctypes.c_float),
+        ('gain', ctypes.c_float),
+        ('offset', ctypes.c_float),
+    ]
+
+class HalCtrlConfig(ctypes.Structure):
+    """對應 hal_ctrl.h 的 hal_ctrl_config_t"""
+    _fields_ = [
+        ('pv_handle', ctypes.c_int),
+        ('ff_handle', ctypes.c_int),
+        ('setpoint', ctypes.c_float),
+        ('kp', ctypes.c_float),
+        ('ki', ctypes.c_float),
+        ('kd', ctypes.c_float),
+        ('ff_gain', ctypes.c_float),
+        ('ff_ref', ctypes.c_float),
+        ('bias', ctypes.c_float),
+        ('out_min', ctypes.c_float),
+        ('out_max', ctypes.c_float),
+        ('out_scale', ctypes.c_float),
+        ('stale_periods', ctypes.c_int),
+    ]
+
+class HalCtrlStatus(ctypes.Structure):
+    """對應 hal_ctrl.h 的 hal_ctrl_status_t"""
+    _fields_ = [
+        ('setpoint', ctypes.c_float),
+        ('pv', ctypes.c_float),
+        ('output', ctypes.c_float),
+        ('integral', ctypes.c_float),
+        ('enabled', ctypes.c_uint32),
+        ('saturated', ctypes.c_uint32),
+        ('cycles', ctypes.c_uint64),
+        ('bad_pv', ctypes.c_uint64),
+        ('writes', ctypes.c_uint64),
+        ('write_errors', ctypes.c_uint64),
+    ]
+
+class HalCtrlThreadStats(ctypes.Structure):
+    """對應 hal_ctrl.h 的 hal_ctrl_thread_stats_t"""
+    _fields_ = [
+        ('rate_hz', ctypes.c_uint32),
+        ('realtime', ctypes.c_uint32),
+        ('cycles', ctypes.c_uint64),
+        ('overruns', ctypes.c_uint64),
+        ('last_cycle_us', ctypes.c_uint32),
+        ('max_cycle_us', ctypes.c_uint32),
+        ('last_jitter_us', ctypes.c_uint32),
+        ('max_jitter_us', ctypes.c_uint32),
+    ]
+
+class HalSimConfig(ctypes.Structure):
+    """對應 hal_modbus_sim.h 的 hal_sim_config_t"""
+    _fields_ = [
+        ('baud', ctypes.c_int),
+        ('latency_us', ctypes.c_uint32),
+        ('jitter_us', ctypes.c_uint32),
+        ('timeout_ppm', ctypes.c_uint32),
+        ('crc_error_ppm', ctypes.c_uint32),
+        ('exception_ppm', ctypes.c_uint32),
+        ('seed', ctypes.c_uint32),
+        ('auto_slaves', ctypes.c_int),
+        ('realtime', ctypes.c_int),
+    ]
+
+class HalAcqStats(ctypes.Structure):
+    """對應 hal_acq.h 的 hal_acq_stats_t"""
+    _fields_ = [
+        ('device', ctypes.c_char * 64),
+        ('cpu', ctypes.c_int32),
+        ('period_ms', ctypes.c_uint32),
+        ('cycles', ctypes.c_uint64),
+        ('overruns', ctypes.c_uint64),
+        ('last_cycle_us', ctypes.c_uint32),
+        ('max_cycle_us', ctypes.c_uint32),
+    ]
+
+class HalDiscoverConfig(ctypes.Structure):
+    """對應 hal_discover.h 的 hal_discover_config_t"""
+    _fields_ = [
+        ('slave_first', ctypes.c_int),
+        ('slave_last', ctypes.c_int),
+        ('probe_timeout_ms', ctypes.c_int),
+        ('retries', ctypes.c_int),
+        ('reg_first', ctypes.c_int),
+        ('reg_last', ctypes.c_int),
+        ('reg_block', ctypes.c_int),
+        ('tune_turnaround', ctypes.c_int),
+    ]
+
+class HalDiscoverRange(ctypes.Structure):
+    """對應 hal_discover.h 的 hal_discover_range_t"""
+    _fields_ = [
+        ('start', ctypes.c_uint16),
+        ('count', ctypes.c_uint16),
+    ]
+
+HAL_DISCOVER_MAX_ADDRESS = 247
+HAL_DISCOVER_MAX_RANGES = 8
+
+class HalDiscoverSlave(ctypes.Structure):
+    """對應 hal_discover.h 的 hal_discover_slave_t"""
+    _fields_ = [
+        ('slave', ctypes.c_int),
+        ('response_us', ctypes.c_uint32),
+        ('turnaround_us', ctypes.c_uint32),
+        ('n_ranges', ctypes.c_int),
+        ('ranges', HalDiscoverRange * HAL_DISCOVER_MAX_RANGES),
+    ]
+
+class HalDiscoverPort(ctypes.Structure):
+    """對應 hal_discover.h 的 hal_discover_port_t"""
+    _fields_ = [
+        ('device', ctypes.c_char * 64),
+        ('slave_first', ctypes.c_int),
+        ('slave_last', ctypes.c_int),
+        ('probe_timeout_ms', ctypes.c_int),
+        ('frame_gap_us', ctypes.c_int),
+        ('from_cache', ctypes.c_int),
+        ('elapsed_ms', ctypes.c_uint32),
+        ('discovered_us', ctypes.c_uint64),
+        ('n_slaves', ctypes.c_int),
+        ('slaves', HalDiscoverSlave * HAL_DISCOVER_MAX_ADDRESS),
+    ]
+
+class HalPortLine(ctypes.Structure):
+    """對應 hal_port.h 的 hal_port_line_t"""
+    _fields_ = [
+        ('baud', ctypes.c_int),
+        ('parity', ctypes.c_char),
+        ('stop_bits', ctypes.c_int),
+        ('char_us', ctypes.c_int),
+        ('t15_us', ctypes.c_int),
+        ('t35_us', ctypes.c_int),
+        ('frame_gap_us', ctypes.c_int),
+    ]
+
+class HalWriteStatus(ctypes.Structure):
+    """對應 hal_write.h 的 hal_write_status_t"""
+    _fields_ = [
+        ('queued', ctypes.c_uint64),
+        ('written', ctypes.c_uint64),
+        ('failed', ctypes.c_uint64),
+        ('last_status', ctypes.c_int32),
+        ('last_error_reg', ctypes.c_int32),
+        ('last_error_us', ctypes.c_uint64),
+    ]
+
+# 非同步請求 (對應 hal_async.h)
+HAL_REQ_READ = 0
+HAL_REQ_WRITE = 1
+HAL_REQ_PLC_READ = 2
+HAL_ASYNC_MAX_INFLIGHT = 64
+HAL_ASYNC_MAX_REGISTERS = 125
+
+class HalRequest(ctypes.Structure):
+    """對應 hal_async.h 的 hal_request_t"""
+    _fields_ = [
+        ('kind', ctypes.c_int32),
+        ('device', ctypes.c_char * 64),
+        ('slave', ctypes.c_int32),
+        ('reg', ctypes.c_int32),
+        ('address', ctypes.c_char * 16),
+        ('count', ctypes.c_int32),
+        ('values', ctypes.c_uint16 * HAL_ASYNC_MAX_REGISTERS),
+        ('user_data', ctypes.c_uint64),
+    ]
+
+class HalCompletion(ctypes.Structure):
+    """對應 hal_async.h 的 hal_completion_t"""
+    _fields_ = [
+        ('ticket', ctypes.c_uint64),
+        ('user_data', ctypes.c_uint64),
+        ('kind', ctypes.c_int32),
+        ('status', ctypes.c_int32),
+        ('count', ctypes.c_int32),
+        ('elapsed_us', ctypes.c_uint32),
+        ('values', ctypes.c_uint16 * HAL_ASYNC_MAX_REGISTERS),
+    ]
+
+# 節點間遙測 frame (對應 hal_telemetry.h)
+HAL_TELEMETRY_MAX_BATCH = 16
+
+class HalTelemetryConfig(ctypes.Structure):
+    """對應 hal_telemetry.h 的 hal_telemetry_config_t"""
+    _fields_ = [
+        ('node_id', ctypes.c_uint16),
+        ('batch_cycles', ctypes.c_int),
+        ('keyframe_interval', ctypes.c_int),
+    ]
+
+class HalTelemetryInfo(ctypes.Structure):
+    """對應 hal_telemetry.h 的 hal_telemetry_info_t"""
+    _fields_ = [
+        ('node_id', ctypes.c_uint16),
+        ('point_count', ctypes.c_uint16),
+        ('seq', ctypes.c_uint32),
+        ('layout_hash', ctypes.c_uint32),
+        ('keyframe', ctypes.c_int),
+        ('cycles', ctypes.c_int),
+        ('last_cycle_us', ctypes.c_uint64),
+    ]
+
+HAL_MAX_POINTS = 256
+HAL_SCHED_SLAVE_UART_DI = -1
+# 歷史紀錄層級與容量 (對應 hal_history.h)
+HAL_HISTORY_RAW = 0
+HAL_HISTORY_1S = 1
+HAL_HISTORY_1MIN = 2
+HAL_HISTORY_RAW_SIZE = 256
+HAL_HISTORY_SEC_SIZE = 600
+HAL_HISTORY_MIN_SIZE = 1440
+_HISTORY_TIERS = {'raw': HAL_HISTORY_RAW, '1s': HAL_HISTORY_1S, '1min': HAL_HISTORY_1MIN}
+HAL_SHM_DEFAULT_NAME = 'cdu_hal_snapshot'
+HAL_MAX_PORTS = 8
+HAL_STATS_MAX_ENTRIES = 64
+_LATENCY_KINDS = ('write', 'first_byte', 'frame')
+
+# 獲取當前腳本所在目錄的父目錄（項目根目錄）
+PROJECT_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# 根據作業系統選擇正確的庫文件
+if platform.system() == "Windows":
+    HAL_LIB_PATH = os.path.join(PROJECT_ROOT, 'hal', 'lib-cdu-hal.dll')
+else:
+    HAL_LIB_PATH = os.path.join(PROJECT_ROOT, 'hal', 'lib-cdu-hal.so')
+
+try:
+    hal_lib = ctypes.CDLL(HAL_LIB_PATH)
+    hal_lib.hal_point_register.restype = ctypes.c_int
+    hal_lib.hal_point_register.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_float]
+    hal_lib.hal_sim_default_config.restype = None
+    hal_lib.hal_sim_default_config.argtypes = [ctypes.POINTER(HalSimConfig)]
+    hal_lib.hal_sim_route_all.restype = ctypes.c_int
+    hal_lib.hal_sim_route_all.argtypes = [ctypes.c_int]
+    hal_lib.hal_sim_configure.restype = ctypes.c_int
+    hal_lib.hal_sim_configure.argtypes = [ctypes.c_char_p, ctypes.POINTER(HalSimConfig)]
+    hal_lib.hal_sim_add_slave.restype = ctypes.c_int
+    hal_lib.hal_sim_add_slave.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_int]
+    hal_lib.hal_sim_set_register.restype = ctypes.c_int
+    hal_lib.hal_sim_set_register.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_uint16]
+    hal_lib.hal_sim_set_turnaround.restype = ctypes.c_int
+    hal_lib.hal_sim_set_turnaround.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
+    hal_lib.hal_port_get.restype = ctypes.c_void_p
+    hal_lib.hal_port_get.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    hal_lib.hal_port_configure.restype = ctypes.c_int
+    hal_lib.hal_port_configure.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_char, ctypes.c_int]
+    hal_lib.hal_port_get_line.restype = ctypes.c_int
+    hal_lib.hal_port_get_line.argtypes = [ctypes.c_void_p, ctypes.POINTER(HalPortLine)]
+    hal_lib.hal_port_turnaround.restype = ctypes.c_int
+    hal_lib.hal_port_turnaround.argtypes = [ctypes.c_void_p, ctypes.c_int]
+    hal_lib.hal_point_register_di.restype = ctypes.c_int
+    hal_lib.hal_point_register_di.argtypes = [ctypes.c_char_p]
+    hal_lib.hal_di_read_pin.restype = ctypes.c_int
+    hal_lib.hal_di_read_pin.argtypes = [ctypes.c_int, ctypes.c_int]
+    hal_lib.hal_uart_watch_pin.restype = ctypes.c_int
+    hal_lib.hal_uart_watch_pin.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    hal_lib.hal_point_register_plc.restype = ctypes.c_int
+    hal_lib.hal_point_register_plc.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_float]
+    hal_lib.hal_slmp_read.restype = ctypes.c_int
+    hal_lib.hal_slmp_read.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int,
+                                      ctypes.POINTER(ctypes.c_uint16)]
+    hal_lib.hal_point_set_rate.restype = ctypes.c_int
+    hal_lib.hal_point_set_rate.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int]
+    hal_lib.hal_point_set_deadband.restype = ctypes.c_int
+    hal_lib.hal_point_set_deadband.argtypes = [ctypes.c_int, ctypes.c_float, ctypes.c_float]
+    hal_lib.hal_discover_default_config.restype = None
+    hal_lib.hal_discover_default_config.argtypes = [ctypes.POINTER(HalDiscoverConfig)]
+    hal_lib.hal_discover_run.restype = ctypes.c_int
+    hal_lib.hal_discover_run.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+                                         ctypes.POINTER(HalDiscoverConfig), ctypes.c_char_p]
+    hal_lib.hal_discover_get.restype = ctypes.c_int
+    hal_lib.hal_discover_get.argtypes = [ctypes.c_char_p, ctypes.POINTER(HalDiscoverPort)]
+    hal_lib.hal_discover_present.restype = ctypes.c_int
+    hal_lib.hal_discover_present.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    hal_lib.hal_discover_tune_turnaround.restype = ctypes.c_int
+    hal_lib.hal_discover_tune_turnaround.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
+    hal_lib.hal_point_set_filter.restype = ctypes.c_int
+    hal_lib.hal_point_set_filter.argtypes = [ctypes.c_int, ctypes.POINTER(HalFilterConfig)]
+    hal_lib.hal_wait_changes.restype = ctypes.c_int
+    hal_lib.hal_wait_changes.argtypes = [ctypes.c_int]
+    hal_lib.hal_drain_changes.restype = ctypes.c_int
+    hal_lib.hal_drain_changes.argtypes = [ctypes.POINTER(HalChange), ctypes.c_int]
+    hal_lib.hal_submit.restype = ctypes.c_uint64
+    hal_lib.hal_submit.argtypes = [ctypes.POINTER(HalRequest)]
+    hal_lib.hal_completion_fd.restype = ctypes.c_ssize_t
+    hal_lib.hal_completion_fd.argtypes = []
+    hal_lib.hal_wait_completions.restype = ctypes.c_int
+    hal_lib.hal_wait_completions.argtypes = [ctypes.c_int]
+    hal_lib.hal_drain_completions.restype = ctypes.c_int
+    hal_lib.hal_drain_completions.argtypes = [ctypes.POINTER(HalCompletion), ctypes.c_int]
+    hal_lib.hal_async_pending.restype = ctypes.c_int
+    hal_lib.hal_async_pending.argtypes = []
+    hal_lib.hal_async_stop.restype = None
+    hal_lib.hal_async_stop.argtypes = []
+    hal_lib.hal_telemetry_configure.restype = ctypes.c_int
+    hal_lib.hal_telemetry_configure.argtypes = [ctypes.POINTER(HalTelemetryConfig)]
+    hal_lib.hal_telemetry_capture.restype = ctypes.c_int
+    hal_lib.hal_telemetry_capture.argtypes = [ctypes.c_uint64]
+    hal_lib.hal_telemetry_flush.restype = ctypes.c_int
+    hal_lib.hal_telemetry_flush.argtypes = []
+    hal_lib.hal_telemetry_frame.restype = ctypes.c_void_p
+    hal_lib.hal_telemetry_frame.argtypes = [ctypes.POINTER(ctypes.c_uint32)]
+    hal_lib.hal_telemetry_request_keyframe.restype = None
+    hal_lib.hal_telemetry_request_keyframe.argtypes = []
+    hal_lib.hal_telemetry_decode.restype = ctypes.c_int
+    hal_lib.hal_telemetry_decode.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.POINTER(HalTelemetryInfo)]
+    hal_lib.hal_telemetry_peer_read.restype = ctypes.c_int
+    hal_lib.hal_telemetry_peer_read.argtypes = [ctypes.c_int, ctypes.POINTER(HalBatch)]
+    hal_lib.hal_telemetry_reset.restype = None
+    hal_lib.hal_telemetry_reset.argtypes = []
+    hal_lib.hal_change_overflows.restype = ctypes.c_uint64
+    hal_lib.hal_change_overflows.argtypes = []
+    hal_lib.hal_point_read.restype = ctypes.c_int
+    hal_lib.hal_point_read.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_float)]
+    hal_lib.hal_sched_set_max_gap.restype = None
+    hal_lib.hal_sched_set_max_gap.argtypes = [ctypes.c_int]
+    hal_lib.hal_write_get_status.restype = ctypes.c_int
+    hal_lib.hal_write_get_status.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(HalWriteStatus)]
+    hal_lib.hal_ptable_load_builtin.restype = ctypes.c_int
+    hal_lib.hal_ptable_load_builtin.argtypes = []
+    hal_lib.hal_ptable_load.restype = ctypes.c_int
+    hal_lib.hal_ptable_load.argtypes = [ctypes.c_char_p]
+    hal_lib.hal_ptable_save.restype = ctypes.c_int
+    hal_lib.hal_ptable_save.argtypes = [ctypes.c_char_p]
+    hal_lib.hal_sched_poll.restype = ctypes.c_int
+    hal_lib.hal_sched_poll.argtypes = []
+    hal_lib.hal_get_snapshot.restype = ctypes.c_int
+    hal_lib.hal_get_snapshot.argtypes = [ctypes.c_int, ctypes.POINTER(HalSample)]
+    hal_lib.hal_read_all.restype = ctypes.c_int
+    hal_lib.hal_read_all.argtypes = [ctypes.POINTER(HalBatch)]
+    hal_lib.hal_acq_start.restype = ctypes.c_int
+    hal_lib.hal_acq_start.argtypes = [ctypes.c_int]
+    hal_lib.hal_acq_stop.restype = None
+    hal_lib.hal_acq_stop.argtypes = []
+    hal_lib.hal_acq_set_affinity.restype = ctypes.c_int
+    hal_lib.hal_acq_set_affinity.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    hal_lib.hal_acq_stats.restype = ctypes.c_int
+    hal_lib.hal_acq_stats.argtypes = [ctypes.POINTER(HalAcqStats), ctypes.c_int]
+    hal_lib.hal_log_set_level.restype = None
+    hal_lib.hal_log_set_level.argtypes = [ctypes.c_int]
+    hal_lib.hal_log_set_sink.restype = None
+    hal_lib.hal_log_set_sink.argtypes = [ctypes.c_int]
+    hal_lib.hal_log_drain.restype = ctypes.c_int
+    hal_lib.hal_log_drain.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    hal_lib.hal_slmp_parse_device.restype = ctypes.c_int
+    hal_lib.hal_slmp_parse_device.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_int),
+                                              ctypes.POINTER(ctypes.c_int)]
+    hal_lib.hal_shm_publish.restype = ctypes.c_int
+    hal_lib.hal_shm_publish.argtypes = [ctypes.c_char_p]
+    hal_lib.hal_shm_unpublish.restype = None
+    hal_lib.hal_shm_unpublish.argtypes = []
+    hal_lib.hal_shm_open.restype = ctypes.c_void_p
+    hal_lib.hal_shm_open.argtypes = [ctypes.c_char_p]
+    hal_lib.hal_shm_close.restype = None
+    hal_lib.hal_shm_close.argtypes = [ctypes.c_void_p]
+    hal_lib.hal_shm_find.restype = ctypes.c_int
+    hal_lib.hal_shm_find.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int,
+                                     ctypes.c_int, ctypes.c_float]
+    hal_lib.hal_shm_get.restype = ctypes.c_int
+    hal_lib.hal_shm_get.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(HalSample)]
+    hal_lib.hal_shm_read_all.restype = ctypes.c_int
+    hal_lib.hal_shm_read_all.argtypes = [ctypes.c_void_p, ctypes.POINTER(HalBatch)]
+    hal_lib.hal_history_read_raw.restype = ctypes.c_int
+    hal_lib.hal_history_read_raw.argtypes = [ctypes.c_int, ctypes.c_uint64, ctypes.c_uint64,
+                                             ctypes.POINTER(HalHistorySample), ctypes.c_int]
+    hal_lib.hal_history_read_buckets.restype = ctypes.c_int
+    hal_lib.hal_history_read_buckets.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_uint64, ctypes.c_uint64,
+                                                 ctypes.POINTER(HalHistoryBucket), ctypes.c_int]
+    hal_lib.hal_ctrl_default_config.restype = None
+    hal_lib.hal_ctrl_default_config.argtypes = [ctypes.POINTER(HalCtrlConfig)]
+    hal_lib.hal_ctrl_add.restype = ctypes.c_int
+    hal_lib.hal_ctrl_add.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.POINTER(HalCtrlConfig)]
+    hal_lib.hal_ctrl_set_target.restype = ctypes.c_int
+    hal_lib.hal_ctrl_set_target.argtypes = [ctypes.c_int, ctypes.c_float]
+    hal_lib.hal_ctrl_set_gains.restype = ctypes.c_int
+    hal_lib.hal_ctrl_set_gains.argtypes = [ctypes.c_int, ctypes.c_float, ctypes.c_float, ctypes.c_float]
+    hal_lib.hal_ctrl_enable.restype = ctypes.c_int
+    hal_lib.hal_ctrl_enable.argtypes = [ctypes.c_int, ctypes.c_int]
+    hal_lib.hal_ctrl_status.restype = ctypes.c_int
+    hal_lib.hal_ctrl_status.argtypes = [ctypes.c_int, ctypes.POINTER(HalCtrlStatus)]
+    hal_lib.hal_ctrl_count.restype = ctypes.c_int
+    hal_lib.hal_ctrl_count.argtypes = []
+    hal_lib.hal_ctrl_start.restype = ctypes.c_int
+    hal_lib.hal_ctrl_start.argtypes = [ctypes.c_int]
+    hal_lib.hal_ctrl_stop.restype = None
+    hal_lib.hal_ctrl_stop.argtypes = []
+    hal_lib.hal_ctrl_thread_stats.restype = ctypes.c_int
+    hal_lib.hal_ctrl_thread_stats.argtypes = [ctypes.POINTER(HalCtrlThreadStats)]
+    hal_lib.hal_get_stats.restype = ctypes.c_int
+    hal_lib.hal_get_stats.argtypes = [ctypes.POINTER(HalStats), ctypes.c_int]
+    hal_lib.hal_stats_reset.restype = None
+    hal_lib.hal_stats_reset.argtypes = []
+    # HAL 日誌寫入無鎖 ring buffer，由 forward_log() 在控制迴圈之外轉交 Python logging
+    hal_lib.hal_log_set_sink(HAL_LOG_SINK_RING)
+    logging.info(f"Successfully loaded HAL scheduler from: {HAL_LIB_PATH}")
+except (OSError, AttributeError) as e:
+    logging.error(f"HAL scheduler unavailable: {e}. Blocks fall back to direct reads.")
+    hal_lib = None
+
+_point_count = 0
+
+# 每個控制週期由 refresh() 以一次 FFI 呼叫填滿的 struct-of-arrays 緩衝區 (只配置一次)
+_values = (ctypes.c_float * HAL_MAX_POINTS)()
+_raw = (ctypes.c_uint32 * HAL_MAX_POINTS)()
+_quality = (ctypes.c_uint32 * HAL_MAX_POINTS)()
+_timestamp_us = (ctypes.c_uint64 * HAL_MAX_POINTS)()
+_batch = HalBatch(HAL_MAX_POINTS, _values, _raw, _quality, _timestamp_us)
+_batch_ref = ctypes.byref(_batch)
+_batch_count = 0
+_changes = (HalChange * HAL_MAX_POINTS)()
+_completions = (HalCompletion * HAL_ASYNC_MAX_INFLIGHT)()
+# 其他節點遙測的讀取緩衝區 (與 _batch 分開，讀取不會影響本機的 refresh() 結果)
+_peer_values = (ctypes.c_float * HAL_MAX_POINTS)()
+_peer_quality = (ctypes.c_uint32 * HAL_MAX_POINTS)()
+_peer_timestamp_us = (ctypes.c_uint64 * HAL_MAX_POINTS)()
+_peer_batch = HalBatch(HAL_MAX_POINTS, _peer_values, None, _peer_quality, _peer_timestamp_us)
+_log_buffer = ctypes.create_string_buffer(16384)
+# 歷史查詢的輸出緩衝區，大小等於各層容量 (只配置一次，查詢不會超過)
+_history_raw = (HalHistorySample * HAL_HISTORY_RAW_SIZE)()
+_history_buckets = (HalHistoryBucket * max(HAL_HISTORY_SEC_SIZE, HAL_HISTORY_MIN_SIZE))()
+_hal_logger = logging.getLogger('hal')
+
+# 共享快照的讀取端：register_*() 返回 _shared_defs 的索引，
+# _shared_handles 為對應的快照表 handle (-1 表示擷取程序尚未登錄)，每次 refresh() 補齊
+_shared_name = None
+_shared_reader = None
+_shared_defs = []
+_shared_handles = []
+
+
+def available():
+    """HAL 排程器是否可用"""
+    return hal_lib is not None
+
+
+def configure_simulator(sim_config):
+    """依 cdu_config.yaml 的 HAL.simulator 設定模擬匯流排，必須在 Block 註冊量測點之前呼叫
+    enabled 為 true 時所有非 TCP device 都接到模擬匯流排；"sim://" device 不需啟用也會使用模擬器
+    其餘鍵值 (latency_us、jitter_us、timeout_ppm、seed ...) 對應 hal_sim_config_t，返回是否啟用"""
+    if hal_lib is None or not sim_config:
+        return False
+    cfg = HalSimConfig()
+    hal_lib.hal_sim_default_config(ctypes.byref(cfg))
+    for name, _ in HalSimConfig._fields_:
+        if name in sim_config:
+            setattr(cfg, name, int(sim_config[name]))
+    hal_lib.hal_sim_configure(None, ctypes.byref(cfg))
+    enabled = bool(sim_config.get('enabled', False))
+    hal_lib.hal_sim_route_all(1 if enabled else 0)
+    if enabled:
+        logging.warning("HAL simulator enabled: all serial devices are routed to simulated buses")
+    return enabled
+
+
+def set_sim_register(device, slave, register, value):
+    """改變模擬 slave 的暫存器內容 (測試用)，成功返回 True"""
+    if hal_lib is None:
+        return False
+    return hal_lib.hal_sim_set_register(device.encode('utf-8'), int(slave), int(register),
+                                        int(value) & 0xFFFF) == 0
+
+
+def set_sim_turnaround(device, slave, turnaround_us):
+    """設定模擬 slave 需要的轉向時間 (測試自動調整用)，成功返回 True"""
+    if hal_lib is None:
+        return False
+    return hal_lib.hal_sim_set_turnaround(device.encode('utf-8'), int(slave), int(turnaround_us)) == 0
+
+
+def register_point(device, slave, register, value_type=HAL_VALUE_U16, scale=1.0,
+                   poll_period_ms=0, priority=0, deadband=0.0, hysteresis=0.0, filter=None):
+    """註冊一個量測點，返回 handle；排程器不可用或註冊失敗時返回 None
+    poll_period_ms 為 0 時使用背景擷取的 acquisition_period_ms，priority 越大越優先
+    deadband / hysteresis (工程單位) 決定 wait_changes() 何時回報這個量測點
+    filter 為 set_point_filter 參數的 dict (例如 {'median': 3, 'ema_alpha': 0.2})"""
+    global _point_count
+    if hal_lib is None:
+        return None
+    if _shared_name is not None:
+        return _shared_register(device, slave, register, value_type, scale)
+    handle = hal_lib.hal_point_register(device.encode('utf-8'), int(slave), int(register),
+                                        int(value_type), float(scale))
+    if handle < 0:
+        logging.error(f"Failed to register HAL point {device} slave {slave} reg {register}")
+        return None
+    if (poll_period_ms or priority) and hal_lib.hal_point_set_rate(handle, int(poll_period_ms or 0),
+                                                                   int(priority or 0)) != 0:
+        logging.warning(f"Failed to set poll rate for HAL point {device} slave {slave} reg {register}")
+    if (deadband or hysteresis) and hal_lib.hal_point_set_deadband(handle, float(deadband or 0.0),
+                                                                   float(hysteresis or 0.0)) != 0:
+        logging.warning(f"Failed to set deadband for HAL point {device} slave {slave} reg {register}")
+    if filter and not set_point_filter(handle, **filter):
+        logging.warning(f"Failed to set filter for HAL point {device} slave {slave} reg {register}")
+    _point_count += 1
+    return handle
+
+
+def register_di(device, poll_period_ms=0, priority=0, pins=()):
+    """註冊 device 上 UART DI/DO 板的輸入 bitmap，返回 handle；同一 device 的所有 pin 共用一個 handle
+    pins 為會用到的 pin (1-32)：板子不支援整板讀取時 HAL 只逐一讀取登錄過的 pin
+    排程器不可用或註冊失敗時返回 None"""
+    global _point_count
+    if hal_lib is None:
+        return None
+    if _shared_name is not None:
+        return _shared_register(device, HAL_SCHED_SLAVE_UART_DI, 0, HAL_VALUE_U32, 1.0)
+    handle = hal_lib.hal_point_register_di(device.encode('utf-8'))
+    if handle < 0:
+        logging.error(f"Failed to register HAL DI point on {device}")
+        return None
+    if (poll_period_ms or priority) and hal_lib.hal_point_set_rate(handle, int(poll_period_ms or 0),
+                                                                   int(priority or 0)) != 0:
+        logging.warning(f"Failed to set poll rate for HAL DI point on {device}")
+    for pin in pins:
+        if hal_lib.hal_uart_watch_pin(device.encode('utf-8'), int(pin)) != 0:
+            logging.warning(f"Failed to watch DI pin {pin} on {device}")
+    _point_count += 1
+    return handle
+
+
+def register_plc_point(endpoint, address, value_type=HAL_VALUE_U16, scale=1.0,
+                       poll_period_ms=0, priority=0, deadband=0.0, hysteresis=0.0, filter=None):
+    """註冊三菱 PLC 的一個 word 裝置 (endpoint 為 "slmp://host[:port]"，address 例如 "R10020")，返回 handle
+    同一 PLC 上的所有裝置由排程器合併，每個週期以一個 SLMP frame 讀回；失敗時返回 None"""
+    global _point_count
+    if hal_lib is None:
+        return None
+    if _shared_name is not None:
+        code = ctypes.c_int()
+        number = ctypes.c_int()
+        if hal_lib.hal_slmp_parse_device(address.encode('utf-8'), ctypes.byref(code), ctypes.byref(number)) != 0:
+            logging.error(f"Invalid PLC point {endpoint} {address}")
+            return None
+        return _shared_register(endpoint, code.value, number.value, value_type, scale)
+    handle = hal_lib.hal_point_register_plc(endpoint.encode('utf-8'), address.encode('utf-8'),
+                                            int(value_type), float(scale))
+    if handle < 0:
+        logging.error(f"Failed to register HAL PLC point {endpoint} {address}")
+        return None
+    if (poll_period_ms or priority) and hal_lib.hal_point_set_rate(handle, int(poll_period_ms or 0),
+                                                                   int(priority or 0)) != 0:
+        logging.warning(f"Failed to set poll rate for HAL PLC point {endpoint} {address}")
+    if (deadband or hysteresis) and hal_lib.hal_point_set_deadband(handle, float(deadband or 0.0),
+                                                                   float(hysteresis or 0.0)) != 0:
+        logging.warning(f"Failed to set deadband for HAL PLC point {endpoint} {address}")
+    if filter and not set_point_filter(handle, **filter):
+        logging.warning(f"Failed to set filter for HAL PLC point {endpoint} {address}")
+    _point_count += 1
+    return handle
+
+
+def set_point_filter(handle, median=1, ema_alpha=1.0, max_rate=0.0, gain=1.0, offset=0.0):
+    """設定量測點的訊號調理 (在 C 端寫入快照表之前執行)，成功返回 True
+    median 為 1/3/5，ema_alpha 在 (0, 1]，max_rate 為每秒最大變化量 (0 不限制)，
+    輸出 = 濾波後的值 * gain + offset；handle 為 None 或讀取端模式時返回 False"""
+    if hal_lib is None or handle is None or _shared_name is not None:
+        return False
+    cfg = HalFilterConfig(int(median), float(ema_alpha), float(max_rate), float(gain), float(offset))
+    return hal_lib.hal_point_set_filter(int(handle), ctypes.byref(cfg)) == 0
+
+
+def read_plc(endpoint, address, count=1):
+    """立即以 SLMP 讀取 address 開始的 count 個 word (1-125)，返回整數列表，失敗時返回 None"""
+    if hal_lib is None or not 1 <= count <= 125:
+        return None
+    buf = (ctypes.c_uint16 * count)()
+    if hal_lib.hal_slmp_read(endpoint.encode('utf-8'), address.encode('utf-8'), int(count), buf) != 0:
+        return None
+    return list(buf)
+
+
+def configure_shared_snapshot(shared_config):
+    """依 cdu_config.yaml 的 HAL.shared_snapshot 設定共享快照，必須在 Block 註冊量測點之前呼叫
+    role 為 publisher 時本程序擷取並發布，reader 時只讀取其他程序發布的快照表；返回 role 或 None"""
+    if hal_lib is None or not shared_config:
+        return None
+    role = shared_config.get('role', 'publisher')
+    name = shared_config.get('name') or HAL_SHM_DEFAULT_NAME
+    if role == 'reader':
+        return role if attach_snapshot(name) else None
+    if role != 'publisher':
+        logging.error(f"Unknown HAL shared_snapshot role '{role}'")
+        return None
+    return role if publish_snapshot(name) else None
+
+
+def publish_snapshot(name=None):
+    """把快照表發布成具名共享記憶體 (擷取程序呼叫，需在 start_acquisition() 之前)，成功返回 True"""
+    if hal_lib is None:
+        return False
+    if hal_lib.hal_shm_publish((name or HAL_SHM_DEFAULT_NAME).encode('utf-8')) != 0:
+        logging.error(f"Failed to publish HAL shared snapshot '{name or HAL_SHM_DEFAULT_NAME}'")
+        return False
+    logging.info(f"HAL snapshot table published as shared memory '{name or HAL_SHM_DEFAULT_NAME}'")
+    return True
+
+
+def attach_snapshot(name=None):
+    """改為讀取擷取程序發布的共享快照 (需在 Block 註冊量測點之前呼叫)，返回 True 表示已切換為讀取端
+    擷取程序尚未啟動時仍會切換，之後每次 refresh() 重試映射"""
+    global _shared_name
+    if hal_lib is None:
+        return False
+    _shared_name = name or HAL_SHM_DEFAULT_NAME
+    if _shared_open() is None:
+        logging.warning(f"HAL shared snapshot '{_shared_name}' not published yet, will retry")
+    else:
+        logging.info(f"Attached to HAL shared snapshot '{_shared_name}'")
+    return True
+
+
+def _shared_open():
+    global _shared_reader
+    if _shared_reader is None:
+        reader = hal_lib.hal_shm_open(_shared_name.encode('utf-8'))
+        _shared_reader = reader if reader else None
+    return _shared_reader
+
+
+def _shared_close():
+    global _shared_reader, _batch_count
+    if _shared_reader is not None:
+        hal_lib.hal_shm_close(_shared_reader)
+        _shared_reader = None
+    # 擷取程序重新啟動後 handle 可能改變
+    for i in range(len(_shared_handles)):
+        _shared_handles[i] = -1
+    _batch_count = 0
+
+
+def _shared_register(device, slave, register, value_type, scale):
+    key = (device.encode('utf-8'), int(slave), int(register), int(value_type), float(scale))
+    if key in _shared_defs:
+        return _shared_defs.index(key)
+    _shared_defs.append(key)
+    _shared_handles.append(-1)
+    _shared_resolve()
+    return len(_shared_defs) - 1
+
+
+def _shared_resolve():
+    if _shared_open() is None:
+        return
+    for i, handle in enumerate(_shared_handles):
+        if handle < 0:
+            _shared_handles[i] = hal_lib.hal_shm_find(_shared_reader, *_shared_defs[i])
+
+
+def _shared_slot(handle):
+    """讀取端：把 register_*() 返回的 handle 轉為快照表 handle，尚未登錄時返回 -1"""
+    if handle is None or not 0 <= handle < len(_shared_handles):
+        return -1
+    return _shared_handles[handle]
+
+
+def _expected_slaves(blocks_config):
+    """FunctionBlocks 中設定的 {device: {modbus_address, ...}}"""
+    expected = {}
+    for block in blocks_config or []:
+        if block.get('modbus_address') is not None and block.get('device'):
+            expected.setdefault(block['device'], set()).add(int(block['modbus_address']))
+    return expected
+
+
+def configure_ports(ports_config, blocks_config):
+    """依 cdu_config.yaml 的 HAL.ports 設定各串口的 baud / parity / stop_bits，必須在 Block 註冊量測點之前呼叫
+    autotune 為 true 時對 FunctionBlocks 中該串口的每個 slave 量測最短轉向時間
+    返回 {device: port_line(device)}，讀取端模式或沒有設定時返回 {}"""
+    if hal_lib is None or not ports_config or _shared_name is not None:
+        return {}
+    expected = _expected_slaves(blocks_config)
+    lines = {}
+    for device, port_config in ports_config.items():
+        port_config = port_config or {}
+        parity = str(port_config.get('parity', 'N')).upper()[:1]
+        if hal_lib.hal_port_configure(str(device).encode('utf-8'), int(port_config.get('baud', 9600)),
+                                      parity.encode('ascii'), int(port_config.get('stop_bits', 1))) != 0:
+            logging.error(f"Invalid line settings for {device}: {port_config}")
+            continue
+        if port_config.get('autotune'):
+            for slave in sorted(expected.get(device, ())):
+                if tune_turnaround(device, slave, port_config.get('probe_timeout_ms', 50)) is None:
+                    logging.warning(f"Slave {slave} on {device} did not respond to turnaround tuning")
+        lines[device] = port_line(device)
+    return lines
+
+
+def port_line(device):
+    """串口的線路設定與字元時序 {baud, parity, stop_bits, char_us, t15_us, t35_us, frame_gap_us}，
+    TCP 端點返回 None"""
+    if hal_lib is None:
+        return None
+    port = hal_lib.hal_port_get(str(device).encode('utf-8'), 0)
+    line = HalPortLine()
+    if not port or hal_lib.hal_port_get_line(port, ctypes.byref(line)) != 0:
+        return None
+    return {
+        'baud': line.baud,
+        'parity': line.parity.decode('ascii'),
+        'stop_bits': line.stop_bits,
+        'char_us': line.char_us,
+        't15_us': line.t15_us,
+        't35_us': line.t35_us,
+        'frame_gap_us': line.frame_gap_us,
+    }
+
+
+def tune_turnaround(device, slave, probe_timeout_ms=50):
+    """量測 slave 可接受的最短轉向時間並套用到串口，返回微秒數；slave 沒有回應時返回 None"""
+    if hal_lib is None:
+        return None
+    turnaround = hal_lib.hal_discover_tune_turnaround(str(device).encode('utf-8'), int(slave),
+                                                      int(probe_timeout_ms))
+    return None if turnaround < 0 else turnaround
+
+
+def configure_discovery(discovery_config, blocks_config):
+    """依 cdu_config.yaml 的 HAL.discovery 在 Block 註冊量測點之前探測匯流排
+    devices 未指定時取 FunctionBlocks 中有 modbus_address 的串口 device (TCP 端點需明確列出)；
+    設定的 slave 沒有回應時記錄警告。返回 discover() 的結果，未啟用或讀取端模式時返回 None"""
+    if hal_lib is None or not discovery_config or not discovery_config.get('enabled', True):
+        return None
+    if _shared_name is not None:
+        return None
+    expected = _expected_slaves(blocks_config)
+    devices = discovery_config.get('devices') or [d for d in expected if not d.startswith(('tcp://', 'slmp://'))]
+    if not devices:
+        return None
+    slave_range = discovery_config.get('slave_range') or (1, HAL_DISCOVER_MAX_ADDRESS)
+    register_range = discovery_config.get('register_range') or (0, -1)
+    topology = discover(devices, discovery_config.get('cache'),
+                        slave_first=slave_range[0], slave_last=slave_range[1],
+                        probe_timeout_ms=discovery_config.get('probe_timeout_ms', 50),
+                        retries=discovery_config.get('retries', 1),
+                        reg_first=register_range[0], reg_last=register_range[1],
+                        reg_block=discovery_config.get('register_block', 16),
+                        tune_turnaround=discovery_config.get('tune_turnaround', True))
+    if topology is None:
+        return None
+    for device, slaves in expected.items():
+        for slave in sorted(slaves):
+            if slave_present(device, slave) is False:
+                logging.warning(f"Configured slave {slave} on {device} did not respond to discovery")
+    return topology
+
+
+def discover(devices, cache_path=None, slave_first=1, slave_last=HAL_DISCOVER_MAX_ADDRESS,
+             probe_timeout_ms=50, retries=1, reg_first=0, reg_last=-1, reg_block=16, tune_turnaround=True):
+    """同時探測 devices 上的 slave (每個 port 一條執行緒)，cache_path 不為 None 時以快取加速並寫回
+    返回 {device: discovery_topology(device)}，參數無效或探測進行中返回 None"""
+    if hal_lib is None or not devices:
+        return None
+    names = (ctypes.c_char_p * len(devices))(*[d.encode('utf-8') for d in devices])
+    cfg = HalDiscoverConfig(int(slave_first), int(slave_last), int(probe_timeout_ms), int(retries),
+                            int(reg_first), int(reg_last), int(reg_block), 1 if tune_turnaround else 0)
+    total = hal_lib.hal_discover_run(names, len(devices), ctypes.byref(cfg),
+                                     cache_path.encode('utf-8') if cache_path else None)
+    if total < 0:
+        logging.error("HAL bus discovery failed")
+        return None
+    return {device: discovery_topology(device) for device in devices}
+
+
+def discovery_topology(device):
+    """device 的探測結果：slaves 為 [{'slave', 'response_us', 'turnaround_us', 'ranges': [(start, count), ...]}]，
+    另有 frame_gap_us、from_cache、elapsed_ms；尚未探測時返回 None"""
+    if hal_lib is None:
+        return None
+    port = HalDiscoverPort()
+    if hal_lib.hal_discover_get(device.encode('utf-8'), ctypes.byref(port)) != 0:
+        return None
+    slaves = []
+    for s in port.slaves[:port.n_slaves]:
+        slaves.append({
+            'slave': s.slave,
+            'response_us': s.response_us,
+            'turnaround_us': s.turnaround_us,
+            'ranges': [(r.start, r.count) for r in s.ranges[:s.n_ranges]],
+        })
+    return {
+        'slaves': slaves,
+        'slave_range': (port.slave_first, port.slave_last),
+        'frame_gap_us': port.frame_gap_us,
+        'from_cache': bool(port.from_cache),
+        'elapsed_ms': port.elapsed_ms,
+        'discovered_us': port.discovered_us,
+    }
+
+
+def slave_present(device, slave):
+    """探測結果中 slave 是否存在，device 未探測或 slave 不在探測範圍內時返回 None"""
+    if hal_lib is None:
+        return None
+    present = hal_lib.hal_discover_present(device.encode('utf-8'), int(slave))
+    return None if present < 0 else bool(present)
+
+
+def write_status(device, slave=-1):
+    """寫入佇列對 device 上 slave (-1 為所有 slave) 的送出結果：
+    {'queued', 'written', 'failed', 'last_status', 'last_error_reg', 'last_error_us'}
+    寫入排入佇列後才送出，呼叫端以 failed 的增加判斷設定值是否沒有到達設備；尚未寫入過或不可用時返回 None"""
+    if hal_lib is None:
+        return None
+    port = hal_lib.hal_port_get(str(device).encode('utf-8'), 0)
+    status = HalWriteStatus()
+    if not port or hal_lib.hal_write_get_status(port, int(slave), ctypes.byref(status)) != 0:
+        return None
+    return {name: getattr(status, name) for name, _ in HalWriteStatus._fields_}
+
+
+def set_max_gap(registers):
+    """設定合併門檻 (兩個量測點之間可容許的未使用暫存器數量)"""
+    if hal_lib is not None:
+        hal_lib.hal_sched_set_max_gap(int(registers))
+
+
+def configure_point_table(point_table):
+    """依 cdu_config.yaml 的 HAL.point_table 安裝預先編譯的量測點表 (hal/hal_ptable.h)，必須在 Block 註冊量測點之前呼叫
+    'builtin' 使用函式庫內建的表 (make point-table)，其他值為 make point-table-bin 產生的二進位檔路徑
+    之後 Block 以相同定義註冊會得到表中的 handle，不重建計畫；安裝成功返回 True"""
+    if hal_lib is None or not point_table or _shared_name is not None:
+        return False
+    if point_table == 'builtin':
+        ok = hal_lib.hal_ptable_load_builtin() == 0
+    else:
+        path = point_table if os.path.isabs(point_table) else os.path.join(PROJECT_ROOT, point_table)
+        ok = hal_lib.hal_ptable_load(path.encode('utf-8')) == 0
+    if not ok:
+        logging.warning(f"HAL point table '{point_table}' not installed, points are registered from the config")
+    return ok
+
+
+def save_point_table(path):
+    """把目前註冊的量測點與排程計畫寫成二進位量測點表 (tools/gen_point_table.py 使用)，成功返回 True"""
+    if hal_lib is None:
+        return False
+    return hal_lib.hal_ptable_save(str(path).encode('utf-8')) == 0
+
+
+def start_acquisition(period_ms=1000, cpu_affinity=None):
+    """啟動 HAL 背景擷取執行緒 (每個串口一個)，成功返回 True
+    cpu_affinity 為 {device: cpu} 對照表，指定的串口執行緒會綁定到該 CPU
+    共享快照的讀取端不擷取，返回 False"""
+    if hal_lib is None or _point_count == 0 or _shared_name is not None:
+        return False
+    for device, cpu in (cpu_affinity or {}).items():
+        if hal_lib.hal_acq_set_affinity(str(device).encode('utf-8'), int(cpu)) != 0:
+            logging.warning(f"Failed to set CPU affinity {cpu} for {device}")
+    started = hal_lib.hal_acq_start(int(period_ms))
+    if started < 0:
+        logging.error("Failed to start HAL acquisition threads")
+        return False
+    logging.info(f"HAL acquisition started with {started} port thread(s), period {period_ms} ms")
+    return True
+
+
+def stop_acquisition():
+    """停止控制執行緒與 HAL 背景擷取執行緒 (並結束共享快照的發布)"""
+    if hal_lib is not None:
+        hal_lib.hal_ctrl_stop()
+        hal_lib.hal_acq_stop()
+        hal_lib.hal_shm_unpublish()
+
+
+def acquisition_stats():
+    """讀取每個擷取執行緒的週期統計，返回 dict 列表；未運作時返回空列表"""
+    if hal_lib is None:
+        return []
+    entries = (HalAcqStats * HAL_MAX_PORTS)()
+    n = hal_lib.hal_acq_stats(entries, HAL_MAX_PORTS)
+    return [{
+        'device': entry.device.decode('utf-8', errors='replace'),
+        'cpu': entry.cpu,
+        'period_ms': entry.period_ms,
+        'cycles': entry.cycles,
+        'overruns': entry.overruns,
+        'last_cycle_us': entry.last_cycle_us,
+        'max_cycle_us': entry.max_cycle_us,
+    } for entry in entries[:n]]
+
+
+def add_control_loop(device, slave, register, pv_handle, setpoint, kp=1.0, ki=0.0, kd=0.0,
+                     out_min=0.0, out_max=65535.0, bias=0.0, out_scale=1.0,
+                     ff_handle=None, ff_gain=0.0, ff_ref=0.0, stale_periods=5):
+    """新增一個原生 PID 迴圈：讀取 pv_handle (與選用的前饋量測點 ff_handle)，
+    把輸出寫到 device 上 slave 的 register；返回迴圈 id，失敗時返回 None
+    pv_handle 超過 stale_periods 個輪詢週期沒有更新時保持輸出 (0 表示不檢查)
+    新增後為停用狀態，以 enable_control() 啟用；控制執行緒由 start_control() 啟動"""
+    if hal_lib is None or pv_handle is None or _shared_name is not None:
+        return None
+    cfg = HalCtrlConfig()
+    hal_lib.hal_ctrl_default_config(ctypes.byref(cfg))
+    cfg.pv_handle = int(pv_handle)
+    cfg.ff_handle = int(ff_handle) if ff_handle is not None else -1
+    cfg.setpoint = float(setpoint)
+    cfg.kp, cfg.ki, cfg.kd = float(kp), float(ki), float(kd)
+    cfg.ff_gain, cfg.ff_ref = float(ff_gain), float(ff_ref)
+    cfg.bias = float(bias)
+    cfg.out_min, cfg.out_max = float(out_min), float(out_max)
+    cfg.out_scale = float(out_scale)
+    cfg.stale_periods = int(stale_periods)
+    loop = hal_lib.hal_ctrl_add(device.encode('utf-8'), int(slave), int(register), ctypes.byref(cfg))
+    if loop < 0:
+        logging.error(f"Failed to add HAL control loop for {device} slave {slave} reg {register}")
+        return None
+    return loop
+
+
+def set_control_target(loop, setpoint):
+    """設定控制迴圈的目標值，成功返回 True"""
+    if hal_lib is None or loop is None:
+        return False
+    return hal_lib.hal_ctrl_set_target(loop, float(setpoint)) == 0
+
+
+def set_control_gains(loop, kp, ki, kd):
+    """設定控制迴圈的 PID 增益，成功返回 True"""
+    if hal_lib is None or loop is None:
+        return False
+    return hal_lib.hal_ctrl_set_gains(loop, float(kp), float(ki), float(kd)) == 0
+
+
+def enable_control(loop, enabled=True):
+    """啟用 (無衝擊切換) 或停用控制迴圈，停用時保持最後寫入的設定值，成功返回 True"""
+    if hal_lib is None or loop is None:
+        return False
+    return hal_lib.hal_ctrl_enable(loop, 1 if enabled else 0) == 0
+
+
+def control_status(loop):
+    """讀取控制迴圈的狀態，返回 dict；失敗時返回 None"""
+    if hal_lib is None or loop is None:
+        return None
+    status = HalCtrlStatus()
+    if hal_lib.hal_ctrl_status(loop, ctypes.byref(status)) != 0:
+        return None
+    return {name: getattr(status, name) for name, _ in HalCtrlStatus._fields_}
+
+
+def start_control(rate_hz=50):
+    """以 rate_hz (10-100) 啟動原生控制執行緒，沒有控制迴圈或啟動失敗時返回 False"""
+    if hal_lib is None or hal_lib.hal_ctrl_count() == 0:
+        return False
+    if hal_lib.hal_ctrl_start(int(rate_hz)) != 0:
+        logging.error("Failed to start HAL control thread")
+        return False
+    logging.info(f"HAL control thread started at {rate_hz} Hz")
+    return True
+
+
+def stop_control():
+    """停止原生控制執行緒"""
+    if hal_lib is not None:
+        hal_lib.hal_ctrl_stop()
+
+
+def control_thread_stats():
+    """讀取控制執行緒的週期與抖動統計，返回 dict；未運作時返回 None"""
+    if hal_lib is None:
+        return None
+    stats = HalCtrlThreadStats()
+    if hal_lib.hal_ctrl_thread_stats(ctypes.byref(stats)) != 0:
+        return None
+    return {name: getattr(stats, name) for name, _ in HalCtrlThreadStats._fields_}
+
+
+def poll():
+    """執行一個輪詢週期並 refresh() 快照，返回成功的 frame 數量
+    (背景擷取運作中或共享快照的讀取端只做 refresh)"""
+    if hal_lib is None:
+        return 0
+    if _shared_name is not None:
+        refresh()
+        return 0
+    if _point_count == 0:
+        return 0
+    frames = hal_lib.hal_sched_poll()
+    refresh()
+    return frames
+
+
+def refresh():
+    """以一次 FFI 呼叫把所有量測點的最新值複製到預先配置的緩衝區，返回量測點數量
+    之後同一週期內的 read_point() 直接讀緩衝區，所有 Block 看到的是同一個時間點的資料"""
+    global _batch_count
+    if hal_lib is None:
+        return 0
+    if _shared_name is not None:
+        _shared_resolve()
+        if _shared_reader is None:
+            return 0
+        n = hal_lib.hal_shm_read_all(_shared_reader, _batch_ref)
+        if n < 0:
+            logging.warning(f"HAL shared snapshot '{_shared_name}' is no longer published")
+            _shared_close()
+            return 0
+        _batch_count = n
+        return n
+    n = hal_lib.hal_read_all(_batch_ref)
+    _batch_count = n if n > 0 else 0
+    return _batch_count
+
+
+def read_point(handle):
+    """讀取量測點最近一次輪詢的工程值，失敗時返回 None"""
+    if hal_lib is None or handle is None:
+        return None
+    if _shared_name is not None:
+        handle = _shared_slot(handle)
+        if handle < 0 or handle >= _batch_count:
+            return None
+    if handle < _batch_count:
+        return _values[handle] if _quality[handle] == HAL_QUALITY_GOOD else None
+    value = ctypes.c_float()
+    if hal_lib.hal_point_read(handle, ctypes.byref(value)) != 0:
+        return None
+    return value.value
+
+
+def read_di_pin(handle, pin):
+    """讀取 DI 點上一個 pin (1-32) 最近一次輪詢的狀態，返回 0 / 1，失敗時返回 None"""
+    if hal_lib is None or handle is None or not 1 <= pin <= 32:
+        return None
+    if _shared_name is not None:
+        handle = _shared_slot(handle)
+        if handle < 0 or handle >= _batch_count:
+            return None
+    if handle < _batch_count:
+        if _quality[handle] != HAL_QUALITY_GOOD:
+            return None
+        return (_raw[handle] >> (pin - 1)) & 1
+    state = hal_lib.hal_di_read_pin(handle, int(pin))
+    return state if state >= 0 else None
+
+
+def read_sample(handle):
+    """讀取量測點的完整快照 (值、原始值、品質、時間戳記)，失敗時返回 None"""
+    if hal_lib is None or handle is None:
+        return None
+    sample = HalSample()
+    if _shared_name is not None:
+        handle = _shared_slot(handle)
+        if handle < 0 or hal_lib.hal_shm_get(_shared_reader, handle, ctypes.byref(sample)) != 0:
+            return None
+        return sample
+    if hal_lib.hal_get_snapshot(handle, ctypes.byref(sample)) != 0:
+        return None
+    return sample
+
+
+def read_history(handle, tier='raw', since_us=0, until_us=0, max_points=None):
+    """讀取量測點的歷史紀錄 (tier 為 'raw'、'1s' 或 '1min')，依時間由舊到新排列
+    since_us <= timestamp_us < until_us (Unix epoch 微秒，until_us 為 0 表示到最新)，
+    超過 max_points 時只返回最新的部分
+    raw 返回 (timestamp_us, value, quality) 列表，彙總層返回 (timestamp_us, min, max, avg, good, bad) 列表
+    歷史紀錄只存在於擷取程序，共享快照的讀取端返回空列表"""
+    if hal_lib is None or handle is None or _shared_name is not None:
+        return []
+    level = _HISTORY_TIERS.get(tier)
+    if level is None:
+        raise ValueError(f"Unknown history tier '{tier}'")
+    if level == HAL_HISTORY_RAW:
+        buf, cap = _history_raw, HAL_HISTORY_RAW_SIZE
+    else:
+        buf = _history_buckets
+        cap = HAL_HISTORY_SEC_SIZE if level == HAL_HISTORY_1S else HAL_HISTORY_MIN_SIZE
+    limit = cap if max_points is None else max(0, min(int(max_points), cap))
+    if level == HAL_HISTORY_RAW:
+        n = hal_lib.hal_history_read_raw(handle, int(since_us), int(until_us), buf, limit)
+        return [(s.timestamp_us, s.value, s.quality) for s in buf[:max(n, 0)]]
+    n = hal_lib.hal_history_read_buckets(handle, level, int(since_us), int(until_us), buf, limit)
+    return [(b.timestamp_us, b.min, b.max, b.avg, b.good, b.bad) for b in buf[:max(n, 0)]]
+
+
+def wait_changes(timeout_ms=1000):
+    """等待並取出量測點變更事件 (超出死區或品質改變)，返回 (handle, value, quality, timestamp_us) 列表
+    超時返回空列表；等待期間釋放 GIL"""
+    if hal_lib is None:
+        return []
+    if hal_lib.hal_wait_changes(int(timeout_ms)) <= 0:
+        return []
+    changes = []
+    while True:
+        n = hal_lib.hal_drain_changes(_changes, HAL_MAX_POINTS)
+        changes.extend((c.handle, c.value, c.quality, c.timestamp_us) for c in _changes[:n])
+        if n < HAL_MAX_POINTS:
+            return changes
+
+
+def change_overflows():
+    """變更事件緩衝區溢位而丟棄的事件總數；增加時應以 refresh() 重新同步全部量測點"""
+    return hal_lib.hal_change_overflows() if hal_lib is not None else 0
+
+
+def submit(kind, device, slave=0, register=0, count=1, values=None, address='', user_data=0):
+    """排入一個非同步請求 (HAL_REQ_*)，立即返回 ticket；參數無效或在途請求已達上限時返回 None
+    結果以 wait_completions() / drain_completions() 取出，asyncio 程式改用 read_registers_async() 等函式"""
+    if hal_lib is None:
+        return None
+    req = HalRequest()
+    req.kind = int(kind)
+    req.device = str(device).encode('utf-8')
+    req.slave = int(slave)
+    req.reg = int(register)
+    req.address = str(address).encode('ascii')
+    req.count = len(values) if values is not None else int(count)
+    for i, value in enumerate((values or [])[:HAL_ASYNC_MAX_REGISTERS]):
+        req.values[i] = int(value) & 0xFFFF
+    req.user_data = int(user_data)
+    ticket = hal_lib.hal_submit(ctypes.byref(req))
+    return ticket or None
+
+
+def wait_completions(timeout_ms=1000):
+    """等待並取出完成結果，超時返回空列表；等待期間釋放 GIL"""
+    if hal_lib is None or hal_lib.hal_wait_completions(int(timeout_ms)) <= 0:
+        return []
+    return drain_completions()
+
+
+def drain_completions():
+    """依完成順序取出所有完成結果：[{'ticket', 'user_data', 'kind', 'ok', 'values', 'elapsed_us'}]
+    values 為讀取結果 (寫入與失敗時為空列表)"""
+    if hal_lib is None:
+        return []
+    completions = []
+    while True:
+        n = hal_lib.hal_drain_completions(_completions, HAL_ASYNC_MAX_INFLIGHT)
+        for c in _completions[:n]:
+            ok = c.status == 0
+            completions.append({
+                'ticket': c.ticket,
+                'user_data': c.user_data,
+                'kind': c.kind,
+                'ok': ok,
+                'values': list(c.values[:c.count]) if ok and c.kind != HAL_REQ_WRITE else [],
+                'elapsed_us': c.elapsed_us,
+            })
+        if n < HAL_ASYNC_MAX_INFLIGHT:
+            return completions
+
+
+# asyncio 整合：完成通知由 event loop 監看，每個在途請求只是一個 Future，不佔用執行緒。
+# Linux 以 loop.add_reader() 監看 eventfd；Windows 的 event loop 不能直接監看 event handle，
+# 由一條共用的等待執行緒呼叫 hal_wait_completions() 後把取出工作交回 event loop。
+# 使用這些函式後完成佇列由 event loop 取出，不要再同時呼叫 wait_completions()。
+_async_loop = None
+_async_futures = {}
+_async_drained = threading.Event()
+
+
+def _async_dispatch():
+    for completion in drain_completions():
+        future = _async_futures.pop(completion['ticket'], None)
+        if future is not None and not future.done():
+            future.set_result(completion)
+    _async_drained.set()
+
+
+def _async_wait_thread(loop):
+    while _async_loop is loop and not loop.is_closed():
+        if hal_lib.hal_wait_completions(200) <= 0:
+            continue
+        _async_drained.clear()
+        try:
+            loop.call_soon_threadsafe(_async_dispatch)
+        except RuntimeError:
+            return  # event loop 已關閉
+        _async_drained.wait(1.0)
+
+
+def _async_attach(loop):
+    """讓 loop 監看完成通知 (只在第一次使用或換了 event loop 時設定)，成功返回 True"""
+    global _async_loop
+    if _async_loop is loop:
+        return True
+    fd = hal_lib.hal_completion_fd()
+    if fd < 0:
+        return False
+    if _async_loop is not None and not _async_loop.is_closed() and platform.system() != "Windows":
+        _async_loop.remove_reader(fd)
+    _async_loop = loop
+    if platform.system() == "Windows":
+        threading.Thread(target=_async_wait_thread, args=(loop,), name='hal-completions', daemon=True).start()
+    else:
+        loop.add_reader(fd, _async_dispatch)
+    return True
+
+
+async def _submit_async(kind, device, **kwargs):
+    if hal_lib is None:
+        return None
+    loop = asyncio.get_running_loop()
+    if not _async_attach(loop):
+        return None
+    ticket = submit(kind, device, **kwargs)
+    if ticket is None:
+        return None
+    # 完成結果只在 event loop 中取出，登錄 Future 之前不會被取走
+    future = loop.create_future()
+    _async_futures[ticket] = future
+    return await future
+
+
+async def read_registers_async(device, slave, register, count=1):
+    """非同步 FC03 讀取，返回暫存器值列表，失敗返回 None"""
+    done = await _submit_async(HAL_REQ_READ, device, slave=slave, register=register, count=count)
+    return done['values'] if done is not None and done['ok'] else None
+
+
+async def write_registers_async(device, slave, register, values):
+    """非同步寫入連續暫存器 (1 個時以 FC06，否則 FC16)，成功返回 True
+    背景擷取運作時經由 HAL 寫入佇列送出 (與其他設定值寫入依序合併)，送出後才完成"""
+    done = await _submit_async(HAL_REQ_WRITE, device, slave=slave, register=register, values=list(values))
+    return done is not None and done['ok']
+
+
+async def read_plc_async(endpoint, address, count=1):
+    """非同步 SLMP 讀取 endpoint 上從 address (例如 "R10000") 開始的 count 個 word，失敗返回 None"""
+    done = await _submit_async(HAL_REQ_PLC_READ, endpoint, address=address, count=count)
+    return done['values'] if done is not None and done['ok'] else None
+
+
+def stop_async():
+    """停止非同步請求的工作執行緒 (尚未執行的請求以失敗完成)"""
+    if hal_lib is not None:
+        hal_lib.hal_async_stop()
+
+
+def configure_telemetry(telemetry_config, node_id):
+    """依設定檔的 telemetry 區段設定節點間遙測 frame 的編碼端，啟用時返回 True
+    telemetry_config: {'enabled', 'batch_cycles', 'keyframe_interval'}；node_id 為叢集內的節點編號"""
+    if hal_lib is None or not telemetry_config or not telemetry_config.get('enabled', False):
+        return False
+    cfg = HalTelemetryConfig(int(node_id),
+                             int(telemetry_config.get('batch_cycles', 1)),
+                             int(telemetry_config.get('keyframe_interval', 30)))
+    if hal_lib.hal_telemetry_configure(ctypes.byref(cfg)) != 0:
+        logging.error(f"Invalid HAL telemetry config: {telemetry_config}")
+        return False
+    return True
+
+
+def _telemetry_frame():
+    length = ctypes.c_uint32()
+    address = hal_lib.hal_telemetry_frame(ctypes.byref(length))
+    if not address:
+        return None
+    # 直接映射 HAL 內部的 frame 緩衝區，不複製
+    return memoryview((ctypes.c_uint8 * length.value).from_address(address)).cast('B')
+
+
+def encode_telemetry(timestamp_us=0):
+    """把目前的快照表加入待送的遙測 frame 成為一個週期
+    frame 完成時返回指向 HAL 緩衝區的 memoryview (下一個 frame 完成之前有效，需要保存時以 bytes() 複製)，
+    尚未湊滿 batch_cycles 個週期返回 None"""
+    if hal_lib is None or hal_lib.hal_telemetry_capture(int(timestamp_us)) <= 0:
+        return None
+    return _telemetry_frame()
+
+
+def flush_telemetry():
+    """立即完成包含尚未送出週期的 frame，返回 memoryview，沒有待送週期返回 None"""
+    if hal_lib is None or hal_lib.hal_telemetry_flush() <= 0:
+        return None
+    return _telemetry_frame()
+
+
+def request_telemetry_keyframe():
+    """下一個遙測 frame 改送關鍵 frame (其他節點遺失 frame 或剛加入時)"""
+    if hal_lib is not None:
+        hal_lib.hal_telemetry_request_keyframe()
+
+
+def decode_telemetry(frame):
+    """解碼其他節點的遙測 frame，返回 (cycles, info)
+    cycles > 0 為解碼的週期數，info 為 {'node_id', 'seq', 'keyframe', 'point_count', 'layout_hash', 'last_cycle_us'}；
+    -1 表示格式或 CRC 錯誤，-2 表示前一個 frame 遺失，應要求來源節點送出關鍵 frame (兩者 info 皆為 None)"""
+    if hal_lib is None:
+        return -1, None
+    if not isinstance(frame, bytes):
+        frame = bytes(frame)
+    info = HalTelemetryInfo()
+    cycles = hal_lib.hal_telemetry_decode(frame, len(frame), ctypes.byref(info))
+    if cycles <= 0:
+        return cycles, None
+    return cycles, {
+        'node_id': info.node_id,
+        'seq': info.seq,
+        'keyframe': bool(info.keyframe),
+        'point_count': info.point_count,
+        'layout_hash': info.layout_hash,
+        'last_cycle_us': info.last_cycle_us,
+    }
+
+
+def peer_points(node_id):
+    """其他節點最新週期的量測點，依 handle 排列的 (value, quality, timestamp_us) 列表
+    尚未收到該節點的關鍵 frame 返回 None"""
+    if hal_lib is None:
+        return None
+    n = hal_lib.hal_telemetry_peer_read(int(node_id), ctypes.byref(_peer_batch))
+    if n < 0:
+        return None
+    return [(_peer_values[i], _peer_quality[i], _peer_timestamp_us[i]) for i in range(n)]
+
+
+def set_log_level(level):
+    """設定 HAL 執行期日誌層級 (HAL_LOG_LEVEL_*)"""
+    if hal_lib is not None:
+        hal_lib.hal_log_set_level(int(level))
+
+
+def forward_log():
+    """把 HAL ring buffer 中累積的日誌轉交給 Python logging，返回轉交的行數"""
+    if hal_lib is None:
+        return 0
+    count = 0
+    while True:
+        size = hal_lib.hal_log_drain(_log_buffer, len(_log_buffer))
+        if size <= 0:
+            return count
+        for line in _log_buffer.raw[:size].decode('utf-8', errors='replace').splitlines():
+            # 格式: "<timestamp_us> <LEVEL> <message>"
+            parts = line.split(' ', 2)
+            if len(parts) < 3:
+                continue
+            _hal_logger.log(_LOG_LEVEL_MAP.get(parts[1], logging.INFO), parts[2])
+            count += 1
+
+
+def get_stats():
+    """讀取匯流排統計，返回 dict 列表 (slave 為 -1 表示串口整體)；HAL 不可用時返回空列表"""
+    if hal_lib is None:
+        return []
+    entries = (HalStats * HAL_STATS_MAX_ENTRIES)()
+    n = hal_lib.hal_get_stats(entries, HAL_STATS_MAX_ENTRIES)
+    result = []
+    for entry in entries[:n]:
+        latency = {}
+        for name, summary in zip(_LATENCY_KINDS, entry.latency):
+            latency[name] = {
+                'count': summary.count,
+                'mean_us': summary.sum_us / summary.count if summary.count else 0.0,
+                'min_us': summary.min_us,
+                'max_us': summary.max_us,
+                'p50_us': summary.p50_us,
+                'p90_us': summary.p90_us,
+                'p99_us': summary.p99_us,
+                'p999_us': summary.p999_us,
+            }
+        result.append({
+            'device': entry.device.decode('utf-8', errors='replace'),
+            'slave': entry.slave,
+            'requests': entry.requests,
+            'responses': entry.responses,
+            'timeouts': entry.timeouts,
+            'crc_errors': entry.crc_errors,
+            'exceptions': entry.exceptions,
+            'other_errors': entry.other_errors,
+            'bytes_out': entry.bytes_out,
+            'bytes_in': entry.bytes_in,
+            'latency': latency,
+        })
+    return result
+
+
+def reset_stats():
+    """清除匯流排統計"""
+    if hal_lib is not None:
+        hal_lib.hal_stats_reset()
@@ -1,5 +1,6 @@
 
 from .base_block import BaseBlock
+from . import hal_bus
 import ctypes
 import logging
 
@@ -26,7 +27,13 @@ class LiquidLevelSensorBlock(BaseBlock):
     def __init__(self, block_id, config):
         super().__init__(block_id, config)
         self.device = config.get('device', '/dev/ttyUSB0') # USB-to-UART 通常是 ttyUSBn
+        self.c_device = self.device.encode('utf-8')
         self.pin_number = config.get('pin')
+
+        # 同一塊 DI/DO 板上的所有 pin 共用一個 DI 點，由 HAL 以一次指令讀回整個 bitmap
+        self.di_point = hal_bus.register_di(self.device, config.get('poll_period_ms', 0),
+                                            config.get('priority', 0),
+                                            [self.pin_number] if self.pin_number else ())
         
         # Output
         self.output_level_status = "Normal" # e.g., Normal, High, Low
@@ -35,9 +42,11 @@ class LiquidLevelSensorBlock(BaseBlock):
 
     def update(self):
         try:
-            if c_lib:
-                c_device = self.device.encode('utf-8')
-                pin_state = c_lib.uart_read_di_pin(c_device, self.pin_number)
+            if self.di_point is not None or c_lib:
+                if self.di_point is not None:
+                    pin_state = hal_bus.read_di_pin(self.di_point, self.pin_number)
+                else:
+                    pin_state = c_lib.uart_read_di_pin(self.c_device, self.pin_number)
 
                 if pin_state == 1:
                     self.output_level_status = "High"
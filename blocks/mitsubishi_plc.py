@@ -5,6 +5,8 @@
 
 from .base_block import BaseBlock
 from .plc_connection_pool import plc_pool
+from . import hal_bus
+import asyncio
 import logging
 import time
 from typing import Dict, List, Optional, Any
@@ -99,6 +101,26 @@ class MitsubishiPLCBlock(BaseBlock):
         self.r_register_count = config.get('r_register_count', 201)    # R10500-R10700 (201個暫存器)
         self.r_modbus_start_address = 500  # R10500對應Modbus地址500
 
+        # protocol: slmp 時由 lib-cdu-hal 以三菱 SLMP (MC protocol 4E binary) 直接讀取 R 暫存器，
+        # 同一 PLC 的所有區塊共用一條連線，每個週期以一個 frame 讀回；寫入仍經由 Modbus TCP
+        self.protocol = config.get('protocol', 'modbus')
+        self.slmp_endpoint = f"slmp://{self.ip_address}:{config.get('slmp_port', 5000)}"
+        self.slmp_points = {}  # R 暫存器編號 -> HAL handle
+        # API 的非同步讀寫 (*_async) 經由 lib-cdu-hal 的 Modbus TCP 連線送出
+        self.modbus_endpoint = f"tcp://{self.ip_address}:{self.port}"
+        if self.protocol == 'slmp':
+            if hal_bus.available():
+                for i in range(self.register_count):
+                    actual_register = self.start_register + i
+                    handle = hal_bus.register_plc_point(self.slmp_endpoint, f"R{actual_register}",
+                                                        poll_period_ms=config.get('poll_period_ms', 0),
+                                                        priority=config.get('priority', 0))
+                    if handle is not None:
+                        self.slmp_points[actual_register] = handle
+            else:
+                logger.warning(f"PLC block '{block_id}': HAL unavailable, falling back to Modbus TCP")
+                self.protocol = 'modbus'
+
         # 連接狀態 (使用連接池)
         self.client = None  # 保持兼容性，但實際使用連接池
         self.connected = False
@@ -196,12 +218,44 @@ class MitsubishiPLCBlock(BaseBlock):
                 logger.error(f"Error disconnecting from PLC: {e}")
     
     def _read_r_registers(self):
-        """讀取R暫存器數據 (使用連接池)"""
+        """讀取R暫存器數據 (SLMP 或連接池)"""
+        if self.slmp_points:
+            return self._read_using_slmp()
         if self.use_connection_pool:
             return self._read_using_connection_pool()
         else:
             return self._read_using_direct_connection()
     
+    def _read_using_slmp(self):
+        """從 HAL 快照取出本週期以 SLMP 讀回的 R 暫存器"""
+        success = False
+        for actual_register, handle in self.slmp_points.items():
+            value = hal_bus.read_point(handle)
+            if value is None:
+                continue
+            success = True
+            value = int(value)
+            self.register_values[f"R{actual_register}"] = {
+                'value': value,
+                'name': self.register_names.get(actual_register, f'未知暫存器R{actual_register}'),
+                'register': actual_register
+            }
+            if self.register is not None:
+                self.register_values[self.register] = value
+
+        if success:
+            self.last_update_time = time.time()
+            self.output_health = "OK"
+            self.output_status = "Connected"
+            self.connected = True
+            self.connection_errors = 0
+        else:
+            self.output_health = "Warning"
+            self.output_status = "Read Error"
+            self.connected = False
+            self.connection_errors += 1
+        return success
+
     def _read_using_connection_pool(self):
         """使用連接池讀取暫存器"""
         try:
@@ -320,7 +374,19 @@ class MitsubishiPLCBlock(BaseBlock):
             return False
 
     def read_single_r_register(self, register_address):
-        """讀取單個R暫存器 (使用功能碼03 - Read Holding Registers)"""
+        """讀取單個R暫存器 (使用功能碼03 - Read Holding Registers，protocol: slmp 時以 SLMP 讀取)"""
+        if self.protocol == 'slmp' and 10000 <= register_address <= 11000:
+            values = hal_bus.read_plc(self.slmp_endpoint, f"R{register_address}")
+            if values is None:
+                logger.error(f"SLMP read error for R{register_address}")
+                return None
+            return {
+                'value': values[0],
+                'register': register_address,
+                'modbus_address': register_address - 10000,
+                'timestamp': time.time()
+            }
+
         if not self.connected:
             logger.warning("PLC not connected, cannot read register")
             return None
@@ -359,8 +425,8 @@ class MitsubishiPLCBlock(BaseBlock):
             return None
 
     def read_r_registers_batch(self, start_address, count):
-        """批量讀取R暫存器 (使用功能碼03 - Read Holding Registers)"""
-        if not self.connected:
+        """批量讀取R暫存器 (使用功能碼03 - Read Holding Registers，protocol: slmp 時以 SLMP 讀取)"""
+        if not self.connected and self.protocol != 'slmp':
             logger.warning("PLC not connected, cannot read registers")
             return None
 
@@ -378,6 +444,25 @@ class MitsubishiPLCBlock(BaseBlock):
         # 計算Modbus地址
         modbus_start_address = start_address - 10000
 
+        if self.protocol == 'slmp':
+            values = hal_bus.read_plc(self.slmp_endpoint, f"R{start_address}", count)
+            if values is None:
+                logger.error(f"SLMP batch read error for R{start_address}-R{end_address}")
+                return None
+            registers_data = {}
+            for i, value in enumerate(values):
+                registers_data[f"R{start_address + i}"] = {
+                    'value': value,
+                    'register': start_address + i,
+                    'modbus_address': modbus_start_address + i
+                }
+            return {
+                'registers': registers_data,
+                'start_address': start_address,
+                'count': count,
+                'timestamp': time.time()
+            }
+
         try:
             # 使用功能碼03批量讀取暫存器
             result = self.client.read_holding_registers(
@@ -413,6 +498,70 @@ class MitsubishiPLCBlock(BaseBlock):
             logger.error(f"Error batch reading registers R{start_address}-R{end_address}: {e}")
             return None
 
+    async def read_r_registers_batch_async(self, start_address, count):
+        """read_r_registers_batch 的 asyncio 版本：請求交給 HAL 的非同步介面，與背景擷取同時進行，
+        等待期間不佔用 worker thread；HAL 不可用時在 executor 中執行同步版本"""
+        if not hal_bus.available():
+            return await asyncio.get_running_loop().run_in_executor(None, self.read_r_registers_batch,
+                                                                    start_address, count)
+
+        end_address = start_address + count - 1
+        if not (10000 <= start_address <= 11000) or not (10000 <= end_address <= 11000) or count > 125:
+            logger.error(f"Register range R{start_address}-R{end_address} out of range (R10000-R11000, max 125)")
+            return None
+
+        modbus_start_address = start_address - 10000
+        if self.protocol == 'slmp':
+            values = await hal_bus.read_plc_async(self.slmp_endpoint, f"R{start_address}", count)
+        else:
+            values = await hal_bus.read_registers_async(self.modbus_endpoint, self.unit_id,
+                                                        modbus_start_address, count)
+        if values is None:
+            logger.error(f"Async read error for R{start_address}-R{end_address}")
+            return None
+
+        registers_data = {}
+        for i, value in enumerate(values):
+            registers_data[f"R{start_address + i}"] = {
+                'value': value,
+                'register': start_address + i,
+                'modbus_address': modbus_start_address + i
+            }
+        return {
+            'registers': registers_data,
+            'start_address': start_address,
+            'count': count,
+            'timestamp': time.time()
+        }
+
+    async def write_r_registers_batch_async(self, start_address, values):
+        """write_r_registers_batch 的 asyncio 版本 (1 個值時以功能碼06寫入，超過 123 個時分成多個 frame)，
+        成功返回 True"""
+        if not hal_bus.available():
+            return await asyncio.get_running_loop().run_in_executor(None, self.write_r_registers_batch,
+                                                                    start_address, values)
+
+        end_address = start_address + len(values) - 1
+        last_register = self.r_start_register + self.r_register_count - 1
+        if not values or not (self.r_start_register <= start_address <= last_register) or \
+                not (self.r_start_register <= end_address <= last_register):
+            logger.error(f"Register range R{start_address}-R{end_address} out of range")
+            return False
+
+        modbus_start_address = self.r_modbus_start_address + (start_address - self.r_start_register)
+        for offset in range(0, len(values), 123):
+            chunk = values[offset:offset + 123]
+            if not await hal_bus.write_registers_async(self.modbus_endpoint, self.unit_id,
+                                                       modbus_start_address + offset, chunk):
+                logger.error(f"Async write error for R{start_address + offset}-R{start_address + offset + len(chunk) - 1}")
+                self.write_errors += 1
+                return False
+
+        for i, value in enumerate(values):
+            self.r_register_values[f"R{start_address + i}"] = value
+        logger.info(f"Successfully wrote {len(values)} registers starting from R{start_address}")
+        return True
+
     def write_r_register(self, register_address, value):
         """寫入單個R暫存器 (使用功能碼06 - Write Single Register)"""
         if not self.connected:
@@ -595,6 +744,13 @@ class MitsubishiPLCBlock(BaseBlock):
     def read_register(self, register_address: int) -> Optional[int]:
         """讀取單個特定暫存器的值 (例如: R10001-R10005 異常暫存器)"""
         try:
+            if self.protocol == 'slmp':
+                values = hal_bus.read_plc(self.slmp_endpoint, f"R{register_address}")
+                if values is None:
+                    logger.warning(f"Failed to read register R{register_address}")
+                    return None
+                return values[0]
+
             if self.use_connection_pool:
                 # 使用連接池讀取單個暫存器
                 register_list = [(register_address - 10000, f"temp_read_{register_address}")]
@@ -653,6 +809,7 @@ class MitsubishiPLCBlock(BaseBlock):
             "r_register_count": len(self.r_register_values),
             "last_update": self.last_update_time,
             "connection_errors": self.connection_errors,
+            "protocol": self.protocol,
             "write_errors": self.write_errors,
             "registers": self.register_values,
             "r_registers": self.r_register_values,
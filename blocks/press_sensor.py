@@ -1,5 +1,6 @@
 
 from .base_block import BaseBlock
+from . import hal_bus
 import ctypes
 import logging
 
@@ -30,8 +31,21 @@ class PressSensorBlock(BaseBlock):
     def __init__(self, block_id, config):
         super().__init__(block_id, config)
         self.device = config.get('device', '/dev/ttyTHS1')
+        self.c_device = self.device.encode('utf-8')
         self.modbus_address = config.get('modbus_address')
         self.register = config.get('register', 0)
+        self.scale = config.get('scale', 0.01) # 假設單位為 0.01 Bar
+
+        # 向 HAL 排程器註冊量測點，由引擎每週期統一輪詢
+        self.point = None
+        if self.modbus_address is not None:
+            self.point = hal_bus.register_point(self.device, self.modbus_address, self.register,
+                                                hal_bus.HAL_VALUE_U16, self.scale,
+                                                config.get('poll_period_ms', 0),
+                                                config.get('priority', 0),
+                                                config.get('deadband', 0.0),
+                                                config.get('hysteresis', 0.0),
+                                                config.get('filter'))
         
         # Output
         self.output_pressure = 0.0
@@ -40,9 +54,13 @@ class PressSensorBlock(BaseBlock):
 
     def update(self):
         try:
-            if c_lib:
-                c_device = self.device.encode('utf-8')
-                pressure = c_lib.modbus_read_pressure(c_device, self.modbus_address, self.register)
+            if self.point is not None:
+                pressure = hal_bus.read_point(self.point)
+                self.output_pressure = pressure if pressure is not None else -1.0
+                self.output_status = "Enabled"
+                self.output_health = "OK" if pressure is not None else "Critical"
+            elif c_lib:
+                pressure = c_lib.modbus_read_pressure(self.c_device, self.modbus_address, self.register)
                 self.output_pressure = pressure
                 self.output_status = "Enabled"
                 self.output_health = "OK"
@@ -1,17 +1,21 @@
 import ctypes
 import logging
 from .base_block import BaseBlock
+from . import hal_bus
 
 # 載入 C 語言的 HAL 共享函式庫
 # 這是 Python 與 C 溝通的橋樑
 import platform
 import os
 
+# 獲取當前腳本所在目錄的父目錄（項目根目錄）
+PROJECT_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
 # 根據作業系統選擇正確的庫文件
 if platform.system() == "Windows":
-    HAL_LIB_PATH = './hal/lib-cdu-hal.dll'
+    HAL_LIB_PATH = os.path.join(PROJECT_ROOT, 'hal', 'lib-cdu-hal.dll')
 else:
-    HAL_LIB_PATH = './lib-cdu-hal.so'
+    HAL_LIB_PATH = os.path.join(PROJECT_ROOT, 'hal', 'lib-cdu-hal.so')
 
 try:
     hal_lib = ctypes.CDLL(HAL_LIB_PATH)
@@ -21,6 +25,8 @@ try:
     hal_lib.hal_modbus_disconnect.argtypes = [ctypes.POINTER(ctypes.c_void_p)]
     hal_lib.hal_modbus_write_register.restype = ctypes.c_int
     hal_lib.hal_modbus_write_register.argtypes = [ctypes.POINTER(ctypes.c_void_p), ctypes.c_int, ctypes.c_int]
+    hal_lib.hal_modbus_write_registers.restype = ctypes.c_int
+    hal_lib.hal_modbus_write_registers.argtypes = [ctypes.POINTER(ctypes.c_void_p), ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_uint16)]
     hal_lib.hal_modbus_read_registers.restype = ctypes.c_int
     hal_lib.hal_modbus_read_registers.argtypes = [ctypes.POINTER(ctypes.c_void_p), ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_uint16)]
     logging.info(f"Successfully loaded HAL library from: {HAL_LIB_PATH}")
@@ -41,6 +47,7 @@ class PumpVFDBlock(BaseBlock):
         self.device_port = self.config.get('device', '/dev/ttyTHS1') # RS-485 端口
         self.baud_rate = self.config.get('baud', 9600)
         self.ctx = None # Modbus context
+        self.read_buffer = (ctypes.c_uint16 * 1)() # 備用讀取路徑的緩衝區，只配置一次
         
         # 定義 Inputs (可由 API 或其他 Block 寫入)
         self.input_target_rpm = 0.0
@@ -51,7 +58,24 @@ class PumpVFDBlock(BaseBlock):
         self.output_power_watts = 0.0
         self.output_status = "Disabled"
         self.output_health = "OK"
-        
+        self.output_control_rpm = 0.0   # 差壓控制迴圈計算的目標轉速
+        self.output_pressure = 0.0      # 差壓控制迴圈的過程值
+        self.output_write_errors = 0    # 排入佇列後送出失敗的設定值寫入次數
+        self._write_failed_seen = 0
+
+        # 實際轉速回授交給 HAL 排程器輪詢 (假設實際轉速暫存器位址是 0x2000)
+        self.rpm_point = hal_bus.register_point(self.device_port, self.modbus_addr, 0x2000,
+                                                poll_period_ms=config.get('poll_period_ms', 0),
+                                                priority=config.get('priority', 0))
+
+        # 差壓閉迴路交給 HAL 原生控制迴圈，目標轉速暫存器由控制執行緒寫入
+        self.control_loop = None
+        self.input_target_pressure = None
+        self._control_state = None
+        control = config.get('pressure_control')
+        if control:
+            self._setup_pressure_control(control)
+
         # 初始化與硬體的連接
         if hal_lib:
             self.ctx = hal_lib.hal_modbus_connect(self.device_port.encode('utf-8'), self.baud_rate, self.modbus_addr)
@@ -68,25 +92,24 @@ class PumpVFDBlock(BaseBlock):
             return
 
         # 1. 執行控制邏輯 (寫入)
-        try:
-            if self.input_enable:
-                target_val = int(self.input_target_rpm)
-                # 假設目標轉速暫存器位址是 0x1000
-                hal_lib.hal_modbus_write_register(self.ctx, 0x1000, target_val)
-                self.output_status = "Enabled"
-            else:
-                hal_lib.hal_modbus_write_register(self.ctx, 0x1000, 0)
-                self.output_status = "Disabled"
-        except Exception as e:
-            logging.error(f"Error writing to VFD '{self.id}': {e}")
-            self.output_health = "Error"
+        # 設定值排入 HAL 寫入佇列，由串口擷取執行緒在下一次讀取之前送出；
+        # 尚未送出的舊設定值會被新的值取代
+        if self.control_loop is not None:
+            self._update_pressure_control()
+        else:
+            self._write_target_rpm()
 
         # 2. 讀取硬體狀態 (讀取)
+        if self.rpm_point is not None:
+            rpm = hal_bus.read_point(self.rpm_point)
+            self.output_current_rpm = rpm if rpm is not None else 0.0
+            self.output_health = "OK" if rpm is not None and not self._writes_failed() else "Error"
+            return
+
         try:
             # 假設實際轉速暫存器位址是 0x2000
-            read_buffer = (ctypes.c_uint16 * 1)()
-            if hal_lib.hal_modbus_read_registers(self.ctx, 0x2000, 1, read_buffer) == 0:
-                self.output_current_rpm = float(read_buffer[0])
+            if hal_lib.hal_modbus_read_registers(self.ctx, 0x2000, 1, self.read_buffer) == 0:
+                self.output_current_rpm = float(self.read_buffer[0])
                 self.output_health = "OK"
             else:
                 self.output_health = "Error"
@@ -96,6 +119,74 @@ class PumpVFDBlock(BaseBlock):
             logging.error(f"Error reading from VFD '{self.id}': {e}")
             self.output_health = "Error"
 
+    def _writes_failed(self):
+        """上一個週期之後是否有排入佇列的寫入送出失敗 (hal_write_submit 排入即返回成功)"""
+        status = hal_bus.write_status(self.device_port, self.modbus_addr)
+        if status is None:
+            return False
+        new_failures = status['failed'] - self._write_failed_seen
+        self._write_failed_seen = status['failed']
+        if new_failures > 0:
+            self.output_write_errors += new_failures
+            logging.error(f"{new_failures} queued write(s) to VFD '{self.id}' failed "
+                          f"(last reg 0x{status['last_error_reg']:04X})")
+            return True
+        return False
+
+    def _write_target_rpm(self):
+        try:
+            target_val = int(self.input_target_rpm) if self.input_enable else 0
+            # 假設目標轉速暫存器位址是 0x1000
+            if hal_lib.hal_modbus_write_register(self.ctx, 0x1000, target_val) != 0:
+                logging.error(f"Failed to write target RPM to VFD '{self.id}'")
+                self.output_health = "Error"
+            self.output_status = "Enabled" if self.input_enable else "Disabled"
+        except Exception as e:
+            logging.error(f"Error writing to VFD '{self.id}': {e}")
+            self.output_health = "Error"
+
+    def _setup_pressure_control(self, control):
+        """註冊差壓 (與選用的前饋溫度) 量測點並新增 HAL 控制迴圈，輸出寫到目標轉速暫存器 0x1000"""
+        pv = control.get('pv') or {}
+        pv_point = hal_bus.register_point(pv.get('device', self.device_port), pv.get('modbus_address'),
+                                          pv.get('register', 0), hal_bus.HAL_VALUE_U16, pv.get('scale', 1.0),
+                                          pv.get('poll_period_ms', 20), pv.get('priority', 10))
+        ff = control.get('feedforward') or {}
+        ff_point = None
+        if ff:
+            ff_point = hal_bus.register_point(ff.get('device', self.device_port), ff.get('modbus_address'),
+                                              ff.get('register', 0), hal_bus.HAL_VALUE_U16, ff.get('scale', 1.0),
+                                              ff.get('poll_period_ms', 0), ff.get('priority', 0))
+        self.input_target_pressure = float(control.get('setpoint', 0.0))
+        self.control_loop = hal_bus.add_control_loop(
+            self.device_port, self.modbus_addr, 0x1000, pv_point, self.input_target_pressure,
+            control.get('kp', 1.0), control.get('ki', 0.0), control.get('kd', 0.0),
+            control.get('out_min', 0.0), control.get('out_max', 3000.0), control.get('bias', 0.0),
+            control.get('out_scale', 1.0), ff_point, ff.get('gain', 0.0), ff.get('ref', 0.0))
+        if self.control_loop is None:
+            logging.error(f"Pressure control for VFD '{self.id}' unavailable, falling back to target RPM")
+            self.input_target_pressure = None
+
+    def set_control_gains(self, kp, ki, kd):
+        """調整差壓 PID 增益 (供 API 使用)，成功返回 True"""
+        return hal_bus.set_control_gains(self.control_loop, kp, ki, kd)
+
+    def _update_pressure_control(self):
+        """把目標差壓與啟用狀態交給 HAL 控制迴圈，PID 本身在 HAL 控制執行緒中執行"""
+        state = (self.input_enable, self.input_target_pressure)
+        if state != self._control_state:
+            hal_bus.set_control_target(self.control_loop, self.input_target_pressure)
+            hal_bus.enable_control(self.control_loop, self.input_enable)
+            if not self.input_enable:
+                # 停用時控制迴圈保持最後的設定值，另外寫入 0 停止泵浦
+                hal_lib.hal_modbus_write_register(self.ctx, 0x1000, 0)
+            self._control_state = state
+        status = hal_bus.control_status(self.control_loop)
+        if status is not None:
+            self.output_control_rpm = status['output']
+            self.output_pressure = status['pv']
+        self.output_status = "Enabled" if self.input_enable else "Disabled"
+
     def _simulate_pump_operation(self):
         """模擬泵浦運行，用於沒有硬體時的測試"""
         import random
@@ -1,5 +1,6 @@
 
 from .base_block import BaseBlock
+from . import hal_bus
 import ctypes
 import logging
 
@@ -31,8 +32,21 @@ class TempSensorBlock(BaseBlock):
     def __init__(self, block_id, config):
         super().__init__(block_id, config)
         self.device = config.get('device', '/dev/ttyTHS1')
+        self.c_device = self.device.encode('utf-8')
         self.modbus_address = config.get('modbus_address')
         self.register = config.get('register', 0) # 假設溫度讀數在 register 0
+        self.scale = config.get('scale', 0.1) # 假設單位為 0.1°C
+
+        # 向 HAL 排程器註冊量測點，由引擎每週期統一輪詢
+        self.point = None
+        if self.modbus_address is not None:
+            self.point = hal_bus.register_point(self.device, self.modbus_address, self.register,
+                                                hal_bus.HAL_VALUE_U16, self.scale,
+                                                config.get('poll_period_ms', 0),
+                                                config.get('priority', 0),
+                                                config.get('deadband', 0.0),
+                                                config.get('hysteresis', 0.0),
+                                                config.get('filter'))
         
         # Output
         self.output_temperature = 0.0
@@ -41,12 +55,14 @@ class TempSensorBlock(BaseBlock):
 
     def update(self):
         try:
-            if c_lib:
-                # 將 Python 字串轉換為 C 的 char*
-                c_device = self.device.encode('utf-8')
-
-                # 呼叫 C 函式
-                temp = c_lib.modbus_read_temperature(c_device, self.modbus_address, self.register)
+            if self.point is not None:
+                temp = hal_bus.read_point(self.point)
+                self.output_temperature = temp if temp is not None else -1.0
+                self.output_status = "Enabled"
+                self.output_health = "OK" if temp is not None else "Critical"
+            elif c_lib:
+                # 呼叫 C 函式 (device 字串已在初始化時轉換為 C 的 char*)
+                temp = c_lib.modbus_read_temperature(self.c_device, self.modbus_address, self.register)
                 self.output_temperature = temp
                 self.output_status = "Enabled"
                 self.output_health = "OK"
@@ -11,6 +11,7 @@ import can
 from dataclasses import dataclass
 import threading
 import time
+from blocks import hal_bus
 
 logger = logging.getLogger(__name__)
 
@@ -281,12 +282,13 @@ class MQTTHandler:
     """MQTT 處理器 - 數據上傳和遠端監控"""
     
     def __init__(self, broker: str, port: int = 8883, username: str = None, 
-                 password: str = None, use_tls: bool = True):
+                 password: str = None, use_tls: bool = True, telemetry_topic: str = "cdu/telemetry"):
         self.broker = broker
         self.port = port
         self.username = username
         self.password = password
         self.use_tls = use_tls
+        self.telemetry_topic = telemetry_topic
         self.client = mqtt.Client()
         self.connected = False
         self.message_handlers: Dict[str, Callable] = {}
@@ -317,6 +319,7 @@ class MQTTHandler:
             # 訂閱主題
             self.client.subscribe(f"cdu/commands/{node_id}")
             self.client.subscribe("cdu/commands/broadcast")
+            self.client.subscribe(f"{self.telemetry_topic}/+")
             
             logger.info(f"MQTT client started, connecting to {self.broker}:{self.port}")
             
@@ -340,6 +343,13 @@ class MQTTHandler:
         """MQTT訊息回調"""
         try:
             topic = msg.topic
+            # 遙測 frame 為二進位，不經過 JSON 解析
+            if topic.startswith(f"{self.telemetry_topic}/"):
+                handler = self.message_handlers.get('telemetry')
+                if handler:
+                    handler(topic[len(self.telemetry_topic) + 1:], msg.payload)
+                return
+
             payload = json.loads(msg.payload.decode('utf-8'))
             
             # 根據主題分發訊息
@@ -389,6 +399,27 @@ class MQTTHandler:
         except Exception as e:
             logger.error(f"Failed to publish MQTT metrics: {e}")
             
+    def publish_telemetry(self, node_id: str, frame):
+        """發布遙測 frame (hal_telemetry 編碼的二進位快照差值)"""
+        if not self.connected:
+            return
+            
+        try:
+            # 差值 frame 遺失時由接收端要求關鍵 frame，不需要 QoS 1 的重送
+            self.client.publish(f"{self.telemetry_topic}/{node_id}", bytes(frame), qos=0)
+        except Exception as e:
+            logger.error(f"Failed to publish telemetry frame: {e}")
+            
+    def publish_command(self, target_node: str, command: Dict[str, Any]):
+        """發送指令給指定節點"""
+        if not self.connected:
+            return
+            
+        try:
+            self.client.publish(f"cdu/commands/{target_node}", json.dumps(command), qos=1)
+        except Exception as e:
+            logger.error(f"Failed to publish command to {target_node}: {e}")
+            
     def register_handler(self, message_type: str, handler: Callable):
         """註冊訊息處理器"""
         self.message_handlers[message_type] = handler
@@ -415,7 +446,8 @@ class ClusterCommunication:
             broker=mqtt_config['broker'],
             port=mqtt_config['port'],
             username=mqtt_config['username'],
-            use_tls=mqtt_config['use_tls']
+            use_tls=mqtt_config['use_tls'],
+            telemetry_topic=mqtt_config.get('topics', {}).get('telemetry', 'cdu/telemetry')
         )
         
         # 訊息處理器
@@ -448,6 +480,7 @@ class ClusterCommunication:
         
         # MQTT 處理器
         self.mqtt_handler.register_handler('command', self._handle_mqtt_command)
+        self.mqtt_handler.register_handler('telemetry', self._handle_telemetry)
         
     def _handle_heartbeat(self, source_node: str, term: int, timestamp: int):
         """處理心跳訊息"""
@@ -469,10 +502,33 @@ class ClusterCommunication:
             
     def _handle_mqtt_command(self, topic: str, payload: Dict[str, Any]):
         """處理MQTT指令"""
+        if payload.get('command') == 'telemetry_keyframe':
+            # 其他節點遺失了本節點的遙測 frame，下一個 frame 送出全部量測點
+            hal_bus.request_telemetry_keyframe()
+            return
+            
         handler = self.message_handlers.get('mqtt_command')
         if handler:
             handler(topic, payload)
             
+    def _handle_telemetry(self, source_node: str, frame: bytes):
+        """處理其他節點的遙測 frame"""
+        if source_node == self.node_id:
+            return
+            
+        cycles, info = hal_bus.decode_telemetry(frame)
+        if cycles == -2:
+            # 差值 frame 的前一個 frame 遺失 (或剛加入叢集)，要求來源節點送出關鍵 frame
+            self.mqtt_handler.publish_command(source_node, {'command': 'telemetry_keyframe', 'from': self.node_id})
+            return
+        if cycles < 0:
+            logger.warning(f"Invalid telemetry frame from {source_node} ({len(frame)} bytes)")
+            return
+            
+        handler = self.message_handlers.get('telemetry')
+        if handler:
+            handler(source_node, info)
+            
     def send_heartbeat(self, term: int):
         """發送心跳 (透過CAN Bus)"""
         self.can_handler.send_heartbeat(self.node_id, term)
@@ -497,6 +553,10 @@ class ClusterCommunication:
         """發布指標 (透過MQTT)"""
         self.mqtt_handler.publish_metrics(self.node_id, metrics)
         
+    def publish_telemetry(self, frame):
+        """發布遙測 frame (透過MQTT)"""
+        self.mqtt_handler.publish_telemetry(self.node_id, frame)
+        
     def register_handler(self, message_type: str, handler: Callable):
         """註冊訊息處理器"""
         self.message_handlers[message_type] = handler
\ No newline at end of file
@@ -11,6 +11,7 @@ from typing import Dict, List, Optional, Any
 from datetime import datetime, timedelta
 import asyncio
 import importlib
+from blocks import hal_bus
 
 # 設定日誌
 logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
@@ -294,8 +295,26 @@ class DistributedCDUEngine:
         self.health_score = 1.0
         
         # 功能區塊 (保持原有架構)
+        # 模擬匯流排必須在 Block 註冊量測點 (開啟串口) 之前設定
+        hal_bus.configure_simulator((self.config.get('HAL') or {}).get('simulator'))
+        # 共享快照：擷取程序發布，其他 API 程序只讀取，不開啟串口
+        hal_bus.configure_shared_snapshot((self.config.get('HAL') or {}).get('shared_snapshot'))
+        # 串口線路設定 (baud / parity / stop bits) 在開啟串口之前套用
+        hal_bus.configure_ports((self.config.get('HAL') or {}).get('ports'), self.config.get('FunctionBlocks', []))
+        # 匯流排探測在註冊量測點之前完成，排程器才能略過不存在的 slave
+        hal_bus.configure_discovery((self.config.get('HAL') or {}).get('discovery'),
+                                    self.config.get('FunctionBlocks', []))
+        # 預先編譯的量測點表：一次安裝全部量測點與排程計畫，Block 註冊時直接取得表中的 handle
+        hal_bus.configure_point_table((self.config.get('HAL') or {}).get('point_table'))
         self.blocks = {}
         self._load_function_blocks()
+
+        # 節點間遙測：HAL 把快照表編碼成二進位差值 frame，由 attach_telemetry() 設定的發送函式送出
+        self.telemetry_config = (self.config.get('Communication') or {}).get('telemetry') or {}
+        self.telemetry_enabled = hal_bus.configure_telemetry(self.telemetry_config,
+                                                             self._node_number(self.node_id))
+        self.telemetry_sink = None
+        self._next_telemetry = 0.0
         
         # 運行狀態
         self.running = False
@@ -303,6 +322,11 @@ class DistributedCDUEngine:
         
         logger.info(f"Distributed CDU Engine initialized for node {self.node_id}")
         
+    @staticmethod
+    def _node_number(node_id: str) -> int:
+        """節點編號 (CDU_01 -> 1)，與 CAN ID 的規則相同"""
+        return int(node_id.split('_')[1])
+        
     def _load_config(self, config_path: str) -> Dict:
         """載入配置檔"""
         with open(config_path, 'r', encoding='utf-8') as f:
@@ -339,6 +363,13 @@ class DistributedCDUEngine:
     def start(self):
         """啟動分散式CDU引擎"""
         self.running = True
+
+        # 由 HAL 的串口執行緒在背景擷取，控制迴圈只讀取快照表
+        hal_config = self.config.get('HAL') or {}
+        hal_bus.start_acquisition(hal_config.get('acquisition_period_ms', 1000),
+                                  hal_config.get('cpu_affinity'))
+        # 泵浦的差壓 PID 由 HAL 控制執行緒以固定頻率執行
+        hal_bus.start_control(hal_config.get('control_rate_hz', 50))
         
         # 啟動各個執行緒 (暫時停用Raft算法)
         # threading.Thread(target=self._raft_loop, daemon=True).start()  # 停用Raft選舉
@@ -368,6 +399,10 @@ class DistributedCDUEngine:
         """控制迴圈 (保持原有架構)"""
         while self.running:
             try:
+                # 未啟動背景擷取時，先由 HAL 以合併後的 frame 輪詢所有已註冊的量測點
+                hal_bus.poll()
+                hal_bus.forward_log()
+
                 # 更新所有功能區塊
                 for block_id, block in self.blocks.items():
                     logger.debug(f"Updating block: {block_id}")
@@ -471,7 +506,27 @@ class DistributedCDUEngine:
     def _handle_network_communication(self):
         """處理網路通訊"""
         # 實際實現中應處理CAN Bus、Modbus TCP、MQTT等協定
-        pass
+        self._publish_telemetry()
+        
+    def _publish_telemetry(self):
+        """每 publish_interval_ms 把快照表加入遙測 frame，frame 完成時交給發送函式"""
+        if not self.telemetry_enabled or self.telemetry_sink is None:
+            return
+        now = time.time()
+        if now < self._next_telemetry:
+            return
+        self._next_telemetry = now + self.telemetry_config.get('publish_interval_ms', 1000) / 1000.0
+        frame = hal_bus.encode_telemetry()
+        if frame is not None:
+            self.telemetry_sink(frame)
+            
+    def attach_telemetry(self, sink):
+        """設定遙測 frame 的發送函式 (例如 ClusterCommunication.publish_telemetry)"""
+        self.telemetry_sink = sink
+        
+    def get_peer_telemetry(self, node_id: str) -> Optional[List]:
+        """其他節點最新的量測點 (value, quality, timestamp_us)，依 handle 排列；尚未收到時返回 None"""
+        return hal_bus.peer_points(self._node_number(node_id))
         
     def get_node_status(self) -> Dict:
         """獲取節點狀態"""
@@ -516,4 +571,5 @@ class DistributedCDUEngine:
     def stop(self):
         """停止引擎"""
         logger.info(f"Stopping Distributed CDU Engine for {self.node_id}")
-        self.running = False
\ No newline at end of file
+        self.running = False
+        hal_bus.stop_acquisition()
\ No newline at end of file
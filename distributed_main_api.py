@@ -69,6 +69,7 @@ class DistributedCDUAPI:
         
         # 啟動集群通訊
         self.communication.start()
+        self.engine.attach_telemetry(self.communication.publish_telemetry)
         
         # 註冊通訊處理器
         self._register_communication_handlers()
@@ -1,11 +1,27 @@
 import yaml
 import time
 import importlib
+import re
 import logging
+from blocks import hal_bus
 
 # 設定日誌
 logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
 
+def load_block_class(block_type):
+    """動態載入 Block Class (hal/tools/gen_point_table.py 也以此建立 Block)"""
+    # 轉換 BlockType (e.g., PumpVFDBlock) to module_name (e.g., pump_vfd)
+    # 簡化的映射方式
+    if block_type == 'PumpVFDBlock':
+        module_name = "blocks.pump_vfd"
+    else:
+        # 通用轉換邏輯
+        type_without_block = block_type.replace('Block', '')
+        module_name_snake_case = re.sub('([A-Z])', r'_\1', type_without_block).lower().lstrip('_')
+        module_name = f"blocks.{module_name_snake_case}"
+    module = importlib.import_module(module_name)
+    return getattr(module, block_type)
+
 class ControlEngine:
     def __init__(self, config_path):
         self.blocks = {}
@@ -16,6 +32,19 @@ class ControlEngine:
         with open(config_path, 'r', encoding='utf-8') as f:
             config = yaml.safe_load(f)
         
+        # HAL 背景擷取設定
+        self.hal_config = config.get('HAL') or {}
+        # 模擬匯流排必須在 Block 註冊量測點 (開啟串口) 之前設定
+        hal_bus.configure_simulator(self.hal_config.get('simulator'))
+        # 共享快照：擷取程序發布，其他 API 程序只讀取，不開啟串口
+        hal_bus.configure_shared_snapshot(self.hal_config.get('shared_snapshot'))
+        # 串口線路設定 (baud / parity / stop bits) 在開啟串口之前套用
+        hal_bus.configure_ports(self.hal_config.get('ports'), config.get('FunctionBlocks', []))
+        # 匯流排探測在註冊量測點之前完成，排程器才能略過不存在的 slave
+        hal_bus.configure_discovery(self.hal_config.get('discovery'), config.get('FunctionBlocks', []))
+        # 預先編譯的量測點表 (make point-table)：一次安裝全部量測點與排程計畫，Block 註冊時直接取得表中的 handle
+        hal_bus.configure_point_table(self.hal_config.get('point_table'))
+
         for block_conf in config.get('FunctionBlocks', []):
             block_id = block_conf.get('id')
             block_type = block_conf.get('type')
@@ -24,22 +53,10 @@ class ControlEngine:
                 logging.warning(f"Skipping invalid block config: {block_conf}")
                 continue
 
-            # 動態載入並實例化 Block Class
-            # 轉換 BlockType (e.g., PumpVFDBlock) to module_name (e.g., pump_vfd)
-            # 簡化的映射方式
-            if block_type == 'PumpVFDBlock':
-                module_name = "blocks.pump_vfd"
-            else:
-                # 通用轉換邏輯
-                type_without_block = block_type.replace('Block', '')
-                import re
-                module_name_snake_case = re.sub('([A-Z])', r'_\1', type_without_block).lower().lstrip('_')
-                module_name = f"blocks.{module_name_snake_case}"
             class_name = block_type
             
             try:
-                module = importlib.import_module(module_name)
-                BlockClass = getattr(module, class_name)
+                BlockClass = load_block_class(block_type)
                 self.blocks[block_id] = BlockClass(block_id, block_conf)
                 logging.info(f"Loaded Block: '{block_id}' of type '{class_name}'")
             except (ImportError, AttributeError) as e:
@@ -47,7 +64,21 @@ class ControlEngine:
 
     def run(self):
         logging.info("Control Engine Started...")
+
+        # 由 HAL 的串口執行緒在背景擷取，控制迴圈只讀取快照表
+        hal_bus.start_acquisition(self.hal_config.get('acquisition_period_ms', 1000),
+                                  self.hal_config.get('cpu_affinity'))
+        # 泵浦的差壓 PID 由 HAL 控制執行緒以固定頻率執行，不受這個 1 秒迴圈影響
+        hal_bus.start_control(self.hal_config.get('control_rate_hz', 50))
+
         while True:
+            # 未啟動背景擷取時，先由 HAL 以合併後的 frame 輪詢所有已註冊的量測點
+            try:
+                hal_bus.poll()
+            except Exception as e:
+                logging.error(f"Error polling HAL points: {e}")
+            hal_bus.forward_log()
+
             for block_id, block in self.blocks.items():
                 try:
                     block.update()
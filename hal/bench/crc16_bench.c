@@ -0,0 +1,67 @@
+// CRC16 微基準測試：比較原始逐位元版本、查表版本與 slice-by-4/8
+// 用法: crc16_bench [iterations]
+
+#include "../hal_crc16.h"
+#include "../hal_platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef uint16_t (*crc_fn)(const uint8_t*, size_t);
+
+static const struct {
+    const char* name;
+    crc_fn fn;
+} g_impls[] = {
+    { "bitwise", hal_crc16_bitwise },
+    { "table",   hal_crc16_table },
+    { "slice4",  hal_crc16_slice4 },
+    { "slice8",  hal_crc16_slice8 },
+    { "auto",    hal_crc16 },
+};
+
+// 8: FC03 請求, 255: 125 暫存器回應, 260: Modbus TCP 轉 RTU 的最大 ADU
+static const size_t g_sizes[] = { 6, 8, 255, 260 };
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+    uint8_t buf[260];
+    for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (uint8_t)(i * 37 + 11);
+
+    // 正確性：所有實作必須與原始版本一致
+    for (size_t s = 0; s < sizeof(g_sizes) / sizeof(g_sizes[0]); s++) {
+        for (size_t len = 0; len <= g_sizes[s]; len++) {
+            uint16_t expect = hal_crc16_bitwise(buf, len);
+            for (size_t k = 1; k < sizeof(g_impls) / sizeof(g_impls[0]); k++) {
+                if (g_impls[k].fn(buf, len) != expect) {
+                    printf("MISMATCH: %s len %zu\n", g_impls[k].name, len);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("%-8s %6s %12s %10s %8s\n", "impl", "bytes", "ns/frame", "MB/s", "speedup");
+    for (size_t s = 0; s < sizeof(g_sizes) / sizeof(g_sizes[0]); s++) {
+        size_t len = g_sizes[s];
+        long iters = iterations * 8 / (long)(len + 8);
+        double base_ns = 0.0;
+
+        for (size_t k = 0; k < sizeof(g_impls) / sizeof(g_impls[0]); k++) {
+            volatile uint16_t sink = 0;
+            uint64_t start = hal_time_us();
+            for (long i = 0; i < iters; i++) {
+                buf[0] = (uint8_t)i;
+                sink ^= g_impls[k].fn(buf, len);
+            }
+            uint64_t elapsed = hal_time_us() - start;
+            (void)sink;
+
+            double ns = iters > 0 ? (double)elapsed * 1000.0 / (double)iters : 0.0;
+            double mbps = elapsed > 0 ? (double)len * (double)iters / (double)elapsed : 0.0;
+            if (k == 0) base_ns = ns;
+            printf("%-8s %6zu %12.1f %10.1f %7.1fx\n", g_impls[k].name, len, ns, mbps,
+                   ns > 0.0 ? base_ns / ns : 0.0);
+        }
+    }
+    return 0;
+}
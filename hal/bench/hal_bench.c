@@ -0,0 +1,314 @@
+// HAL 匯流排基準測試：比較三種讀取 N 個量測點的方式
+//   legacy    每個量測點呼叫一次 modbus_read_temperature (一個 FC03 讀一個暫存器)
+//   batched   每個 slave 呼叫一次 hal_modbus_read_sensors (一個 FC03 讀整段)
+//   scheduled 註冊量測點後每週期呼叫 hal_sched_poll (排程器合併 frame)
+// 每種方式報告 transactions/sec、週期時間與單筆交易延遲的 p50/p99/p999、每筆交易的 CPU 時間。
+//
+// 用法: hal_bench [-p points] [-c cycles] [-r] [-d device]
+//   預設在模擬匯流排 (sim://bench) 與虛擬串口對 (POSIX pty，另一端由模擬器回應) 上各跑一次
+//   -r  模擬匯流排依 baud 與處理時間實際等待 (量測實際週期時間；預設只量測軟體開銷)
+//       未加 -r 時模擬匯流排的交易延遲是模擬器依 baud 計算的模型值，欄位標為 "mdl"，不是量測值
+//   -d  改為只測指定的實體串口或 tcp:// 端點 (需外接 slave，位址 1 起、暫存器 0 起)
+
+#ifndef _WIN32
+#define _GNU_SOURCE // posix_openpt/ptsname
+#endif
+
+#include "../hal_log.h"
+#include "../hal_modbus.h"
+#include "../hal_modbus_sim.h"
+#include "../hal_platform.h"
+#include "../hal_port.h"
+#include "../hal_sched.h"
+#include "../hal_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_POINTS_PER_SLAVE 10
+#define BENCH_MAX_CYCLES 100000
+
+typedef struct {
+    const char* device;
+    int points;
+    int slaves;
+} bench_ctx_t;
+
+typedef struct {
+    const char* name;
+    int (*setup)(bench_ctx_t* ctx);     // 返回每週期的交易數
+    void (*cycle)(bench_ctx_t* ctx);
+} bench_path_t;
+
+static uint32_t g_cycle_us[BENCH_MAX_CYCLES];
+
+// 行程的 CPU 時間 (user + system，微秒)
+static uint64_t bench_cpu_us(void) {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) / 10;
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+#endif
+}
+
+static int slave_points(const bench_ctx_t* ctx, int s) {
+    int rest = ctx->points - s * BENCH_POINTS_PER_SLAVE;
+    return rest < BENCH_POINTS_PER_SLAVE ? rest : BENCH_POINTS_PER_SLAVE;
+}
+
+static int legacy_setup(bench_ctx_t* ctx) {
+    return ctx->points;
+}
+
+static void legacy_cycle(bench_ctx_t* ctx) {
+    for (int i = 0; i < ctx->points; i++) {
+        modbus_read_temperature(ctx->device, 1 + i / BENCH_POINTS_PER_SLAVE, i % BENCH_POINTS_PER_SLAVE);
+    }
+}
+
+static int batched_setup(bench_ctx_t* ctx) {
+    return ctx->slaves;
+}
+
+static void batched_cycle(bench_ctx_t* ctx) {
+    hal_sensor_map_t map[BENCH_POINTS_PER_SLAVE];
+    float out[BENCH_POINTS_PER_SLAVE];
+    for (int k = 0; k < BENCH_POINTS_PER_SLAVE; k++) {
+        map[k].offset = k;
+        map[k].type = HAL_VALUE_U16;
+        map[k].scale = 0.1f;
+    }
+    for (int s = 0; s < ctx->slaves; s++) {
+        int n = slave_points(ctx, s);
+        hal_modbus_read_sensors(ctx->device, 1 + s, 0, n, map, n, out);
+    }
+}
+
+static int scheduled_setup(bench_ctx_t* ctx) {
+    hal_point_clear();
+    for (int i = 0; i < ctx->points; i++) {
+        hal_point_register(ctx->device, 1 + i / BENCH_POINTS_PER_SLAVE, i % BENCH_POINTS_PER_SLAVE,
+                           HAL_VALUE_U16, 0.1f);
+    }
+    return hal_sched_frame_count();
+}
+
+static void scheduled_cycle(bench_ctx_t* ctx) {
+    (void)ctx;
+    hal_sched_poll();
+}
+
+static const bench_path_t g_paths[] = {
+    { "legacy",    legacy_setup,    legacy_cycle },
+    { "batched",   batched_setup,   batched_cycle },
+    { "scheduled", scheduled_setup, scheduled_cycle },
+};
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static uint32_t percentile(const uint32_t* sorted, int n, double p) {
+    if (n == 0) return 0;
+    int idx = (int)(p * n + 0.999999) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return sorted[idx];
+}
+
+// 本次執行在 device 上累計的串口統計
+static int port_stats(const char* device, hal_stats_t* out) {
+    hal_stats_t entries[HAL_STATS_MAX_ENTRIES];
+    int n = hal_get_stats(entries, HAL_STATS_MAX_ENTRIES);
+    for (int i = 0; i < n; i++) {
+        if (entries[i].slave == -1 && strcmp(entries[i].device, device) == 0) {
+            *out = entries[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// modeled 非 0 時交易延遲來自模擬器的傳輸時間模型 (不實際等待)，欄位標為 "mdl"
+static void run_device(const char* title, const char* device, int points, int cycles, int modeled) {
+    bench_ctx_t ctx = { device, points, (points + BENCH_POINTS_PER_SLAVE - 1) / BENCH_POINTS_PER_SLAVE };
+
+    printf("== %s: %d points on %d slaves, %d cycles ==\n", title, ctx.points, ctx.slaves, cycles);
+    if (modeled) printf("mdl p50/p99/p999: transaction latency modeled from baud rate, not measured (use -r)\n");
+    printf("%-10s %8s %10s %9s %9s %9s %8s %8s %8s %10s\n", "path", "tx/cycle", "tx/s",
+           "cyc p50", "cyc p99", "cyc p999", modeled ? "mdl p50" : "tx p50", modeled ? "mdl p99" : "tx p99",
+           modeled ? "mdl p999" : "tx p999", "cpu us/tx");
+
+    for (size_t k = 0; k < sizeof(g_paths) / sizeof(g_paths[0]); k++) {
+        const bench_path_t* path = &g_paths[k];
+        int tx_per_cycle = path->setup(&ctx);
+
+        // 暖機一個週期 (開啟串口、建立模擬 slave)
+        path->cycle(&ctx);
+        hal_stats_reset();
+
+        uint64_t cpu_start = bench_cpu_us();
+        uint64_t wall_start = hal_time_us();
+        for (int c = 0; c < cycles; c++) {
+            uint64_t t = hal_time_us();
+            path->cycle(&ctx);
+            g_cycle_us[c] = (uint32_t)(hal_time_us() - t);
+        }
+        uint64_t wall_us = hal_time_us() - wall_start;
+        uint64_t cpu_us = bench_cpu_us() - cpu_start;
+
+        hal_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        port_stats(device, &stats);
+        const hal_latency_summary_t* lat = &stats.latency[HAL_STATS_LAT_FRAME];
+        uint64_t tx = stats.requests;
+
+        qsort(g_cycle_us, (size_t)cycles, sizeof(uint32_t), cmp_u32);
+        printf("%-10s %8d %10.0f %9u %9u %9u %8u %8u %8u %10.2f\n", path->name, tx_per_cycle,
+               wall_us > 0 ? (double)tx * 1e6 / (double)wall_us : 0.0,
+               percentile(g_cycle_us, cycles, 0.50), percentile(g_cycle_us, cycles, 0.99),
+               percentile(g_cycle_us, cycles, 0.999), lat->p50_us, lat->p99_us, lat->p999_us,
+               tx > 0 ? (double)cpu_us / (double)tx : 0.0);
+        if (stats.responses != tx) {
+            printf("           %llu of %llu transactions failed\n",
+                   (unsigned long long)(tx - stats.responses), (unsigned long long)tx);
+        }
+    }
+    hal_point_clear();
+    printf("\n");
+}
+
+#ifndef _WIN32
+
+// 虛擬串口對：HAL 開啟 pty 的 slave 端，這個執行緒在 master 端以模擬器回應
+static int g_pty_master = -1;
+static atomic_int g_pty_running = 0;
+static hal_sim_bus_t* g_pty_bus = NULL;
+
+// RTU 請求長度：FC16 依 byte count 決定，其餘為 8 bytes
+static int pty_request_len(const uint8_t* buf, int have) {
+    if (have >= 7 && buf[1] == 0x10) return 9 + buf[6];
+    return 8;
+}
+
+static void pty_slave_main(void* arg) {
+    (void)arg;
+    uint8_t buf[512];
+    int have = 0;
+    while (atomic_load(&g_pty_running)) {
+        struct pollfd pfd = { g_pty_master, POLLIN, 0 };
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        int got = (int)read(g_pty_master, buf + have, sizeof(buf) - (size_t)have);
+        if (got <= 0) continue;
+        have += got;
+        for (;;) {
+            int need = pty_request_len(buf, have);
+            if (have < need) break;
+            uint8_t resp[256];
+            int len = hal_sim_transact(g_pty_bus, buf, need, resp, sizeof(resp), 0, NULL);
+            if (len > 0 && write(g_pty_master, resp, (size_t)len) != len) break;
+            memmove(buf, buf + need, (size_t)(have - need));
+            have -= need;
+        }
+    }
+}
+
+static void run_pty(int points, int cycles) {
+    g_pty_master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (g_pty_master < 0 || grantpt(g_pty_master) != 0 || unlockpt(g_pty_master) != 0) {
+        printf("== pty: cannot create virtual serial pair, skipped ==\n\n");
+        return;
+    }
+    char device[64];
+    strncpy(device, ptsname(g_pty_master), sizeof(device) - 1);
+    device[sizeof(device) - 1] = '\0';
+
+    // 回應端不模擬傳輸時間，量測的是串口驅動、核心與 HAL 的開銷
+    hal_sim_config_t cfg;
+    hal_sim_default_config(&cfg);
+    cfg.latency_us = 0;
+    cfg.realtime = 0;
+    hal_sim_configure("bench-pty", &cfg);
+    g_pty_bus = hal_sim_open("bench-pty", 9600);
+
+    hal_thread_t thread;
+    atomic_store(&g_pty_running, 1);
+    if (hal_thread_create(&thread, pty_slave_main, NULL) != 0) {
+        printf("== pty: cannot start slave thread, skipped ==\n\n");
+        close(g_pty_master);
+        return;
+    }
+
+    char title[128];
+    snprintf(title, sizeof(title), "pty %s (simulated slave on master side)", device);
+    run_device(title, device, points, cycles, 0);
+
+    atomic_store(&g_pty_running, 0);
+    hal_thread_join(thread);
+    hal_port_close_all();
+    close(g_pty_master);
+}
+
+#endif
+
+int main(int argc, char** argv) {
+    int points = 100;
+    int cycles = 200;
+    int realtime = 0;
+    const char* device = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            points = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            realtime = 1;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        } else {
+            printf("usage: %s [-p points] [-c cycles] [-r] [-d device]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (points < 1 || points > HAL_MAX_POINTS) points = 100;
+    if (cycles < 1 || cycles > BENCH_MAX_CYCLES) cycles = 200;
+
+    // 錯誤注入與超時屬於正常情況，不輸出警告
+    hal_log_set_level(HAL_LOG_LEVEL_ERROR);
+
+    if (device != NULL) {
+        run_device(device, device, points, cycles, 0);
+        return 0;
+    }
+
+    hal_sim_config_t cfg;
+    hal_sim_default_config(&cfg);
+    cfg.realtime = realtime;
+    hal_sim_configure("sim://bench", &cfg);
+    run_device(realtime ? "sim://bench (9600 baud, realtime)" : "sim://bench (software overhead only)",
+               "sim://bench", points, cycles, !realtime);
+
+#ifndef _WIN32
+    run_pty(points, cycles);
+#endif
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "hal_acq.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include "hal_sched.h"
+#include "hal_write.h"
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct {
+    hal_port_t* port;
+    hal_thread_t thread;
+    int cpu;                        // -1 表示不綁定
+    atomic_ullong cycles;
+    atomic_ullong overruns;
+    atomic_uint last_cycle_us;
+    atomic_uint max_cycle_us;
+} acq_worker_t;
+
+typedef struct {
+    char device[64];
+    int cpu;
+} acq_affinity_t;
+
+static acq_worker_t g_workers[HAL_MAX_PORTS];
+static int g_worker_count = 0;
+static int g_period_ms = 1000;
+static atomic_int g_running = 0;
+static hal_mutex_t g_acq_lock = HAL_MUTEX_INIT;
+
+static acq_affinity_t g_affinity[HAL_MAX_PORTS];
+static int g_affinity_count = 0;
+
+static void acq_worker_main(void* arg) {
+    acq_worker_t* worker = (acq_worker_t*)arg;
+    if (worker->cpu >= 0 && hal_thread_pin_current(worker->cpu) != 0) {
+        HAL_WARN("Failed to pin acquisition thread for %s to CPU %d",
+                 hal_port_device(worker->port), worker->cpu);
+    }
+
+    while (atomic_load(&g_running)) {
+        uint64_t start = hal_time_us();
+        uint64_t next = 0;
+        hal_sched_poll_due(worker->port, g_period_ms, &next);
+
+        uint64_t now = hal_time_us();
+        uint32_t cycle_us = (uint32_t)(now - start);
+        atomic_store_explicit(&worker->last_cycle_us, cycle_us, memory_order_relaxed);
+        if (cycle_us > atomic_load_explicit(&worker->max_cycle_us, memory_order_relaxed)) {
+            atomic_store_explicit(&worker->max_cycle_us, cycle_us, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&worker->cycles, 1, memory_order_relaxed);
+
+        // 排程器返回最早的下一次截止時間；已經過了表示這條匯流排跟不上設定的週期
+        if (next == 0) next = now + (uint64_t)g_period_ms * 1000;
+        if (now >= next) {
+            atomic_fetch_add_explicit(&worker->overruns, 1, memory_order_relaxed);
+            continue;
+        }
+        // 分段等待，讓 hal_acq_stop() 能在 50ms 內生效；有寫入排入時立即醒來送出
+        while (atomic_load(&g_running) && (now = hal_time_us()) < next) {
+            int remain_ms = (int)((next - now + 999) / 1000);
+            if (hal_write_wait(worker->port, remain_ms < 50 ? remain_ms : 50) > 0) break;
+        }
+    }
+}
+
+// 查詢 device 設定的 CPU (呼叫者需持有 g_acq_lock)
+static int acq_affinity_for(const char* device) {
+    for (int i = 0; i < g_affinity_count; i++) {
+        if (strcmp(g_affinity[i].device, device) == 0) return g_affinity[i].cpu;
+    }
+    return -1;
+}
+
+int hal_acq_set_affinity(const char* device, int cpu) {
+    if (device == NULL) return -1;
+    if (cpu < 0) cpu = -1;
+
+    hal_mutex_lock(&g_acq_lock);
+    for (int i = 0; i < g_affinity_count; i++) {
+        if (strcmp(g_affinity[i].device, device) == 0) {
+            g_affinity[i].cpu = cpu;
+            hal_mutex_unlock(&g_acq_lock);
+            return 0;
+        }
+    }
+    if (g_affinity_count >= HAL_MAX_PORTS) {
+        hal_mutex_unlock(&g_acq_lock);
+        HAL_ERROR("Affinity table full, cannot pin %s", device);
+        return -1;
+    }
+    acq_affinity_t* entry = &g_affinity[g_affinity_count++];
+    memset(entry->device, 0, sizeof(entry->device));
+    strncpy(entry->device, device, sizeof(entry->device) - 1);
+    entry->cpu = cpu;
+    hal_mutex_unlock(&g_acq_lock);
+    return 0;
+}
+
+int hal_acq_start(int period_ms) {
+    hal_mutex_lock(&g_acq_lock);
+    if (atomic_load(&g_running)) {
+        hal_mutex_unlock(&g_acq_lock);
+        return -1;
+    }
+
+    g_period_ms = period_ms < HAL_ACQ_MIN_PERIOD_MS ? HAL_ACQ_MIN_PERIOD_MS : period_ms;
+
+    hal_port_t* ports[HAL_MAX_PORTS];
+    int n = hal_sched_ports(ports, HAL_MAX_PORTS);
+
+    atomic_store(&g_running, 1);
+    g_worker_count = 0;
+    for (int i = 0; i < n; i++) {
+        acq_worker_t* worker = &g_workers[g_worker_count];
+        worker->port = ports[i];
+        worker->cpu = acq_affinity_for(hal_port_device(ports[i]));
+        atomic_store(&worker->cycles, 0);
+        atomic_store(&worker->overruns, 0);
+        atomic_store(&worker->last_cycle_us, 0);
+        atomic_store(&worker->max_cycle_us, 0);
+        if (hal_thread_create(&worker->thread, acq_worker_main, worker) != 0) {
+            HAL_ERROR("Failed to start acquisition thread %d", i);
+            continue;
+        }
+        g_worker_count++;
+    }
+
+    if (g_worker_count == 0) {
+        atomic_store(&g_running, 0);
+        hal_mutex_unlock(&g_acq_lock);
+        return -1;
+    }
+
+    HAL_INFO("Acquisition started: %d port thread(s), period %d ms", g_worker_count, g_period_ms);
+    int started = g_worker_count;
+    hal_mutex_unlock(&g_acq_lock);
+    return started;
+}
+
+void hal_acq_stop(void) {
+    hal_mutex_lock(&g_acq_lock);
+    if (atomic_load(&g_running)) {
+        atomic_store(&g_running, 0);
+        for (int i = 0; i < g_worker_count; i++) {
+            hal_thread_join(g_workers[i].thread);
+        }
+        // 執行緒結束後仍在佇列中的寫入直接送出
+        for (int i = 0; i < g_worker_count; i++) {
+            hal_write_flush(g_workers[i].port);
+        }
+        g_worker_count = 0;
+        HAL_INFO("Acquisition stopped");
+    }
+    hal_mutex_unlock(&g_acq_lock);
+}
+
+int hal_acq_running(void) {
+    return atomic_load(&g_running);
+}
+
+// 不取 g_acq_lock：控制執行緒每個週期呼叫，hal_acq_stop 持有鎖等待 worker 結束時不能被阻塞
+// (g_period_ms 在 g_running 設為 1 之前寫入)
+int hal_acq_period_ms(void) {
+    return atomic_load(&g_running) ? g_period_ms : 0;
+}
+
+int hal_acq_owns_port(hal_port_t* port) {
+    int owned = 0;
+    hal_mutex_lock(&g_acq_lock);
+    if (atomic_load(&g_running)) {
+        for (int i = 0; i < g_worker_count && !owned; i++) {
+            owned = g_workers[i].port == port;
+        }
+    }
+    hal_mutex_unlock(&g_acq_lock);
+    return owned;
+}
+
+int hal_acq_stats(hal_acq_stats_t* out, int max) {
+    if (out == NULL || max <= 0) return 0;
+
+    hal_mutex_lock(&g_acq_lock);
+    int n = g_worker_count < max ? g_worker_count : max;
+    for (int i = 0; i < n; i++) {
+        acq_worker_t* worker = &g_workers[i];
+        memset(&out[i], 0, sizeof(out[i]));
+        strncpy(out[i].device, hal_port_device(worker->port), sizeof(out[i].device) - 1);
+        out[i].cpu = worker->cpu;
+        out[i].period_ms = (uint32_t)g_period_ms;
+        out[i].cycles = atomic_load_explicit(&worker->cycles, memory_order_relaxed);
+        out[i].overruns = atomic_load_explicit(&worker->overruns, memory_order_relaxed);
+        out[i].last_cycle_us = atomic_load_explicit(&worker->last_cycle_us, memory_order_relaxed);
+        out[i].max_cycle_us = atomic_load_explicit(&worker->max_cycle_us, memory_order_relaxed);
+    }
+    hal_mutex_unlock(&g_acq_lock);
+    return n;
+}
@@ -0,0 +1,49 @@
+#ifndef HAL_ACQ_H
+#define HAL_ACQ_H
+
+#include <stdint.h>
+
+// 背景擷取：計畫中每個串口各有一個輪詢執行緒，
+// 依固定週期執行 hal_sched_poll_port() 並把讀數寫入快照表。
+// Python 端只需呼叫 hal_get_snapshot()，控制迴圈不再被匯流排延遲拖住；
+// 各匯流排平行輪詢，整體週期取決於最慢的一條匯流排而非所有匯流排的總和。
+
+#define HAL_ACQ_MIN_PERIOD_MS 10
+
+// 一個擷取執行緒的運作統計
+typedef struct {
+    char device[64];
+    int32_t cpu;            // 綁定的 CPU，-1 表示未綁定
+    uint32_t period_ms;
+    uint64_t cycles;        // 完成的輪詢週期數
+    uint64_t overruns;      // 輪詢結束時下一個截止時間已過的次數 (匯流排跟不上)
+    uint32_t last_cycle_us; // 最近一次輪詢所花的時間
+    uint32_t max_cycle_us;
+} hal_acq_stats_t;
+
+// 指定 device 的擷取執行緒綁定到哪一個 CPU (cpu < 0 取消綁定)
+// 於下一次 hal_acq_start() 生效，成功返回 0，設定表已滿返回 -1
+int hal_acq_set_affinity(const char* device, int cpu);
+
+// 啟動背景擷取，period_ms 為未指定週期 (hal_point_set_rate) 的量測點的輪詢週期
+// 成功返回啟動的執行緒數量，已在運作或失敗返回 -1
+int hal_acq_start(int period_ms);
+
+// 停止所有擷取執行緒並等待其結束
+void hal_acq_stop(void);
+
+// 背景擷取是否運作中
+int hal_acq_running(void);
+
+// 背景擷取運作中時返回未指定週期的量測點的輪詢週期，未運作返回 0
+int hal_acq_period_ms(void);
+
+struct hal_port;
+
+// port 是否有運作中的擷取執行緒負責 (寫入佇列據此決定排入或同步寫入)
+int hal_acq_owns_port(struct hal_port* port);
+
+// 複製最多 max 個擷取執行緒的統計到 out，返回實際數量
+int hal_acq_stats(hal_acq_stats_t* out, int max);
+
+#endif // HAL_ACQ_H
@@ -0,0 +1,350 @@
+#include "hal_async.h"
+#include "hal_log.h"
+#include "hal_modbus.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include "hal_slmp.h"
+#include "hal_write.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+// 請求存放在固定的 slot 表中，由排入到取出結果都不搬動；
+// 工作執行緒依 ticket 順序執行自己 device 的 QUEUED slot，完成後把 slot 編號放入完成佇列。
+// 通知物件只在 g_async_lock 內改變狀態：完成佇列由空變為非空時觸發，取完時重設，
+// 因此「可讀 / signaled」與「有未取出的完成結果」一致，不會遺漏通知。
+// 工作執行緒閒置時自行結束並把表中的位置標為 WORKER_EXITED，下一次使用該位置時才 join。
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_DONE
+} async_slot_state_t;
+
+typedef struct {
+    int state;                  // async_slot_state_t
+    int worker;                 // 負責的工作執行緒
+    uint64_t submit_us;
+    hal_request_t req;
+    hal_completion_t done;
+} async_slot_t;
+
+typedef enum {
+    WORKER_FREE = 0,
+    WORKER_RUNNING,
+    WORKER_EXITED       // 執行緒已結束或正在結束，尚未 join
+} async_worker_state_t;
+
+typedef struct {
+    int state;          // async_worker_state_t
+    char device[64];
+    hal_thread_t thread;
+} async_worker_t;
+
+static async_slot_t g_slots[HAL_ASYNC_MAX_INFLIGHT];
+static int g_done[HAL_ASYNC_MAX_INFLIGHT];     // 完成佇列 (slot 編號，環形)
+static int g_done_head = 0;
+static int g_done_count = 0;
+static async_worker_t g_workers[HAL_MAX_PORTS];
+static uint64_t g_next_ticket = 1;
+static int g_stopping = 0;
+static hal_mutex_t g_async_lock = HAL_MUTEX_INIT;
+static hal_cond_t g_submit_cond = HAL_COND_INIT;   // 有新的請求排入或要求停止
+static hal_cond_t g_done_cond = HAL_COND_INIT;     // 有新的完成結果
+
+#ifdef _WIN32
+static HANDLE g_event = NULL;
+#else
+static int g_event_fd = -1;
+#endif
+
+// 建立通知物件 (呼叫者需持有 g_async_lock)，成功返回 0
+static int notifier_open(void) {
+#ifdef _WIN32
+    if (g_event == NULL) g_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (g_event == NULL) {
+        HAL_ERROR("Failed to create completion event (error %lu)", (unsigned long)GetLastError());
+        return -1;
+    }
+#else
+    if (g_event_fd < 0) g_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_event_fd < 0) {
+        HAL_ERROR("Failed to create completion eventfd: %s", strerror(errno));
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static void notifier_set(void) {
+#ifdef _WIN32
+    if (g_event != NULL) SetEvent(g_event);
+#else
+    uint64_t one = 1;
+    if (g_event_fd >= 0 && write(g_event_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+        HAL_WARN("Failed to signal completion eventfd: %s", strerror(errno));
+    }
+#endif
+}
+
+static void notifier_clear(void) {
+#ifdef _WIN32
+    if (g_event != NULL) ResetEvent(g_event);
+#else
+    uint64_t count;
+    if (g_event_fd >= 0 && read(g_event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        HAL_WARN("Failed to reset completion eventfd: %s", strerror(errno));
+    }
+#endif
+}
+
+static int request_valid(const hal_request_t* req) {
+    if (memchr(req->device, '\0', sizeof(req->device)) == NULL || req->device[0] == '\0') return 0;
+    switch (req->kind) {
+        case HAL_REQ_READ:
+            return req->count >= 1 && req->count <= HAL_MODBUS_MAX_READ_REGISTERS &&
+                   req->slave >= 0 && req->slave <= 255 && req->reg >= 0 && req->reg + req->count <= 0x10000;
+        case HAL_REQ_WRITE:
+            return req->count >= 1 && req->count <= HAL_MODBUS_MAX_WRITE_REGISTERS &&
+                   req->slave >= 0 && req->slave <= 255 && req->reg >= 0 && req->reg + req->count <= 0x10000;
+        case HAL_REQ_PLC_READ:
+            return req->count >= 1 && req->count <= HAL_ASYNC_MAX_REGISTERS &&
+                   memchr(req->address, '\0', sizeof(req->address)) != NULL && req->address[0] != '\0' &&
+                   hal_slmp_is_endpoint(req->device);
+        default:
+            return 0;
+    }
+}
+
+// 依 ticket 順序取得 worker 的下一個請求 (呼叫者需持有 g_async_lock)
+static async_slot_t* async_next(int worker) {
+    async_slot_t* next = NULL;
+    for (int i = 0; i < HAL_ASYNC_MAX_INFLIGHT; i++) {
+        async_slot_t* slot = &g_slots[i];
+        if (slot->state == SLOT_QUEUED && slot->worker == worker &&
+            (next == NULL || slot->done.ticket < next->done.ticket)) {
+            next = slot;
+        }
+    }
+    return next;
+}
+
+// 執行一個請求 (不持有 g_async_lock，串口鎖由各協定層取得)，成功返回 0
+static int async_execute(const hal_request_t* req, uint16_t* values) {
+    if (req->kind == HAL_REQ_PLC_READ) return hal_slmp_read(req->device, req->address, req->count, values);
+
+    hal_port_t* port = hal_port_get(req->device, 0);
+    if (port == NULL) return -1;
+    if (req->kind == HAL_REQ_READ) return hal_modbus_read_holding(port, req->slave, req->reg, req->count, values);
+
+    // 排入佇列時等待擷取執行緒送出；同步寫入時 ticket 為 0，返回值即為結果
+    uint32_t ticket;
+    int result = hal_write_submit_tracked(port, req->slave, req->reg, req->count, req->values, &ticket);
+    if (result != 0 || ticket == 0) return result;
+    result = hal_write_wait_done(ticket, HAL_ASYNC_WRITE_TIMEOUT_MS);
+    if (result == -2) {
+        HAL_WARN("Async write to %s slave %d reg 0x%04X not sent within %d ms",
+                 req->device, req->slave, req->reg, HAL_ASYNC_WRITE_TIMEOUT_MS);
+    }
+    return result;
+}
+
+// 把 slot 放入完成佇列並通知 (呼叫者需持有 g_async_lock)
+static void async_complete(async_slot_t* slot, int status) {
+    hal_completion_t* done = &slot->done;
+    done->status = status == 0 ? 0 : -1;
+    done->elapsed_us = (uint32_t)(hal_time_us() - slot->submit_us);
+    if (done->status != 0 || slot->req.kind == HAL_REQ_WRITE) {
+        memset(done->values, 0, sizeof(done->values));
+    }
+    slot->state = SLOT_DONE;
+
+    g_done[(g_done_head + g_done_count) % HAL_ASYNC_MAX_INFLIGHT] = (int)(slot - g_slots);
+    if (g_done_count++ == 0) notifier_set();
+    hal_cond_broadcast(&g_done_cond);
+}
+
+static void async_worker_main(void* arg) {
+    int worker = (int)(intptr_t)arg;
+
+    hal_mutex_lock(&g_async_lock);
+    uint64_t idle_since = hal_time_us();
+    while (!g_stopping) {
+        async_slot_t* slot = async_next(worker);
+        if (slot == NULL) {
+            // 沒有請求時 hal_submit 不會再把請求分給這條執行緒 (狀態在鎖內改變)
+            if (hal_time_us() - idle_since >= (uint64_t)HAL_ASYNC_IDLE_MS * 1000) break;
+            hal_cond_wait(&g_submit_cond, &g_async_lock, HAL_ASYNC_IDLE_MS);
+            continue;
+        }
+        // RUNNING 的 slot 只有這條執行緒會存取，執行期間不需要持有鎖
+        slot->state = SLOT_RUNNING;
+        hal_mutex_unlock(&g_async_lock);
+        int status = async_execute(&slot->req, slot->done.values);
+        hal_mutex_lock(&g_async_lock);
+        async_complete(slot, status);
+        idle_since = hal_time_us();
+    }
+    g_workers[worker].state = WORKER_EXITED;
+    hal_mutex_unlock(&g_async_lock);
+}
+
+// 取得 device 的工作執行緒，尚未啟動時啟動 (呼叫者需持有 g_async_lock)，失敗返回 -1
+static int async_worker_for(const char* device) {
+    int free_slot = -1;
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        if (g_workers[i].state == WORKER_RUNNING) {
+            if (strcmp(g_workers[i].device, device) == 0) return i;
+        } else if (free_slot < 0) {
+            free_slot = i;
+        }
+    }
+    if (free_slot < 0) {
+        HAL_ERROR("Async worker table full, cannot serve %s", device);
+        return -1;
+    }
+
+    // 已結束的執行緒設定 WORKER_EXITED 後只剩釋放鎖與返回，持有鎖 join 不會互相等待
+    async_worker_t* worker = &g_workers[free_slot];
+    if (worker->state == WORKER_EXITED) {
+        hal_thread_join(worker->thread);
+        worker->state = WORKER_FREE;
+    }
+    snprintf(worker->device, sizeof(worker->device), "%s", device);
+    if (hal_thread_create(&worker->thread, async_worker_main, (void*)(intptr_t)free_slot) != 0) {
+        HAL_ERROR("Failed to start async worker for %s", device);
+        return -1;
+    }
+    worker->state = WORKER_RUNNING;
+    return free_slot;
+}
+
+uint64_t hal_submit(const hal_request_t* req) {
+    if (req == NULL || !request_valid(req)) return 0;
+
+    hal_mutex_lock(&g_async_lock);
+    async_slot_t* slot = NULL;
+    for (int i = 0; i < HAL_ASYNC_MAX_INFLIGHT && slot == NULL; i++) {
+        if (g_slots[i].state == SLOT_FREE) slot = &g_slots[i];
+    }
+    int worker = -1;
+    if (slot == NULL || g_stopping || notifier_open() != 0 || (worker = async_worker_for(req->device)) < 0) {
+        hal_mutex_unlock(&g_async_lock);
+        if (slot == NULL) HAL_WARN("Async request queue full (%d in flight)", HAL_ASYNC_MAX_INFLIGHT);
+        return 0;
+    }
+
+    uint64_t ticket = g_next_ticket++;
+    slot->req = *req;
+    slot->worker = worker;
+    slot->submit_us = hal_time_us();
+    memset(&slot->done, 0, sizeof(slot->done));
+    slot->done.ticket = ticket;
+    slot->done.user_data = req->user_data;
+    slot->done.kind = req->kind;
+    slot->done.count = req->count;
+    slot->state = SLOT_QUEUED;
+    hal_cond_broadcast(&g_submit_cond);
+    hal_mutex_unlock(&g_async_lock);
+    return ticket;
+}
+
+intptr_t hal_completion_fd(void) {
+    hal_mutex_lock(&g_async_lock);
+    intptr_t fd = -1;
+    if (notifier_open() == 0) {
+#ifdef _WIN32
+        fd = (intptr_t)g_event;
+#else
+        fd = g_event_fd;
+#endif
+    }
+    hal_mutex_unlock(&g_async_lock);
+    return fd;
+}
+
+int hal_wait_completions(int timeout_ms) {
+    hal_mutex_lock(&g_async_lock);
+    if (timeout_ms > 0) {
+        uint64_t deadline = hal_time_us() + (uint64_t)timeout_ms * 1000;
+        uint64_t now;
+        while (g_done_count == 0 && (now = hal_time_us()) < deadline) {
+            hal_cond_wait(&g_done_cond, &g_async_lock, (int)((deadline - now + 999) / 1000));
+        }
+    }
+    int pending = g_done_count;
+    hal_mutex_unlock(&g_async_lock);
+    return pending;
+}
+
+int hal_drain_completions(hal_completion_t* out, int max) {
+    if (out == NULL || max <= 0) return 0;
+
+    hal_mutex_lock(&g_async_lock);
+    int n = 0;
+    while (n < max && g_done_count > 0) {
+        async_slot_t* slot = &g_slots[g_done[g_done_head]];
+        out[n++] = slot->done;
+        slot->state = SLOT_FREE;
+        g_done_head = (g_done_head + 1) % HAL_ASYNC_MAX_INFLIGHT;
+        g_done_count--;
+    }
+    if (g_done_count == 0) notifier_clear();
+    hal_mutex_unlock(&g_async_lock);
+    return n;
+}
+
+int hal_async_pending(void) {
+    hal_mutex_lock(&g_async_lock);
+    int pending = 0;
+    for (int i = 0; i < HAL_ASYNC_MAX_INFLIGHT; i++) {
+        if (g_slots[i].state != SLOT_FREE) pending++;
+    }
+    hal_mutex_unlock(&g_async_lock);
+    return pending;
+}
+
+int hal_async_workers(void) {
+    hal_mutex_lock(&g_async_lock);
+    int n = 0;
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        if (g_workers[i].state == WORKER_RUNNING) n++;
+    }
+    hal_mutex_unlock(&g_async_lock);
+    return n;
+}
+
+void hal_async_stop(void) {
+    hal_mutex_lock(&g_async_lock);
+    if (g_stopping) {
+        hal_mutex_unlock(&g_async_lock);
+        return;
+    }
+    g_stopping = 1;
+    hal_cond_broadcast(&g_submit_cond);
+    // g_stopping 期間 hal_submit 不會啟動新的執行緒，執行中的執行緒只會變為 WORKER_EXITED
+    hal_thread_t threads[HAL_MAX_PORTS];
+    int n = 0;
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        if (g_workers[i].state != WORKER_FREE) threads[n++] = g_workers[i].thread;
+    }
+    hal_mutex_unlock(&g_async_lock);
+
+    for (int i = 0; i < n; i++) hal_thread_join(threads[i]);
+
+    hal_mutex_lock(&g_async_lock);
+    for (int i = 0; i < HAL_ASYNC_MAX_INFLIGHT; i++) {
+        if (g_slots[i].state == SLOT_QUEUED) async_complete(&g_slots[i], -1);
+    }
+    for (int i = 0; i < HAL_MAX_PORTS; i++) g_workers[i].state = WORKER_FREE;
+    g_stopping = 0;
+    hal_mutex_unlock(&g_async_lock);
+}
@@ -0,0 +1,72 @@
+#ifndef HAL_ASYNC_H
+#define HAL_ASYNC_H
+
+#include <stdint.h>
+
+// 非同步請求：API 的單次讀寫 (例如 REST 的 R 暫存器讀寫) 以 hal_submit 排入，立即返回 ticket。
+// 每個 device 由一條 HAL 內部的工作執行緒依排入順序執行 (與背景擷取共用串口鎖與 TCP 連線)，
+// 工作執行緒閒置超過 HAL_ASYNC_IDLE_MS 後結束，下一個請求再啟動，不會因為用過的 device 而佔滿執行緒表。
+// 寫入經由寫入佇列 (hal_write_submit)：背景擷取負責該 port 時與其他設定值寫入一起由擷取執行緒送出，
+// 送出後才完成；沒有擷取執行緒時同步寫入。
+// 完成結果放入完成佇列，並通知一個可等待的物件：
+//   Linux：eventfd，有未取出的完成結果時可讀，asyncio 以 loop.add_reader() 監看
+//   Windows：manual-reset event，有未取出的完成結果時為 signaled
+// 呼叫端以 hal_drain_completions 依完成順序取出結果，不需要為每個請求佔用一條執行緒。
+
+#define HAL_ASYNC_MAX_INFLIGHT 64       // 已排入但尚未取出結果的請求上限
+#define HAL_ASYNC_MAX_REGISTERS 125     // 一個請求的暫存器數上限 (寫入為 123)
+#define HAL_ASYNC_IDLE_MS 1000          // 工作執行緒閒置多久後結束 (也是檢查停止旗標的間隔)
+#define HAL_ASYNC_WRITE_TIMEOUT_MS 5000 // 排入寫入佇列的寫入等待送出的上限，超過時以失敗完成
+
+typedef enum {
+    HAL_REQ_READ = 0,       // FC03 讀取 count 個保持暫存器
+    HAL_REQ_WRITE = 1,      // 經由寫入佇列寫入 count 個暫存器 (1 個時以 FC06，否則 FC16)
+    HAL_REQ_PLC_READ = 2    // SLMP 讀取 address 開始的 count 個 word
+} hal_request_kind_t;
+
+typedef struct {
+    int32_t kind;           // hal_request_kind_t
+    char device[64];        // 串口、"tcp://..." 或 "slmp://..." 端點
+    int32_t slave;          // Modbus slave / unit identifier (PLC 讀取不使用)
+    int32_t reg;            // 起始暫存器 (PLC 讀取不使用)
+    char address[16];       // PLC 讀取的裝置位址，例如 "R10000"
+    int32_t count;
+    uint16_t values[HAL_ASYNC_MAX_REGISTERS];  // 寫入的值
+    uint64_t user_data;     // 原樣帶回完成結果
+} hal_request_t;
+
+typedef struct {
+    uint64_t ticket;
+    uint64_t user_data;
+    int32_t kind;
+    int32_t status;         // 0 成功，-1 失敗
+    int32_t count;
+    uint32_t elapsed_us;    // 排入到完成所花的時間
+    uint16_t values[HAL_ASYNC_MAX_REGISTERS];  // 讀取結果
+} hal_completion_t;
+
+// 排入請求，內容會被複製，返回之後 req 可以重複使用
+// 返回 ticket (> 0)；參數無效、在途請求已達上限或無法啟動工作執行緒返回 0
+uint64_t hal_submit(const hal_request_t* req);
+
+// 完成通知的 eventfd (Linux) 或 event handle (Windows，轉為整數)，無法建立時返回 -1
+// 物件由 HAL 持有，呼叫端只等待，不可讀取、重設或關閉
+intptr_t hal_completion_fd(void);
+
+// 等待完成結果，timeout_ms 為 0 時不等待
+// 返回目前待取出的完成結果數量，超時返回 0
+int hal_wait_completions(int timeout_ms);
+
+// 依完成順序取出最多 max 筆結果，取完時通知物件回到未觸發狀態，返回取出的數量
+int hal_drain_completions(hal_completion_t* out, int max);
+
+// 已排入但尚未取出結果的請求數量
+int hal_async_pending(void);
+
+// 運作中的工作執行緒數量
+int hal_async_workers(void);
+
+// 停止所有工作執行緒 (執行中的請求會先完成，尚未執行的請求以失敗完成)
+void hal_async_stop(void);
+
+#endif // HAL_ASYNC_H
@@ -0,0 +1,132 @@
+#include "hal_change.h"
+#include "hal_platform.h"
+#include "hal_sched.h"
+#include "hal_snapshot.h"
+#include <string.h>
+
+// 每個量測點的回報狀態與環形緩衝區都由 g_change_lock 保護；
+// 每次取樣只在鎖內做幾次比較，沒有事件時不會喚醒消費端。
+
+typedef struct {
+    float deadband;
+    float hysteresis;
+    int reported;           // 是否已回報過
+    uint32_t last_quality;
+    float last_value;       // 上一次回報的值
+    int last_dir;           // 上一次回報的變化方向 (+1 / -1 / 0)
+} change_state_t;
+
+static change_state_t g_state[HAL_MAX_POINTS];
+static hal_change_t g_ring[HAL_CHANGE_RING_SIZE];
+static uint32_t g_head = 0;     // 下一筆寫入位置
+static uint32_t g_tail = 0;     // 下一筆讀取位置
+static uint64_t g_overflows = 0;
+static hal_mutex_t g_change_lock = HAL_MUTEX_INIT;
+static hal_cond_t g_change_cond = HAL_COND_INIT;
+
+int hal_point_set_deadband(int handle, float deadband, float hysteresis) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS || deadband < 0 || hysteresis < 0) return -1;
+    hal_mutex_lock(&g_change_lock);
+    g_state[handle].deadband = deadband;
+    g_state[handle].hysteresis = hysteresis;
+    hal_mutex_unlock(&g_change_lock);
+    return 0;
+}
+
+// 判斷新的取樣是否需要回報，需要時更新回報狀態 (呼叫者需持有 g_change_lock)
+static int change_due(change_state_t* st, uint32_t quality, float value) {
+    if (!st->reported || quality != st->last_quality) {
+        st->last_dir = 0;
+        return 1;
+    }
+    if (quality != HAL_QUALITY_GOOD) return 0;
+
+    float delta = value - st->last_value;
+    if (delta == 0) return 0;
+    int dir = delta > 0 ? 1 : -1;
+    float magnitude = delta > 0 ? delta : -delta;
+    float band = st->deadband;
+    if (st->last_dir != 0 && dir != st->last_dir) band += st->hysteresis;
+    if (magnitude < band) return 0;
+
+    st->last_dir = dir;
+    return 1;
+}
+
+void hal_change_sample(int handle, uint32_t quality, float value, uint32_t raw, uint64_t timestamp_us) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS) return;
+
+    hal_mutex_lock(&g_change_lock);
+    change_state_t* st = &g_state[handle];
+    if (!change_due(st, quality, value)) {
+        hal_mutex_unlock(&g_change_lock);
+        return;
+    }
+    st->reported = 1;
+    st->last_quality = quality;
+    if (quality == HAL_QUALITY_GOOD) st->last_value = value;
+
+    // 緩衝區滿時丟棄最舊的事件
+    if (g_head - g_tail >= HAL_CHANGE_RING_SIZE) {
+        g_tail++;
+        g_overflows++;
+    }
+    hal_change_t* ev = &g_ring[g_head & (HAL_CHANGE_RING_SIZE - 1)];
+    ev->handle = handle;
+    ev->quality = quality;
+    ev->value = value;
+    ev->raw = raw;
+    ev->timestamp_us = timestamp_us;
+    g_head++;
+
+    hal_cond_broadcast(&g_change_cond);
+    hal_mutex_unlock(&g_change_lock);
+}
+
+int hal_wait_changes(int timeout_ms) {
+    hal_mutex_lock(&g_change_lock);
+    if (g_head == g_tail && timeout_ms > 0) {
+        uint64_t deadline = hal_time_us() + (uint64_t)timeout_ms * 1000;
+        uint64_t now;
+        while (g_head == g_tail && (now = hal_time_us()) < deadline) {
+            hal_cond_wait(&g_change_cond, &g_change_lock, (int)((deadline - now + 999) / 1000));
+        }
+    }
+    int pending = (int)(g_head - g_tail);
+    hal_mutex_unlock(&g_change_lock);
+    return pending;
+}
+
+int hal_drain_changes(hal_change_t* out, int max) {
+    if (out == NULL || max <= 0) return 0;
+
+    hal_mutex_lock(&g_change_lock);
+    int n = 0;
+    while (n < max && g_tail != g_head) {
+        out[n++] = g_ring[g_tail & (HAL_CHANGE_RING_SIZE - 1)];
+        g_tail++;
+    }
+    hal_mutex_unlock(&g_change_lock);
+    return n;
+}
+
+uint64_t hal_change_overflows(void) {
+    hal_mutex_lock(&g_change_lock);
+    uint64_t overflows = g_overflows;
+    hal_mutex_unlock(&g_change_lock);
+    return overflows;
+}
+
+void hal_change_reset(void) {
+    hal_mutex_lock(&g_change_lock);
+    // 死區與遲滯是量測點的設定，只清除回報狀態；下一次取樣一律回報
+    for (int i = 0; i < HAL_MAX_POINTS; i++) {
+        change_state_t* st = &g_state[i];
+        st->reported = 0;
+        st->last_quality = 0;
+        st->last_value = 0;
+        st->last_dir = 0;
+    }
+    g_tail = g_head;
+    hal_mutex_unlock(&g_change_lock);
+}
@@ -0,0 +1,44 @@
+#ifndef HAL_CHANGE_H
+#define HAL_CHANGE_H
+
+#include <stdint.h>
+
+// 例外回報 (report-by-exception)：量測點的值超出死區或品質改變時，
+// 擷取執行緒把一筆變更事件放入環形緩衝區，上層 (Redfish、SNMP、儲存) 只處理有變化的量測點，
+// 大部分週期不需要做任何事。
+
+#define HAL_CHANGE_RING_SIZE 1024   // 必須是 2 的冪次
+
+typedef struct {
+    int32_t handle;
+    uint32_t quality;       // HAL_QUALITY_*
+    float value;            // 品質變為 BAD 時為最後一次有效值
+    uint32_t raw;
+    uint64_t timestamp_us;  // Unix epoch 微秒
+} hal_change_t;
+
+// 設定量測點的死區與遲滯 (工程單位)
+// 值與上一次回報的值相差達 deadband 才回報；變化方向與上一次回報相反時需再多超過 hysteresis，
+// 避免雜訊在門檻附近來回觸發。預設皆為 0：值有任何改變就回報
+// 成功返回 0，handle 無效或參數為負返回 -1
+int hal_point_set_deadband(int handle, float deadband, float hysteresis);
+
+// 等待變更事件，timeout_ms 為 0 時不等待
+// 返回目前待取出的事件數量，超時返回 0
+int hal_wait_changes(int timeout_ms);
+
+// 依發生順序取出最多 max 筆事件，返回取出的數量
+int hal_drain_changes(hal_change_t* out, int max);
+
+// 緩衝區滿而被丟棄的事件總數；數值增加時消費端應以 hal_read_all() 重新同步
+uint64_t hal_change_overflows(void);
+
+// ---- 以下由 HAL 內部的寫入端使用 ----
+
+// 擷取執行緒每次更新快照後呼叫，依死區判斷是否產生事件
+void hal_change_sample(int handle, uint32_t quality, float value, uint32_t raw, uint64_t timestamp_us);
+
+// 清除回報狀態與尚未取出的事件，hal_point_set_deadband 的設定保留
+void hal_change_reset(void);
+
+#endif // HAL_CHANGE_H
@@ -0,0 +1,64 @@
+#include "hal_crc16.h"
+#include "hal_crc16_tables.h"
+
+uint16_t hal_crc16_bitwise(const uint8_t* buf, size_t len) {
+    uint16_t crc = 0xFFFF;
+
+    for (size_t pos = 0; pos < len; pos++) {
+        crc ^= (uint16_t)buf[pos];
+
+        for (int i = 8; i != 0; i--) {
+            if ((crc & 0x0001) != 0) {
+                crc >>= 1;
+                crc ^= 0xA001;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+static inline uint16_t crc16_bytes(uint16_t crc, const uint8_t* buf, size_t len) {
+    while (len--) {
+        crc = (crc >> 8) ^ crc16_table[0][(crc ^ *buf++) & 0xFF];
+    }
+    return crc;
+}
+
+uint16_t hal_crc16_table(const uint8_t* buf, size_t len) {
+    return crc16_bytes(0xFFFF, buf, len);
+}
+
+uint16_t hal_crc16_slice4(const uint8_t* buf, size_t len) {
+    uint16_t crc = 0xFFFF;
+
+    while (len >= 4) {
+        crc ^= (uint16_t)(buf[0] | (buf[1] << 8));
+        crc = crc16_table[3][crc & 0xFF] ^ crc16_table[2][crc >> 8] ^
+              crc16_table[1][buf[2]] ^ crc16_table[0][buf[3]];
+        buf += 4;
+        len -= 4;
+    }
+    return crc16_bytes(crc, buf, len);
+}
+
+uint16_t hal_crc16_slice8(const uint8_t* buf, size_t len) {
+    uint16_t crc = 0xFFFF;
+
+    while (len >= 8) {
+        crc ^= (uint16_t)(buf[0] | (buf[1] << 8));
+        crc = crc16_table[7][crc & 0xFF] ^ crc16_table[6][crc >> 8] ^
+              crc16_table[5][buf[2]] ^ crc16_table[4][buf[3]] ^
+              crc16_table[3][buf[4]] ^ crc16_table[2][buf[5]] ^
+              crc16_table[1][buf[6]] ^ crc16_table[0][buf[7]];
+        buf += 8;
+        len -= 8;
+    }
+    return crc16_bytes(crc, buf, len);
+}
+
+uint16_t hal_crc16(const uint8_t* buf, size_t len) {
+    if (len >= HAL_CRC16_SLICE_THRESHOLD) return hal_crc16_slice8(buf, len);
+    return crc16_bytes(0xFFFF, buf, len);
+}
@@ -0,0 +1,26 @@
+#ifndef HAL_CRC16_H
+#define HAL_CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Modbus RTU CRC16 (初始值 0xFFFF，反射多項式 0xA001)
+// 結果低位元組先傳送：frame[n] = crc & 0xFF, frame[n + 1] = crc >> 8
+
+// 長度達到此值時改用 slice-by-8
+#define HAL_CRC16_SLICE_THRESHOLD 16
+
+// 自動選擇實作：短 frame 逐位元組查表，長 frame (例如 125 暫存器讀取) 使用 slice-by-8
+uint16_t hal_crc16(const uint8_t* buf, size_t len);
+
+// 256 項查表，每個位元組一次查表
+uint16_t hal_crc16_table(const uint8_t* buf, size_t len);
+
+// 一次處理 4 / 8 個位元組
+uint16_t hal_crc16_slice4(const uint8_t* buf, size_t len);
+uint16_t hal_crc16_slice8(const uint8_t* buf, size_t len);
+
+// 原始逐位元運算版本，保留作為正確性與效能比較的基準
+uint16_t hal_crc16_bitwise(const uint8_t* buf, size_t len);
+
+#endif // HAL_CRC16_H
@@ -0,0 +1,432 @@
+#include "hal_ctrl.h"
+#include "hal_acq.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include "hal_sched.h"
+#include "hal_snapshot.h"
+#include "hal_write.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// 迴圈設定與狀態由 g_ctrl_lock 保護：控制執行緒每個週期在鎖內計算所有迴圈，
+// 需要寫入的設定值先收集起來，釋放鎖之後才排入寫入佇列。控制執行緒只排入佇列、從不直接寫入匯流排，
+// 佇列由擷取 worker 送出；沒有 worker 的 port 由下一次 hal_sched_poll 送出 (hal_ctrl_start 會警告)。
+
+typedef struct {
+    hal_port_t* port;
+    int slave;
+    int reg;
+    hal_ctrl_config_t cfg;
+    int enabled;
+    float integral;
+    float output;
+    int has_output;         // output 是否已有計算值
+    float last_pv;
+    uint64_t last_pv_us;    // 上一次用於微分的取樣時間 (單調時鐘)，0 表示沒有
+    float derivative;       // 最後一次計算的微分項，沒有新取樣的週期沿用
+    int hold_integral;      // 啟用後的第一個週期不累加積分，輸出等於啟用前的輸出
+    int last_written;       // 上一次寫入的暫存器值，-1 表示尚未寫入
+    uint64_t seen_written;  // 上一次讀取的 hal_write_get_status 計數，用來計算這一週期新增的結果
+    uint64_t seen_failed;
+    hal_ctrl_status_t status;
+} ctrl_loop_t;
+
+typedef struct {
+    hal_port_t* port;
+    int slave;
+    int reg;
+    uint16_t value;
+    int loop;
+} ctrl_write_t;
+
+static ctrl_loop_t g_loops[HAL_CTRL_MAX_LOOPS];
+static int g_loop_count = 0;
+static hal_mutex_t g_ctrl_lock = HAL_MUTEX_INIT;
+
+static hal_thread_t g_ctrl_thread;
+static atomic_int g_ctrl_running = 0;
+static int g_rate_hz = 50;
+static atomic_int g_realtime = 0;
+static atomic_ullong g_cycles;
+static atomic_ullong g_overruns;
+static atomic_uint g_last_cycle_us;
+static atomic_uint g_max_cycle_us;
+static atomic_uint g_last_jitter_us;
+static atomic_uint g_max_jitter_us;
+
+void hal_ctrl_default_config(hal_ctrl_config_t* cfg) {
+    if (cfg == NULL) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->pv_handle = -1;
+    cfg->ff_handle = -1;
+    cfg->kp = 1.0f;
+    cfg->out_min = 0.0f;
+    cfg->out_max = 65535.0f;
+    cfg->out_scale = 1.0f;
+    cfg->stale_periods = 5;
+}
+
+static int ctrl_config_valid(const hal_ctrl_config_t* cfg) {
+    return cfg != NULL && cfg->pv_handle >= 0 && cfg->pv_handle < HAL_MAX_POINTS &&
+           cfg->ff_handle < HAL_MAX_POINTS && cfg->out_min <= cfg->out_max && cfg->stale_periods >= 0;
+}
+
+int hal_ctrl_add(const char* device, int slave, int reg, const hal_ctrl_config_t* cfg) {
+    if (device == NULL || slave < 0 || slave > 255 || reg < 0 || reg > 0xFFFF || !ctrl_config_valid(cfg)) {
+        return -1;
+    }
+    hal_port_t* port = hal_port_get(device, 0);
+    if (port == NULL) return -1;
+
+    hal_mutex_lock(&g_ctrl_lock);
+    if (g_loop_count >= HAL_CTRL_MAX_LOOPS) {
+        hal_mutex_unlock(&g_ctrl_lock);
+        HAL_ERROR("Control loop table full, cannot add loop for %s slave %d reg 0x%04X", device, slave, reg);
+        return -1;
+    }
+    ctrl_loop_t* loop = &g_loops[g_loop_count];
+    memset(loop, 0, sizeof(*loop));
+    loop->port = port;
+    loop->slave = slave;
+    loop->reg = reg;
+    loop->cfg = *cfg;
+    loop->last_written = -1;
+    loop->status.setpoint = cfg->setpoint;
+    hal_write_status_t ws;
+    if (hal_write_get_status(port, slave, &ws) == 0) {
+        loop->seen_written = ws.written;
+        loop->seen_failed = ws.failed;
+    }
+    int id = g_loop_count++;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return id;
+}
+
+int hal_ctrl_configure(int loop, const hal_ctrl_config_t* cfg) {
+    if (!ctrl_config_valid(cfg)) return -1;
+    hal_mutex_lock(&g_ctrl_lock);
+    if (loop < 0 || loop >= g_loop_count) {
+        hal_mutex_unlock(&g_ctrl_lock);
+        return -1;
+    }
+    g_loops[loop].cfg = *cfg;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return 0;
+}
+
+int hal_ctrl_set_target(int loop, float setpoint) {
+    hal_mutex_lock(&g_ctrl_lock);
+    if (loop < 0 || loop >= g_loop_count) {
+        hal_mutex_unlock(&g_ctrl_lock);
+        return -1;
+    }
+    g_loops[loop].cfg.setpoint = setpoint;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return 0;
+}
+
+int hal_ctrl_set_gains(int loop, float kp, float ki, float kd) {
+    hal_mutex_lock(&g_ctrl_lock);
+    if (loop < 0 || loop >= g_loop_count) {
+        hal_mutex_unlock(&g_ctrl_lock);
+        return -1;
+    }
+    ctrl_loop_t* l = &g_loops[loop];
+    l->cfg.kp = kp;
+    l->cfg.ki = ki;
+    l->cfg.kd = kd;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return 0;
+}
+
+// 前饋項，前饋量測點失效時為 0 (只停用前饋，回授仍繼續)
+static float ctrl_feedforward(const hal_ctrl_config_t* c) {
+    hal_sample_t ffs;
+    if (c->ff_handle < 0 || hal_get_snapshot(c->ff_handle, &ffs) != 0 || ffs.quality != HAL_QUALITY_GOOD) {
+        return 0.0f;
+    }
+    return c->ff_gain * (ffs.value - c->ff_ref);
+}
+
+int hal_ctrl_enable(int loop, int enabled) {
+    hal_mutex_lock(&g_ctrl_lock);
+    if (loop < 0 || loop >= g_loop_count) {
+        hal_mutex_unlock(&g_ctrl_lock);
+        return -1;
+    }
+    ctrl_loop_t* l = &g_loops[loop];
+    if (enabled && !l->enabled) {
+        // 無衝擊切換：積分 = 目前輸出 - 基準 - 比例項 - 前饋，微分從 0 開始，
+        // 過程值與前饋量不變時第一個週期的輸出就是目前的設定值
+        const hal_ctrl_config_t* c = &l->cfg;
+        l->integral = 0.0f;
+        if (l->has_output) {
+            hal_sample_t pv;
+            float p = 0.0f;
+            if (hal_get_snapshot(c->pv_handle, &pv) == 0 && pv.quality == HAL_QUALITY_GOOD) {
+                p = c->kp * (c->setpoint - pv.value);
+            }
+            float span = c->out_max - c->out_min;
+            float integral = l->output - c->bias - p - ctrl_feedforward(c);
+            if (integral > span) integral = span;
+            if (integral < -span) integral = -span;
+            l->integral = integral;
+        }
+        l->hold_integral = 1;
+        l->last_pv_us = 0;
+        l->derivative = 0.0f;
+    }
+    l->enabled = enabled ? 1 : 0;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return 0;
+}
+
+int hal_ctrl_status(int loop, hal_ctrl_status_t* out) {
+    if (out == NULL) return -1;
+    hal_mutex_lock(&g_ctrl_lock);
+    if (loop < 0 || loop >= g_loop_count) {
+        hal_mutex_unlock(&g_ctrl_lock);
+        return -1;
+    }
+    ctrl_loop_t* l = &g_loops[loop];
+    *out = l->status;
+    out->setpoint = l->cfg.setpoint;
+    out->output = l->output;
+    out->integral = l->integral;
+    out->enabled = (uint32_t)l->enabled;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return 0;
+}
+
+int hal_ctrl_count(void) {
+    hal_mutex_lock(&g_ctrl_lock);
+    int n = g_loop_count;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return n;
+}
+
+int hal_ctrl_clear(void) {
+    if (atomic_load(&g_ctrl_running)) return -1;
+    hal_mutex_lock(&g_ctrl_lock);
+    g_loop_count = 0;
+    hal_mutex_unlock(&g_ctrl_lock);
+    return 0;
+}
+
+// 取樣是否已超過 stale_periods 個輪詢週期沒有更新
+static int ctrl_pv_stale(const hal_ctrl_config_t* c, uint64_t sample_us) {
+    if (c->stale_periods <= 0) return 0;
+    int period_ms = hal_point_period_ms(c->pv_handle);
+    if (period_ms == 0) period_ms = hal_acq_period_ms();
+    if (period_ms <= 0) return 0;
+    uint64_t now = hal_time_us();
+    return now > sample_us && now - sample_us > (uint64_t)c->stale_periods * (uint64_t)period_ms * 1000;
+}
+
+// 計算一個迴圈，暫存器值改變而需要寫入時返回 1 (呼叫者需持有 g_ctrl_lock)
+static int ctrl_step(ctrl_loop_t* l, float dt) {
+    const hal_ctrl_config_t* c = &l->cfg;
+    hal_sample_t pv;
+    uint64_t pv_us;
+    l->status.cycles++;
+    if (hal_snapshot_read(c->pv_handle, &pv, &pv_us) != 0 || pv.quality != HAL_QUALITY_GOOD ||
+        ctrl_pv_stale(c, pv_us)) {
+        l->status.bad_pv++;
+        return 0;
+    }
+    l->status.pv = pv.value;
+    float ff = ctrl_feedforward(c);
+
+    // 微分只在有新取樣時重新計算，取樣之間沿用上一次的值：
+    // 輪詢週期比控制週期長時微分項保持連續，不會變成只在取樣週期出現的脈衝
+    if (l->last_pv_us != 0 && pv_us > l->last_pv_us) {
+        float sample_dt = (float)(pv_us - l->last_pv_us) / 1e6f;
+        l->derivative = -c->kd * (pv.value - l->last_pv) / sample_dt;
+    }
+    float d = l->derivative;
+    if (pv_us != l->last_pv_us) {
+        l->last_pv = pv.value;
+        l->last_pv_us = pv_us;
+    }
+
+    float e = c->setpoint - pv.value;
+    float p = c->kp * e;
+    float integral = l->hold_integral ? l->integral : l->integral + c->ki * e * dt;
+    l->hold_integral = 0;
+    float u = c->bias + p + integral + d + ff;
+
+    // anti-windup：輸出飽和且這一步的積分會讓飽和更嚴重時保留原本的積分
+    int saturated = 0;
+    if (u > c->out_max) {
+        saturated = 1;
+        if (c->ki * e > 0) integral = l->integral;
+        u = c->out_max;
+    } else if (u < c->out_min) {
+        saturated = 1;
+        if (c->ki * e < 0) integral = l->integral;
+        u = c->out_min;
+    }
+    l->integral = integral;
+    l->output = u;
+    l->has_output = 1;
+    l->status.saturated = (uint32_t)saturated;
+
+    float scale = c->out_scale != 0.0f ? c->out_scale : 1.0f;
+    long reg_value = lroundf(u * scale);
+    if (reg_value < 0) reg_value = 0;
+    if (reg_value > 0xFFFF) reg_value = 0xFFFF;
+    if ((int)reg_value == l->last_written) return 0;
+    l->last_written = (int)reg_value;
+    return 1;
+}
+
+// 依寫入佇列的送出結果更新統計；送出失敗時下一個週期重送 (呼叫者需持有 g_ctrl_lock)
+static void ctrl_update_writes(ctrl_loop_t* l) {
+    hal_write_status_t ws;
+    if (hal_write_get_status(l->port, l->slave, &ws) != 0) return;
+    if (ws.written > l->seen_written) l->status.writes += ws.written - l->seen_written;
+    if (ws.failed > l->seen_failed) {
+        l->status.write_errors += ws.failed - l->seen_failed;
+        l->last_written = -1;
+    }
+    l->seen_written = ws.written;
+    l->seen_failed = ws.failed;
+}
+
+static int ctrl_cycle(float dt, ctrl_write_t* writes) {
+    int n = 0;
+    hal_mutex_lock(&g_ctrl_lock);
+    for (int i = 0; i < g_loop_count; i++) {
+        ctrl_loop_t* l = &g_loops[i];
+        ctrl_update_writes(l);
+        if (!l->enabled || !ctrl_step(l, dt)) continue;
+        writes[n].port = l->port;
+        writes[n].slave = l->slave;
+        writes[n].reg = l->reg;
+        writes[n].value = (uint16_t)l->last_written;
+        writes[n].loop = i;
+        n++;
+    }
+    hal_mutex_unlock(&g_ctrl_lock);
+    return n;
+}
+
+// 排入失敗 (佇列已滿) 時計為寫入錯誤；排入成功的結果由 ctrl_update_writes 在送出後計入
+static void ctrl_record_write(int loop, int ok) {
+    if (ok) return;
+    hal_mutex_lock(&g_ctrl_lock);
+    if (loop < g_loop_count) {
+        ctrl_loop_t* l = &g_loops[loop];
+        l->status.write_errors++;
+        l->last_written = -1;   // 下一個週期重送
+    }
+    hal_mutex_unlock(&g_ctrl_lock);
+}
+
+static void ctrl_thread_main(void* arg) {
+    (void)arg;
+    atomic_store(&g_realtime, hal_thread_set_realtime() == 0);
+    if (!atomic_load(&g_realtime)) {
+        HAL_WARN("Control thread running without real-time priority (insufficient privileges?)");
+    }
+    hal_timer_hires_begin();
+
+    uint64_t period_us = 1000000ULL / (uint64_t)g_rate_hz;
+    uint64_t next = hal_time_us();
+    uint64_t last = next;
+    ctrl_write_t writes[HAL_CTRL_MAX_LOOPS];
+
+    while (atomic_load(&g_ctrl_running)) {
+        uint64_t start = hal_time_us();
+        uint32_t jitter = start > next ? (uint32_t)(start - next) : 0;
+        atomic_store_explicit(&g_last_jitter_us, jitter, memory_order_relaxed);
+        if (jitter > atomic_load_explicit(&g_max_jitter_us, memory_order_relaxed)) {
+            atomic_store_explicit(&g_max_jitter_us, jitter, memory_order_relaxed);
+        }
+
+        float dt = (float)(start - last) / 1e6f;
+        if (dt <= 0.0f || dt > 1.0f) dt = (float)period_us / 1e6f;
+        last = start;
+
+        int n = ctrl_cycle(dt, writes);
+        for (int i = 0; i < n; i++) {
+            ctrl_write_t* w = &writes[i];
+            ctrl_record_write(w->loop, hal_write_enqueue(w->port, w->slave, w->reg, 1, &w->value) == 0);
+        }
+
+        uint64_t now = hal_time_us();
+        uint32_t cycle_us = (uint32_t)(now - start);
+        atomic_store_explicit(&g_last_cycle_us, cycle_us, memory_order_relaxed);
+        if (cycle_us > atomic_load_explicit(&g_max_cycle_us, memory_order_relaxed)) {
+            atomic_store_explicit(&g_max_cycle_us, cycle_us, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&g_cycles, 1, memory_order_relaxed);
+
+        // 以絕對時間排定下一個週期，執行時間不會累積成漂移；落後時跳過錯過的週期
+        next += period_us;
+        if (now >= next) {
+            atomic_fetch_add_explicit(&g_overruns, 1, memory_order_relaxed);
+            next = now + period_us;
+        }
+        now = hal_time_us();
+        if (next > now) hal_sleep_us(next - now);
+    }
+    hal_timer_hires_end();
+}
+
+int hal_ctrl_start(int rate_hz) {
+    if (atomic_load(&g_ctrl_running)) return -1;
+    if (rate_hz < HAL_CTRL_MIN_RATE_HZ) rate_hz = HAL_CTRL_MIN_RATE_HZ;
+    if (rate_hz > HAL_CTRL_MAX_RATE_HZ) rate_hz = HAL_CTRL_MAX_RATE_HZ;
+    g_rate_hz = rate_hz;
+
+    hal_mutex_lock(&g_ctrl_lock);
+    for (int i = 0; i < g_loop_count; i++) {
+        if (!hal_acq_owns_port(g_loops[i].port)) {
+            HAL_WARN("Control loop %d: %s has no acquisition worker, outputs are sent by hal_sched_poll",
+                     i, hal_port_device(g_loops[i].port));
+        }
+    }
+    hal_mutex_unlock(&g_ctrl_lock);
+
+    atomic_store(&g_cycles, 0);
+    atomic_store(&g_overruns, 0);
+    atomic_store(&g_last_cycle_us, 0);
+    atomic_store(&g_max_cycle_us, 0);
+    atomic_store(&g_last_jitter_us, 0);
+    atomic_store(&g_max_jitter_us, 0);
+    atomic_store(&g_ctrl_running, 1);
+    if (hal_thread_create(&g_ctrl_thread, ctrl_thread_main, NULL) != 0) {
+        atomic_store(&g_ctrl_running, 0);
+        HAL_ERROR("Failed to start control thread");
+        return -1;
+    }
+    HAL_INFO("Control thread started: %d loop(s) at %d Hz", hal_ctrl_count(), rate_hz);
+    return 0;
+}
+
+void hal_ctrl_stop(void) {
+    if (!atomic_exchange(&g_ctrl_running, 0)) return;
+    hal_thread_join(g_ctrl_thread);
+    HAL_INFO("Control thread stopped");
+}
+
+int hal_ctrl_running(void) {
+    return atomic_load(&g_ctrl_running);
+}
+
+int hal_ctrl_thread_stats(hal_ctrl_thread_stats_t* out) {
+    if (out == NULL || !atomic_load(&g_ctrl_running)) return -1;
+    memset(out, 0, sizeof(*out));
+    out->rate_hz = (uint32_t)g_rate_hz;
+    out->realtime = (uint32_t)atomic_load(&g_realtime);
+    out->cycles = atomic_load_explicit(&g_cycles, memory_order_relaxed);
+    out->overruns = atomic_load_explicit(&g_overruns, memory_order_relaxed);
+    out->last_cycle_us = atomic_load_explicit(&g_last_cycle_us, memory_order_relaxed);
+    out->max_cycle_us = atomic_load_explicit(&g_max_cycle_us, memory_order_relaxed);
+    out->last_jitter_us = atomic_load_explicit(&g_last_jitter_us, memory_order_relaxed);
+    out->max_jitter_us = atomic_load_explicit(&g_max_jitter_us, memory_order_relaxed);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#ifndef HAL_CTRL_H
+#define HAL_CTRL_H
+
+#include <stdint.h>
+
+// 原生控制迴圈 (泵浦轉速的差壓 / 溫度 PID)
+// 一條即時優先權的執行緒以固定頻率 (10-100 Hz) 執行所有迴圈：
+// 從快照表讀取過程值與前饋量測點，計算 PID 後把設定值 (例如 VFD 目標轉速) 排入寫入佇列。
+// 控制週期不受 Python 引擎的週期、GC 或 GIL 影響；Python 只設定目標值與增益。
+// 量測點應以 hal_point_set_rate 設定與控制頻率相當的輪詢週期，否則 PID 看到的是較舊的取樣。
+//
+// 輸出 = bias + Kp*e + I + D + 前饋，其中
+//   e  = setpoint - pv  (Kp/Ki/Kd 取負值即為反向動作)
+//   I  = Σ Ki*e*dt，輸出飽和且誤差仍往飽和方向時停止累加 (anti-windup)
+//   D  = -Kd * d(pv)/dt，對量測值微分，改變目標值時不會產生突波；只在有新取樣時更新，取樣之間保持，
+//        dt 為兩次取樣的單調時鐘差 (不受系統時間調整影響)
+//   前饋 = ff_gain * (ff_pv - ff_ref)
+// 過程值品質不良、尚未取樣或過期 (超過 stale_periods 個輪詢週期沒有新的取樣) 時保持上一次輸出且不累加積分，
+// 這些週期都計入 bad_pv。輪詢週期為量測點的 hal_point_set_rate 週期，未指定時為背景擷取的週期；
+// 兩者都沒有 (同步輪詢且未指定週期) 時不檢查過期。
+// 暫存器值 = round(輸出 * out_scale)，與上一次寫入的值相同時不送出。
+// 設定值只排入寫入佇列 (hal_write_enqueue)，由輸出 port 的擷取 worker 送出；沒有 worker 時由 hal_sched_poll 送出。
+
+#define HAL_CTRL_MAX_LOOPS 16
+#define HAL_CTRL_MIN_RATE_HZ 10
+#define HAL_CTRL_MAX_RATE_HZ 100
+
+typedef struct {
+    int pv_handle;          // 過程值量測點 (hal_point_register 的 handle)
+    int ff_handle;          // 前饋量測點，-1 表示不使用
+    float setpoint;
+    float kp;
+    float ki;               // 1/s
+    float kd;               // s
+    float ff_gain;
+    float ff_ref;
+    float bias;             // 輸出基準 (積分為 0 時的輸出)
+    float out_min;
+    float out_max;
+    float out_scale;        // 暫存器值 = 輸出 * out_scale，0 視為 1
+    int stale_periods;      // 過程值超過幾個輪詢週期沒有更新視為過期，0 表示不檢查
+} hal_ctrl_config_t;
+
+typedef struct {
+    float setpoint;
+    float pv;
+    float output;           // 最近一次計算的輸出 (工程單位)
+    float integral;
+    uint32_t enabled;
+    uint32_t saturated;     // 最近一次輸出被 out_min / out_max 限制
+    uint64_t cycles;        // 執行的控制週期數
+    uint64_t bad_pv;        // 過程值品質不良或過期而保持輸出的週期數
+    uint64_t writes;        // 成功送到設備的寫入 frame 數 (hal_write_get_status，含同一 slave 的其他寫入)
+    uint64_t write_errors;  // 排入失敗或送出失敗的次數，失敗後下一個週期重送
+} hal_ctrl_status_t;
+
+typedef struct {
+    uint32_t rate_hz;
+    uint32_t realtime;      // 是否取得即時優先權
+    uint64_t cycles;
+    uint64_t overruns;      // 週期執行時間超過控制週期的次數
+    uint32_t last_cycle_us; // 最近一次執行所有迴圈的時間
+    uint32_t max_cycle_us;
+    uint32_t last_jitter_us; // 實際開始時間與排定時間的差
+    uint32_t max_jitter_us;
+} hal_ctrl_thread_stats_t;
+
+// 以預設值填入 cfg (不使用前饋，Kp 1，輸出 0-65535，過程值 5 個輪詢週期未更新視為過期)
+void hal_ctrl_default_config(hal_ctrl_config_t* cfg);
+
+// 新增一個迴圈，輸出寫到 device 上 slave 的 reg (FC06)
+// 新增後為停用狀態，以 hal_ctrl_enable 啟用
+// 返回迴圈 id (>= 0)，參數無效或迴圈表已滿返回 -1
+int hal_ctrl_add(const char* device, int slave, int reg, const hal_ctrl_config_t* cfg);
+
+// 更新迴圈的全部設定 (積分保留)，成功返回 0，id 無效返回 -1
+int hal_ctrl_configure(int loop, const hal_ctrl_config_t* cfg);
+
+// 設定目標值，成功返回 0
+int hal_ctrl_set_target(int loop, float setpoint);
+
+// 設定 PID 增益，成功返回 0
+int hal_ctrl_set_gains(int loop, float kp, float ki, float kd);
+
+// 啟用或停用迴圈，停用時保持最後寫入的設定值
+// 啟用時以目前的過程值與前饋量反推積分，使第一個週期的輸出等於最近一次輸出 (無衝擊切換)；
+// 積分限制在輸出範圍的寬度內。迴圈從未計算過輸出時積分從 0 開始
+int hal_ctrl_enable(int loop, int enabled);
+
+// 讀取迴圈狀態，成功返回 0
+int hal_ctrl_status(int loop, hal_ctrl_status_t* out);
+
+// 已新增的迴圈數量
+int hal_ctrl_count(void);
+
+// 移除所有迴圈 (控制執行緒運作中時返回 -1)
+int hal_ctrl_clear(void);
+
+// 以 rate_hz (限制於 10-100) 啟動控制執行緒，成功返回 0，已在運作或失敗返回 -1
+int hal_ctrl_start(int rate_hz);
+
+// 停止控制執行緒並等待其結束
+void hal_ctrl_stop(void);
+
+// 控制執行緒是否運作中
+int hal_ctrl_running(void);
+
+// 讀取控制執行緒的週期統計，成功返回 0，未運作返回 -1
+int hal_ctrl_thread_stats(hal_ctrl_thread_stats_t* out);
+
+#endif // HAL_CTRL_H
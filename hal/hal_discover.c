@@ -0,0 +1,544 @@
+#include "hal_discover.h"
+#include "hal_log.h"
+#include "hal_modbus.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include "hal_tcp.h"
+#include <stdio.h>
+#include <string.h>
+
+// 每個 port 的探測結果另外以 bitmap 記錄存在的位址，排程器每個 frame 查詢一次，不必搜尋 slaves[]。
+// 探測在各 port 的工作執行緒中進行，結果寫在各自的 job 內；全部結束後才在 g_discover_lock 內
+// 放入 g_topo，因此排程器查詢時不會看到探測到一半的拓撲。
+
+#define CACHE_LINE_MAX 512
+
+// 候選轉向時間 (微秒)，由短到長嘗試；實體串口至少仍保留 3.5 字元
+static const int g_turnaround_candidates_us[] = { 0, 500, 1000, 2000, 3000, 5000, 10000, 20000 };
+#define TURNAROUND_CANDIDATES ((int)(sizeof(g_turnaround_candidates_us) / sizeof(g_turnaround_candidates_us[0])))
+
+typedef struct {
+    int valid;
+    hal_port_t* port;
+    hal_discover_port_t info;
+    uint8_t present[(HAL_DISCOVER_MAX_ADDRESS + 8) / 8];
+    uint64_t recheck_us[HAL_DISCOVER_MAX_ADDRESS + 1];  // 不存在的 slave 下一次可重新探測的時間
+} topo_entry_t;
+
+typedef struct {
+    const char* device;
+    hal_discover_config_t cfg;
+    int has_cache;
+    hal_discover_port_t cached;
+    topo_entry_t result;
+    int status;             // 0 成功，-1 port 無法探測
+    hal_thread_t thread;
+    int started;
+} discover_job_t;
+
+static topo_entry_t g_topo[HAL_MAX_PORTS];
+static hal_discover_port_t g_cache[HAL_MAX_PORTS];
+static int g_cache_count;
+static discover_job_t g_jobs[HAL_MAX_PORTS];
+static int g_running;
+static hal_mutex_t g_discover_lock = HAL_MUTEX_INIT;
+
+void hal_discover_default_config(hal_discover_config_t* cfg) {
+    if (cfg == NULL) return;
+    cfg->slave_first = 1;
+    cfg->slave_last = HAL_DISCOVER_MAX_ADDRESS;
+    cfg->probe_timeout_ms = HAL_DISCOVER_PROBE_TIMEOUT_MS;
+    cfg->retries = 1;
+    cfg->reg_first = 0;
+    cfg->reg_last = -1;
+    cfg->reg_block = 16;
+    cfg->tune_turnaround = 1;
+}
+
+static int config_valid(const hal_discover_config_t* cfg) {
+    if (cfg->slave_first < 1 || cfg->slave_last > HAL_DISCOVER_MAX_ADDRESS ||
+        cfg->slave_first > cfg->slave_last) return 0;
+    if (cfg->probe_timeout_ms < 1 || cfg->probe_timeout_ms > HAL_PORT_RESPONSE_TIMEOUT_MS) return 0;
+    if (cfg->retries < 0 || cfg->retries > 5) return 0;
+    if (cfg->reg_first < 0 || cfg->reg_first > 0xFFFF || cfg->reg_last > 0xFFFF) return 0;
+    if (cfg->reg_block < 1 || cfg->reg_block > HAL_MODBUS_MAX_READ_REGISTERS) return 0;
+    return 1;
+}
+
+static int bit_get(const uint8_t* bits, int i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static void bit_set(uint8_t* bits, int i) {
+    bits[i >> 3] |= (uint8_t)(1u << (i & 7));
+}
+
+static int probe_responded(int status) {
+    return status == HAL_MODBUS_OK || status == HAL_MODBUS_ERR_EXCEPTION;
+}
+
+// 探測 slave 是否存在 (沒有回應時再試 retries 次)，存在時返回 1 並寫入回應時間
+static int probe_slave(hal_port_t* port, int slave, int reg, int timeout_ms, int retries, uint32_t* response_us) {
+    for (int attempt = 0; attempt <= retries; attempt++) {
+        if (probe_responded(hal_modbus_probe(port, slave, reg, 1, timeout_ms, response_us))) return 1;
+    }
+    return 0;
+}
+
+// 把 slave 依位址順序加入拓撲，已存在時返回原本的項目
+static hal_discover_slave_t* topo_add(topo_entry_t* t, int slave, uint32_t response_us) {
+    hal_discover_port_t* info = &t->info;
+    bit_set(t->present, slave);
+    int pos = 0;
+    while (pos < info->n_slaves && info->slaves[pos].slave < slave) pos++;
+    if (pos < info->n_slaves && info->slaves[pos].slave == slave) return &info->slaves[pos];
+
+    memmove(&info->slaves[pos + 1], &info->slaves[pos], (size_t)(info->n_slaves - pos) * sizeof(info->slaves[0]));
+    hal_discover_slave_t* s = &info->slaves[pos];
+    memset(s, 0, sizeof(*s));
+    s->slave = slave;
+    s->response_us = response_us;
+    info->n_slaves++;
+    return s;
+}
+
+// 以 reg_block 個暫存器為單位掃描，連續可讀的區塊合併成一個區段
+static void scan_ranges(hal_port_t* port, hal_discover_slave_t* s, const hal_discover_config_t* cfg) {
+    int extend = 0;
+    for (int base = cfg->reg_first; base <= cfg->reg_last; base += cfg->reg_block) {
+        int count = cfg->reg_last - base + 1;
+        if (count > cfg->reg_block) count = cfg->reg_block;
+        uint32_t response_us;
+        if (hal_modbus_probe(port, s->slave, base, count, cfg->probe_timeout_ms, &response_us) != HAL_MODBUS_OK) {
+            extend = 0;
+            continue;
+        }
+        if (extend) {
+            s->ranges[s->n_ranges - 1].count = (uint16_t)(s->ranges[s->n_ranges - 1].count + count);
+            continue;
+        }
+        if (s->n_ranges >= HAL_DISCOVER_MAX_RANGES) break;
+        s->ranges[s->n_ranges].start = (uint16_t)base;
+        s->ranges[s->n_ranges].count = (uint16_t)count;
+        s->n_ranges++;
+        extend = 1;
+    }
+}
+
+// 對單一 slave 由短到長嘗試候選轉向時間，最後套用到串口並返回
+// 每個候選的第一次交易前線路已靜默夠久，只有緊接著的交易能看出轉向時間是否足夠
+static int tune_turnaround(hal_port_t* port, int slave, int reg, int timeout_ms) {
+    for (int c = 0; c < TURNAROUND_CANDIDATES; c++) {
+        int turnaround = g_turnaround_candidates_us[c];
+        if (hal_port_set_turnaround(port, slave, turnaround) != 0) return 0;    // TCP 端點沒有轉向時間
+        int ok = 1;
+        for (int k = 0; k < HAL_DISCOVER_TURNAROUND_TRIALS && ok; k++) {
+            uint32_t response_us;
+            ok = probe_responded(hal_modbus_probe(port, slave, reg, 1, timeout_ms, &response_us));
+        }
+        if (ok) return turnaround;
+    }
+    HAL_WARN("Slave %d on %s drops requests even with %d us turnaround", slave, hal_port_device(port),
+             g_turnaround_candidates_us[TURNAROUND_CANDIDATES - 1]);
+    return g_turnaround_candidates_us[TURNAROUND_CANDIDATES - 1];
+}
+
+// 快取的位址範圍與設定相同，且快取中的每個 slave 都回應時沿用快取
+static int discover_verify(hal_port_t* port, discover_job_t* job) {
+    const hal_discover_config_t* cfg = &job->cfg;
+    const hal_discover_port_t* cached = &job->cached;
+    topo_entry_t* t = &job->result;
+    if (!job->has_cache || cached->slave_first != cfg->slave_first || cached->slave_last != cfg->slave_last ||
+        cached->n_slaves == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < cached->n_slaves; i++) {
+        uint32_t response_us;
+        if (!probe_slave(port, cached->slaves[i].slave, cfg->reg_first, cfg->probe_timeout_ms, cfg->retries,
+                         &response_us)) {
+            HAL_INFO("Cached slave %d on %s did not respond, rescanning", cached->slaves[i].slave, job->device);
+            return 0;
+        }
+    }
+
+    t->info = *cached;
+    snprintf(t->info.device, sizeof(t->info.device), "%s", job->device);
+    t->info.probe_timeout_ms = cfg->probe_timeout_ms;
+    t->info.frame_gap_us = hal_port_frame_gap(port);
+    for (int i = 0; i < t->info.n_slaves; i++) {
+        hal_discover_slave_t* s = &t->info.slaves[i];
+        bit_set(t->present, s->slave);
+        if (!cfg->tune_turnaround || hal_port_set_turnaround(port, s->slave, (int)s->turnaround_us) != 0) {
+            s->turnaround_us = (uint32_t)hal_port_turnaround(port, s->slave);
+        }
+    }
+    t->info.from_cache = 1;
+    return 1;
+}
+
+static void discover_scan(hal_port_t* port, discover_job_t* job) {
+    const hal_discover_config_t* cfg = &job->cfg;
+    topo_entry_t* t = &job->result;
+
+    for (int slave = cfg->slave_first; slave <= cfg->slave_last; slave++) {
+        uint32_t response_us;
+        if (probe_slave(port, slave, cfg->reg_first, cfg->probe_timeout_ms, cfg->retries, &response_us)) {
+            topo_add(t, slave, response_us);
+        }
+    }
+    if (cfg->reg_last >= cfg->reg_first) {
+        for (int i = 0; i < t->info.n_slaves; i++) scan_ranges(port, &t->info.slaves[i], cfg);
+    }
+    for (int i = 0; i < t->info.n_slaves; i++) {
+        hal_discover_slave_t* s = &t->info.slaves[i];
+        int turnaround = cfg->tune_turnaround ? tune_turnaround(port, s->slave, cfg->reg_first, cfg->probe_timeout_ms)
+                                              : hal_port_turnaround(port, s->slave);
+        s->turnaround_us = (uint32_t)turnaround;
+    }
+    t->info.frame_gap_us = hal_port_frame_gap(port);
+    t->info.discovered_us = hal_wall_time_us();
+}
+
+static void discover_worker(void* arg) {
+    discover_job_t* job = (discover_job_t*)arg;
+    topo_entry_t* t = &job->result;
+    uint64_t start_us = hal_time_us();
+
+    memset(t, 0, sizeof(*t));
+    snprintf(t->info.device, sizeof(t->info.device), "%s", job->device);
+    t->info.slave_first = job->cfg.slave_first;
+    t->info.slave_last = job->cfg.slave_last;
+    t->info.probe_timeout_ms = job->cfg.probe_timeout_ms;
+
+    hal_port_t* port = hal_port_get(job->device, 0);
+    if (port == NULL || hal_tcp_is_slmp(hal_port_tcp(port))) {
+        HAL_ERROR("Cannot discover Modbus slaves on %s", job->device);
+        job->status = -1;
+        return;
+    }
+    t->port = port;
+
+    if (!discover_verify(port, job)) discover_scan(port, job);
+    t->info.elapsed_ms = (uint32_t)((hal_time_us() - start_us) / 1000);
+    t->valid = 1;
+    job->status = 0;
+
+    uint32_t max_turnaround = 0;
+    for (int i = 0; i < t->info.n_slaves; i++) {
+        if (t->info.slaves[i].turnaround_us > max_turnaround) max_turnaround = t->info.slaves[i].turnaround_us;
+    }
+    HAL_INFO("%s %d slaves on %s in %u ms (max turnaround %u us)",
+             t->info.from_cache ? "Verified cached" : "Discovered", t->info.n_slaves, job->device,
+             t->info.elapsed_ms, (unsigned)max_turnaround);
+}
+
+// 依 device 名稱尋找 (呼叫者需持有 g_discover_lock)
+static topo_entry_t* topo_find(const char* device) {
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        if (g_topo[i].valid && strcmp(g_topo[i].info.device, device) == 0) return &g_topo[i];
+    }
+    return NULL;
+}
+
+// 把探測結果放入 g_topo (呼叫者需持有 g_discover_lock)
+static void topo_store(const topo_entry_t* result) {
+    topo_entry_t* t = topo_find(result->info.device);
+    for (int i = 0; t == NULL && i < HAL_MAX_PORTS; i++) {
+        if (!g_topo[i].valid) t = &g_topo[i];
+    }
+    if (t == NULL) return;
+    *t = *result;
+
+    // 剛探測過，不存在的 slave 等到重新探測間隔後才再確認
+    uint64_t recheck = hal_time_us() + (uint64_t)HAL_DISCOVER_RECHECK_MS * 1000;
+    for (int slave = 0; slave <= HAL_DISCOVER_MAX_ADDRESS; slave++) t->recheck_us[slave] = recheck;
+}
+
+int hal_discover_run(const char* const* devices, int n, const hal_discover_config_t* cfg,
+                     const char* cache_path) {
+    hal_discover_config_t config;
+    if (cfg == NULL) {
+        hal_discover_default_config(&config);
+    } else {
+        config = *cfg;
+    }
+    if (devices == NULL || n < 1 || n > HAL_MAX_PORTS || !config_valid(&config)) return -1;
+    for (int i = 0; i < n; i++) {
+        if (devices[i] == NULL || devices[i][0] == '\0') return -1;
+    }
+
+    hal_mutex_lock(&g_discover_lock);
+    if (g_running) {
+        hal_mutex_unlock(&g_discover_lock);
+        return -1;
+    }
+    g_running = 1;
+    hal_mutex_unlock(&g_discover_lock);
+
+    if (cache_path != NULL && hal_discover_load(cache_path) < 0) {
+        HAL_INFO("No usable topology cache at %s, running full discovery", cache_path);
+    }
+
+    // 重複的 device 只探測一次
+    int jobs = 0;
+    hal_mutex_lock(&g_discover_lock);
+    for (int i = 0; i < n; i++) {
+        int duplicate = 0;
+        for (int k = 0; k < jobs; k++) {
+            if (strcmp(g_jobs[k].device, devices[i]) == 0) duplicate = 1;
+        }
+        if (duplicate) continue;
+
+        discover_job_t* job = &g_jobs[jobs++];
+        job->device = devices[i];
+        job->cfg = config;
+        job->has_cache = 0;
+        job->status = -1;
+        job->started = 0;
+        for (int c = 0; c < g_cache_count; c++) {
+            if (strcmp(g_cache[c].device, devices[i]) == 0) {
+                job->cached = g_cache[c];
+                job->has_cache = 1;
+                break;
+            }
+        }
+    }
+    hal_mutex_unlock(&g_discover_lock);
+
+    // 每個 port 一條執行緒，同一 port 上的探測仍依序進行
+    for (int i = 0; i < jobs; i++) {
+        g_jobs[i].started = hal_thread_create(&g_jobs[i].thread, discover_worker, &g_jobs[i]) == 0;
+        if (!g_jobs[i].started) discover_worker(&g_jobs[i]);
+    }
+    for (int i = 0; i < jobs; i++) {
+        if (g_jobs[i].started) hal_thread_join(g_jobs[i].thread);
+    }
+
+    int total = 0;
+    hal_mutex_lock(&g_discover_lock);
+    for (int i = 0; i < jobs; i++) {
+        if (g_jobs[i].status != 0) continue;
+        topo_store(&g_jobs[i].result);
+        total += g_jobs[i].result.info.n_slaves;
+    }
+    hal_mutex_unlock(&g_discover_lock);
+
+    if (cache_path != NULL && hal_discover_save(cache_path) != 0) {
+        HAL_WARN("Failed to write topology cache %s", cache_path);
+    }
+
+    hal_mutex_lock(&g_discover_lock);
+    g_running = 0;
+    hal_mutex_unlock(&g_discover_lock);
+    return total;
+}
+
+int hal_discover_get(const char* device, hal_discover_port_t* out) {
+    if (device == NULL || out == NULL) return -1;
+    hal_mutex_lock(&g_discover_lock);
+    topo_entry_t* t = topo_find(device);
+    if (t != NULL) *out = t->info;
+    hal_mutex_unlock(&g_discover_lock);
+    return t != NULL ? 0 : -1;
+}
+
+int hal_discover_present(const char* device, int slave) {
+    if (device == NULL) return -1;
+    hal_mutex_lock(&g_discover_lock);
+    topo_entry_t* t = topo_find(device);
+    int present = -1;
+    if (t != NULL && slave >= t->info.slave_first && slave <= t->info.slave_last) {
+        present = bit_get(t->present, slave);
+    }
+    hal_mutex_unlock(&g_discover_lock);
+    return present;
+}
+
+int hal_discover_tune_turnaround(const char* device, int slave, int timeout_ms) {
+    if (device == NULL || slave < 1 || slave > HAL_DISCOVER_MAX_ADDRESS) return -1;
+    if (timeout_ms <= 0) timeout_ms = HAL_DISCOVER_PROBE_TIMEOUT_MS;
+    if (timeout_ms > HAL_PORT_RESPONSE_TIMEOUT_MS) return -1;
+
+    hal_port_t* port = hal_port_get(device, 0);
+    if (port == NULL || hal_port_tcp(port) != NULL) return -1;
+    uint32_t response_us;
+    if (!probe_slave(port, slave, 0, timeout_ms, 1, &response_us)) return -1;
+
+    int turnaround = tune_turnaround(port, slave, 0, timeout_ms);
+    HAL_INFO("Slave %d on %s turnaround %d us", slave, device, turnaround);
+
+    // 已探測的 port 同步更新拓撲中的記錄，之後寫入的快取沿用
+    hal_mutex_lock(&g_discover_lock);
+    topo_entry_t* t = topo_find(device);
+    for (int i = 0; t != NULL && i < t->info.n_slaves; i++) {
+        if (t->info.slaves[i].slave == slave) t->info.slaves[i].turnaround_us = (uint32_t)turnaround;
+    }
+    hal_mutex_unlock(&g_discover_lock);
+    return turnaround;
+}
+
+int hal_discover_skip(hal_port_t* port, int slave) {
+    if (port == NULL || slave < 1 || slave > HAL_DISCOVER_MAX_ADDRESS) return 0;
+
+    hal_mutex_lock(&g_discover_lock);
+    topo_entry_t* t = NULL;
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        // 串口登錄表的項目會重複使用，port 指標相同時還要確認 device 名稱
+        if (g_topo[i].valid && g_topo[i].port == port &&
+            strcmp(g_topo[i].info.device, hal_port_device(port)) == 0) {
+            t = &g_topo[i];
+            break;
+        }
+    }
+    if (t == NULL || slave < t->info.slave_first || slave > t->info.slave_last || bit_get(t->present, slave)) {
+        hal_mutex_unlock(&g_discover_lock);
+        return 0;
+    }
+    uint64_t now = hal_time_us();
+    if (now < t->recheck_us[slave]) {
+        hal_mutex_unlock(&g_discover_lock);
+        return 1;
+    }
+    t->recheck_us[slave] = now + (uint64_t)HAL_DISCOVER_RECHECK_MS * 1000;
+    int timeout_ms = t->info.probe_timeout_ms;
+    hal_mutex_unlock(&g_discover_lock);
+
+    // 探測在鎖外進行，期間其他 port 的查詢不受影響
+    uint32_t response_us;
+    if (!probe_responded(hal_modbus_probe(port, slave, 0, 1, timeout_ms, &response_us))) return 1;
+
+    hal_mutex_lock(&g_discover_lock);
+    if (t->valid && t->port == port) topo_add(t, slave, response_us);
+    hal_mutex_unlock(&g_discover_lock);
+    HAL_INFO("Slave %d on %s now responds, resuming polling", slave, hal_port_device(port));
+    return 0;
+}
+
+// 快取檔格式 (每行一筆，欄位以空白分隔)：
+//   version <n>
+//   port <device> <slave_first> <slave_last> <frame_gap_us> <discovered_us>
+//   slave <address> <response_us> <turnaround_us> [<start>:<count> ...]
+int hal_discover_save(const char* path) {
+    if (path == NULL) return -1;
+    char tmp[CACHE_LINE_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return -1;
+
+    FILE* f = fopen(tmp, "w");
+    if (f == NULL) return -1;
+    fprintf(f, "# CDU HAL bus topology cache, rewritten by hal_discover_run\n");
+    fprintf(f, "version %d\n", HAL_DISCOVER_CACHE_VERSION);
+
+    hal_mutex_lock(&g_discover_lock);
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        const hal_discover_port_t* info = &g_topo[i].info;
+        if (!g_topo[i].valid) continue;
+        fprintf(f, "port %s %d %d %d %llu\n", info->device, info->slave_first, info->slave_last,
+                info->frame_gap_us, (unsigned long long)info->discovered_us);
+        for (int k = 0; k < info->n_slaves; k++) {
+            const hal_discover_slave_t* s = &info->slaves[k];
+            fprintf(f, "slave %d %u %u", s->slave, (unsigned)s->response_us, (unsigned)s->turnaround_us);
+            for (int r = 0; r < s->n_ranges; r++) fprintf(f, " %u:%u", s->ranges[r].start, s->ranges[r].count);
+            fprintf(f, "\n");
+        }
+    }
+    hal_mutex_unlock(&g_discover_lock);
+
+    int failed = ferror(f);
+    if (fclose(f) != 0) failed = 1;
+    if (failed) {
+        remove(tmp);
+        return -1;
+    }
+#ifdef _WIN32
+    remove(path);   // Windows 的 rename 不覆蓋既有檔案
+#endif
+    if (rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// 解析一行 slave 記錄，成功返回 0
+static int cache_parse_slave(const char* line, hal_discover_slave_t* s) {
+    int used = 0;
+    unsigned response_us = 0;
+    unsigned turnaround_us = 0;
+    memset(s, 0, sizeof(*s));
+    if (sscanf(line, "slave %d %u %u%n", &s->slave, &response_us, &turnaround_us, &used) != 3) return -1;
+    if (s->slave < 1 || s->slave > HAL_DISCOVER_MAX_ADDRESS || turnaround_us > HAL_PORT_MAX_FRAME_GAP_US) return -1;
+    s->response_us = response_us;
+    s->turnaround_us = turnaround_us;
+
+    const char* p = line + used;
+    unsigned start, count;
+    int n;
+    while (sscanf(p, " %u:%u%n", &start, &count, &n) == 2) {
+        if (s->n_ranges >= HAL_DISCOVER_MAX_RANGES || start > 0xFFFF || count > 0xFFFF) return -1;
+        s->ranges[s->n_ranges].start = (uint16_t)start;
+        s->ranges[s->n_ranges].count = (uint16_t)count;
+        s->n_ranges++;
+        p += n;
+    }
+    return 0;
+}
+
+int hal_discover_load(const char* path) {
+    if (path == NULL) return -1;
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return -1;
+
+    static hal_discover_port_t loaded[HAL_MAX_PORTS];   // 只在 g_discover_lock 內使用
+    char line[CACHE_LINE_MAX];
+    int count = 0;
+    int version = 0;
+    int ok = 1;
+    hal_discover_port_t* cur = NULL;
+
+    hal_mutex_lock(&g_discover_lock);
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        if (strncmp(line, "version ", 8) == 0) {
+            ok = sscanf(line, "version %d", &version) == 1 && version == HAL_DISCOVER_CACHE_VERSION;
+        } else if (strncmp(line, "port ", 5) == 0) {
+            if (version != HAL_DISCOVER_CACHE_VERSION || count >= HAL_MAX_PORTS) {
+                ok = 0;
+                break;
+            }
+            cur = &loaded[count++];
+            memset(cur, 0, sizeof(*cur));
+            unsigned long long discovered_us = 0;
+            ok = sscanf(line, "port %63s %d %d %d %llu", cur->device, &cur->slave_first, &cur->slave_last,
+                        &cur->frame_gap_us, &discovered_us) == 5 &&
+                 cur->frame_gap_us >= 0 && cur->frame_gap_us <= HAL_PORT_MAX_FRAME_GAP_US;
+            cur->discovered_us = discovered_us;
+        } else if (strncmp(line, "slave ", 6) == 0) {
+            hal_discover_slave_t s;
+            ok = cur != NULL && cur->n_slaves < HAL_DISCOVER_MAX_SLAVES && cache_parse_slave(line, &s) == 0 &&
+                 (cur->n_slaves == 0 || s.slave > cur->slaves[cur->n_slaves - 1].slave);
+            if (ok) cur->slaves[cur->n_slaves++] = s;
+        } else {
+            ok = 0;
+        }
+    }
+    if (ok && version == HAL_DISCOVER_CACHE_VERSION) {
+        memcpy(g_cache, loaded, (size_t)count * sizeof(loaded[0]));
+        g_cache_count = count;
+    } else {
+        g_cache_count = 0;
+        count = -1;
+    }
+    hal_mutex_unlock(&g_discover_lock);
+    fclose(f);
+
+    if (count < 0) HAL_WARN("Ignoring invalid topology cache %s", path);
+    return count;
+}
+
+void hal_discover_reset(void) {
+    hal_mutex_lock(&g_discover_lock);
+    for (int i = 0; i < HAL_MAX_PORTS; i++) g_topo[i].valid = 0;
+    g_cache_count = 0;
+    hal_mutex_unlock(&g_discover_lock);
+}
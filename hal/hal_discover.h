@@ -0,0 +1,98 @@
+#ifndef HAL_DISCOVER_H
+#define HAL_DISCOVER_H
+
+#include <stdint.h>
+
+// 匯流排探測與拓撲快取
+// 啟動時對每個 port 以短超時 (預設 50ms，而不是一般交易的 1 秒) 逐一探測 slave 位址，
+// 各 port 由各自的執行緒同時進行。回應正常或例外回應都表示 slave 存在；
+// 對存在的 slave 可再以區塊讀取掃描可讀的暫存器區段，並逐一量測每個 slave 可接受的最短轉向時間。
+// 結果可存成文字快取檔，下次啟動只驗證快取中的 slave (每個 slave 一次探測)，
+// 全部回應時直接沿用快取，否則重新完整探測該 port。
+// 探測過的 port 上不存在的 slave 由排程器直接標記為品質不良，不再每個週期等待超時；
+// 每 HAL_DISCOVER_RECHECK_MS 以一次短超時探測確認是否已接上。
+
+#define HAL_DISCOVER_MAX_ADDRESS 247    // Modbus RTU 可用的 slave 位址上限
+#define HAL_DISCOVER_MAX_SLAVES HAL_DISCOVER_MAX_ADDRESS
+#define HAL_DISCOVER_MAX_RANGES 8       // 每個 slave 記錄的暫存器區段上限
+#define HAL_DISCOVER_PROBE_TIMEOUT_MS 50
+#define HAL_DISCOVER_RECHECK_MS 30000   // 排程器重新探測不存在的 slave 的間隔
+#define HAL_DISCOVER_TURNAROUND_TRIALS 8    // 每個候選轉向時間連續交易的次數
+#define HAL_DISCOVER_CACHE_VERSION 2
+
+typedef struct {
+    int slave_first;        // 探測的位址範圍，預設 1-247
+    int slave_last;
+    int probe_timeout_ms;   // 每次探測等待第一個回應位元組的時間
+    int retries;            // 沒有回應的位址重新探測的次數，預設 1
+    int reg_first;          // 對存在的 slave 掃描 [reg_first, reg_last] 內可讀的暫存器，
+    int reg_last;           // reg_last < reg_first 表示不掃描 (預設)
+    int reg_block;          // 掃描時每次讀取的暫存器數 (1-125)，預設 16
+    int tune_turnaround;    // 1 表示量測每個 slave 最短可用的轉向時間並套用到串口 (預設)
+} hal_discover_config_t;
+
+typedef struct {
+    uint16_t start;
+    uint16_t count;
+} hal_discover_range_t;
+
+typedef struct {
+    int slave;
+    uint32_t response_us;   // 探測時量到的最短回應時間 (請求送出到第一個回應位元組)
+    uint32_t turnaround_us; // 套用到串口的轉向時間 (hal_port_set_turnaround)
+    int n_ranges;
+    hal_discover_range_t ranges[HAL_DISCOVER_MAX_RANGES];
+} hal_discover_slave_t;
+
+typedef struct {
+    char device[64];
+    int slave_first;        // 探測過的位址範圍
+    int slave_last;
+    int probe_timeout_ms;
+    int frame_gap_us;       // 串口的 frame 間隔 (hal_port_set_frame_gap，探測不改變)
+    int from_cache;         // 1 表示由快取驗證後沿用
+    uint32_t elapsed_ms;    // 本次探測所花的時間
+    uint64_t discovered_us; // 完整探測的時間 (wall clock)
+    int n_slaves;
+    hal_discover_slave_t slaves[HAL_DISCOVER_MAX_SLAVES];   // 依位址排序
+} hal_discover_port_t;
+
+// 以預設值填入 cfg
+void hal_discover_default_config(hal_discover_config_t* cfg);
+
+// 同時探測 devices[0 .. n) (每個 port 一條執行緒)，cfg 為 NULL 時使用預設值
+// cache_path 不為 NULL 時先讀取快取驗證，探測完成後寫回
+// 返回找到的 slave 總數，參數無效或探測進行中返回 -1
+int hal_discover_run(const char* const* devices, int n, const hal_discover_config_t* cfg,
+                     const char* cache_path);
+
+// 讀取 device 的探測結果，成功返回 0，尚未探測返回 -1
+int hal_discover_get(const char* device, hal_discover_port_t* out);
+
+// slave 是否存在：1 存在，0 不存在，-1 未探測 (port 未探測或位址不在探測範圍內)
+int hal_discover_present(const char* device, int slave);
+
+// 把所有探測結果寫入快取檔，成功返回 0
+int hal_discover_save(const char* path);
+
+// 讀取快取檔 (只供之後的 hal_discover_run 驗證，不直接套用)，返回讀到的 port 數，失敗返回 -1
+int hal_discover_load(const char* path);
+
+// 清除探測結果與快取 (不改變已套用的轉向時間)
+void hal_discover_reset(void);
+
+// 由短到長嘗試候選轉向時間，對 slave 連續交易 HAL_DISCOVER_TURNAROUND_TRIALS 次都有回應者即為結果
+// (轉向時間不足的 slave 還沒切回接收，會漏收緊接著的請求)，結果以 hal_port_set_turnaround 套用
+// timeout_ms <= 0 時使用 HAL_DISCOVER_PROBE_TIMEOUT_MS
+// 返回套用的轉向時間 (微秒)，slave 沒有回應、TCP 端點或參數無效返回 -1
+int hal_discover_tune_turnaround(const char* device, int slave, int timeout_ms);
+
+// ---- 以下由排程器使用 ----
+
+struct hal_port;
+
+// 探測結果顯示 slave 不存在且尚未到重新探測時間時返回 1 (呼叫者不送出交易)
+// 到了重新探測時間時以一次短超時探測，slave 回應時加回拓撲並返回 0
+int hal_discover_skip(struct hal_port* port, int slave);
+
+#endif // HAL_DISCOVER_H
@@ -0,0 +1,251 @@
+#include "hal_filter.h"
+#include "hal_platform.h"
+#include "hal_sched.h"
+#include <float.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAL_FILTER_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAL_FILTER_NEON 1
+#endif
+
+// 設定與狀態都以 handle 為索引的平行陣列存放；
+// hal_filter_apply 在 g_filter_lock 內把一批量測點收集到連續的區塊、執行 kernel、再寫回狀態。
+// 同一量測點只有一個寫入者 (負責該串口的擷取執行緒)，鎖只用來與設定變更互斥。
+
+#define FILTER_CHUNK 128
+#define FILTER_HISTORY (HAL_FILTER_MAX_MEDIAN - 1)
+
+static int g_enabled[HAL_MAX_POINTS];
+static int g_median[HAL_MAX_POINTS];
+static float g_alpha[HAL_MAX_POINTS];
+static float g_max_rate[HAL_MAX_POINTS];
+static float g_gain[HAL_MAX_POINTS];
+static float g_offset[HAL_MAX_POINTS];
+
+static int g_primed[HAL_MAX_POINTS];
+static float g_hist[FILTER_HISTORY][HAL_MAX_POINTS];   // 前幾次的原始取樣，[0] 為最新
+static float g_prev[HAL_MAX_POINTS];                   // 上一次變化率限制後的值
+static float g_ema[HAL_MAX_POINTS];
+static uint64_t g_last_us[HAL_MAX_POINTS];
+static hal_mutex_t g_filter_lock = HAL_MUTEX_INIT;
+
+// 一批量測點的 struct-of-arrays 工作區
+typedef struct {
+    float x[FILTER_CHUNK];
+    float h[FILTER_HISTORY][FILTER_CHUNK];
+    uint32_t m3[FILTER_CHUNK];      // median 3 的選擇遮罩 (全 1 位元表示選用)
+    uint32_t m5[FILTER_CHUNK];
+    float prev[FILTER_CHUNK];
+    float step[FILTER_CHUNK];
+    float ema[FILTER_CHUNK];
+    float alpha[FILTER_CHUNK];
+    float gain[FILTER_CHUNK];
+    float offset[FILTER_CHUNK];
+    float clamped[FILTER_CHUNK];    // 輸出：變化率限制後的值
+    float out[FILTER_CHUNK];        // 輸出：新的 EMA；調理後的值另寫入 result
+    float result[FILTER_CHUNK];
+} filter_batch_t;
+
+void hal_filter_default_config(hal_filter_config_t* cfg) {
+    if (cfg == NULL) return;
+    cfg->median = 1;
+    cfg->ema_alpha = 1.0f;
+    cfg->max_rate = 0.0f;
+    cfg->gain = 1.0f;
+    cfg->offset = 0.0f;
+}
+
+int hal_point_set_filter(int handle, const hal_filter_config_t* cfg) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS) return -1;
+    if (cfg != NULL && ((cfg->median != 1 && cfg->median != 3 && cfg->median != 5) ||
+                        !(cfg->ema_alpha > 0.0f && cfg->ema_alpha <= 1.0f) || cfg->max_rate < 0.0f)) {
+        return -1;
+    }
+
+    hal_mutex_lock(&g_filter_lock);
+    if (cfg == NULL) {
+        g_enabled[handle] = 0;
+    } else {
+        g_enabled[handle] = 1;
+        g_median[handle] = cfg->median;
+        g_alpha[handle] = cfg->ema_alpha;
+        g_max_rate[handle] = cfg->max_rate;
+        g_gain[handle] = cfg->gain;
+        g_offset[handle] = cfg->offset;
+    }
+    g_primed[handle] = 0;
+    hal_mutex_unlock(&g_filter_lock);
+    return 0;
+}
+
+void hal_filter_reset(void) {
+    hal_mutex_lock(&g_filter_lock);
+    memset(g_enabled, 0, sizeof(g_enabled));
+    memset(g_primed, 0, sizeof(g_primed));
+    hal_mutex_unlock(&g_filter_lock);
+}
+
+// 與 _mm_min_ps / _mm_max_ps 相同：任一方為 NaN 時返回 b
+static float min_f(float a, float b) { return a < b ? a : b; }
+static float max_f(float a, float b) { return a > b ? a : b; }
+
+static float median3_f(float a, float b, float c) {
+    return max_f(min_f(a, b), min_f(max_f(a, b), c));
+}
+
+// 逐點版本，也用來處理 SIMD 迴圈剩下的尾端
+static void kernel_scalar(filter_batch_t* b, int first, int n) {
+    for (int i = first; i < n; i++) {
+        float x = b->x[i];
+        float med = x;
+        if (b->m5[i]) {
+            float f = max_f(min_f(x, b->h[0][i]), min_f(b->h[1][i], b->h[2][i]));
+            float g = min_f(max_f(x, b->h[0][i]), max_f(b->h[1][i], b->h[2][i]));
+            med = median3_f(b->h[3][i], f, g);
+        } else if (b->m3[i]) {
+            med = median3_f(x, b->h[0][i], b->h[1][i]);
+        }
+        float c = min_f(max_f(med, b->prev[i] - b->step[i]), b->prev[i] + b->step[i]);
+        float e = b->ema[i] + b->alpha[i] * (c - b->ema[i]);
+        b->clamped[i] = c;
+        b->out[i] = e;
+        b->result[i] = e * b->gain[i] + b->offset[i];
+    }
+}
+
+#if defined(HAL_FILTER_SSE2)
+typedef __m128 vf_t;
+#define VF_LOAD(p) _mm_loadu_ps(p)
+#define VF_STORE(p, v) _mm_storeu_ps((p), (v))
+#define VF_MASK(p) _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(p)))
+#define VF_MIN(a, b) _mm_min_ps((a), (b))
+#define VF_MAX(a, b) _mm_max_ps((a), (b))
+#define VF_ADD(a, b) _mm_add_ps((a), (b))
+#define VF_SUB(a, b) _mm_sub_ps((a), (b))
+#define VF_MUL(a, b) _mm_mul_ps((a), (b))
+#define VF_SEL(m, a, b) _mm_or_ps(_mm_and_ps((m), (a)), _mm_andnot_ps((m), (b)))
+#define HAL_FILTER_SIMD 1
+#elif defined(HAL_FILTER_NEON)
+typedef float32x4_t vf_t;
+#define VF_LOAD(p) vld1q_f32(p)
+#define VF_STORE(p, v) vst1q_f32((p), (v))
+#define VF_MASK(p) vreinterpretq_f32_u32(vld1q_u32(p))
+// vminq/vmaxq 遇到 NaN 時返回 NaN；以比較後選擇實作，與 SSE2 及逐點版本相同 (NaN 時返回 b)
+#define VF_MIN(a, b) vbslq_f32(vcltq_f32((a), (b)), (a), (b))
+#define VF_MAX(a, b) vbslq_f32(vcgtq_f32((a), (b)), (a), (b))
+#define VF_ADD(a, b) vaddq_f32((a), (b))
+#define VF_SUB(a, b) vsubq_f32((a), (b))
+#define VF_MUL(a, b) vmulq_f32((a), (b))
+#define VF_SEL(m, a, b) vbslq_f32(vreinterpretq_u32_f32(m), (a), (b))
+#define HAL_FILTER_SIMD 1
+#endif
+
+static void kernel_simd(filter_batch_t* b, int n) {
+    int i = 0;
+#if defined(HAL_FILTER_SIMD)
+    for (; i + 4 <= n; i += 4) {
+        vf_t x = VF_LOAD(&b->x[i]);
+        vf_t h0 = VF_LOAD(&b->h[0][i]);
+        vf_t h1 = VF_LOAD(&b->h[1][i]);
+        vf_t h2 = VF_LOAD(&b->h[2][i]);
+        vf_t h3 = VF_LOAD(&b->h[3][i]);
+
+        // median 3 與 median 5 都算出來，再依每個量測點的遮罩選擇
+        vf_t med3 = VF_MAX(VF_MIN(x, h0), VF_MIN(VF_MAX(x, h0), h1));
+        vf_t f = VF_MAX(VF_MIN(x, h0), VF_MIN(h1, h2));
+        vf_t g = VF_MIN(VF_MAX(x, h0), VF_MAX(h1, h2));
+        vf_t med5 = VF_MAX(VF_MIN(h3, f), VF_MIN(VF_MAX(h3, f), g));
+        vf_t med = VF_SEL(VF_MASK(&b->m5[i]), med5, VF_SEL(VF_MASK(&b->m3[i]), med3, x));
+
+        vf_t prev = VF_LOAD(&b->prev[i]);
+        vf_t step = VF_LOAD(&b->step[i]);
+        vf_t c = VF_MIN(VF_MAX(med, VF_SUB(prev, step)), VF_ADD(prev, step));
+
+        vf_t ema = VF_LOAD(&b->ema[i]);
+        vf_t e = VF_ADD(ema, VF_MUL(VF_LOAD(&b->alpha[i]), VF_SUB(c, ema)));
+
+        VF_STORE(&b->clamped[i], c);
+        VF_STORE(&b->out[i], e);
+        VF_STORE(&b->result[i], VF_ADD(VF_MUL(e, VF_LOAD(&b->gain[i])), VF_LOAD(&b->offset[i])));
+    }
+#endif
+    kernel_scalar(b, i, n);
+}
+
+// 收集 handles 中有設定濾波的量測點，最多 FILTER_CHUNK 個 (呼叫者需持有 g_filter_lock)
+// 返回處理到的 handles 位置；pos[] 記錄每個收集到的量測點在 values 中的位置
+static int filter_gather(filter_batch_t* b, const int* handles, const float* values, int start, int n,
+                         uint64_t timestamp_us, int* pos, int* count) {
+    int m = 0;
+    int i = start;
+    for (; i < n && m < FILTER_CHUNK; i++) {
+        int h = handles[i];
+        if (h < 0 || h >= HAL_MAX_POINTS || !g_enabled[h]) continue;
+        float x = values[i];
+        if (!g_primed[h]) {
+            // 第一筆取樣填滿歷史與狀態，輸出即為第一筆取樣
+            for (int k = 0; k < FILTER_HISTORY; k++) g_hist[k][h] = x;
+            g_prev[h] = x;
+            g_ema[h] = x;
+            g_last_us[h] = timestamp_us;
+            g_primed[h] = 1;
+        }
+        b->x[m] = x;
+        for (int k = 0; k < FILTER_HISTORY; k++) b->h[k][m] = g_hist[k][h];
+        b->m3[m] = g_median[h] == 3 ? 0xFFFFFFFFu : 0;
+        b->m5[m] = g_median[h] == 5 ? 0xFFFFFFFFu : 0;
+        b->prev[m] = g_prev[h];
+        float dt = timestamp_us > g_last_us[h] ? (float)(timestamp_us - g_last_us[h]) / 1e6f : 0.0f;
+        b->step[m] = g_max_rate[h] > 0.0f ? g_max_rate[h] * dt : FLT_MAX;
+        b->ema[m] = g_ema[h];
+        b->alpha[m] = g_alpha[h];
+        b->gain[m] = g_gain[h];
+        b->offset[m] = g_offset[h];
+        pos[m++] = i;
+    }
+    *count = m;
+    return i;
+}
+
+static void filter_scatter(const filter_batch_t* b, const int* handles, float* values, const int* pos, int m,
+                           uint64_t timestamp_us) {
+    for (int j = 0; j < m; j++) {
+        int h = handles[pos[j]];
+        for (int k = FILTER_HISTORY - 1; k > 0; k--) g_hist[k][h] = g_hist[k - 1][h];
+        g_hist[0][h] = b->x[j];
+        g_prev[h] = b->clamped[j];
+        g_ema[h] = b->out[j];
+        g_last_us[h] = timestamp_us;
+        values[pos[j]] = b->result[j];
+    }
+}
+
+static void filter_run(const int* handles, float* values, int n, uint64_t timestamp_us, int simd) {
+    if (handles == NULL || values == NULL || n <= 0) return;
+
+    filter_batch_t batch;
+    int pos[FILTER_CHUNK];
+    hal_mutex_lock(&g_filter_lock);
+    int next = 0;
+    while (next < n) {
+        int m;
+        next = filter_gather(&batch, handles, values, next, n, timestamp_us, pos, &m);
+        if (m == 0) continue;
+        if (simd && m >= HAL_FILTER_SIMD_THRESHOLD) kernel_simd(&batch, m);
+        else kernel_scalar(&batch, 0, m);
+        filter_scatter(&batch, handles, values, pos, m, timestamp_us);
+    }
+    hal_mutex_unlock(&g_filter_lock);
+}
+
+void hal_filter_apply(const int* handles, float* values, int n, uint64_t timestamp_us) {
+    filter_run(handles, values, n, timestamp_us, 1);
+}
+
+void hal_filter_apply_scalar(const int* handles, float* values, int n, uint64_t timestamp_us) {
+    filter_run(handles, values, n, timestamp_us, 0);
+}
@@ -0,0 +1,45 @@
+#ifndef HAL_FILTER_H
+#define HAL_FILTER_H
+
+#include <stdint.h>
+
+// 量測點訊號調理
+// 每個成功讀取的 frame 在寫入快照表之前，先把有設定濾波的量測點收集成 struct-of-arrays，
+// 以 SIMD (SSE2 / NEON，一次 4 個量測點) 依序執行：
+//   1. median-of-N (N = 1/3/5)：單一壞 frame 造成的突波不會出現在輸出
+//   2. 變化率限制：與上一次輸出相差不超過 max_rate * dt
+//   3. EMA：y = y_prev + alpha * (x - y_prev)
+//   4. 單位換算：output = y * gain + offset
+// 快照表、變更事件與歷史紀錄看到的都是調理後的值，raw 仍為原始暫存器內容。
+// 沒有設定濾波的量測點不進入這個階段。
+
+#define HAL_FILTER_MAX_MEDIAN 5
+#define HAL_FILTER_SIMD_THRESHOLD 4 // 達到此量測點數量時改用 SIMD
+
+typedef struct {
+    int median;             // 1 (不使用)、3 或 5
+    float ema_alpha;        // (0, 1]，1 表示不平滑
+    float max_rate;         // 每秒最大變化量 (工程單位)，0 表示不限制
+    float gain;             // 單位換算
+    float offset;
+} hal_filter_config_t;
+
+// 以不做任何處理的設定填入 cfg
+void hal_filter_default_config(hal_filter_config_t* cfg);
+
+// 設定量測點的濾波 (cfg 為 NULL 時移除)，設定後濾波狀態從下一次取樣重新開始
+// 成功返回 0，handle 或參數無效返回 -1
+int hal_point_set_filter(int handle, const hal_filter_config_t* cfg);
+
+// 對 n 個量測點的新取樣就地調理 (沒有設定濾波的量測點保持不變)
+// timestamp_us 用於變化率限制的 dt
+void hal_filter_apply(const int* handles, float* values, int n, uint64_t timestamp_us);
+
+// 以逐點運算執行相同的調理，保留作為正確性與效能比較的基準
+// 與 hal_filter_apply 的結果位元相同 (含 NaN、無限大與 median 暖機期間)
+void hal_filter_apply_scalar(const int* handles, float* values, int n, uint64_t timestamp_us);
+
+// 清除所有濾波設定與狀態
+void hal_filter_reset(void);
+
+#endif // HAL_FILTER_H
@@ -0,0 +1,81 @@
+#include "hal_frame.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAL_FRAME_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAL_FRAME_NEON 1
+#endif
+
+// 大端序主機 (例如部分 PowerPC) 的線上格式即主機格式
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HAL_FRAME_HOST_BE 1
+#endif
+
+void hal_frame_arena_init(hal_frame_arena_t* arena, void* storage, size_t size) {
+    arena->base = (uint8_t*)storage;
+    arena->cap = size;
+    arena->used = 0;
+}
+
+void* hal_frame_alloc(hal_frame_arena_t* arena, size_t size) {
+    size_t start = (arena->used + HAL_FRAME_ALIGN - 1) & ~(size_t)(HAL_FRAME_ALIGN - 1);
+    if (start > arena->cap || size > arena->cap - start) return NULL;
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+void hal_frame_arena_reset(hal_frame_arena_t* arena) {
+    arena->used = 0;
+}
+
+void hal_frame_decode_be16_scalar(const uint8_t* src, uint16_t* dest, int count) {
+    for (int i = 0; i < count; i++) {
+        dest[i] = (uint16_t)((src[2 * i] << 8) | src[2 * i + 1]);
+    }
+}
+
+// 每個 16 位元元素交換高低位元組；對稱運算，解碼與編碼共用
+static void frame_swap16(const uint8_t* src, uint8_t* dest, int count) {
+#if defined(HAL_FRAME_HOST_BE)
+    memcpy(dest, src, (size_t)count * 2);
+#else
+    int i = 0;
+    if (count >= HAL_FRAME_SIMD_THRESHOLD) {
+#if defined(HAL_FRAME_SSE2)
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            _mm_storeu_si128((__m128i*)(dest + 2 * i), v);
+        }
+#elif defined(HAL_FRAME_NEON)
+        for (; i + 8 <= count; i += 8) {
+            vst1q_u8(dest + 2 * i, vrev16q_u8(vld1q_u8(src + 2 * i)));
+        }
+#else
+        // 沒有 SIMD 時一次處理 4 個暫存器 (64 位元)
+        for (; i + 4 <= count; i += 4) {
+            uint64_t v;
+            memcpy(&v, src + 2 * i, sizeof(v));
+            v = ((v & 0x00FF00FF00FF00FFULL) << 8) | ((v >> 8) & 0x00FF00FF00FF00FFULL);
+            memcpy(dest + 2 * i, &v, sizeof(v));
+        }
+#endif
+    }
+    for (; i < count; i++) {
+        uint8_t hi = src[2 * i];
+        dest[2 * i] = src[2 * i + 1];
+        dest[2 * i + 1] = hi;
+    }
+#endif
+}
+
+void hal_frame_decode_be16(const uint8_t* src, uint16_t* dest, int count) {
+    frame_swap16(src, (uint8_t*)dest, count);
+}
+
+void hal_frame_encode_be16(const uint16_t* src, uint8_t* dest, int count) {
+    frame_swap16((const uint8_t*)src, dest, count);
+}
@@ -0,0 +1,43 @@
+#ifndef HAL_FRAME_H
+#define HAL_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 交易用的 frame 緩衝區與暫存器酬載轉換
+// 一個輪詢批次的回應 PDU 與解碼後的暫存器由呼叫者提供的一塊固定 arena 依實際長度切出，
+// 穩態下不做任何動態配置，整批資料集中在連續的幾條 cache line 內，
+// 不必為每個 frame 保留最大長度 (253 bytes) 的緩衝區。
+
+#define HAL_FRAME_ALIGN 16          // 每次切出的位址對齊 (SIMD 載入/存放)
+#define HAL_FRAME_ARENA_SIZE 8192   // 可容納一整批 (32 個) 最大 frame：每個 252 bytes 對齊後 256
+
+// 達到此暫存器數量時改用 SIMD 轉換
+#define HAL_FRAME_SIMD_THRESHOLD 8
+
+typedef struct {
+    uint8_t* base;
+    size_t cap;
+    size_t used;
+} hal_frame_arena_t;
+
+// 以 storage (至少 HAL_FRAME_ALIGN 對齊) 初始化 arena
+void hal_frame_arena_init(hal_frame_arena_t* arena, void* storage, size_t size);
+
+// 切出 size bytes (HAL_FRAME_ALIGN 對齊)，空間不足返回 NULL
+void* hal_frame_alloc(hal_frame_arena_t* arena, size_t size);
+
+// 釋放已切出的全部空間
+void hal_frame_arena_reset(hal_frame_arena_t* arena);
+
+// 把 count 個大端序 (Modbus 線上格式) 暫存器直接從接收緩衝區轉為主機位元組序
+// src 不需對齊；長區塊使用 SSE2 / NEON 一次交換 8 個暫存器
+void hal_frame_decode_be16(const uint8_t* src, uint16_t* dest, int count);
+
+// 反向轉換：把 count 個暫存器以大端序寫入 frame (FC16 請求)
+void hal_frame_encode_be16(const uint16_t* src, uint8_t* dest, int count);
+
+// 逐暫存器轉換版本，保留作為正確性與效能比較的基準
+void hal_frame_decode_be16_scalar(const uint8_t* src, uint16_t* dest, int count);
+
+#endif // HAL_FRAME_H
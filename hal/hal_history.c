@@ -0,0 +1,234 @@
+#include "hal_history.h"
+#include "hal_platform.h"
+#include "hal_sched.h"
+#include "hal_snapshot.h"
+#include <stdatomic.h>
+#include <string.h>
+
+// 三層緩衝區共用同一組環形緩衝區操作：元素的第一個欄位都是 timestamp_us，
+// 依寫入順序 (時間遞增) 排列，查詢以二分搜尋找出範圍後最多兩次 memcpy 複製到呼叫者的緩衝區。
+// 緩衝區內的 timestamp_us 是單調時鐘 (hal_time_us)，牆上時間被調整 (NTP step) 不會破壞排序；
+// 只有查詢時以當下的 牆上時間 - 單調時鐘 換算查詢範圍與複製出來的時間戳記。
+// 每個量測點有自己的鎖：寫入端每次取樣只在鎖內更新幾個欄位，
+// 查詢端持有鎖的時間只有複製所需的時間，不同量測點的擷取與查詢互不等待。
+
+#define US_PER_SEC 1000000ULL
+#define US_PER_MIN 60000000ULL
+
+typedef struct {
+    void* items;
+    size_t item_size;
+    uint32_t cap;
+    uint32_t head;      // 下一筆寫入位置
+    uint32_t count;
+} history_ring_t;
+
+// 進行中的彙總區間
+typedef struct {
+    int active;         // 是否有進行中的區間
+    uint64_t start_us;  // 區間起點 (單調時鐘)
+    double sum;
+    float min;
+    float max;
+    uint32_t good;
+    uint32_t bad;
+} history_acc_t;
+
+typedef struct {
+    hal_history_sample_t raw[HAL_HISTORY_RAW_SIZE];
+    hal_history_bucket_t sec[HAL_HISTORY_SEC_SIZE];
+    hal_history_bucket_t min[HAL_HISTORY_MIN_SIZE];
+    history_ring_t rings[3];    // 依 hal_history_tier_t 排列
+    history_acc_t acc[2];       // 1 秒、1 分鐘
+    int ready;
+    hal_mutex_t lock;           // 與 hal_port 的登錄項目相同，靜態陣列歸零即為未持有的鎖
+} point_history_t;
+
+static point_history_t g_history[HAL_MAX_POINTS];
+
+static const uint64_t g_bucket_us[2] = { US_PER_SEC, US_PER_MIN };
+
+// 查詢換算用的 牆上時間 - 單調時鐘
+// 兩個時鐘先後讀取，每次量到的差會有幾微秒的抖動；差異在 HISTORY_OFFSET_SLACK_US 內時沿用上一次的值，
+// 同一筆取樣在不同查詢中換算出相同的時間戳記 (查詢結果的時間可以直接當作下一次查詢的範圍)，
+// 牆上時間真正被調整時才改用新的差
+#define HISTORY_OFFSET_SLACK_US 1000
+static atomic_llong g_wall_offset;
+
+static int64_t history_wall_offset(void) {
+    int64_t measured = (int64_t)hal_wall_time_us() - (int64_t)hal_time_us();
+    int64_t offset = atomic_load_explicit(&g_wall_offset, memory_order_relaxed);
+    int64_t diff = measured - offset;
+    if (offset != 0 && diff < HISTORY_OFFSET_SLACK_US && diff > -HISTORY_OFFSET_SLACK_US) return offset;
+    atomic_store_explicit(&g_wall_offset, measured, memory_order_relaxed);
+    return measured;
+}
+
+// 牆上時間換算成單調時鐘，早於開機的時間換算為 0
+static uint64_t history_mono(uint64_t wall_us, int64_t offset) {
+    int64_t t = (int64_t)wall_us - offset;
+    return t > 0 ? (uint64_t)t : 0;
+}
+
+// 第一次使用時才設定 ring 描述，未註冊的量測點不會碰到對應的記憶體頁 (呼叫者需持有鎖)
+static void history_prepare(point_history_t* h) {
+    if (h->ready) return;
+    h->rings[HAL_HISTORY_RAW] = (history_ring_t){ h->raw, sizeof(h->raw[0]), HAL_HISTORY_RAW_SIZE, 0, 0 };
+    h->rings[HAL_HISTORY_1S] = (history_ring_t){ h->sec, sizeof(h->sec[0]), HAL_HISTORY_SEC_SIZE, 0, 0 };
+    h->rings[HAL_HISTORY_1MIN] = (history_ring_t){ h->min, sizeof(h->min[0]), HAL_HISTORY_MIN_SIZE, 0, 0 };
+    memset(h->acc, 0, sizeof(h->acc));
+    h->ready = 1;
+}
+
+static void* ring_slot(const history_ring_t* r, uint32_t pos) {
+    return (uint8_t*)r->items + (size_t)(pos % r->cap) * r->item_size;
+}
+
+// 寫入一筆並設定 timestamp_us (單調時鐘，同一量測點只有一個寫入者，因此依序遞增)
+static void* ring_push(history_ring_t* r, uint64_t timestamp_us) {
+    void* slot = ring_slot(r, r->head);
+    *(uint64_t*)slot = timestamp_us;
+    r->head = (r->head + 1) % r->cap;
+    if (r->count < r->cap) r->count++;
+    return slot;
+}
+
+// 第 i 筆 (0 為最舊) 的 timestamp
+static uint64_t ring_timestamp(const history_ring_t* r, uint32_t i) {
+    uint32_t pos = r->head + r->cap - r->count + i;
+    return *(const uint64_t*)ring_slot(r, pos);
+}
+
+// 第一筆 timestamp >= t 的位置
+static uint32_t ring_lower_bound(const history_ring_t* r, uint64_t t) {
+    uint32_t lo = 0, hi = r->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ring_timestamp(r, mid) < t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// 把 timestamp_us 在 [from_us, to_us) 範圍內最新的 max 筆依序複製到 out (has_to 為 0 表示不設上限)
+static int ring_copy_range(const history_ring_t* r, uint64_t from_us, uint64_t to_us, int has_to,
+                           void* out, int max) {
+    if (r->count == 0 || max <= 0) return 0;
+    uint32_t lo = ring_lower_bound(r, from_us);
+    uint32_t hi = has_to ? ring_lower_bound(r, to_us) : r->count;
+    if (hi <= lo) return 0;
+    if (hi - lo > (uint32_t)max) lo = hi - (uint32_t)max;
+
+    uint32_t n = hi - lo;
+    uint32_t first = (r->head + r->cap - r->count + lo) % r->cap;
+    uint32_t head_part = r->cap - first;
+    if (head_part > n) head_part = n;
+    memcpy(out, ring_slot(r, first), (size_t)head_part * r->item_size);
+    if (n > head_part) {
+        memcpy((uint8_t*)out + (size_t)head_part * r->item_size, r->items, (size_t)(n - head_part) * r->item_size);
+    }
+    return (int)n;
+}
+
+static void acc_flush(history_acc_t* acc, history_ring_t* ring) {
+    if (!acc->active) return;
+    hal_history_bucket_t* b = (hal_history_bucket_t*)ring_push(ring, acc->start_us);
+    b->min = acc->good ? acc->min : 0.0f;
+    b->max = acc->good ? acc->max : 0.0f;
+    b->avg = acc->good ? (float)(acc->sum / acc->good) : 0.0f;
+    b->good = acc->good > 0xFFFF ? 0xFFFF : (uint16_t)acc->good;
+    b->bad = acc->bad > 0xFFFF ? 0xFFFF : (uint16_t)acc->bad;
+    acc->active = 0;
+}
+
+// 取樣落在新的區間時先寫出上一個區間；區間以單調時鐘對齊
+static void acc_add(history_acc_t* acc, history_ring_t* ring, uint64_t bucket_us,
+                    uint32_t quality, float value, uint64_t timestamp_us) {
+    uint64_t start = timestamp_us - timestamp_us % bucket_us;
+    if (!acc->active || acc->start_us != start) {
+        acc_flush(acc, ring);
+        acc->active = 1;
+        acc->start_us = start;
+        acc->sum = 0;
+        acc->good = 0;
+        acc->bad = 0;
+    }
+    if (quality != HAL_QUALITY_GOOD) {
+        acc->bad++;
+        return;
+    }
+    if (acc->good == 0 || value < acc->min) acc->min = value;
+    if (acc->good == 0 || value > acc->max) acc->max = value;
+    acc->sum += value;
+    acc->good++;
+}
+
+void hal_history_sample(int handle, uint32_t quality, float value, uint64_t timestamp_us) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS) return;
+
+    point_history_t* h = &g_history[handle];
+    hal_mutex_lock(&h->lock);
+    history_prepare(h);
+
+    hal_history_sample_t* s = (hal_history_sample_t*)ring_push(&h->rings[HAL_HISTORY_RAW], timestamp_us);
+    s->value = value;
+    s->quality = quality;
+
+    for (int k = 0; k < 2; k++) {
+        acc_add(&h->acc[k], &h->rings[HAL_HISTORY_1S + k], g_bucket_us[k], quality, value, timestamp_us);
+    }
+    hal_mutex_unlock(&h->lock);
+}
+
+static int history_read(int handle, int tier, uint64_t from_us, uint64_t to_us, void* out, int max) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS || out == NULL || max < 0) return -1;
+
+    // 查詢範圍換算成單調時鐘，複製出來的 timestamp_us 在鎖外換算回牆上時間
+    int64_t offset = history_wall_offset();
+    point_history_t* h = &g_history[handle];
+    size_t item_size = 0;
+    int n = 0;
+    hal_mutex_lock(&h->lock);
+    if (h->ready) {
+        const history_ring_t* r = &h->rings[tier];
+        item_size = r->item_size;
+        n = ring_copy_range(r, history_mono(from_us, offset), history_mono(to_us, offset), to_us != 0,
+                            out, max);
+    }
+    hal_mutex_unlock(&h->lock);
+
+    for (int i = 0; i < n; i++) {
+        uint64_t* ts = (uint64_t*)((uint8_t*)out + (size_t)i * item_size);
+        *ts = (uint64_t)((int64_t)*ts + offset);
+    }
+    return n;
+}
+
+int hal_history_read_raw(int handle, uint64_t from_us, uint64_t to_us, hal_history_sample_t* out, int max) {
+    return history_read(handle, HAL_HISTORY_RAW, from_us, to_us, out, max);
+}
+
+int hal_history_read_buckets(int handle, int tier, uint64_t from_us, uint64_t to_us,
+                             hal_history_bucket_t* out, int max) {
+    if (tier != HAL_HISTORY_1S && tier != HAL_HISTORY_1MIN) return -1;
+    return history_read(handle, tier, from_us, to_us, out, max);
+}
+
+int hal_history_count(int handle, int tier) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS || tier < HAL_HISTORY_RAW || tier > HAL_HISTORY_1MIN) return -1;
+
+    point_history_t* h = &g_history[handle];
+    hal_mutex_lock(&h->lock);
+    int n = h->ready ? (int)h->rings[tier].count : 0;
+    hal_mutex_unlock(&h->lock);
+    return n;
+}
+
+void hal_history_reset(void) {
+    for (int i = 0; i < HAL_MAX_POINTS; i++) {
+        point_history_t* h = &g_history[i];
+        hal_mutex_lock(&h->lock);
+        h->ready = 0;
+        hal_mutex_unlock(&h->lock);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef HAL_HISTORY_H
+#define HAL_HISTORY_H
+
+#include <stdint.h>
+
+// 量測點歷史紀錄 (趨勢圖、故障診斷)
+// 每個量測點有三層固定大小的環形緩衝區，擷取執行緒更新快照時逐筆累加，不做任何動態配置：
+//   原始取樣     HAL_HISTORY_RAW_SIZE 筆 (timestamp, value, quality)
+//   1 秒彙總     HAL_HISTORY_SEC_SIZE 筆 (min / max / avg)
+//   1 分鐘彙總   HAL_HISTORY_MIN_SIZE 筆 (min / max / avg)
+// 彙總區間在下一個區間的第一筆取樣到達時才寫入緩衝區，進行中的區間不會出現在查詢結果。
+// 緩衝區為靜態陣列，未使用的量測點不佔用實體記憶體。
+// 取樣以單調時鐘 (hal_time_us) 記錄，1 秒 / 1 分鐘區間也以單調時鐘對齊；查詢時才換算成 Unix epoch，
+// 系統時間被調整 (NTP step) 後，調整前的資料以調整後的時間基準回報。
+
+#ifndef HAL_HISTORY_RAW_SIZE
+#define HAL_HISTORY_RAW_SIZE 256
+#endif
+#ifndef HAL_HISTORY_SEC_SIZE
+#define HAL_HISTORY_SEC_SIZE 600    // 10 分鐘
+#endif
+#ifndef HAL_HISTORY_MIN_SIZE
+#define HAL_HISTORY_MIN_SIZE 1440   // 24 小時
+#endif
+
+// 查詢的層級
+typedef enum {
+    HAL_HISTORY_RAW = 0,
+    HAL_HISTORY_1S = 1,
+    HAL_HISTORY_1MIN = 2,
+} hal_history_tier_t;
+
+typedef struct {
+    uint64_t timestamp_us;  // Unix epoch 微秒
+    float value;            // 品質為 BAD 時為最後一次有效值
+    uint32_t quality;       // HAL_QUALITY_*
+} hal_history_sample_t;
+
+typedef struct {
+    uint64_t timestamp_us;  // 區間起點 (Unix epoch 微秒)
+    float min;              // 只統計品質良好的取樣；good 為 0 時三者皆為 0
+    float max;
+    float avg;
+    uint16_t good;          // 區間內品質良好的取樣數
+    uint16_t bad;           // 區間內讀取失敗的次數
+} hal_history_bucket_t;
+
+// 讀取原始取樣中 from_us <= timestamp_us < to_us 的部分 (to_us 為 0 表示不設上限)
+// 依時間由舊到新連續寫入 out；範圍內超過 max 筆時只返回最新的 max 筆
+// 返回寫入的筆數，handle 無效返回 -1
+int hal_history_read_raw(int handle, uint64_t from_us, uint64_t to_us, hal_history_sample_t* out, int max);
+
+// 與 hal_history_read_raw 相同，讀取彙總層 (HAL_HISTORY_1S / HAL_HISTORY_1MIN)，以區間起點比較
+// 返回寫入的筆數，handle 或 tier 無效返回 -1
+int hal_history_read_buckets(int handle, int tier, uint64_t from_us, uint64_t to_us,
+                             hal_history_bucket_t* out, int max);
+
+// 各層目前保存的筆數，handle 或 tier 無效返回 -1
+int hal_history_count(int handle, int tier);
+
+// ---- 以下由 HAL 內部的寫入端使用 ----
+
+// 快照更新後呼叫，寫入原始取樣並累加到 1 秒 / 1 分鐘區間 (timestamp_us 為 hal_time_us)
+void hal_history_sample(int handle, uint32_t quality, float value, uint64_t timestamp_us);
+
+// 清除所有量測點的歷史
+void hal_history_reset(void);
+
+#endif // HAL_HISTORY_H
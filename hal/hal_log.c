@@ -0,0 +1,149 @@
+#include "hal_log.h"
+#include "hal_platform.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+int hal_log_level = HAL_LOG_LEVEL_INFO;
+static atomic_int g_sink = HAL_LOG_SINK_STDOUT;
+
+// 有界 MPMC 佇列 (Vyukov)：每個 cell 的 seq 表示它目前可被寫入或讀取的序號。
+// 寫入端以 CAS 取得位置，佇列已滿時直接丟棄訊息，熱路徑永遠不會等待。
+typedef struct {
+    atomic_uint seq;
+    int level;
+    uint64_t timestamp_us;
+    char msg[HAL_LOG_MSG_LEN];
+} log_cell_t;
+
+static log_cell_t g_ring[HAL_LOG_RING_SIZE];
+static atomic_uint g_enqueue_pos;
+static atomic_uint g_dequeue_pos;
+static atomic_uint g_dropped;
+static atomic_int g_ring_ready;
+
+static const char* level_name(int level) {
+    switch (level) {
+        case HAL_LOG_LEVEL_TRACE: return "TRACE";
+        case HAL_LOG_LEVEL_DEBUG: return "DEBUG";
+        case HAL_LOG_LEVEL_INFO:  return "INFO";
+        case HAL_LOG_LEVEL_WARN:  return "WARN";
+        default:                  return "ERROR";
+    }
+}
+
+static void ring_init(void) {
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&g_ring_ready, &expected, -1)) return;
+    for (unsigned i = 0; i < HAL_LOG_RING_SIZE; i++) {
+        atomic_store_explicit(&g_ring[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store(&g_enqueue_pos, 0);
+    atomic_store(&g_dequeue_pos, 0);
+    atomic_store(&g_ring_ready, 1);
+}
+
+static void ring_push(int level, const char msg[HAL_LOG_MSG_LEN]) {
+    if (atomic_load(&g_ring_ready) != 1) return;
+
+    unsigned pos = atomic_load_explicit(&g_enqueue_pos, memory_order_relaxed);
+    log_cell_t* cell;
+    for (;;) {
+        cell = &g_ring[pos & (HAL_LOG_RING_SIZE - 1)];
+        unsigned seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&g_enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&g_enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->level = level;
+    cell->timestamp_us = hal_wall_time_us();
+    memcpy(cell->msg, msg, HAL_LOG_MSG_LEN); // msg 來自 hal_log_write 的同尺寸緩衝區
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+}
+
+// 取出一筆訊息，佇列為空時返回 0
+static int ring_pop(int* level, uint64_t* timestamp_us, char* msg) {
+    unsigned pos = atomic_load_explicit(&g_dequeue_pos, memory_order_relaxed);
+    log_cell_t* cell;
+    for (;;) {
+        cell = &g_ring[pos & (HAL_LOG_RING_SIZE - 1)];
+        unsigned seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int diff = (int)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&g_dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&g_dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *level = cell->level;
+    *timestamp_us = cell->timestamp_us;
+    memcpy(msg, cell->msg, HAL_LOG_MSG_LEN);
+    atomic_store_explicit(&cell->seq, pos + HAL_LOG_RING_SIZE, memory_order_release);
+    return 1;
+}
+
+void hal_log_set_level(int level) {
+    if (level < HAL_LOG_LEVEL_TRACE) level = HAL_LOG_LEVEL_TRACE;
+    if (level > HAL_LOG_LEVEL_OFF) level = HAL_LOG_LEVEL_OFF;
+    hal_log_level = level;
+}
+
+void hal_log_set_sink(int sink) {
+    if (sink == HAL_LOG_SINK_RING) ring_init();
+    atomic_store(&g_sink, sink);
+}
+
+void hal_log_write(int level, const char* fmt, ...) {
+    int sink = atomic_load_explicit(&g_sink, memory_order_relaxed);
+    if (sink == HAL_LOG_SINK_NONE) return;
+
+    char msg[HAL_LOG_MSG_LEN];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+
+    if (sink == HAL_LOG_SINK_RING) {
+        ring_push(level, msg);
+    } else {
+        fprintf(level >= HAL_LOG_LEVEL_WARN ? stderr : stdout, "HAL: %s\n", msg);
+    }
+}
+
+int hal_log_drain(char* buf, int cap) {
+    if (buf == NULL || cap <= 0) return 0;
+    buf[0] = '\0';
+    if (atomic_load(&g_ring_ready) != 1) return 0;
+
+    int used = 0;
+    int level;
+    uint64_t ts;
+    char msg[HAL_LOG_MSG_LEN];
+    // 一行最長為時間戳記 + 層級 + 訊息，剩餘空間不足時留待下一次讀取
+    while (cap - used > HAL_LOG_MSG_LEN + 32 && ring_pop(&level, &ts, msg)) {
+        used += snprintf(buf + used, (size_t)(cap - used), "%llu %s %s\n",
+                         (unsigned long long)ts, level_name(level), msg);
+    }
+    return used;
+}
+
+unsigned hal_log_dropped(void) {
+    return atomic_load(&g_dropped);
+}
@@ -0,0 +1,65 @@
+#ifndef HAL_LOG_H
+#define HAL_LOG_H
+
+// HAL 分級日誌
+// 低於 HAL_LOG_COMPILE_LEVEL 的訊息在編譯時就被移除 (預設移除 TRACE，
+// 例如每個 frame 的 hex dump)；其餘訊息再依執行期層級過濾。
+// 輸出目的地可選擇 stdout 或無鎖 ring buffer，後者由 Python 在熱路徑之外讀取。
+
+#define HAL_LOG_LEVEL_TRACE 0
+#define HAL_LOG_LEVEL_DEBUG 1
+#define HAL_LOG_LEVEL_INFO  2
+#define HAL_LOG_LEVEL_WARN  3
+#define HAL_LOG_LEVEL_ERROR 4
+#define HAL_LOG_LEVEL_OFF   5
+
+// 編譯時層級，可用 -DHAL_LOG_COMPILE_LEVEL=0 保留 TRACE 訊息
+#ifndef HAL_LOG_COMPILE_LEVEL
+#define HAL_LOG_COMPILE_LEVEL HAL_LOG_LEVEL_DEBUG
+#endif
+
+// 輸出目的地
+#define HAL_LOG_SINK_NONE   0
+#define HAL_LOG_SINK_STDOUT 1
+#define HAL_LOG_SINK_RING   2
+
+#define HAL_LOG_RING_SIZE 256   // ring buffer 訊息數 (必須是 2 的次方)
+#define HAL_LOG_MSG_LEN   160   // 單一訊息最大長度 (含結尾 '\0')
+
+extern int hal_log_level;
+
+// 設定執行期層級 (預設 HAL_LOG_LEVEL_INFO)
+void hal_log_set_level(int level);
+
+// 設定輸出目的地 (預設 HAL_LOG_SINK_STDOUT)
+void hal_log_set_sink(int sink);
+
+// 從 ring buffer 取出訊息，每行格式為 "<timestamp_us> <LEVEL> <message>\n"
+// 返回寫入 buf 的位元組數 (不含結尾 '\0')
+int hal_log_drain(char* buf, int cap);
+
+// ring buffer 已滿而被丟棄的訊息數
+unsigned hal_log_dropped(void);
+
+void hal_log_write(int level, const char* fmt, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+#define HAL_LOG(level, ...)                                           \
+    do {                                                              \
+        if ((level) >= HAL_LOG_COMPILE_LEVEL && (level) >= hal_log_level) \
+            hal_log_write((level), __VA_ARGS__);                      \
+    } while (0)
+
+#define HAL_TRACE(...) HAL_LOG(HAL_LOG_LEVEL_TRACE, __VA_ARGS__)
+#define HAL_DEBUG(...) HAL_LOG(HAL_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define HAL_INFO(...)  HAL_LOG(HAL_LOG_LEVEL_INFO, __VA_ARGS__)
+#define HAL_WARN(...)  HAL_LOG(HAL_LOG_LEVEL_WARN, __VA_ARGS__)
+#define HAL_ERROR(...) HAL_LOG(HAL_LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// TRACE 層級是否已編譯進來 (用於略過只為日誌而做的計算，例如 hex dump)
+#define HAL_TRACE_ENABLED (HAL_LOG_COMPILE_LEVEL <= HAL_LOG_LEVEL_TRACE && hal_log_level <= HAL_LOG_LEVEL_TRACE)
+
+#endif // HAL_LOG_H
@@ -1,14 +1,41 @@
 #include "hal_modbus.h"
+#include "hal_crc16.h"
+#include "hal_frame.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include "hal_stats.h"
+#include "hal_tcp.h"
+#include "hal_write.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <windows.h>
+
+#define MODBUS_RTU_MAX_ADU (1 + HAL_MODBUS_MAX_PDU + 2) // 位址 + PDU + CRC
+
+// 預先配置的 context 池：連線與斷線不經過 malloc/free，由 g_ctx_lock 保護
+static modbus_t g_contexts[HAL_MODBUS_MAX_CONTEXTS];
+static hal_mutex_t g_ctx_lock = HAL_MUTEX_INIT;
 
 modbus_t* hal_modbus_connect(const char* device, int baud, int slave_id) {
-    modbus_t *ctx = (modbus_t*)malloc(sizeof(modbus_t));
+    if (device == NULL) return NULL;
+
+    // 從共用登錄表取得串口 (同一 device 的多個 slave 共用一個 handle)
+    hal_port_t* port = hal_port_get(device, baud);
+    if (port == NULL || !hal_port_is_open(port)) return NULL;
+
+    modbus_t *ctx = NULL;
+    hal_mutex_lock(&g_ctx_lock);
+    for (int i = 0; i < HAL_MODBUS_MAX_CONTEXTS; i++) {
+        if (!g_contexts[i].in_use) {
+            ctx = &g_contexts[i];
+            ctx->in_use = 1;
+            break;
+        }
+    }
+    hal_mutex_unlock(&g_ctx_lock);
     if (ctx == NULL) {
-        fprintf(stderr, "Failed to allocate memory for modbus context\n");
+        HAL_ERROR("Modbus context pool exhausted (%d contexts)", HAL_MODBUS_MAX_CONTEXTS);
         return NULL;
     }
 
@@ -17,437 +44,553 @@ modbus_t* hal_modbus_connect(const char* device, int baud, int slave_id) {
     ctx->device[sizeof(ctx->device) - 1] = '\0';
     ctx->baud = baud;
     ctx->slave_id = slave_id;
-    ctx->connected = 0;
-    ctx->hSerial = NULL;
-
-    // 嘗試打開串口
-    char port_name[32];
-    snprintf(port_name, sizeof(port_name), "\\\\.\\%s", device);
-
-    HANDLE hSerial = CreateFileA(port_name,
-                                GENERIC_READ | GENERIC_WRITE,
-                                0,
-                                NULL,
-                                OPEN_EXISTING,
-                                FILE_ATTRIBUTE_NORMAL,
-                                NULL);
-
-    if (hSerial == INVALID_HANDLE_VALUE) {
-        DWORD error = GetLastError();
-        printf("HAL: Failed to open serial port %s, error: %lu", device, error);
-        switch(error) {
-            case 2: printf(" (File not found - port may not exist)\n"); break;
-            case 5: printf(" (Access denied - port may be in use by another application)\n"); break;
-            case 87: printf(" (Invalid parameter)\n"); break;
-            default: printf(" (Unknown error)\n"); break;
-        }
-        free(ctx);
-        return NULL;
-    }
-
-    // 設定串口參數
-    DCB dcbSerialParams = {0};
-    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
-
-    if (!GetCommState(hSerial, &dcbSerialParams)) {
-        printf("HAL: Failed to get comm state\n");
-        CloseHandle(hSerial);
-        free(ctx);
-        return NULL;
-    }
-
-    dcbSerialParams.BaudRate = baud;
-    dcbSerialParams.ByteSize = 8;
-    dcbSerialParams.StopBits = ONESTOPBIT;
-    dcbSerialParams.Parity = NOPARITY;
-
-    if (!SetCommState(hSerial, &dcbSerialParams)) {
-        printf("HAL: Failed to set comm state\n");
-        CloseHandle(hSerial);
-        free(ctx);
-        return NULL;
-    }
-
-    // 設定超時
-    COMMTIMEOUTS timeouts = {0};
-    timeouts.ReadIntervalTimeout = 50;
-    timeouts.ReadTotalTimeoutConstant = 50;
-    timeouts.ReadTotalTimeoutMultiplier = 10;
-    timeouts.WriteTotalTimeoutConstant = 50;
-    timeouts.WriteTotalTimeoutMultiplier = 10;
-
-    if (!SetCommTimeouts(hSerial, &timeouts)) {
-        printf("HAL: Failed to set timeouts\n");
-        CloseHandle(hSerial);
-        free(ctx);
-        return NULL;
-    }
-
-    ctx->hSerial = hSerial;
+    ctx->port = port;
     ctx->connected = 1;
 
-    printf("HAL: Successfully opened serial port %s, slave ID %d, baud %d\n",
+    HAL_DEBUG("Successfully opened serial port %s, slave ID %d, baud %d",
            device, slave_id, baud);
     return ctx;
 }
 
 void hal_modbus_disconnect(modbus_t* ctx) {
     if (ctx) {
-        printf("HAL: Disconnecting modbus device %s\n", ctx->device);
-        if (ctx->hSerial && ctx->hSerial != INVALID_HANDLE_VALUE) {
-            CloseHandle((HANDLE)ctx->hSerial);
-        }
+        HAL_DEBUG("Disconnecting modbus device %s", ctx->device);
+        // 串口由登錄表持有，其他 slave 仍可能在使用，這裡只把 context 歸還池中
+        hal_mutex_lock(&g_ctx_lock);
         ctx->connected = 0;
-        free(ctx);
+        ctx->port = NULL;
+        ctx->in_use = 0;
+        hal_mutex_unlock(&g_ctx_lock);
     }
 }
 
 int hal_modbus_write_register(modbus_t* ctx, int addr, int value) {
     if (ctx == NULL || !ctx->connected) return -1;
 
-    printf("HAL: Writing register [device:%s, addr:0x%04X, value:%d]\n",
+    HAL_TRACE("Queueing register write [device:%s, addr:0x%04X, value:%d]",
            ctx->device, addr, value);
 
-    // 模擬寫入操作（總是成功）
-    return 0; // Success
+    uint16_t reg_value = (uint16_t)value;
+    return hal_write_submit(ctx->port, ctx->slave_id, addr, 1, &reg_value);
 }
 
-int hal_modbus_read_registers(modbus_t* ctx, int addr, int num, uint16_t* dest) {
-    if (ctx == NULL || !ctx->connected || dest == NULL) return -1;
+// 依已收到的標頭判斷 RTU 回應 frame 的總長度
+static int modbus_rtu_frame_len(const uint8_t* buf, int have) {
+    if (have < 2) return 5;                     // 最短 frame：例外回應
+    if (buf[1] & 0x80) return 5;                // addr + func|0x80 + code + CRC
+    switch (buf[1]) {
+        case 0x01: case 0x02: case 0x03: case 0x04:
+            return have < 3 ? 5 : 5 + buf[2];   // addr + func + byte count + data + CRC
+        case 0x05: case 0x06: case 0x0F: case 0x10:
+            return 8;                           // 回應固定為 addr + func + 4 bytes + CRC
+        default:
+            return -1;
+    }
+}
 
-    printf("HAL: Reading %d registers from [device:%s, addr:0x%04X]\n",
-           num, ctx->device, addr);
+static const char* modbus_exception_name(int code) {
+    switch (code) {
+        case 0x01: return "Illegal function";
+        case 0x02: return "Illegal data address";
+        case 0x03: return "Illegal data value";
+        case 0x04: return "Slave device failure";
+        case 0x05: return "Acknowledge";
+        case 0x06: return "Slave device busy";
+        case 0x0B: return "Gateway target failed to respond";
+        default:   return "Unknown exception";
+    }
+}
 
-    // 模擬讀取操作 - 生成一些模擬數據
-    srand((unsigned int)time(NULL) + addr);
-    for (int i = 0; i < num; i++) {
-        dest[i] = (uint16_t)(rand() % 4000 + 1000); // 1000-5000 範圍的隨機值
+// 驗證回應 PDU 的功能碼並辨識例外回應 (RTU 與 TCP 共用)
+static int modbus_check_pdu(const uint8_t* pdu, int len, int slave, int func) {
+    if (len <= 0) return HAL_MODBUS_ERR_TIMEOUT;
+    if (len < 2) {
+        HAL_WARN("Short response from addr %d (PDU %d bytes)", slave, len);
+        return HAL_MODBUS_ERR_SHORT;
     }
 
-    return 0; // Success
+    if ((pdu[0] & 0x7F) != func) {
+        HAL_WARN("Invalid response (expected func=%02X, got func=%02X) from addr %d",
+               func, pdu[0], slave);
+        return HAL_MODBUS_ERR_MISMATCH;
+    }
+
+    if (pdu[0] & 0x80) {
+        HAL_WARN("Exception response from addr %d func %02X: %02X (%s)",
+               slave, func, pdu[1], modbus_exception_name(pdu[1]));
+        return HAL_MODBUS_ERR_EXCEPTION;
+    }
+    return HAL_MODBUS_OK;
 }
 
-// 計算 Modbus RTU CRC16
-static unsigned short crc16(unsigned char *buffer, unsigned short buffer_length) {
-    unsigned short crc = 0xFFFF;
+// 驗證 Modbus TCP 回應：連線錯誤、MBAP unit identifier 與 PDU
+// (transaction ID 相同但 unit 不符的回應來自錯誤的裝置，不能當成本次交易的結果)
+static int modbus_check_tcp(const hal_tcp_xfer_t* x, int func) {
+    if (x->resp_len < 0) return HAL_MODBUS_ERR_IO;
+    if (x->resp_len > 0 && x->resp_unit != (x->unit & 0xFF)) {
+        HAL_WARN("Unit mismatch (expected %d, got %d)", x->unit, x->resp_unit);
+        return HAL_MODBUS_ERR_MISMATCH;
+    }
+    return modbus_check_pdu(x->resp, x->resp_len, x->unit, func);
+}
 
-    for (int pos = 0; pos < buffer_length; pos++) {
-        crc ^= (unsigned short)buffer[pos];
+// 驗證 RTU 回應：長度、CRC、slave 位址與功能碼，並辨識例外回應
+static int modbus_check_response(const uint8_t* resp, int len, int slave, int func) {
+    if (len <= 0) return HAL_MODBUS_ERR_TIMEOUT;
+    if (len < 5) {
+        HAL_WARN("Short response from addr %d (read %d bytes)", slave, len);
+        return HAL_MODBUS_ERR_SHORT;
+    }
 
-        for (int i = 8; i != 0; i--) {
-            if ((crc & 0x0001) != 0) {
-                crc >>= 1;
-                crc ^= 0xA001;
-            } else {
-                crc >>= 1;
-            }
-        }
+    uint16_t crc = hal_crc16(resp, (size_t)(len - 2));
+    if (resp[len - 2] != (crc & 0xFF) || resp[len - 1] != (crc >> 8)) {
+        HAL_WARN("CRC error in response from addr %d (calc %04X, got %02X%02X)",
+               slave, crc, resp[len - 1], resp[len - 2]);
+        return HAL_MODBUS_ERR_CRC;
+    }
+
+    if (resp[0] != slave) {
+        HAL_WARN("Invalid response (expected addr=%d, got addr=%d)", slave, resp[0]);
+        return HAL_MODBUS_ERR_MISMATCH;
     }
-    return crc;
+    return modbus_check_pdu(resp + 1, len - 3, slave, func);
 }
 
-// 讀取溫度感測器
-float modbus_read_temperature(const char *device, int addr, int reg) {
-    printf("HAL: Reading temperature from device %s, addr %d, reg 0x%04X\n", device, addr, reg);
-
-    // 打開串口
-    char port_name[32];
-    snprintf(port_name, sizeof(port_name), "\\\\.\\%s", device);
-
-    HANDLE hSerial = CreateFileA(port_name,
-                                GENERIC_READ | GENERIC_WRITE,
-                                0,
-                                NULL,
-                                OPEN_EXISTING,
-                                FILE_ATTRIBUTE_NORMAL,
-                                NULL);
-
-    if (hSerial == INVALID_HANDLE_VALUE) {
-        printf("HAL: Failed to open serial port %s, error: %lu\n", device, GetLastError());
-        return -1.0f;
+// FC03 請求 PDU：功能碼 + 起始暫存器 + 暫存器數量
+static void modbus_build_fc03(uint8_t* pdu, int reg, int count) {
+    pdu[0] = 0x03;                     // Function code (Read Holding Registers)
+    pdu[1] = (uint8_t)(reg >> 8);      // Register address (high byte)
+    pdu[2] = (uint8_t)(reg & 0xFF);    // Register address (low byte)
+    pdu[3] = (uint8_t)(count >> 8);    // Number of registers (high byte)
+    pdu[4] = (uint8_t)(count & 0xFF);  // Number of registers (low byte)
+}
+
+void hal_modbus_fc03_request(uint8_t* out, int slave, int reg, int count) {
+    out[0] = (uint8_t)slave;
+    modbus_build_fc03(out + 1, reg, count);
+    uint16_t crc = hal_crc16(out, 6);
+    out[6] = (uint8_t)(crc & 0xFF);
+    out[7] = (uint8_t)(crc >> 8);
+}
+
+// 檢查 FC03 回應 PDU 的資料長度，直接從接收緩衝區解出暫存器內容
+static int modbus_decode_fc03(const uint8_t* pdu, int len, int count, uint16_t* dest) {
+    if (pdu[1] != 2 * count || len != 2 + 2 * count) {
+        HAL_WARN("Invalid data length in response (expected %d bytes, got %d)", 2 * count, pdu[1]);
+        return HAL_MODBUS_ERR_MISMATCH;
     }
+    hal_frame_decode_be16(pdu + 2, dest, count);
+    return HAL_MODBUS_OK;
+}
 
-    // 設定串口參數
-    DCB dcbSerialParams = {0};
-    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+// 以 RTU 送出一個完整的請求 frame (已含 slave 位址與 CRC)，回應 frame 收進 buf (MODBUS_RTU_MAX_ADU bytes)
+// 驗證後 *resp 指向 buf 內的回應 PDU，不另外複製
+// 返回 hal_modbus_status_t，並記錄統計
+static int modbus_rtu_send(hal_port_t* port, int addr, const uint8_t* request, int req_len,
+                           uint8_t* buf, const uint8_t** resp, int* resp_len) {
+    // 例外回應 (5 bytes) 在第 5 個位元組到達時即結束
+    uint8_t* response = buf;
+    hal_port_timing_t timing;
+    int total_read = hal_port_transact_framed(port, addr, request, req_len, response, MODBUS_RTU_MAX_ADU,
+                                              modbus_rtu_frame_len, HAL_PORT_RESPONSE_TIMEOUT_MS,
+                                              &timing);
+    if (HAL_TRACE_ENABLED && total_read > 0) {
+        // 顯示接收到的數據 (除錯用，預設編譯時移除)
+        char hex[3 * MODBUS_RTU_MAX_ADU + 1];
+        for (int i = 0; i < total_read; i++) {
+            snprintf(hex + 3 * i, 4, "%02X ", response[i]);
+        }
+        HAL_TRACE("Received %d bytes: %s", total_read, hex);
+    }
 
-    if (!GetCommState(hSerial, &dcbSerialParams)) {
-        printf("HAL: Failed to get comm state\n");
-        CloseHandle(hSerial);
-        return -1.0f;
+    int status = total_read < 0 ? HAL_MODBUS_ERR_IO
+                                : modbus_check_response(response, total_read, addr, request[1]);
+    if (status == HAL_MODBUS_OK) {
+        *resp = response + 1;
+        *resp_len = total_read - 3;
     }
 
-    dcbSerialParams.BaudRate = 9600;
-    dcbSerialParams.ByteSize = 8;
-    dcbSerialParams.Parity = NOPARITY;
-    dcbSerialParams.StopBits = ONESTOPBIT;
-    dcbSerialParams.fBinary = TRUE;
-    dcbSerialParams.fParity = FALSE;
-    dcbSerialParams.fOutxCtsFlow = FALSE;
-    dcbSerialParams.fOutxDsrFlow = FALSE;
-    dcbSerialParams.fDtrControl = DTR_CONTROL_DISABLE;
-    dcbSerialParams.fDsrSensitivity = FALSE;
-    dcbSerialParams.fTXContinueOnXoff = FALSE;
-    dcbSerialParams.fOutX = FALSE;
-    dcbSerialParams.fInX = FALSE;
-    dcbSerialParams.fErrorChar = FALSE;
-    dcbSerialParams.fNull = FALSE;
-    dcbSerialParams.fRtsControl = RTS_CONTROL_DISABLE;
-    dcbSerialParams.fAbortOnError = FALSE;
-
-    if (!SetCommState(hSerial, &dcbSerialParams)) {
-        printf("HAL: Failed to set comm state\n");
-        CloseHandle(hSerial);
-        return -1.0f;
+    // I/O 錯誤時無法確認請求是否送出，不計入位元組數與延遲直方圖
+    hal_stats_record(port, addr, status, total_read < 0 ? 0 : req_len, total_read, &timing);
+    return status;
+}
+
+// 以 RTU 送出一個請求 PDU (加上 slave 位址與 CRC)
+static int modbus_rtu_transact(hal_port_t* port, int addr, const uint8_t* pdu, int pdu_len,
+                               uint8_t* buf, const uint8_t** resp, int* resp_len) {
+    uint8_t request[1 + HAL_MODBUS_MAX_PDU + 2];
+    int req_len = 1 + pdu_len + 2;
+    request[0] = (uint8_t)addr;  // Slave address
+    memcpy(request + 1, pdu, (size_t)pdu_len);
+
+    // 計算 CRC
+    uint16_t crc = hal_crc16(request, (size_t)(1 + pdu_len));
+    request[1 + pdu_len] = (uint8_t)(crc & 0xFF);        // CRC 低位元組
+    request[2 + pdu_len] = (uint8_t)((crc >> 8) & 0xFF); // CRC 高位元組
+    return modbus_rtu_send(port, addr, request, req_len, buf, resp, resp_len);
+}
+
+// 以 Modbus TCP 送出單一請求 PDU，回應 PDU 直接收進 buf，*resp 指向 buf
+// 返回 hal_modbus_status_t，並記錄統計
+static int modbus_tcp_transact(hal_port_t* port, int unit, const uint8_t* pdu, int pdu_len,
+                               uint8_t* buf, const uint8_t** resp, int* resp_len) {
+    hal_tcp_xfer_t x;
+    memset(&x, 0, sizeof(x));
+    x.unit = unit;
+    x.pdu = pdu;
+    x.pdu_len = pdu_len;
+    x.resp = buf;
+    x.resp_cap = HAL_TCP_MAX_PDU;
+
+    hal_tcp_transact_many(hal_port_tcp(port), &x, 1, HAL_PORT_RESPONSE_TIMEOUT_MS);
+
+    int status = modbus_check_tcp(&x, pdu[0]);
+    if (status == HAL_MODBUS_OK) {
+        *resp = buf;
+        *resp_len = x.resp_len;
     }
+    hal_stats_record(port, unit, status, x.resp_len < 0 ? 0 : 7 + pdu_len,
+                     x.resp_len > 0 ? 7 + x.resp_len : x.resp_len, &x.timing);
+    return status;
+}
 
-    // 設定超時 (參考工作程式的設定)
-    COMMTIMEOUTS timeouts = {0};
-    timeouts.ReadIntervalTimeout = 50;
-    timeouts.ReadTotalTimeoutMultiplier = 10;
-    timeouts.ReadTotalTimeoutConstant = 1000;
-    timeouts.WriteTotalTimeoutMultiplier = 10;
-    timeouts.WriteTotalTimeoutConstant = 1000;
+// 依 port 型態送出一個請求 PDU，buf 為 MODBUS_RTU_MAX_ADU bytes 的接收緩衝區
+static int modbus_transact(hal_port_t* port, int slave, const uint8_t* pdu, int pdu_len,
+                           uint8_t* buf, const uint8_t** resp, int* resp_len) {
+    if (hal_tcp_is_slmp(hal_port_tcp(port))) {
+        HAL_ERROR("Modbus request to SLMP endpoint %s rejected", hal_port_device(port));
+        return HAL_MODBUS_ERR_IO;
+    }
+    if (hal_port_tcp(port)) return modbus_tcp_transact(port, slave, pdu, pdu_len, buf, resp, resp_len);
+    return modbus_rtu_transact(port, slave, pdu, pdu_len, buf, resp, resp_len);
+}
 
-    if (!SetCommTimeouts(hSerial, &timeouts)) {
-        printf("HAL: Failed to set timeouts\n");
-        CloseHandle(hSerial);
-        return -1.0f;
+// request 為預先產生的請求 (hal_modbus_fc03_request)，NULL 時在此產生
+static int modbus_rtu_read_holding(hal_port_t* port, int addr, int reg, int count, uint16_t* dest,
+                                   const uint8_t* request) {
+    // 構建 Modbus 請求 (Function Code 3: Read Holding Registers)
+    uint8_t built[HAL_MODBUS_FC03_REQUEST_LEN];
+    if (request == NULL) {
+        hal_modbus_fc03_request(built, addr, reg, count);
+        request = built;
     }
 
-    // 構建 Modbus RTU 請求 (Function Code 3: Read Holding Registers)
-    unsigned char request[8];
-    request[0] = (unsigned char)addr;  // Slave address
-    request[1] = 0x03;                 // Function code (Read Holding Registers)
-    request[2] = (unsigned char)(reg >> 8);    // Register address (high byte)
-    request[3] = (unsigned char)(reg & 0xFF);  // Register address (low byte)
-    request[4] = 0x00;                 // Number of registers (high byte)
-    request[5] = 0x01;                 // Number of registers (low byte)
-
-    // 計算 CRC (參考工作程式的順序)
-    unsigned short crc = crc16(request, 6);
-    request[6] = (unsigned char)(crc & 0xFF);        // CRC 低位元組
-    request[7] = (unsigned char)((crc >> 8) & 0xFF); // CRC 高位元組
-
-    // 清空接收緩衝區
-    PurgeComm(hSerial, PURGE_RXCLEAR | PURGE_TXCLEAR);
-
-    // 發送請求
-    DWORD bytes_written = 0;
-    if (!WriteFile(hSerial, request, 8, &bytes_written, NULL) || bytes_written != 8) {
-        printf("HAL: Failed to write to serial port\n");
-        CloseHandle(hSerial);
-        return -1.0f;
+    uint8_t buf[MODBUS_RTU_MAX_ADU];
+    const uint8_t* resp = NULL;
+    int resp_len = 0;
+    int status = modbus_rtu_send(port, addr, request, HAL_MODBUS_FC03_REQUEST_LEN, buf, &resp, &resp_len);
+    if (status == HAL_MODBUS_OK) {
+        status = modbus_decode_fc03(resp, resp_len, count, dest);
     }
+    return status;
+}
 
-    // 等待回應
-    Sleep(100);
+// Modbus TCP：每批最多 HAL_MODBUS_TCP_BATCH 筆交易交給 hal_tcp_transact_many 同時在途
+// 回應 PDU 依預期長度從 arena 切出 (較長的回應會被截斷，解碼時判定長度不符)
+static void modbus_tcp_read_many(hal_port_t* port, hal_modbus_read_t* reads, int n) {
+    hal_tcp_xfer_t xfers[HAL_MODBUS_TCP_BATCH];
+    uint8_t pdus[HAL_MODBUS_TCP_BATCH][5];
+    uint64_t storage[HAL_FRAME_ARENA_SIZE / sizeof(uint64_t)];
+    hal_frame_arena_t arena;
+    hal_frame_arena_init(&arena, storage, sizeof(storage));
+
+    hal_modbus_read_t* batch[HAL_MODBUS_TCP_BATCH];
+
+    int next = 0;
+    while (next < n) {
+        // 參數無效的讀取已在呼叫端標記錯誤，不送出
+        int m = 0;
+        while (next < n && m < HAL_MODBUS_TCP_BATCH) {
+            if (reads[next].status == HAL_MODBUS_OK) batch[m++] = &reads[next];
+            next++;
+        }
+        if (m == 0) break;
+
+        hal_frame_arena_reset(&arena);
+        for (int i = 0; i < m; i++) {
+            hal_modbus_read_t* r = batch[i];
+            int resp_cap = 2 + 2 * r->count;   // 功能碼 + byte count + 資料
+            memset(&xfers[i], 0, sizeof(xfers[i]));
+            if (r->request != NULL) {
+                xfers[i].pdu = r->request + 1;
+            } else {
+                modbus_build_fc03(pdus[i], r->reg, r->count);
+                xfers[i].pdu = pdus[i];
+            }
+            xfers[i].unit = r->slave;
+            xfers[i].pdu_len = 5;
+            xfers[i].resp = (uint8_t*)hal_frame_alloc(&arena, (size_t)resp_cap);
+            xfers[i].resp_cap = resp_cap;
+        }
 
-    // 接收回應 (使用循環讀取策略)
-    unsigned char response[256];
-    DWORD bytes_read = 0;
-    DWORD total_read = 0;
-    DWORD start_time = GetTickCount();
+        hal_tcp_transact_many(hal_port_tcp(port), xfers, m, HAL_PORT_RESPONSE_TIMEOUT_MS);
 
-    while (total_read < sizeof(response) && (GetTickCount() - start_time) < 1000) {
-        if (ReadFile(hSerial, response + total_read, sizeof(response) - total_read, &bytes_read, NULL)) {
-            if (bytes_read > 0) {
-                total_read += bytes_read;
-                if (total_read >= 7) break; // 最少需要 7 個位元組
+        for (int i = 0; i < m; i++) {
+            hal_modbus_read_t* r = batch[i];
+            hal_tcp_xfer_t* x = &xfers[i];
+            int status = modbus_check_tcp(x, 0x03);
+            if (status == HAL_MODBUS_OK) {
+                status = modbus_decode_fc03(x->resp, x->resp_len, r->count, r->dest);
             }
+            r->status = status;
+            // MBAP 標頭 7 bytes (含 unit) + PDU
+            hal_stats_record(port, r->slave, status, x->resp_len < 0 ? 0 : 7 + x->pdu_len,
+                             x->resp_len > 0 ? 7 + x->resp_len : x->resp_len, &x->timing);
         }
-        Sleep(10);
     }
+}
 
-    if (total_read < 7) {
-        printf("HAL: Failed to read from serial port or timeout (read %lu bytes)\n", total_read);
-        CloseHandle(hSerial);
-        return -1.0f;
+int hal_modbus_read_holding_many(hal_port_t* port, hal_modbus_read_t* reads, int n) {
+    if (port == NULL || reads == NULL || n <= 0) return 0;
+
+    for (int i = 0; i < n; i++) {
+        hal_modbus_read_t* r = &reads[i];
+        r->status = (r->dest == NULL || r->count < 1 || r->count > HAL_MODBUS_MAX_READ_REGISTERS)
+                        ? HAL_MODBUS_ERR_MISMATCH : HAL_MODBUS_OK;
     }
 
-    // 關閉串口
-    CloseHandle(hSerial);
+    if (hal_tcp_is_slmp(hal_port_tcp(port))) {
+        HAL_ERROR("Modbus request to SLMP endpoint %s rejected", hal_port_device(port));
+        for (int i = 0; i < n; i++) reads[i].status = HAL_MODBUS_ERR_IO;
+    } else if (hal_port_tcp(port)) {
+        modbus_tcp_read_many(port, reads, n);
+    } else {
+        for (int i = 0; i < n; i++) {
+            hal_modbus_read_t* r = &reads[i];
+            if (r->status != HAL_MODBUS_OK) continue;
+            r->status = modbus_rtu_read_holding(port, r->slave, r->reg, r->count, r->dest, r->request);
+        }
+    }
 
-    // 顯示接收到的數據 (除錯用)
-    printf("HAL: Received %lu bytes: ", total_read);
-    for (DWORD i = 0; i < total_read; i++) {
-        printf("%02X ", response[i]);
+    int ok = 0;
+    for (int i = 0; i < n; i++) {
+        if (reads[i].status == HAL_MODBUS_OK) ok++;
     }
-    printf("\n");
+    return ok;
+}
 
-    // 檢查回應
-    if (response[0] != addr || response[1] != 0x03) {
-        printf("HAL: Invalid response (expected addr=%d func=03, got addr=%d func=%02X)\n",
-               addr, response[0], response[1]);
-        CloseHandle(hSerial);
-        return -1.0f;
+int hal_modbus_read_holding(hal_port_t *port, int addr, int reg, int count, uint16_t *dest) {
+    if (port == NULL || dest == NULL || count < 1 || count > HAL_MODBUS_MAX_READ_REGISTERS) return -1;
+
+    if (hal_port_tcp(port)) {
+        hal_modbus_read_t read = { addr, reg, count, dest, HAL_MODBUS_OK, NULL };
+        hal_modbus_read_holding_many(port, &read, 1);
+        return read.status == HAL_MODBUS_OK ? 0 : -1;
     }
+    return modbus_rtu_read_holding(port, addr, reg, count, dest, NULL) == HAL_MODBUS_OK ? 0 : -1;
+}
 
-    // 檢查數據長度
-    if (total_read < 5 || response[2] != 2) {
-        printf("HAL: Invalid data length in response (expected 2 bytes, got %d)\n",
-               total_read >= 3 ? response[2] : 0);
-        CloseHandle(hSerial);
-        return -1.0f;
+int hal_modbus_probe(hal_port_t* port, int slave, int reg, int count, int timeout_ms, uint32_t* response_us) {
+    if (response_us) *response_us = 0;
+    if (port == NULL || count < 1 || count > HAL_MODBUS_MAX_READ_REGISTERS ||
+        hal_tcp_is_slmp(hal_port_tcp(port))) {
+        return HAL_MODBUS_ERR_IO;
     }
 
-    // 解析溫度值 (16 位整數，根據實際設備調整單位)
-    unsigned short raw_temp = (response[3] << 8) | response[4];
-    float temperature = raw_temp / 10.0f;  // 假設單位為 0.1°C
+    uint8_t pdu[5];
+    modbus_build_fc03(pdu, reg, count);
+    uint8_t buf[MODBUS_RTU_MAX_ADU];
+    const uint8_t* resp = buf;
+    int len = 0;
+    hal_port_timing_t timing;
+
+    if (hal_port_tcp(port)) {
+        hal_tcp_xfer_t x;
+        memset(&x, 0, sizeof(x));
+        x.unit = slave;
+        x.pdu = pdu;
+        x.pdu_len = sizeof(pdu);
+        x.resp = buf;
+        x.resp_cap = HAL_TCP_MAX_PDU;
+        hal_tcp_transact_many(hal_port_tcp(port), &x, 1, timeout_ms);
+        if (x.resp_len < 0) return HAL_MODBUS_ERR_IO;
+        if (x.resp_len > 0 && x.resp_unit != (slave & 0xFF)) return HAL_MODBUS_ERR_MISMATCH;
+        len = x.resp_len;
+        timing = x.timing;
+    } else {
+        uint8_t request[1 + sizeof(pdu) + 2];
+        request[0] = (uint8_t)slave;
+        memcpy(request + 1, pdu, sizeof(pdu));
+        uint16_t crc = hal_crc16(request, 1 + sizeof(pdu));
+        request[1 + sizeof(pdu)] = (uint8_t)(crc & 0xFF);
+        request[2 + sizeof(pdu)] = (uint8_t)(crc >> 8);
+
+        int got = hal_port_probe(port, slave, request, sizeof(request), buf, sizeof(buf),
+                                 modbus_rtu_frame_len, timeout_ms, &timing);
+        if (got < 0) return HAL_MODBUS_ERR_IO;
+        if (got == 0) return HAL_MODBUS_ERR_TIMEOUT;
+        if (got < 5) return HAL_MODBUS_ERR_SHORT;
+        crc = hal_crc16(buf, (size_t)(got - 2));
+        if (buf[got - 2] != (crc & 0xFF) || buf[got - 1] != (crc >> 8)) return HAL_MODBUS_ERR_CRC;
+        if (buf[0] != slave) return HAL_MODBUS_ERR_MISMATCH;
+        resp = buf + 1;
+        len = got - 3;
+    }
 
-    printf("HAL: Successfully read temperature: %.1f°C (raw: %d)\n", temperature, raw_temp);
-    return temperature;
+    // 與 modbus_check_pdu 相同的判斷，但不記錄警告：探測範圍外的暫存器預期會收到例外回應
+    if (len <= 0) return HAL_MODBUS_ERR_TIMEOUT;
+    if (response_us) *response_us = timing.first_byte_us;
+    if (len < 2) return HAL_MODBUS_ERR_SHORT;
+    if ((resp[0] & 0x7F) != 0x03) return HAL_MODBUS_ERR_MISMATCH;
+    if (resp[0] & 0x80) return HAL_MODBUS_ERR_EXCEPTION;
+    return (resp[1] == 2 * count && len == 2 + 2 * count) ? HAL_MODBUS_OK : HAL_MODBUS_ERR_MISMATCH;
 }
 
-// 讀取壓力感測器
-float modbus_read_pressure(const char *device, int addr, int reg) {
-    printf("HAL: Reading pressure from device %s, addr %d, reg 0x%04X\n", device, addr, reg);
-
-    // 打開串口
-    char port_name[32];
-    snprintf(port_name, sizeof(port_name), "\\\\.\\%s", device);
-
-    HANDLE hSerial = CreateFileA(port_name,
-                                GENERIC_READ | GENERIC_WRITE,
-                                0,
-                                NULL,
-                                OPEN_EXISTING,
-                                FILE_ATTRIBUTE_NORMAL,
-                                NULL);
-
-    if (hSerial == INVALID_HANDLE_VALUE) {
-        printf("HAL: Failed to open serial port %s, error: %lu\n", device, GetLastError());
-        return -1.0f;
-    }
+int hal_modbus_read_registers(modbus_t* ctx, int addr, int num, uint16_t* dest) {
+    if (ctx == NULL || !ctx->connected || dest == NULL) return -1;
 
-    // 設定串口參數
-    DCB dcbSerialParams = {0};
-    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+    HAL_TRACE("Reading %d registers from [device:%s, addr:0x%04X]",
+           num, ctx->device, addr);
 
-    if (!GetCommState(hSerial, &dcbSerialParams)) {
-        printf("HAL: Failed to get comm state\n");
-        CloseHandle(hSerial);
-        return -1.0f;
-    }
+    return hal_modbus_read_holding(ctx->port, ctx->slave_id, addr, num, dest);
+}
 
-    dcbSerialParams.BaudRate = 9600;
-    dcbSerialParams.ByteSize = 8;
-    dcbSerialParams.Parity = NOPARITY;
-    dcbSerialParams.StopBits = ONESTOPBIT;
-    dcbSerialParams.fBinary = TRUE;
-    dcbSerialParams.fParity = FALSE;
-    dcbSerialParams.fOutxCtsFlow = FALSE;
-    dcbSerialParams.fOutxDsrFlow = FALSE;
-    dcbSerialParams.fDtrControl = DTR_CONTROL_DISABLE;
-    dcbSerialParams.fDsrSensitivity = FALSE;
-    dcbSerialParams.fTXContinueOnXoff = FALSE;
-    dcbSerialParams.fOutX = FALSE;
-    dcbSerialParams.fInX = FALSE;
-    dcbSerialParams.fErrorChar = FALSE;
-    dcbSerialParams.fNull = FALSE;
-    dcbSerialParams.fRtsControl = RTS_CONTROL_DISABLE;
-    dcbSerialParams.fAbortOnError = FALSE;
-
-    if (!SetCommState(hSerial, &dcbSerialParams)) {
-        printf("HAL: Failed to set comm state\n");
-        CloseHandle(hSerial);
-        return -1.0f;
+// 驗證寫入回應：FC06 回傳原請求，FC16 回傳起始暫存器與數量 (都與請求的前 5 bytes 相同)
+static int modbus_check_write_echo(const uint8_t* req, const uint8_t* resp, int resp_len, int slave) {
+    if (resp_len != 5 || memcmp(req, resp, 5) != 0) {
+        HAL_WARN("Write response from addr %d does not echo request (func %02X)", slave, req[0]);
+        return HAL_MODBUS_ERR_MISMATCH;
     }
+    return HAL_MODBUS_OK;
+}
 
-    // 設定超時
-    COMMTIMEOUTS timeouts = {0};
-    timeouts.ReadIntervalTimeout = 50;
-    timeouts.ReadTotalTimeoutConstant = 500;
-    timeouts.ReadTotalTimeoutMultiplier = 10;
-    timeouts.WriteTotalTimeoutConstant = 50;
-    timeouts.WriteTotalTimeoutMultiplier = 10;
+int hal_modbus_write_single(hal_port_t* port, int slave, int reg, uint16_t value) {
+    if (port == NULL || reg < 0 || reg > 0xFFFF) return -1;
+
+    // Function Code 6: Write Single Register
+    uint8_t pdu[5];
+    pdu[0] = 0x06;
+    pdu[1] = (uint8_t)(reg >> 8);
+    pdu[2] = (uint8_t)(reg & 0xFF);
+    pdu[3] = (uint8_t)(value >> 8);
+    pdu[4] = (uint8_t)(value & 0xFF);
+
+    uint8_t buf[MODBUS_RTU_MAX_ADU];
+    const uint8_t* resp = NULL;
+    int resp_len = 0;
+    int status = modbus_transact(port, slave, pdu, sizeof(pdu), buf, &resp, &resp_len);
+    if (status == HAL_MODBUS_OK) status = modbus_check_write_echo(pdu, resp, resp_len, slave);
+    return status == HAL_MODBUS_OK ? 0 : -1;
+}
 
-    if (!SetCommTimeouts(hSerial, &timeouts)) {
-        printf("HAL: Failed to set timeouts\n");
-        CloseHandle(hSerial);
-        return -1.0f;
+int hal_modbus_write_multiple(hal_port_t* port, int slave, int reg, int count, const uint16_t* values) {
+    if (port == NULL || values == NULL || count < 1 || count > HAL_MODBUS_MAX_WRITE_REGISTERS ||
+        reg < 0 || reg + count > 0x10000) {
+        return -1;
     }
 
-    // 構建 Modbus RTU 請求 (Function Code 3: Read Holding Registers)
-    unsigned char request[8];
-    request[0] = (unsigned char)addr;  // Slave address
-    request[1] = 0x03;                 // Function code (Read Holding Registers)
-    request[2] = (unsigned char)(reg >> 8);    // Register address (high byte)
-    request[3] = (unsigned char)(reg & 0xFF);  // Register address (low byte)
-    request[4] = 0x00;                 // Number of registers (high byte)
-    request[5] = 0x01;                 // Number of registers (low byte)
+    // Function Code 16: Write Multiple Registers
+    uint8_t pdu[6 + 2 * HAL_MODBUS_MAX_WRITE_REGISTERS];
+    pdu[0] = 0x10;
+    pdu[1] = (uint8_t)(reg >> 8);
+    pdu[2] = (uint8_t)(reg & 0xFF);
+    pdu[3] = (uint8_t)(count >> 8);
+    pdu[4] = (uint8_t)(count & 0xFF);
+    pdu[5] = (uint8_t)(2 * count);     // Byte count
+    hal_frame_encode_be16(values, pdu + 6, count);
+
+    uint8_t buf[MODBUS_RTU_MAX_ADU];
+    const uint8_t* resp = NULL;
+    int resp_len = 0;
+    int status = modbus_transact(port, slave, pdu, 6 + 2 * count, buf, &resp, &resp_len);
+    if (status == HAL_MODBUS_OK) status = modbus_check_write_echo(pdu, resp, resp_len, slave);
+    return status == HAL_MODBUS_OK ? 0 : -1;
+}
 
-    // 計算 CRC
-    unsigned short crc = crc16(request, 6);
-    request[6] = (unsigned char)(crc & 0xFF);       // CRC (low byte)
-    request[7] = (unsigned char)((crc >> 8) & 0xFF); // CRC (high byte)
-
-    // 清空接收緩衝區
-    PurgeComm(hSerial, PURGE_RXCLEAR | PURGE_TXCLEAR);
-
-    // 發送請求
-    DWORD bytes_written = 0;
-    if (!WriteFile(hSerial, request, 8, &bytes_written, NULL) || bytes_written != 8) {
-        printf("HAL: Failed to write to serial port\n");
-        CloseHandle(hSerial);
-        return -1.0f;
-    }
+int hal_modbus_write_registers(modbus_t* ctx, int addr, int num, const uint16_t* values) {
+    if (ctx == NULL || !ctx->connected) return -1;
 
-    // 等待回應
-    Sleep(100);
+    HAL_TRACE("Queueing %d register write(s) [device:%s, addr:0x%04X]", num, ctx->device, addr);
 
-    // 接收回應 (使用循環讀取策略)
-    unsigned char response[256];
-    DWORD bytes_read = 0;
-    DWORD total_read = 0;
-    DWORD start_time = GetTickCount();
+    return hal_write_submit(ctx->port, ctx->slave_id, addr, num, values);
+}
 
-    while (total_read < sizeof(response) && (GetTickCount() - start_time) < 1000) {
-        if (ReadFile(hSerial, response + total_read, sizeof(response) - total_read, &bytes_read, NULL)) {
-            if (bytes_read > 0) {
-                total_read += bytes_read;
-                if (total_read >= 7) break; // 最少需要 7 個位元組
-            }
+int hal_value_type_width(int type) {
+    switch (type) {
+        case HAL_VALUE_U32:
+        case HAL_VALUE_S32:
+        case HAL_VALUE_F32:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+float hal_modbus_decode_value(const uint16_t* regs, int type, float scale) {
+    uint32_t raw32;
+    switch (type) {
+        case HAL_VALUE_S16:
+            return (int16_t)regs[0] * scale;
+        case HAL_VALUE_U32:
+            raw32 = ((uint32_t)regs[0] << 16) | regs[1];
+            return (float)raw32 * scale;
+        case HAL_VALUE_S32:
+            raw32 = ((uint32_t)regs[0] << 16) | regs[1];
+            return (float)(int32_t)raw32 * scale;
+        case HAL_VALUE_F32: {
+            float f;
+            raw32 = ((uint32_t)regs[0] << 16) | regs[1];
+            memcpy(&f, &raw32, sizeof(f));
+            return f * scale;
         }
-        Sleep(10);
+        default:
+            return regs[0] * scale;
     }
+}
 
-    if (total_read < 7) {
-        printf("HAL: Failed to read from serial port or timeout (read %lu bytes)\n", total_read);
-        CloseHandle(hSerial);
-        return -1.0f;
+int hal_modbus_read_sensors(const char* device, int slave, int start_reg, int count,
+                            const hal_sensor_map_t* map, int n, float* out) {
+    if (map == NULL || out == NULL || n <= 0) return -1;
+
+    for (int i = 0; i < n; i++) out[i] = -1.0f;
+
+    // 所有感測器都必須落在讀取區塊內
+    for (int i = 0; i < n; i++) {
+        if (map[i].offset < 0 || map[i].offset + hal_value_type_width(map[i].type) > count) {
+            HAL_ERROR("Sensor %d (offset %d) outside register block of %d", i, map[i].offset, count);
+            return -1;
+        }
     }
 
-    // 關閉串口
-    CloseHandle(hSerial);
+    uint16_t regs[HAL_MODBUS_MAX_READ_REGISTERS];
+    if (hal_modbus_read_holding(hal_port_get(device, 0), slave, start_reg, count, regs) != 0) {
+        return -1;
+    }
 
-    // 顯示接收到的數據 (除錯用)
-    printf("HAL: Received %lu bytes: ", total_read);
-    for (DWORD i = 0; i < total_read; i++) {
-        printf("%02X ", response[i]);
+    for (int i = 0; i < n; i++) {
+        out[i] = hal_modbus_decode_value(&regs[map[i].offset], map[i].type, map[i].scale);
     }
-    printf("\n");
+    return 0;
+}
+
+// 讀取溫度感測器
+float modbus_read_temperature(const char *device, int addr, int reg) {
+    HAL_TRACE("Reading temperature from device %s, addr %d, reg 0x%04X", device, addr, reg);
 
-    // 檢查回應
-    if (response[0] != addr || response[1] != 0x03) {
-        printf("HAL: Invalid response (expected addr=%d func=03, got addr=%d func=%02X)\n",
-               addr, response[0], response[1]);
-        CloseHandle(hSerial);
+    uint16_t raw_temp;
+    if (hal_modbus_read_holding(hal_port_get(device, 0), addr, reg, 1, &raw_temp) != 0) {
         return -1.0f;
     }
 
-    // 檢查數據長度
-    if (total_read < 5 || response[2] != 2) {
-        printf("HAL: Invalid data length in response (expected 2 bytes, got %d)\n",
-               total_read >= 3 ? response[2] : 0);
-        CloseHandle(hSerial);
+    // 解析溫度值 (16 位整數，根據實際設備調整單位)
+    float temperature = raw_temp / 10.0f;  // 假設單位為 0.1°C
+
+    HAL_DEBUG("Successfully read temperature: %.1f°C (raw: %d)", temperature, raw_temp);
+    return temperature;
+}
+
+// 讀取壓力感測器
+float modbus_read_pressure(const char *device, int addr, int reg) {
+    HAL_TRACE("Reading pressure from device %s, addr %d, reg 0x%04X", device, addr, reg);
+
+    uint16_t raw_pressure;
+    if (hal_modbus_read_holding(hal_port_get(device, 0), addr, reg, 1, &raw_pressure) != 0) {
         return -1.0f;
     }
 
     // 解析壓力值 (16 位整數，根據實際設備調整單位)
-    unsigned short raw_pressure = (response[3] << 8) | response[4];
     float pressure = raw_pressure / 100.0f;  // 假設單位為 0.01 Bar
 
-    printf("HAL: Successfully read pressure: %.2f Bar (raw: %d)\n", pressure, raw_pressure);
+    HAL_DEBUG("Successfully read pressure: %.2f Bar (raw: %d)", pressure, raw_pressure);
     return pressure;
-}
\ No newline at end of file
+}
@@ -3,30 +3,121 @@
 
 #include <stdint.h> // For uint16_t
 
-// Windows Modbus context 結構
+#define HAL_MODBUS_MAX_READ_REGISTERS 125 // FC03 單一 frame 的暫存器上限
+#define HAL_MODBUS_MAX_WRITE_REGISTERS 123 // FC16 單一 frame 的暫存器上限
+#define HAL_MODBUS_MAX_PDU 253            // 功能碼 + 資料 (不含位址與 CRC / MBAP 標頭)
+#define HAL_MODBUS_MAX_CONTEXTS 32        // hal_modbus_connect 的 context 池大小
+
+// 回應驗證結果
+typedef enum {
+    HAL_MODBUS_OK = 0,
+    HAL_MODBUS_ERR_TIMEOUT = 1,     // 沒有收到任何回應
+    HAL_MODBUS_ERR_SHORT = 2,       // 回應不完整
+    HAL_MODBUS_ERR_CRC = 3,         // CRC 錯誤
+    HAL_MODBUS_ERR_MISMATCH = 4,    // slave 位址或功能碼不符
+    HAL_MODBUS_ERR_EXCEPTION = 5,   // slave 回傳例外回應 (function | 0x80)
+    HAL_MODBUS_ERR_IO = 6           // 串口 (或 TCP 連線) 無法開啟或讀寫失敗
+} hal_modbus_status_t;
+
+struct hal_port;
+
+// Modbus context 結構 (由固定大小的池配置，device 長度與串口登錄表相同)
 typedef struct {
-    char device[256];
+    char device[64];
     int baud;
     int slave_id;
     int connected;
-    void* hSerial;  // Windows HANDLE for serial port
+    int in_use;             // 池中的項目已被取用
+    struct hal_port* port;  // 共用串口 (見 hal_port.h)
 } modbus_t;
 
 // 初始化並連接到一個 Modbus RTU 設備
-// 返回一個 modbus context 指標，失敗則返回 NULL
+// 返回一個 modbus context 指標，串口無法開啟或 context 池已滿則返回 NULL
 modbus_t* hal_modbus_connect(const char* device, int baud, int slave_id);
 
-// 斷開連接並釋放資源
+// 斷開連接並把 context 歸還池中
 void hal_modbus_disconnect(modbus_t* ctx);
 
-// 寫入單個保持暫存器
-// 成功返回 0，失敗返回 -1
+// 寫入單個保持暫存器 (經由寫入佇列，見 hal_write.h)
+// 成功排入 (或同步寫入成功) 返回 0，失敗返回 -1
 int hal_modbus_write_register(modbus_t* ctx, int addr, int value);
+
+// 寫入 num 個連續保持暫存器 (經由寫入佇列，以 FC16 送出)
+// 成功排入 (或同步寫入成功) 返回 0，失敗返回 -1
+int hal_modbus_write_registers(modbus_t* ctx, int addr, int num, const uint16_t* values);
 float modbus_read_temperature(const char *device, int addr, int reg);
 float modbus_read_pressure(const char *device, int addr, int reg);
 
-// 讀取多個保持暫存器
+// 讀取多個保持暫存器 (FC03，一個 frame 最多 125 個)
 // 成功返回 0，失敗返回 -1
 int hal_modbus_read_registers(modbus_t* ctx, int addr, int num, uint16_t* dest);
 
+// 經由共用串口 (hal_port_get 取得) 對 slave 執行 FC03 讀取 count 個連續暫存器 (1-125)
+// port 為 "tcp://..." 端點時以 Modbus TCP 傳送，slave 作為 MBAP unit identifier
+// 成功返回 0 並寫入 dest，失敗返回 -1
+int hal_modbus_read_holding(struct hal_port* port, int slave, int reg, int count, uint16_t* dest);
+
+// 立即對 slave 執行 FC06 寫入單一暫存器，回應必須與請求相同
+// 成功返回 0，失敗返回 -1
+int hal_modbus_write_single(struct hal_port* port, int slave, int reg, uint16_t value);
+
+// 立即對 slave 執行 FC16 寫入 count 個連續暫存器 (1-123)
+// 成功返回 0，失敗返回 -1
+int hal_modbus_write_multiple(struct hal_port* port, int slave, int reg, int count, const uint16_t* values);
+
+// 匯流排探測：以 timeout_ms 的短超時對 slave 送出 FC03 讀取 reg 開始的 count 個暫存器
+// 不記錄統計與警告 (探測時大部分位址預期不會回應)，response_us 寫入請求送出到第一個回應位元組的時間
+// 返回 hal_modbus_status_t；HAL_MODBUS_OK 與 HAL_MODBUS_ERR_EXCEPTION 都表示 slave 存在
+int hal_modbus_probe(struct hal_port* port, int slave, int reg, int count, int timeout_ms, uint32_t* response_us);
+
+#define HAL_MODBUS_TCP_BATCH 32 // Modbus TCP 每批交給傳輸層的讀取數
+#define HAL_MODBUS_FC03_REQUEST_LEN 8   // RTU FC03 請求：slave + PDU 5 bytes + CRC
+
+// 產生 RTU FC03 請求 (slave, 0x03, reg, count, CRC)，排程計畫預先為每個 frame 算好
+// TCP 端點使用其中的 PDU (out + 1，5 bytes)
+void hal_modbus_fc03_request(uint8_t* out, int slave, int reg, int count);
+
+// 批次讀取中的一筆 FC03
+typedef struct {
+    int slave;
+    int reg;
+    int count;
+    uint16_t* dest;
+    int status;     // 輸出：hal_modbus_status_t
+    const uint8_t* request; // 選用：hal_modbus_fc03_request 預先產生的請求，NULL 時每次重新產生
+} hal_modbus_read_t;
+
+// 對同一個 port 執行 n 筆 FC03 讀取
+// 串口依序逐筆交易；TCP 端點把整批請求連續送出，依 transaction ID 收集回應
+// 返回成功的筆數，各筆結果寫入 reads[i].status
+int hal_modbus_read_holding_many(struct hal_port* port, hal_modbus_read_t* reads, int n);
+
+// 暫存器內容的資料型態 (32 位元型態為高位 word 在前)
+typedef enum {
+    HAL_VALUE_U16 = 0,
+    HAL_VALUE_S16 = 1,
+    HAL_VALUE_U32 = 2,
+    HAL_VALUE_S32 = 3,
+    HAL_VALUE_F32 = 4
+} hal_value_type_t;
+
+// 由一次區塊讀取中解碼出的一個邏輯感測器
+typedef struct {
+    int offset;     // 相對於區塊起始暫存器的位移
+    int type;       // hal_value_type_t
+    float scale;    // 工程值 = raw * scale (例如溫度 0.1、壓力 0.01)
+} hal_sensor_map_t;
+
+// 型態佔用的暫存器數量
+int hal_value_type_width(int type);
+
+// 依型態與比例將暫存器內容轉換為工程值
+float hal_modbus_decode_value(const uint16_t* regs, int type, float scale);
+
+// 以一次 FC03 讀取 slave 上 [start_reg, start_reg + count) 的暫存器，
+// 再依 map 解碼出 n 個感測器值寫入 out
+// 成功返回 0，失敗返回 -1 (out 全部填入 -1.0)
+int hal_modbus_read_sensors(const char* device, int slave, int start_reg, int count,
+                            const hal_sensor_map_t* map, int n, float* out);
+
 #endif // HAL_MODBUS_H
\ No newline at end of file
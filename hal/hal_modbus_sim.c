@@ -0,0 +1,408 @@
+#include "hal_modbus_sim.h"
+#include "hal_crc16.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int start;
+    int count;
+    uint16_t* regs;
+} sim_region_t;
+
+typedef struct {
+    int addr;               // 0 表示未使用
+    int n_regions;
+    uint32_t turnaround_us; // 回應結束後多久才能接收下一個請求
+    uint64_t last_end_us;   // 上一個回應結束的時間
+    sim_region_t regions[HAL_SIM_MAX_REGIONS];
+} sim_slave_t;
+
+struct hal_sim_bus {
+    char device[64];
+    int in_use;
+    int port_baud;
+    hal_sim_config_t cfg;
+    uint32_t rng;           // xorshift32 狀態
+    sim_slave_t slaves[HAL_SIM_MAX_SLAVES];
+    hal_mutex_t lock;       // 保護 slave 表、暫存器與亂數
+};
+
+static hal_sim_bus_t g_buses[HAL_MAX_PORTS];
+static hal_sim_config_t g_defaults;
+static int g_defaults_set = 0;
+static int g_route_all = 0;
+static hal_mutex_t g_sim_lock = HAL_MUTEX_INIT;
+
+void hal_sim_default_config(hal_sim_config_t* cfg) {
+    if (cfg == NULL) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->latency_us = 2000;
+    cfg->seed = 1;
+    cfg->auto_slaves = 1;
+    cfg->realtime = 1;
+}
+
+int hal_sim_route_all(int enable) {
+    hal_mutex_lock(&g_sim_lock);
+    int previous = g_route_all;
+    g_route_all = enable ? 1 : 0;
+    hal_mutex_unlock(&g_sim_lock);
+    return previous;
+}
+
+int hal_sim_is_device(const char* device) {
+    if (device == NULL) return 0;
+    if (strncmp(device, HAL_SIM_PREFIX, sizeof(HAL_SIM_PREFIX) - 1) == 0) return 1;
+    hal_mutex_lock(&g_sim_lock);
+    int route_all = g_route_all;
+    hal_mutex_unlock(&g_sim_lock);
+    return route_all;
+}
+
+static uint32_t sim_seed(uint32_t seed) {
+    return seed != 0 ? seed : 0x9E3779B9u;
+}
+
+static uint32_t sim_rand(hal_sim_bus_t* bus) {
+    uint32_t x = bus->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bus->rng = x;
+    return x;
+}
+
+// 以 ppm 機率判斷是否注入錯誤 (每次都消耗一個亂數，讓結果只取決於請求序列)
+static int sim_roll(hal_sim_bus_t* bus, uint32_t ppm) {
+    uint32_t r = sim_rand(bus) % 1000000u;
+    return r < ppm;
+}
+
+// 暫存器初始值只取決於 seed、slave 與暫存器位址，落在 0-999 以便套用感測器比例
+static uint16_t sim_initial_value(uint32_t seed, int slave, int reg) {
+    uint32_t h = sim_seed(seed) ^ ((uint32_t)slave << 16) ^ (uint32_t)reg;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return (uint16_t)(h % 1000u);
+}
+
+// 呼叫者需持有 g_sim_lock
+static hal_sim_bus_t* sim_find(const char* device, int create) {
+    hal_sim_bus_t* free_slot = NULL;
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        if (g_buses[i].in_use) {
+            if (strcmp(g_buses[i].device, device) == 0) return &g_buses[i];
+        } else if (free_slot == NULL) {
+            free_slot = &g_buses[i];
+        }
+    }
+    if (!create) return NULL;
+    if (free_slot == NULL) {
+        HAL_ERROR("Simulator bus table full, cannot create %s", device);
+        return NULL;
+    }
+
+    // 釋放過的項目保留原本的 lock (未被持有)
+    hal_sim_bus_t* bus = free_slot;
+    memset(bus->device, 0, sizeof(bus->device));
+    strncpy(bus->device, device, sizeof(bus->device) - 1);
+    if (g_defaults_set) {
+        bus->cfg = g_defaults;
+    } else {
+        hal_sim_default_config(&bus->cfg);
+    }
+    bus->rng = sim_seed(bus->cfg.seed);
+    bus->port_baud = HAL_PORT_DEFAULT_BAUD;
+    memset(bus->slaves, 0, sizeof(bus->slaves));
+    bus->in_use = 1;
+    return bus;
+}
+
+// 取得匯流排；device 不存在時建立 (呼叫後不再需要 g_sim_lock，匯流排指標不會失效)
+static hal_sim_bus_t* sim_bus(const char* device, int create) {
+    if (device == NULL) return NULL;
+    hal_mutex_lock(&g_sim_lock);
+    hal_sim_bus_t* bus = sim_find(device, create);
+    hal_mutex_unlock(&g_sim_lock);
+    return bus;
+}
+
+int hal_sim_configure(const char* device, const hal_sim_config_t* cfg) {
+    if (cfg == NULL) return -1;
+    if (device == NULL) {
+        hal_mutex_lock(&g_sim_lock);
+        g_defaults = *cfg;
+        g_defaults_set = 1;
+        hal_mutex_unlock(&g_sim_lock);
+        return 0;
+    }
+
+    hal_sim_bus_t* bus = sim_bus(device, 1);
+    if (bus == NULL) return -1;
+    hal_mutex_lock(&bus->lock);
+    bus->cfg = *cfg;
+    bus->rng = sim_seed(cfg->seed);
+    hal_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+// 呼叫者需持有 bus->lock
+static sim_slave_t* sim_slave(hal_sim_bus_t* bus, int addr, int create) {
+    sim_slave_t* free_slot = NULL;
+    for (int i = 0; i < HAL_SIM_MAX_SLAVES; i++) {
+        if (bus->slaves[i].addr == addr) return &bus->slaves[i];
+        if (bus->slaves[i].addr == 0 && free_slot == NULL) free_slot = &bus->slaves[i];
+    }
+    if (!create || free_slot == NULL) return NULL;
+    free_slot->addr = addr;
+    free_slot->n_regions = 0;
+    free_slot->turnaround_us = 0;
+    free_slot->last_end_us = 0;
+    return free_slot;
+}
+
+// 呼叫者需持有 bus->lock
+static int sim_add_region(hal_sim_bus_t* bus, sim_slave_t* slave, int start, int count) {
+    if (slave->n_regions >= HAL_SIM_MAX_REGIONS) return -1;
+    uint16_t* regs = (uint16_t*)malloc(sizeof(uint16_t) * (size_t)count);
+    if (regs == NULL) {
+        HAL_ERROR("Failed to allocate %d simulated registers", count);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) regs[i] = sim_initial_value(bus->cfg.seed, slave->addr, start + i);
+
+    sim_region_t* region = &slave->regions[slave->n_regions++];
+    region->start = start;
+    region->count = count;
+    region->regs = regs;
+    return 0;
+}
+
+int hal_sim_add_slave(const char* device, int slave, int start, int count) {
+    if (slave < 1 || slave > 247 || start < 0 || count < 1 || start + count > 0x10000) return -1;
+
+    hal_sim_bus_t* bus = sim_bus(device, 1);
+    if (bus == NULL) return -1;
+    hal_mutex_lock(&bus->lock);
+    sim_slave_t* s = sim_slave(bus, slave, 1);
+    int result = s != NULL ? sim_add_region(bus, s, start, count) : -1;
+    hal_mutex_unlock(&bus->lock);
+    if (result != 0) HAL_ERROR("Cannot add simulated slave %d region 0x%04X on %s", slave, start, device);
+    return result;
+}
+
+int hal_sim_set_turnaround(const char* device, int slave, int turnaround_us) {
+    if (slave < 1 || slave > 247 || turnaround_us < 0) return -1;
+
+    hal_sim_bus_t* bus = sim_bus(device, 0);
+    if (bus == NULL) return -1;
+    hal_mutex_lock(&bus->lock);
+    sim_slave_t* s = sim_slave(bus, slave, 0);
+    if (s != NULL) s->turnaround_us = (uint32_t)turnaround_us;
+    hal_mutex_unlock(&bus->lock);
+    return s != NULL ? 0 : -1;
+}
+
+// [reg, reg + count) 完全落在某一段時返回該段起始的指標 (呼叫者需持有 bus->lock)
+static uint16_t* sim_regs(sim_slave_t* slave, int reg, int count) {
+    for (int i = 0; i < slave->n_regions; i++) {
+        sim_region_t* region = &slave->regions[i];
+        if (reg >= region->start && reg + count <= region->start + region->count) {
+            return &region->regs[reg - region->start];
+        }
+    }
+    return NULL;
+}
+
+int hal_sim_set_register(const char* device, int slave, int reg, uint16_t value) {
+    hal_sim_bus_t* bus = sim_bus(device, 0);
+    if (bus == NULL) return -1;
+    hal_mutex_lock(&bus->lock);
+    sim_slave_t* s = sim_slave(bus, slave, 0);
+    uint16_t* r = s != NULL ? sim_regs(s, reg, 1) : NULL;
+    if (r != NULL) *r = value;
+    hal_mutex_unlock(&bus->lock);
+    return r != NULL ? 0 : -1;
+}
+
+int hal_sim_get_register(const char* device, int slave, int reg, uint16_t* value) {
+    if (value == NULL) return -1;
+    hal_sim_bus_t* bus = sim_bus(device, 0);
+    if (bus == NULL) return -1;
+    hal_mutex_lock(&bus->lock);
+    sim_slave_t* s = sim_slave(bus, slave, 0);
+    uint16_t* r = s != NULL ? sim_regs(s, reg, 1) : NULL;
+    if (r != NULL) *value = *r;
+    hal_mutex_unlock(&bus->lock);
+    return r != NULL ? 0 : -1;
+}
+
+void hal_sim_reset(void) {
+    hal_mutex_lock(&g_sim_lock);
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        hal_sim_bus_t* bus = &g_buses[i];
+        if (!bus->in_use) continue;
+        hal_mutex_lock(&bus->lock);
+        for (int k = 0; k < HAL_SIM_MAX_SLAVES; k++) {
+            sim_slave_t* s = &bus->slaves[k];
+            for (int r = 0; r < s->n_regions; r++) free(s->regions[r].regs);
+        }
+        memset(bus->slaves, 0, sizeof(bus->slaves));
+        bus->rng = sim_seed(bus->cfg.seed);
+        hal_mutex_unlock(&bus->lock);
+    }
+    hal_mutex_unlock(&g_sim_lock);
+}
+
+hal_sim_bus_t* hal_sim_open(const char* device, int baud) {
+    hal_sim_bus_t* bus = sim_bus(device, 1);
+    if (bus == NULL) return NULL;
+    hal_mutex_lock(&bus->lock);
+    bus->port_baud = baud > 0 ? baud : HAL_PORT_DEFAULT_BAUD;
+    hal_mutex_unlock(&bus->lock);
+    HAL_INFO("Opened simulated Modbus bus %s", device);
+    return bus;
+}
+
+// 例外回應 PDU
+static int sim_exception(uint8_t* pdu, int func, int code) {
+    pdu[0] = (uint8_t)(func | 0x80);
+    pdu[1] = (uint8_t)code;
+    return 2;
+}
+
+// 依請求 PDU 產生回應 PDU，返回長度 (呼叫者需持有 bus->lock)
+static int sim_execute(sim_slave_t* slave, const uint8_t* req, int req_len, uint8_t* pdu) {
+    int func = req[0];
+    if (req_len < 5) return sim_exception(pdu, func, 0x03);
+    int reg = (req[1] << 8) | req[2];
+    int arg = (req[3] << 8) | req[4];
+
+    switch (func) {
+        case 0x03: {
+            if (arg < 1 || arg > 125) return sim_exception(pdu, func, 0x03);
+            uint16_t* r = sim_regs(slave, reg, arg);
+            if (r == NULL) return sim_exception(pdu, func, 0x02);
+            pdu[0] = 0x03;
+            pdu[1] = (uint8_t)(2 * arg);
+            for (int i = 0; i < arg; i++) {
+                pdu[2 + 2 * i] = (uint8_t)(r[i] >> 8);
+                pdu[3 + 2 * i] = (uint8_t)(r[i] & 0xFF);
+            }
+            return 2 + 2 * arg;
+        }
+        case 0x06: {
+            uint16_t* r = sim_regs(slave, reg, 1);
+            if (r == NULL) return sim_exception(pdu, func, 0x02);
+            *r = (uint16_t)arg;
+            memcpy(pdu, req, 5);
+            return 5;
+        }
+        case 0x10: {
+            if (arg < 1 || arg > 123 || req_len < 6 + 2 * arg || req[5] != 2 * arg) {
+                return sim_exception(pdu, func, 0x03);
+            }
+            uint16_t* r = sim_regs(slave, reg, arg);
+            if (r == NULL) return sim_exception(pdu, func, 0x02);
+            for (int i = 0; i < arg; i++) r[i] = (uint16_t)((req[6 + 2 * i] << 8) | req[7 + 2 * i]);
+            memcpy(pdu, req, 5);
+            return 5;
+        }
+        default:
+            return sim_exception(pdu, func, 0x01);
+    }
+}
+
+// RTU 一個字元 11 bit
+static uint64_t sim_char_us(int n, int baud) {
+    return (uint64_t)n * 11 * 1000000 / (uint64_t)baud;
+}
+
+static void sim_wait_until(uint64_t deadline_us) {
+    uint64_t now = hal_time_us();
+    if (now < deadline_us) hal_sleep_us(deadline_us - now);
+}
+
+int hal_sim_transact(hal_sim_bus_t* bus, const uint8_t* req, int req_len,
+                     uint8_t* resp, int resp_cap, int timeout_ms, hal_port_timing_t* timing) {
+    if (bus == NULL || req == NULL || resp == NULL || resp_cap <= 0) return -1;
+
+    uint64_t t_start = hal_time_us();
+    uint8_t frame[256];
+    int len = 0;
+
+    hal_mutex_lock(&bus->lock);
+    const hal_sim_config_t* cfg = &bus->cfg;
+    int baud = cfg->baud > 0 ? cfg->baud : bus->port_baud;
+    uint64_t tx_us = sim_char_us(req_len, baud);
+    // 每個請求固定消耗三個錯誤注入亂數與一個抖動亂數
+    int drop = sim_roll(bus, cfg->timeout_ppm);
+    int fail = sim_roll(bus, cfg->exception_ppm);
+    int corrupt = sim_roll(bus, cfg->crc_error_ppm);
+    uint64_t latency_us = cfg->latency_us + (cfg->jitter_us ? sim_rand(bus) % cfg->jitter_us : 0);
+    int realtime = cfg->realtime;
+    sim_slave_t* responder = NULL;
+
+    // CRC 錯誤的請求、廣播與不存在的 slave 都不回應
+    int valid = 0;
+    if (req_len >= 4) {
+        uint16_t crc = hal_crc16(req, (size_t)(req_len - 2));
+        valid = req[req_len - 2] == (crc & 0xFF) && req[req_len - 1] == (crc >> 8);
+    }
+    if (valid && req[0] != 0 && !drop) {
+        sim_slave_t* slave = sim_slave(bus, req[0], 0);
+        if (slave == NULL && cfg->auto_slaves && req[0] <= 247 &&
+            (slave = sim_slave(bus, req[0], 1)) != NULL && sim_add_region(bus, slave, 0, 0x10000) != 0) {
+            slave->addr = 0;
+            slave = NULL;
+        }
+        if (slave != NULL && slave->turnaround_us && slave->last_end_us &&
+            t_start < slave->last_end_us + slave->turnaround_us) {
+            slave = NULL;   // 還沒切回接收，漏收這個請求
+        }
+        if (slave != NULL) {
+            frame[0] = req[0];
+            int pdu_len = fail ? sim_exception(frame + 1, req[1], 0x04)
+                               : sim_execute(slave, req + 1, req_len - 3, frame + 1);
+            uint16_t crc = hal_crc16(frame, (size_t)(1 + pdu_len));
+            frame[1 + pdu_len] = (uint8_t)(crc & 0xFF);
+            frame[2 + pdu_len] = (uint8_t)(crc >> 8);
+            if (corrupt) frame[2 + pdu_len] ^= 0x5A;
+            len = 3 + pdu_len;
+            responder = slave;
+        }
+    }
+    hal_mutex_unlock(&bus->lock);
+
+    if (len > resp_cap) len = resp_cap;
+    if (len == 0) {
+        // 不回應：呼叫端要等滿整個超時時間
+        if (realtime) sim_wait_until(t_start + tx_us + (uint64_t)timeout_ms * 1000);
+        if (timing) {
+            memset(timing, 0, sizeof(*timing));
+            timing->write_us = (uint32_t)tx_us;
+        }
+        return 0;
+    }
+
+    memcpy(resp, frame, (size_t)len);
+    uint64_t first_byte_us = latency_us + sim_char_us(1, baud);
+    uint64_t frame_us = latency_us + sim_char_us(len, baud);
+    if (realtime) sim_wait_until(t_start + tx_us + frame_us);
+    if (responder != NULL) {
+        hal_mutex_lock(&bus->lock);
+        if (responder->addr == req[0]) responder->last_end_us = hal_time_us();
+        hal_mutex_unlock(&bus->lock);
+    }
+    if (timing) {
+        timing->write_us = (uint32_t)tx_us;
+        timing->first_byte_us = (uint32_t)first_byte_us;
+        timing->frame_us = (uint32_t)frame_us;
+    }
+    return len;
+}
@@ -1,32 +1,74 @@
 #ifndef HAL_MODBUS_SIM_H
 #define HAL_MODBUS_SIM_H
 
+#include "hal_port.h"
 #include <stdint.h>
 
-// 模擬的 modbus context 結構
+// Modbus RTU slave 模擬器
+// device 名稱為 "sim://<name>" 的串口 (或啟用 hal_sim_route_all 後的所有非 TCP device)
+// 接到行程內的虛擬匯流排，請求 frame 不經過硬體，由這裡依 register map 產生回應。
+// 其餘的 RTU 堆疊 (CRC、frame 長度判斷、統計、排程器、背景擷取) 與實體串口完全相同，
+// 因此可以在沒有硬體的環境下對 100+ 量測點的設定與排程器變更做負載測試。
+// 延遲、抖動與錯誤注入使用以 seed 初始化的虛擬亂數，相同設定與請求序列會得到相同結果。
+
+#define HAL_SIM_PREFIX "sim://"
+#define HAL_SIM_MAX_SLAVES 64       // 每條虛擬匯流排的 slave 上限
+#define HAL_SIM_MAX_REGIONS 4       // 每個 slave 的暫存器區段上限
+
 typedef struct {
-    char device[256];
-    int baud;
-    int slave_id;
-    int connected;
-} modbus_sim_t;
+    int baud;               // 計算傳輸時間用的 baud，0 表示使用串口登錄時的 baud
+    uint32_t latency_us;    // slave 收到請求到開始回應的處理時間
+    uint32_t jitter_us;     // 處理時間額外加上 [0, jitter_us) 的均勻亂數
+    uint32_t timeout_ppm;   // 不回應的機率 (百萬分之一)
+    uint32_t crc_error_ppm; // 回應 CRC 損毀的機率
+    uint32_t exception_ppm; // 回應例外 0x04 (Slave device failure) 的機率
+    uint32_t seed;          // 虛擬亂數種子，也決定暫存器初始值
+    int auto_slaves;        // 1 表示未登錄的 slave 自動建立並涵蓋全部 65536 個暫存器
+    int realtime;           // 1 表示依計算出的傳輸與處理時間實際等待；0 表示立即返回 (只回報時間)
+} hal_sim_config_t;
+
+typedef struct hal_sim_bus hal_sim_bus_t;
+
+// 預設設定：9600 baud 由串口決定、處理時間 2ms、無錯誤注入、自動建立 slave、即時模式
+void hal_sim_default_config(hal_sim_config_t* cfg);
+
+// 啟用後 hal_port_get 新開啟的所有非 TCP device 都接到以該名稱建立的虛擬匯流排
+// (已開啟的串口不受影響)，返回先前的設定
+int hal_sim_route_all(int enable);
+
+// device 是否會接到虛擬匯流排
+int hal_sim_is_device(const char* device);
+
+// 設定 device 的虛擬匯流排 (尚未開啟時先建立)，device 為 NULL 時設定之後新建匯流排的預設值
+// 成功返回 0，匯流排表已滿返回 -1
+int hal_sim_configure(const char* device, const hal_sim_config_t* cfg);
+
+// 在 device 的匯流排上登錄 slave 的一段暫存器 [start, start + count)
+// 同一 slave 可登錄多段；讀寫區段之外的暫存器回應例外 0x02 (Illegal data address)
+// 成功返回 0，失敗返回 -1
+int hal_sim_add_slave(const char* device, int slave, int start, int count);
 
-// 初始化並連接到一個 Modbus RTU 設備（模擬版本）
-modbus_sim_t* hal_modbus_connect(const char* device, int baud, int slave_id);
+// 設定 slave 的轉向時間：距離它上一個回應結束不到 turnaround_us 就收到的請求不回應
+// (模擬 RS-485 收發切換較慢的 slave)，slave 需先以 hal_sim_add_slave 登錄或已自動建立
+// 成功返回 0，失敗返回 -1
+int hal_sim_set_turnaround(const char* device, int slave, int turnaround_us);
 
-// 斷開連接並釋放資源
-void hal_modbus_disconnect(modbus_sim_t* ctx);
+// 直接讀寫模擬 slave 的暫存器 (例如測試腳本改變感測器讀值)
+// 成功返回 0，slave 或暫存器不存在返回 -1
+int hal_sim_set_register(const char* device, int slave, int reg, uint16_t value);
+int hal_sim_get_register(const char* device, int slave, int reg, uint16_t* value);
 
-// 寫入單個保持暫存器
-int hal_modbus_write_register(modbus_sim_t* ctx, int addr, int value);
+// 清除所有匯流排的 slave 與暫存器並重設亂數 (匯流排與設定保留)
+void hal_sim_reset(void);
 
-// 讀取多個保持暫存器
-int hal_modbus_read_registers(modbus_sim_t* ctx, int addr, int num, uint16_t* dest);
+// ---- 以下由 hal_port 使用 ----
 
-// 讀取溫度感測器
-float modbus_read_temperature(const char *device, int addr, int reg);
+// 取得 device 的虛擬匯流排 (不存在時建立)，匯流排表已滿返回 NULL
+hal_sim_bus_t* hal_sim_open(const char* device, int baud);
 
-// 讀取壓力感測器
-float modbus_read_pressure(const char *device, int addr, int reg);
+// 處理一個 RTU 請求 frame，語意與 hal_port_transact_framed 相同：
+// 返回回應位元組數，不回應 (超時) 返回 0
+int hal_sim_transact(hal_sim_bus_t* bus, const uint8_t* req, int req_len,
+                     uint8_t* resp, int resp_cap, int timeout_ms, hal_port_timing_t* timing);
 
 #endif // HAL_MODBUS_SIM_H
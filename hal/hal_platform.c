@@ -0,0 +1,199 @@
+#ifndef _WIN32
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include "hal_platform.h"
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+    hal_thread_fn fn;
+    void* arg;
+} thread_start_t;
+
+#ifdef _WIN32
+
+static DWORD WINAPI thread_trampoline(LPVOID param) {
+    thread_start_t start = *(thread_start_t*)param;
+    free(param);
+    start.fn(start.arg);
+    return 0;
+}
+
+int hal_thread_create(hal_thread_t* thread, hal_thread_fn fn, void* arg) {
+    thread_start_t* start = (thread_start_t*)malloc(sizeof(thread_start_t));
+    if (start == NULL) return -1;
+    start->fn = fn;
+    start->arg = arg;
+
+    *thread = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+    if (*thread == NULL) {
+        free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void hal_thread_join(hal_thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+int hal_thread_pin_current(int cpu) {
+    if (cpu < 0 || cpu >= (int)(sizeof(DWORD_PTR) * 8)) return -1;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0 ? 0 : -1;
+}
+
+int hal_thread_set_realtime(void) {
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ? 0 : -1;
+}
+
+void hal_timer_hires_begin(void) { timeBeginPeriod(1); }
+void hal_timer_hires_end(void) { timeEndPeriod(1); }
+
+void hal_mutex_lock(hal_mutex_t* m) { AcquireSRWLockExclusive(m); }
+void hal_mutex_unlock(hal_mutex_t* m) { ReleaseSRWLockExclusive(m); }
+
+int hal_cond_wait(hal_cond_t* c, hal_mutex_t* m, int timeout_ms) {
+    DWORD wait = timeout_ms < 0 ? 0 : (DWORD)timeout_ms;
+    return SleepConditionVariableSRW(c, m, wait, 0) ? 0 : -1;
+}
+
+void hal_cond_broadcast(hal_cond_t* c) { WakeAllConditionVariable(c); }
+
+void hal_rwlock_read_lock(hal_rwlock_t* l) { AcquireSRWLockShared(l); }
+void hal_rwlock_read_unlock(hal_rwlock_t* l) { ReleaseSRWLockShared(l); }
+void hal_rwlock_write_lock(hal_rwlock_t* l) { AcquireSRWLockExclusive(l); }
+void hal_rwlock_write_unlock(hal_rwlock_t* l) { ReleaseSRWLockExclusive(l); }
+
+void hal_sleep_ms(int ms) { Sleep(ms > 0 ? (DWORD)ms : 0); }
+
+void hal_sleep_us(uint64_t us) {
+    // Sleep 只有毫秒解析度，不足 1ms 的部分以忙等補足
+    uint64_t deadline = hal_time_us() + us;
+    if (us >= 2000) Sleep((DWORD)(us / 1000 - 1));
+    while (hal_time_us() < deadline) YieldProcessor();
+}
+
+uint64_t hal_time_us(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000ULL +
+           (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000ULL / (uint64_t)freq.QuadPart;
+}
+
+uint64_t hal_wall_time_us(void) {
+    // FILETIME 為 1601-01-01 起的 100ns 單位
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return t / 10 - 11644473600000000ULL;
+}
+
+#else
+
+static void* thread_trampoline(void* param) {
+    thread_start_t start = *(thread_start_t*)param;
+    free(param);
+    start.fn(start.arg);
+    return NULL;
+}
+
+int hal_thread_create(hal_thread_t* thread, hal_thread_fn fn, void* arg) {
+    thread_start_t* start = (thread_start_t*)malloc(sizeof(thread_start_t));
+    if (start == NULL) return -1;
+    start->fn = fn;
+    start->arg = arg;
+
+    if (pthread_create(thread, NULL, thread_trampoline, start) != 0) {
+        free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void hal_thread_join(hal_thread_t thread) {
+    pthread_join(thread, NULL);
+}
+
+int hal_thread_pin_current(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return -1;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+int hal_thread_set_realtime(void) {
+    // 取中間的優先權，保留更高的層級給核心執行緒與其他即時工作
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0 ? 0 : -1;
+}
+
+void hal_timer_hires_begin(void) {}
+void hal_timer_hires_end(void) {}
+
+void hal_mutex_lock(hal_mutex_t* m) { pthread_mutex_lock(m); }
+void hal_mutex_unlock(hal_mutex_t* m) { pthread_mutex_unlock(m); }
+
+int hal_cond_wait(hal_cond_t* c, hal_mutex_t* m, int timeout_ms) {
+    // 靜態初始化的 condition variable 使用 CLOCK_REALTIME
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (timeout_ms > 0) {
+        ts.tv_sec += timeout_ms / 1000;
+        ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+    }
+    return pthread_cond_timedwait(c, m, &ts) == 0 ? 0 : -1;
+}
+
+void hal_cond_broadcast(hal_cond_t* c) { pthread_cond_broadcast(c); }
+
+void hal_rwlock_read_lock(hal_rwlock_t* l) { pthread_rwlock_rdlock(l); }
+void hal_rwlock_read_unlock(hal_rwlock_t* l) { pthread_rwlock_unlock(l); }
+void hal_rwlock_write_lock(hal_rwlock_t* l) { pthread_rwlock_wrlock(l); }
+void hal_rwlock_write_unlock(hal_rwlock_t* l) { pthread_rwlock_unlock(l); }
+
+void hal_sleep_ms(int ms) {
+    if (ms <= 0) return;
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+void hal_sleep_us(uint64_t us) {
+    if (us == 0) return;
+    struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+uint64_t hal_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+uint64_t hal_wall_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+#endif
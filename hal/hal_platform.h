@@ -0,0 +1,67 @@
+#ifndef HAL_PLATFORM_H
+#define HAL_PLATFORM_H
+
+#include <stdint.h>
+
+// 執行緒、鎖與時間的平台抽象 (Windows / POSIX)
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE hal_thread_t;
+typedef SRWLOCK hal_mutex_t;
+typedef SRWLOCK hal_rwlock_t;
+typedef CONDITION_VARIABLE hal_cond_t;
+#define HAL_MUTEX_INIT SRWLOCK_INIT
+#define HAL_RWLOCK_INIT SRWLOCK_INIT
+#define HAL_COND_INIT CONDITION_VARIABLE_INIT
+#else
+#include <pthread.h>
+typedef pthread_t hal_thread_t;
+typedef pthread_mutex_t hal_mutex_t;
+typedef pthread_rwlock_t hal_rwlock_t;
+typedef pthread_cond_t hal_cond_t;
+#define HAL_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define HAL_RWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+#define HAL_COND_INIT PTHREAD_COND_INITIALIZER
+#endif
+
+typedef void (*hal_thread_fn)(void* arg);
+
+// 建立執行緒，成功返回 0，失敗返回 -1
+int hal_thread_create(hal_thread_t* thread, hal_thread_fn fn, void* arg);
+void hal_thread_join(hal_thread_t thread);
+
+// 把呼叫端執行緒綁定到指定 CPU，成功返回 0，平台不支援或 CPU 不存在返回 -1
+int hal_thread_pin_current(int cpu);
+
+// 把呼叫端執行緒設為即時優先權 (Linux SCHED_FIFO，Windows THREAD_PRIORITY_TIME_CRITICAL)
+// 成功返回 0，權限不足返回 -1 (執行緒維持一般優先權)
+int hal_thread_set_realtime(void);
+
+// 需要毫秒以下等待精度的期間呼叫 (Windows 把系統計時器解析度調為 1ms，POSIX 不做任何事)，需成對呼叫
+void hal_timer_hires_begin(void);
+void hal_timer_hires_end(void);
+
+void hal_mutex_lock(hal_mutex_t* m);
+void hal_mutex_unlock(hal_mutex_t* m);
+
+// 呼叫前需持有 m；等待期間釋放 m，返回時重新持有
+// 被喚醒返回 0，超過 timeout_ms 返回 -1 (呼叫端仍需重新檢查條件)
+int hal_cond_wait(hal_cond_t* c, hal_mutex_t* m, int timeout_ms);
+void hal_cond_broadcast(hal_cond_t* c);
+
+void hal_rwlock_read_lock(hal_rwlock_t* l);
+void hal_rwlock_read_unlock(hal_rwlock_t* l);
+void hal_rwlock_write_lock(hal_rwlock_t* l);
+void hal_rwlock_write_unlock(hal_rwlock_t* l);
+
+void hal_sleep_ms(int ms);
+void hal_sleep_us(uint64_t us);
+
+// 單調時鐘 (微秒)，用於週期與延遲計算
+uint64_t hal_time_us(void);
+
+// 牆上時鐘 (Unix epoch 微秒)，用於資料時間戳記
+uint64_t hal_wall_time_us(void);
+
+#endif // HAL_PLATFORM_H
@@ -0,0 +1,25 @@
+// 由 tools/gen_point_table.py 產生，請勿手動修改 (make point-table)
+// 來源: cdu_config.yaml
+#include "hal_ptable.h"
+#include <stddef.h>
+
+// device, slave, reg, type, scale, period_ms, priority
+static const hal_ptable_point_t point_table_points[] = {
+    { "COM7", 4, 0, 0, 0.1f, 10000, 0 },  // handle 0
+    { "COM7", 5, 2, 0, 0.01f, 100, 10 },  // handle 1
+};
+
+static const int32_t point_table_order[] = {
+    1, 0,
+};
+
+// slave, start, count, first, n_points, period_ms, priority, FC03 請求 (含 CRC)
+static const hal_ptable_frame_t point_table_frames[] = {
+    { 5, 2, 1, 0, 1, 100, 10, { 0x05, 0x03, 0x00, 0x02, 0x00, 0x01, 0x24, 0x4E } },
+    { 4, 0, 1, 1, 1, 10000, 0, { 0x04, 0x03, 0x00, 0x00, 0x00, 0x01, 0x84, 0x5F } },
+};
+
+const hal_ptable_t hal_ptable_builtin = {
+    8, 2, point_table_points, point_table_order,
+    2, point_table_frames
+};
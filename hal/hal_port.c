@@ -0,0 +1,775 @@
+#include "hal_port.h"
+#include "hal_log.h"
+#include "hal_modbus_sim.h"
+#include "hal_platform.h"
+#include "hal_tcp.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+#endif
+
+struct hal_port {
+    char device[64];
+    int baud;
+    int in_use;
+    hal_tcp_t* tcp;         // device 為 "tcp://..." 時的 Modbus TCP 連線，串口為 NULL
+    hal_sim_bus_t* sim;     // 接到模擬匯流排時不為 NULL
+#ifdef _WIN32
+    HANDLE handle;          // 以 FILE_FLAG_OVERLAPPED 開啟
+    HANDLE rx_event;        // overlapped 讀取完成事件
+    HANDLE tx_event;        // overlapped 寫入完成事件
+    DWORD timeout_ms;       // 目前設定在 COMMTIMEOUTS 的回應超時
+#else
+    int fd;                 // 以 O_NONBLOCK 開啟的 tty
+    int epfd;               // 只登錄 fd 的 EPOLLIN
+#endif
+    uint64_t last_open_attempt_us;
+    char parity;            // 'N'、'E' 或 'O'
+    int stop_bits;
+    uint32_t frame_gap_us;  // 上一次交易結束到下一個請求之間至少保留的靜默時間
+    uint32_t turnaround_us[HAL_PORT_MAX_SLAVE + 1]; // 各 slave 在下一個請求之前需要的靜默時間
+    uint64_t last_end_us;   // 上一次交易結束的時間
+    hal_mutex_t lock;       // 交易期間獨佔串口
+};
+
+static hal_port_t g_ports[HAL_MAX_PORTS];
+static hal_mutex_t g_registry_lock = HAL_MUTEX_INIT;
+
+int hal_port_t15_us(int baud, int char_bits) {
+    if (baud <= 0) baud = HAL_PORT_DEFAULT_BAUD;
+    if (baud > 19200) return 750;
+    return (int)((15LL * char_bits * 1000000) / (10LL * baud));
+}
+
+int hal_port_t35_us(int baud, int char_bits) {
+    if (baud <= 0) baud = HAL_PORT_DEFAULT_BAUD;
+    if (baud > 19200) return 1750;
+    return (int)((35LL * char_bits * 1000000) / (10LL * baud));
+}
+
+// 一個字元的位元數：start + 8 data + parity + stop
+static int port_char_bits(const hal_port_t* port) {
+    return 9 + (port->parity != 'N') + port->stop_bits;
+}
+
+static int port_char_us(const hal_port_t* port) {
+    int baud = port->baud > 0 ? port->baud : HAL_PORT_DEFAULT_BAUD;
+    return (int)(((int64_t)port_char_bits(port) * 1000000 + baud - 1) / baud);
+}
+
+// 3.5 字元靜默時間換算成毫秒，計時器解析度約 1ms，至少保留一個 tick 的餘裕
+static int port_t35_ms(const hal_port_t* port) {
+    int t35_ms = (hal_port_t35_us(port->baud, port_char_bits(port)) + 999) / 1000;
+    return t35_ms < 2 ? 2 : t35_ms;
+}
+
+#ifdef _WIN32
+
+static int port_is_open(const hal_port_t* port) {
+    return port->handle != INVALID_HANDLE_VALUE;
+}
+
+// 關閉串口，保留登錄項目以便重新連線 (呼叫者需持有 port->lock)
+static void port_close(hal_port_t* port) {
+    if (port->handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(port->handle);
+        port->handle = INVALID_HANDLE_VALUE;
+    }
+    if (port->rx_event != NULL) {
+        CloseHandle(port->rx_event);
+        port->rx_event = NULL;
+    }
+    if (port->tx_event != NULL) {
+        CloseHandle(port->tx_event);
+        port->tx_event = NULL;
+    }
+}
+
+// 設定讀取超時：ReadIntervalTimeout 為 3.5 字元靜默時間，
+// ReadTotalTimeoutConstant 為等待回應的上限。overlapped ReadFile 會在收滿
+// 要求的位元組數、frame 之後出現靜默、或總超時三者之一發生時立即完成。
+static int port_set_timeouts(hal_port_t* port, int timeout_ms) {
+    if (port->timeout_ms == (DWORD)timeout_ms) return 0;
+
+    COMMTIMEOUTS timeouts = {0};
+    timeouts.ReadIntervalTimeout = (DWORD)port_t35_ms(port);
+    timeouts.ReadTotalTimeoutMultiplier = 0;
+    timeouts.ReadTotalTimeoutConstant = (DWORD)timeout_ms;
+    timeouts.WriteTotalTimeoutMultiplier = 10;
+    timeouts.WriteTotalTimeoutConstant = 100;
+
+    if (!SetCommTimeouts(port->handle, &timeouts)) return -1;
+    port->timeout_ms = (DWORD)timeout_ms;
+    return 0;
+}
+
+// 等待 overlapped 操作完成；返回 0 成功，1 超時 (已取消)，-1 I/O 錯誤
+static int port_wait_overlapped(hal_port_t* port, OVERLAPPED* ov, BOOL started,
+                                DWORD wait_ms, DWORD* transferred) {
+    *transferred = 0;
+    if (!started && GetLastError() != ERROR_IO_PENDING) return -1;
+
+    if (WaitForSingleObject(ov->hEvent, wait_ms) != WAIT_OBJECT_0) {
+        CancelIo(port->handle);
+        GetOverlappedResult(port->handle, ov, transferred, TRUE);
+        return 1;
+    }
+    if (!GetOverlappedResult(port->handle, ov, transferred, FALSE)) return -1;
+    return 0;
+}
+
+// 開啟並設定串口 (呼叫者需持有 port->lock)
+static int port_open(hal_port_t* port) {
+    port->last_open_attempt_us = hal_time_us();
+
+    char port_name[80];
+    snprintf(port_name, sizeof(port_name), "\\\\.\\%s", port->device);
+
+    HANDLE hSerial = CreateFileA(port_name,
+                                GENERIC_READ | GENERIC_WRITE,
+                                0,
+                                NULL,
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+                                NULL);
+
+    if (hSerial == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        const char* reason;
+        switch(error) {
+            case 2: reason = "File not found - port may not exist"; break;
+            case 5: reason = "Access denied - port may be in use by another application"; break;
+            case 87: reason = "Invalid parameter"; break;
+            default: reason = "Unknown error"; break;
+        }
+        HAL_ERROR("Failed to open serial port %s, error: %lu (%s)", port->device, error, reason);
+        return -1;
+    }
+
+    // 設定串口參數
+    DCB dcbSerialParams = {0};
+    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+
+    if (!GetCommState(hSerial, &dcbSerialParams)) {
+        HAL_ERROR("Failed to get comm state");
+        CloseHandle(hSerial);
+        return -1;
+    }
+
+    dcbSerialParams.BaudRate = port->baud;
+    dcbSerialParams.ByteSize = 8;
+    dcbSerialParams.Parity = port->parity == 'E' ? EVENPARITY : port->parity == 'O' ? ODDPARITY : NOPARITY;
+    dcbSerialParams.StopBits = port->stop_bits == 2 ? TWOSTOPBITS : ONESTOPBIT;
+    dcbSerialParams.fBinary = TRUE;
+    dcbSerialParams.fParity = port->parity != 'N';
+    dcbSerialParams.fOutxCtsFlow = FALSE;
+    dcbSerialParams.fOutxDsrFlow = FALSE;
+    dcbSerialParams.fDtrControl = DTR_CONTROL_DISABLE;
+    dcbSerialParams.fDsrSensitivity = FALSE;
+    dcbSerialParams.fTXContinueOnXoff = FALSE;
+    dcbSerialParams.fOutX = FALSE;
+    dcbSerialParams.fInX = FALSE;
+    dcbSerialParams.fErrorChar = FALSE;
+    dcbSerialParams.fNull = FALSE;
+    dcbSerialParams.fRtsControl = RTS_CONTROL_DISABLE;
+    dcbSerialParams.fAbortOnError = FALSE;
+
+    if (!SetCommState(hSerial, &dcbSerialParams)) {
+        HAL_ERROR("Failed to set comm state");
+        CloseHandle(hSerial);
+        return -1;
+    }
+
+    port->handle = hSerial;
+    port->timeout_ms = 0;
+    if (port_set_timeouts(port, HAL_PORT_RESPONSE_TIMEOUT_MS) != 0) {
+        HAL_ERROR("Failed to set timeouts");
+        CloseHandle(hSerial);
+        port->handle = INVALID_HANDLE_VALUE;
+        return -1;
+    }
+
+    port->rx_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    port->tx_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (port->rx_event == NULL || port->tx_event == NULL) {
+        HAL_ERROR("Failed to create overlapped events, error: %lu", GetLastError());
+        port_close(port);
+        return -1;
+    }
+
+    HAL_INFO("Opened serial port %s, %d %c%c%d", port->device, port->baud, '8', port->parity, port->stop_bits);
+    return 0;
+}
+
+static void port_init_handles(hal_port_t* port) {
+    port->handle = INVALID_HANDLE_VALUE;
+    port->rx_event = NULL;
+    port->tx_event = NULL;
+    port->timeout_ms = 0;
+}
+
+// 清空收發緩衝區
+static void port_purge(hal_port_t* port) {
+    PurgeComm(port->handle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+}
+
+// 發送請求，成功返回 0，失敗返回 -1
+static int port_write(hal_port_t* port, const uint8_t* req, int req_len) {
+    OVERLAPPED tx_ov = {0};
+    tx_ov.hEvent = port->tx_event;
+    ResetEvent(tx_ov.hEvent);
+    DWORD bytes_written = 0;
+    BOOL ok = WriteFile(port->handle, req, req_len, &bytes_written, &tx_ov);
+    if (port_wait_overlapped(port, &tx_ov, ok, 1000, &bytes_written) != 0 ||
+        bytes_written != (DWORD)req_len) {
+        HAL_ERROR("Failed to write to serial port %s, error: %lu", port->device, GetLastError());
+        return -1;
+    }
+    return 0;
+}
+
+// 讀取一段回應，收滿 want 位元組或收到部分資料後靜默即完成
+// 返回收到的位元組數 (超時為 0)，I/O 錯誤返回 -1
+static int port_read(hal_port_t* port, uint8_t* buf, int want, int timeout_ms) {
+    OVERLAPPED rx_ov = {0};
+    rx_ov.hEvent = port->rx_event;
+    ResetEvent(rx_ov.hEvent);
+    DWORD got = 0;
+    BOOL ok = ReadFile(port->handle, buf, (DWORD)want, &got, &rx_ov);
+    if (port_wait_overlapped(port, &rx_ov, ok, (DWORD)timeout_ms + 100, &got) < 0) {
+        HAL_ERROR("Failed to read from serial port %s, error: %lu", port->device, GetLastError());
+        return -1;
+    }
+    return (int)got;
+}
+
+#else // POSIX (termios + epoll)
+
+static int port_is_open(const hal_port_t* port) {
+    return port->fd >= 0;
+}
+
+// 關閉串口，保留登錄項目以便重新連線 (呼叫者需持有 port->lock)
+static void port_close(hal_port_t* port) {
+    if (port->epfd >= 0) {
+        close(port->epfd);
+        port->epfd = -1;
+    }
+    if (port->fd >= 0) {
+        close(port->fd);
+        port->fd = -1;
+    }
+}
+
+// 回應的超時由 port_read 以 epoll 自行計算，不需要寫入 tty 設定
+static int port_set_timeouts(hal_port_t* port, int timeout_ms) {
+    (void)port;
+    (void)timeout_ms;
+    return 0;
+}
+
+static speed_t port_speed(int baud) {
+    switch (baud) {
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef B460800
+        case 460800: return B460800;
+#endif
+#ifdef B921600
+        case 921600: return B921600;
+#endif
+        default: return 0;
+    }
+}
+
+// 要求驅動程式關閉接收 FIFO 的延遲回報 (例如 8250/FTDI 預設會累積 1-16ms 才喚醒讀取端)
+// 不是每個驅動程式都支援，失敗時只記錄 DEBUG 訊息
+static void port_set_low_latency(hal_port_t* port) {
+#if defined(__linux__) && defined(ASYNC_LOW_LATENCY)
+    struct serial_struct serial;
+    if (ioctl(port->fd, TIOCGSERIAL, &serial) == 0) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(port->fd, TIOCSSERIAL, &serial) == 0) return;
+    }
+    HAL_DEBUG("ASYNC_LOW_LATENCY not supported on %s (errno %d)", port->device, errno);
+#endif
+}
+
+// 開啟並設定串口 (呼叫者需持有 port->lock)
+static int port_open(hal_port_t* port) {
+    port->last_open_attempt_us = hal_time_us();
+
+    speed_t speed = port_speed(port->baud);
+    if (speed == 0) {
+        HAL_ERROR("Unsupported baud rate %d for %s", port->baud, port->device);
+        return -1;
+    }
+
+    int fd = open(port->device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        const char* reason;
+        switch (errno) {
+            case ENOENT: reason = "File not found - port may not exist"; break;
+            case EACCES: reason = "Access denied - check dialout group membership"; break;
+            case EBUSY: reason = "Port may be in use by another application"; break;
+            default: reason = strerror(errno); break;
+        }
+        HAL_ERROR("Failed to open serial port %s, error: %d (%s)", port->device, errno, reason);
+        return -1;
+    }
+
+    // 8 data bits、依設定的 parity / stop bits、raw 模式、無流量控制；VMIN/VTIME 為 0，位元組間隔由 epoll 計時
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        HAL_ERROR("Failed to get termios on %s, errno %d", port->device, errno);
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
+    tio.c_cflag |= CS8 | CLOCAL | CREAD;
+    if (port->parity != 'N') {
+        tio.c_cflag |= PARENB;
+        if (port->parity == 'O') tio.c_cflag |= PARODD;
+        tio.c_iflag |= INPCK;   // parity 錯誤的位元組由 CRC 檢查拒絕
+    }
+    if (port->stop_bits == 2) tio.c_cflag |= CSTOPB;
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        HAL_ERROR("Failed to set termios on %s, errno %d", port->device, errno);
+        close(fd);
+        return -1;
+    }
+    port->fd = fd;
+    port_set_low_latency(port);
+
+    port->epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (port->epfd < 0 || epoll_ctl(port->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        HAL_ERROR("Failed to set up epoll for %s, errno %d", port->device, errno);
+        port_close(port);
+        return -1;
+    }
+
+    tcflush(fd, TCIOFLUSH);
+    HAL_INFO("Opened serial port %s, %d %c%c%d", port->device, port->baud, '8', port->parity, port->stop_bits);
+    return 0;
+}
+
+static void port_init_handles(hal_port_t* port) {
+    port->fd = -1;
+    port->epfd = -1;
+}
+
+// 清空收發緩衝區
+static void port_purge(hal_port_t* port) {
+    tcflush(port->fd, TCIOFLUSH);
+}
+
+// 發送請求，成功返回 0，失敗返回 -1
+// tty 輸出緩衝區滿時以 poll 等待，最多 1000ms
+static int port_write(hal_port_t* port, const uint8_t* req, int req_len) {
+    int sent = 0;
+    while (sent < req_len) {
+        ssize_t n = write(port->fd, req + sent, (size_t)(req_len - sent));
+        if (n > 0) {
+            sent += (int)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            struct pollfd pfd = { port->fd, POLLOUT, 0 };
+            if (poll(&pfd, 1, 1000) > 0) continue;
+        }
+        HAL_ERROR("Failed to write to serial port %s, errno %d", port->device, errno);
+        return -1;
+    }
+    return 0;
+}
+
+// 讀取一段回應，收滿 want 位元組或收到部分資料後靜默即完成
+// 第一個位元組最多等待 timeout_ms，之後每個位元組間隔超過 3.5 字元時間即視為 frame 結束
+// 返回收到的位元組數 (超時為 0)，I/O 錯誤返回 -1
+static int port_read(hal_port_t* port, uint8_t* buf, int want, int timeout_ms) {
+    int t35_ms = port_t35_ms(port);
+    int have = 0;
+    uint64_t deadline = hal_time_us() + (uint64_t)timeout_ms * 1000;
+
+    while (have < want) {
+        ssize_t n = read(port->fd, buf + have, (size_t)(want - have));
+        if (n > 0) {
+            have += (int)n;
+            continue;
+        }
+        if (n == 0 || errno == EAGAIN) {
+            // 尚未收到資料時等到總超時為止，已有資料時只等一個 3.5 字元靜默時間
+            int wait_ms = t35_ms;
+            if (have == 0) {
+                uint64_t now = hal_time_us();
+                if (now >= deadline) break;
+                wait_ms = (int)((deadline - now + 999) / 1000);
+            }
+            struct epoll_event ev;
+            int ready = epoll_wait(port->epfd, &ev, 1, wait_ms);
+            if (ready == 0 && have > 0) break; // frame 後靜默
+            if (ready < 0 && errno != EINTR) break;
+            if (ready > 0 && (ev.events & (EPOLLERR | EPOLLHUP))) {
+                HAL_ERROR("Serial port %s hung up", port->device);
+                return -1;
+            }
+            continue;
+        }
+        if (errno == EINTR) continue;
+        HAL_ERROR("Failed to read from serial port %s, errno %d", port->device, errno);
+        return -1;
+    }
+    return have;
+}
+
+#endif
+
+// 串口未開啟時嘗試重新開啟，距離上次嘗試太近則直接失敗
+static int port_ensure_open(hal_port_t* port) {
+    if (port_is_open(port)) return 0;
+    if (hal_time_us() - port->last_open_attempt_us < (uint64_t)HAL_PORT_REOPEN_INTERVAL_MS * 1000) return -1;
+    HAL_INFO("Reconnecting serial port %s", port->device);
+    return port_open(port);
+}
+
+// 查詢已登錄的 device，並記下第一個空的項目 (呼叫者需持有 g_registry_lock)
+static hal_port_t* port_find(const char* device, hal_port_t** free_slot) {
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        if (g_ports[i].in_use) {
+            if (strcmp(g_ports[i].device, device) == 0) return &g_ports[i];
+        } else if (*free_slot == NULL) {
+            *free_slot = &g_ports[i];
+        }
+    }
+    return NULL;
+}
+
+hal_port_t* hal_port_get(const char* device, int baud) {
+    if (device == NULL) return NULL;
+    if (strlen(device) >= sizeof(g_ports[0].device)) {
+        // 截斷後會與其他名稱相同的 device 共用登錄項目
+        HAL_ERROR("Device name too long (max %d): %.32s...", (int)sizeof(g_ports[0].device) - 1, device);
+        return NULL;
+    }
+
+    hal_mutex_lock(&g_registry_lock);
+
+    hal_port_t* free_slot = NULL;
+    hal_port_t* port = port_find(device, &free_slot);
+    hal_tcp_t* tcp = NULL;
+    if (port == NULL && free_slot != NULL && hal_tcp_is_endpoint(device)) {
+        // 連線最多阻塞 HAL_TCP_CONNECT_TIMEOUT_MS，期間不持有登錄表鎖；
+        // 之後重新查詢，連線期間其他執行緒可能已登錄同一 device 或用完登錄表
+        hal_mutex_unlock(&g_registry_lock);
+        tcp = hal_tcp_open(device);
+        if (tcp == NULL) return NULL;
+        hal_mutex_lock(&g_registry_lock);
+        free_slot = NULL;
+        port = port_find(device, &free_slot);
+    }
+
+    if (port == NULL && free_slot != NULL) {
+        // 釋放後的項目保留原本的 lock (未被持有)，只重設其他欄位
+        port = free_slot;
+        memset(port->device, 0, sizeof(port->device));
+        strncpy(port->device, device, sizeof(port->device) - 1);
+        port->baud = baud > 0 ? baud : HAL_PORT_DEFAULT_BAUD;
+        port->parity = 'N';
+        port->stop_bits = 1;
+        port->last_open_attempt_us = 0;
+        port->frame_gap_us = 0;
+        port->last_end_us = 0;
+        memset(port->turnaround_us, 0, sizeof(port->turnaround_us));
+        port_init_handles(port);
+        port->tcp = NULL;
+        port->sim = NULL;
+        port->in_use = 1;
+
+        if (tcp != NULL) {
+            // TCP 端點沒有串口 handle，交易經由 hal_port_tcp() 取得的連線進行
+            port->tcp = tcp;
+            tcp = NULL;
+        } else if (hal_sim_is_device(device)) {
+            port->sim = hal_sim_open(device, port->baud);
+            if (port->sim == NULL) {
+                port->in_use = 0;
+                port = NULL;
+            }
+        } else {
+            hal_mutex_lock(&port->lock);
+            port_open(port);
+            hal_mutex_unlock(&port->lock);
+        }
+    } else if (port == NULL) {
+        HAL_ERROR("Port registry full, cannot register %s", device);
+    }
+
+    hal_mutex_unlock(&g_registry_lock);
+    if (tcp != NULL) hal_tcp_close(tcp); // 沒有登錄 (已有同名項目或登錄表已滿)
+    return port;
+}
+
+int hal_port_configure(const char* device, int baud, char parity, int stop_bits) {
+    if (device == NULL || baud <= 0 || (parity != 'N' && parity != 'E' && parity != 'O') ||
+        (stop_bits != 1 && stop_bits != 2)) {
+        return -1;
+    }
+    hal_port_t* port = hal_port_get(device, baud);
+    if (port == NULL || port->tcp) return -1;
+
+    hal_mutex_lock(&port->lock);
+    int changed = port->baud != baud || port->parity != parity || port->stop_bits != stop_bits;
+    port->baud = baud;
+    port->parity = parity;
+    port->stop_bits = stop_bits;
+    if (port->sim) {
+        hal_sim_open(device, baud); // 更新模擬匯流排計算傳輸時間用的 baud
+    } else if (changed && port_is_open(port)) {
+        port_close(port);
+        port_open(port);
+    }
+    hal_mutex_unlock(&port->lock);
+    return 0;
+}
+
+int hal_port_get_line(hal_port_t* port, hal_port_line_t* out) {
+    if (port == NULL || out == NULL || port->tcp) return -1;
+    hal_mutex_lock(&port->lock);
+    int char_bits = port_char_bits(port);
+    out->baud = port->baud;
+    out->parity = port->parity;
+    out->stop_bits = port->stop_bits;
+    out->char_us = port_char_us(port);
+    out->t15_us = hal_port_t15_us(port->baud, char_bits);
+    out->t35_us = hal_port_t35_us(port->baud, char_bits);
+    out->frame_gap_us = (int)port->frame_gap_us;
+    hal_mutex_unlock(&port->lock);
+    return 0;
+}
+
+int hal_port_is_open(hal_port_t* port) {
+    if (port == NULL) return 0;
+    if (port->tcp) return hal_tcp_is_open(port->tcp);
+    if (port->sim) return 1;
+    return port_is_open(port);
+}
+
+hal_tcp_t* hal_port_tcp(hal_port_t* port) {
+    return port != NULL ? port->tcp : NULL;
+}
+
+const char* hal_port_device(hal_port_t* port) {
+    return port != NULL ? port->device : "";
+}
+
+int hal_port_set_frame_gap(hal_port_t* port, int gap_us) {
+    if (port == NULL || port->tcp || gap_us < 0 || gap_us > HAL_PORT_MAX_FRAME_GAP_US) return -1;
+    hal_mutex_lock(&port->lock);
+    port->frame_gap_us = (uint32_t)gap_us;
+    hal_mutex_unlock(&port->lock);
+    return 0;
+}
+
+int hal_port_frame_gap(hal_port_t* port) {
+    return port != NULL ? (int)port->frame_gap_us : 0;
+}
+
+int hal_port_set_turnaround(hal_port_t* port, int slave, int turnaround_us) {
+    if (port == NULL || port->tcp || slave < 1 || slave > HAL_PORT_MAX_SLAVE ||
+        turnaround_us < 0 || turnaround_us > HAL_PORT_MAX_FRAME_GAP_US) {
+        return -1;
+    }
+    hal_mutex_lock(&port->lock);
+    port->turnaround_us[slave] = (uint32_t)turnaround_us;
+    hal_mutex_unlock(&port->lock);
+    return 0;
+}
+
+int hal_port_turnaround(hal_port_t* port, int slave) {
+    if (port == NULL || slave < 1 || slave > HAL_PORT_MAX_SLAVE) return 0;
+    return (int)port->turnaround_us[slave];
+}
+
+// 距離上一次交易結束的靜默時間不足時等待 (呼叫者需持有 port->lock)
+// 實體串口至少 3.5 字元；模擬匯流排沒有線路，只套用 frame 間隔與轉向時間
+static void port_wait_gap(hal_port_t* port, int slave) {
+    if (port->last_end_us == 0) return;
+    uint32_t gap = port->frame_gap_us;
+    if (slave >= 1 && slave <= HAL_PORT_MAX_SLAVE && port->turnaround_us[slave] > gap) {
+        gap = port->turnaround_us[slave];
+    }
+    if (port->sim == NULL) {
+        uint32_t t35 = (uint32_t)hal_port_t35_us(port->baud, port_char_bits(port));
+        if (t35 > gap) gap = t35;
+    }
+    if (gap == 0) return;
+    uint64_t ready = port->last_end_us + gap;
+    uint64_t now = hal_time_us();
+    if (ready > now) hal_sleep_us(ready - now);
+}
+
+// quiet 為 1 時超時不記錄警告 (探測不存在的 slave 時超時是預期結果)
+static int port_transact(hal_port_t* port, int slave, const uint8_t* req, int req_len,
+                         uint8_t* resp, int resp_cap, int fixed_len,
+                         hal_frame_len_fn frame_len, int timeout_ms,
+                         hal_port_timing_t* timing, int quiet) {
+    if (port == NULL || req == NULL || resp == NULL || resp_cap <= 0) return -1;
+    if (timeout_ms <= 0) timeout_ms = HAL_PORT_RESPONSE_TIMEOUT_MS;
+    if (timing) memset(timing, 0, sizeof(*timing));
+    if (port->tcp) return -1; // TCP 端點以 MBAP 交易 (hal_tcp.h) 存取
+
+    hal_mutex_lock(&port->lock);
+    port_wait_gap(port, slave);
+
+    if (port->sim) {
+        // 模擬匯流排一次返回整個回應 frame，不需要分段讀取
+        int have = hal_sim_transact(port->sim, req, req_len, resp,
+                                    fixed_len > 0 ? fixed_len : resp_cap, timeout_ms, timing);
+        port->last_end_us = hal_time_us();
+        hal_mutex_unlock(&port->lock);
+        if (have == 0 && !quiet) HAL_WARN("Timeout waiting for response on %s", port->device);
+        return have;
+    }
+
+    if (port_ensure_open(port) != 0) {
+        hal_mutex_unlock(&port->lock);
+        return -1;
+    }
+    if (port_set_timeouts(port, timeout_ms) != 0) {
+        HAL_ERROR("Failed to set timeouts on %s", port->device);
+        port_close(port);
+        hal_mutex_unlock(&port->lock);
+        return -1;
+    }
+
+    // 清空接收緩衝區
+    port_purge(port);
+
+    // 發送請求
+    uint64_t t_start = hal_time_us();
+    if (port_write(port, req, req_len) != 0) {
+        port_close(port);
+        hal_mutex_unlock(&port->lock);
+        return -1;
+    }
+    uint64_t t_sent = hal_time_us();
+    if (timing) timing->write_us = (uint32_t)(t_sent - t_start);
+
+    // 接收回應：每一段在收滿、frame 後靜默或超時時立即返回。
+    // 有 frame_len 時分段讀取，每段完成後依已收到的標頭重新計算 frame 長度。
+    // 只有第一段等待回應超時；之後的位元組屬於同一個 frame，超過 3.5 字元沒有資料即為 frame 結束
+    int have = 0;
+    int need = frame_len ? frame_len(resp, 0) : fixed_len;
+    if (need > resp_cap) need = resp_cap;
+    while (have < need) {
+        int want = need - have;
+        int got = port_read(port, resp + have, want, have == 0 ? timeout_ms : port_t35_ms(port));
+        if (got < 0) {
+            port_close(port);
+            hal_mutex_unlock(&port->lock);
+            return -1;
+        }
+        if (timing && got > 0) {
+            uint64_t elapsed = hal_time_us() - t_sent;
+            if (have == 0) {
+                // 第一段在收到 got 個位元組後才完成，扣除其後 got-1 個字元的傳輸時間
+                uint64_t tail = (uint64_t)(got - 1) * (uint64_t)port_char_us(port);
+                timing->first_byte_us = (uint32_t)(elapsed > tail ? elapsed - tail : 0);
+            }
+            timing->frame_us = (uint32_t)elapsed;
+        }
+        have += got;
+        if (got < want) break; // 超時或 frame 後靜默
+
+        if (frame_len) {
+            need = frame_len(resp, have);
+            if (need < 0) break; // 無法辨識的 frame，交由呼叫者判斷
+            if (need > resp_cap) need = resp_cap;
+        }
+    }
+
+    port->last_end_us = hal_time_us();
+    hal_mutex_unlock(&port->lock);
+
+    if (have == 0 && !quiet) {
+        HAL_WARN("Timeout waiting for response on %s", port->device);
+    }
+    return have;
+}
+
+int hal_port_transact(hal_port_t* port, const uint8_t* req, int req_len,
+                      uint8_t* resp, int expected_len, int timeout_ms) {
+    if (expected_len <= 0) return -1;
+    return port_transact(port, -1, req, req_len, resp, expected_len, expected_len, NULL, timeout_ms, NULL, 0);
+}
+
+int hal_port_transact_framed(hal_port_t* port, int slave, const uint8_t* req, int req_len,
+                             uint8_t* resp, int resp_cap, hal_frame_len_fn frame_len,
+                             int timeout_ms, hal_port_timing_t* timing) {
+    if (frame_len == NULL) return -1;
+    return port_transact(port, slave, req, req_len, resp, resp_cap, 0, frame_len, timeout_ms, timing, 0);
+}
+
+int hal_port_probe(hal_port_t* port, int slave, const uint8_t* req, int req_len,
+                   uint8_t* resp, int resp_cap, hal_frame_len_fn frame_len,
+                   int timeout_ms, hal_port_timing_t* timing) {
+    if (frame_len == NULL) return -1;
+    return port_transact(port, slave, req, req_len, resp, resp_cap, 0, frame_len, timeout_ms, timing, 1);
+}
+
+void hal_port_close_all(void) {
+    hal_mutex_lock(&g_registry_lock);
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        hal_port_t* port = &g_ports[i];
+        if (!port->in_use) continue;
+        if (port->tcp) {
+            hal_tcp_close(port->tcp);
+            port->tcp = NULL;
+            port->in_use = 0;
+            continue;
+        }
+        if (port->sim) {
+            port->sim = NULL;
+            port->in_use = 0;
+            continue;
+        }
+        hal_mutex_lock(&port->lock);
+        if (port_is_open(port)) {
+            HAL_INFO("Closing serial port %s", port->device);
+        }
+        port_close(port);
+        port->in_use = 0;
+        hal_mutex_unlock(&port->lock);
+    }
+    hal_mutex_unlock(&g_registry_lock);
+}
@@ -0,0 +1,111 @@
+#ifndef HAL_PORT_H
+#define HAL_PORT_H
+
+#include <stdint.h>
+
+// 已開啟串口的共用登錄表
+// 同一個 device 名稱 (例如 COM7) 在整個行程中只開啟與設定一次，
+// 由所有 slave、所有 modbus context 以及 modbus_read_* 呼叫共用。
+// device 為 "tcp://host[:port]" 時登錄項目代表一條 Modbus TCP 連線 (見 hal_tcp.h)，
+// 為 "sim://name" (或啟用 hal_sim_route_all) 時接到行程內的模擬匯流排 (見 hal_modbus_sim.h)。
+
+#define HAL_MAX_PORTS 8
+#define HAL_PORT_REOPEN_INTERVAL_MS 1000 // 重新連線的最短間隔
+#define HAL_PORT_RESPONSE_TIMEOUT_MS 1000 // 預設等待第一個回應位元組的時間
+#define HAL_PORT_MAX_FRAME_GAP_US 100000 // hal_port_set_frame_gap 與 hal_port_set_turnaround 的上限
+#define HAL_PORT_DEFAULT_BAUD 9600
+#define HAL_PORT_MAX_SLAVE 247          // 轉向時間表涵蓋的 RTU 位址 (1-247)
+
+typedef struct hal_port hal_port_t;
+typedef struct hal_tcp hal_tcp_t;
+
+// 一次交易的時間量測 (微秒)，未收到任何回應位元組時 first_byte_us 與 frame_us 為 0
+typedef struct hal_port_timing {
+    uint32_t write_us;      // 發送請求所需時間
+    uint32_t first_byte_us; // 請求送出後到第一個回應位元組 (由第一段讀取完成時間與字元時間推算)
+    uint32_t frame_us;      // 請求送出後到最後一段讀取完成
+} hal_port_timing_t;
+
+// 串口的線路設定與由 baud 計算出的 RTU 字元時序 (微秒)
+typedef struct {
+    int baud;
+    char parity;            // 'N'、'E' 或 'O'
+    int stop_bits;          // 1 或 2
+    int char_us;            // 一個字元 (start + 8 data + parity + stop) 的傳輸時間
+    int t15_us;             // 字元間隔上限 1.5 字元
+    int t35_us;             // frame 之間的靜默時間 3.5 字元，接收端以此判斷 frame 結束
+    int frame_gap_us;       // hal_port_set_frame_gap 設定的額外間隔
+} hal_port_line_t;
+
+// 取得指定 device 的串口，第一次呼叫時開啟並設定
+// baud <= 0 時使用 HAL_PORT_DEFAULT_BAUD；已登錄的串口沿用原本的線路設定 (以 hal_port_configure 變更)
+// 串口暫時無法開啟時仍返回登錄項目，之後的交易會自動重試開啟
+// 登錄表已滿或 device 名稱達 64 個字元以上時返回 NULL
+hal_port_t* hal_port_get(const char* device, int baud);
+
+// 設定 device 的 baud、parity ('N'/'E'/'O') 與 stop bits (1/2)，尚未登錄時登錄並開啟
+// 已開啟的串口立即以新設定重新開啟；TCP 端點沒有線路設定
+// 成功返回 0，參數無效、TCP 端點或登錄表已滿返回 -1
+int hal_port_configure(const char* device, int baud, char parity, int stop_bits);
+
+// 讀取串口的線路設定與字元時序，成功返回 0，port 為 NULL 或 TCP 端點返回 -1
+int hal_port_get_line(hal_port_t* port, hal_port_line_t* out);
+
+// 串口是否處於已開啟狀態
+int hal_port_is_open(hal_port_t* port);
+
+// 串口的 device 名稱
+const char* hal_port_device(hal_port_t* port);
+
+// TCP 端點的連線，串口返回 NULL
+hal_tcp_t* hal_port_tcp(hal_port_t* port);
+
+// 依 baud 與每個字元的位元數 (8N1 為 10，8E1 / 8O1 / 8N2 為 11) 計算 RTU 字元時序 (微秒)
+// 依規範 19200 baud 以上固定 t1.5 = 750us、t3.5 = 1750us
+int hal_port_t15_us(int baud, int char_bits);
+int hal_port_t35_us(int baud, int char_bits);
+
+// 發送請求並接收回應 (整個交易期間獨佔串口)
+// 實體串口在上一次交易結束後至少保留 3.5 字元 (或 frame 間隔、目標 slave 的轉向時間，取最長者) 才送出請求
+// 收滿 expected_len 位元組，或收到部分資料後線路靜默 3.5 字元時立即返回，
+// timeout_ms 內沒有任何回應位元組視為超時
+// 發生 I/O 錯誤時關閉串口，下一次交易會重新連線
+// 返回收到的位元組數 (可能小於 expected_len)，超時返回 0，失敗返回 -1
+int hal_port_transact(hal_port_t* port, const uint8_t* req, int req_len,
+                      uint8_t* resp, int expected_len, int timeout_ms);
+
+// 依已收到的 have 個位元組判斷 frame 總長度 (have 為 0 時返回最短 frame 長度)
+// 無法辨識時返回 -1，接收端會停止讀取並把已收到的資料交給呼叫者
+typedef int (*hal_frame_len_fn)(const uint8_t* buf, int have);
+
+// 與 hal_port_transact 相同，但由 frame_len 分段決定回應長度，
+// 例如 Modbus 例外回應在第 5 個位元組到達時就能結束，不必等待正常回應的長度
+// slave 為請求的目標位址，用來套用該 slave 的轉向時間；非 Modbus 協定傳 -1
+// timing 不為 NULL 時寫入本次交易的時間量測
+int hal_port_transact_framed(hal_port_t* port, int slave, const uint8_t* req, int req_len,
+                             uint8_t* resp, int resp_cap, hal_frame_len_fn frame_len,
+                             int timeout_ms, hal_port_timing_t* timing);
+
+// 與 hal_port_transact_framed 相同，但超時不記錄警告 (匯流排探測時大部分位址預期不會回應)
+int hal_port_probe(hal_port_t* port, int slave, const uint8_t* req, int req_len,
+                   uint8_t* resp, int resp_cap, hal_frame_len_fn frame_len,
+                   int timeout_ms, hal_port_timing_t* timing);
+
+// 設定串口上一次交易結束到下一個請求之間至少保留的靜默時間 (微秒，0 表示不額外等待)，
+// 用於回應後需要較長轉向時間的 slave；TCP 端點或超出範圍返回 -1
+int hal_port_set_frame_gap(hal_port_t* port, int gap_us);
+
+// 目前設定的 frame 間隔 (微秒)
+int hal_port_frame_gap(hal_port_t* port);
+
+// 設定 slave 回應後需要的轉向時間 (微秒)：對該 slave 送出請求前，線路至少已靜默這段時間
+// 由 hal_discover_tune_turnaround 量測，0 表示只需 3.5 字元；成功返回 0
+int hal_port_set_turnaround(hal_port_t* port, int slave, int turnaround_us);
+
+// slave 目前的轉向時間 (微秒)
+int hal_port_turnaround(hal_port_t* port, int slave);
+
+// 關閉所有已開啟的串口並清空登錄表 (行程結束時呼叫)
+void hal_port_close_all(void);
+
+#endif // HAL_PORT_H
@@ -0,0 +1,132 @@
+#include "hal_ptable.h"
+#include "hal_crc16.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include "hal_sched.h"
+#include <stdio.h>
+#include <string.h>
+
+// 二進位檔整個讀進 (或組合在) 靜態緩衝區後一次驗證 CRC，不做動態配置。
+// 量測點與 frame 以 struct 原樣存放，標頭記錄 struct 大小，不同編譯設定產生的檔案會被拒絕。
+
+#define PTABLE_FILE_MAX                                                                \
+    (HAL_PTABLE_HEADER_SIZE + HAL_MAX_POINTS * (sizeof(hal_ptable_point_t) + sizeof(int32_t) + \
+                                                sizeof(hal_ptable_frame_t)) + 2)
+
+static hal_mutex_t g_file_lock = HAL_MUTEX_INIT;   // 保護 g_file 與匯出用的陣列
+static uint8_t g_file[PTABLE_FILE_MAX];
+static hal_ptable_point_t g_points[HAL_MAX_POINTS];
+static int32_t g_order[HAL_MAX_POINTS];
+static hal_ptable_frame_t g_frames[HAL_MAX_POINTS];
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int hal_ptable_load_builtin(void) {
+    if (hal_ptable_builtin.n_points == 0) {
+        HAL_WARN("Built-in point table is empty, regenerate it with make point-table");
+        return -1;
+    }
+    return hal_ptable_install(&hal_ptable_builtin);
+}
+
+int hal_ptable_load(const char* path) {
+    if (path == NULL) return -1;
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        HAL_ERROR("Cannot open point table %s", path);
+        return -1;
+    }
+
+    hal_mutex_lock(&g_file_lock);
+    size_t len = fread(g_file, 1, sizeof(g_file), f);
+    int truncated = !feof(f);   // 檔案比最大的合法大小還長
+    fclose(f);
+
+    hal_ptable_t table;
+    uint32_t n_points = 0, n_frames = 0;
+    int ok = !truncated && len >= HAL_PTABLE_HEADER_SIZE + 2 &&
+             get_u32(g_file) == HAL_PTABLE_MAGIC && get_u32(g_file + 4) == HAL_PTABLE_VERSION &&
+             get_u32(g_file + 8) == sizeof(hal_ptable_point_t) && get_u32(g_file + 12) == sizeof(hal_ptable_frame_t);
+    if (ok) {
+        n_points = get_u32(g_file + 20);
+        n_frames = get_u32(g_file + 24);
+        ok = n_points <= HAL_MAX_POINTS && n_frames <= HAL_MAX_POINTS &&
+             len == HAL_PTABLE_HEADER_SIZE + n_points * (sizeof(hal_ptable_point_t) + sizeof(int32_t)) +
+                        n_frames * sizeof(hal_ptable_frame_t) + 2;
+    }
+    if (ok) {
+        uint16_t crc = hal_crc16(g_file, len - 2);
+        ok = g_file[len - 2] == (uint8_t)(crc & 0xFF) && g_file[len - 1] == (uint8_t)(crc >> 8);
+    }
+    if (!ok) {
+        hal_mutex_unlock(&g_file_lock);
+        HAL_ERROR("Point table %s has an invalid header, size or CRC", path);
+        return -1;
+    }
+
+    // 複製到對齊的陣列，再交給排程器驗證內容
+    const uint8_t* p = g_file + HAL_PTABLE_HEADER_SIZE;
+    memcpy(g_points, p, n_points * sizeof(hal_ptable_point_t));
+    p += n_points * sizeof(hal_ptable_point_t);
+    memcpy(g_order, p, n_points * sizeof(int32_t));
+    p += n_points * sizeof(int32_t);
+    memcpy(g_frames, p, n_frames * sizeof(hal_ptable_frame_t));
+    table.max_gap = (int32_t)get_u32(g_file + 16);
+    table.n_points = (int32_t)n_points;
+    table.points = g_points;
+    table.order = g_order;
+    table.n_frames = (int32_t)n_frames;
+    table.frames = g_frames;
+    int result = hal_ptable_install(&table);
+    hal_mutex_unlock(&g_file_lock);
+
+    if (result == 0) HAL_INFO("Loaded point table %s", path);
+    return result;
+}
+
+int hal_ptable_save(const char* path) {
+    if (path == NULL) return -1;
+
+    hal_mutex_lock(&g_file_lock);
+    hal_ptable_t table;
+    hal_ptable_export(&table, g_points, g_order, g_frames);
+    size_t len = HAL_PTABLE_HEADER_SIZE;
+    memset(g_file, 0, HAL_PTABLE_HEADER_SIZE);
+    put_u32(g_file, HAL_PTABLE_MAGIC);
+    put_u32(g_file + 4, HAL_PTABLE_VERSION);
+    put_u32(g_file + 8, sizeof(hal_ptable_point_t));
+    put_u32(g_file + 12, sizeof(hal_ptable_frame_t));
+    put_u32(g_file + 16, (uint32_t)table.max_gap);
+    put_u32(g_file + 20, (uint32_t)table.n_points);
+    put_u32(g_file + 24, (uint32_t)table.n_frames);
+    memcpy(g_file + len, g_points, (size_t)table.n_points * sizeof(hal_ptable_point_t));
+    len += (size_t)table.n_points * sizeof(hal_ptable_point_t);
+    memcpy(g_file + len, g_order, (size_t)table.n_points * sizeof(int32_t));
+    len += (size_t)table.n_points * sizeof(int32_t);
+    memcpy(g_file + len, g_frames, (size_t)table.n_frames * sizeof(hal_ptable_frame_t));
+    len += (size_t)table.n_frames * sizeof(hal_ptable_frame_t);
+    uint16_t crc = hal_crc16(g_file, len);
+    g_file[len++] = (uint8_t)(crc & 0xFF);
+    g_file[len++] = (uint8_t)(crc >> 8);
+
+    FILE* f = fopen(path, "wb");
+    int failed = f == NULL;
+    if (f != NULL) {
+        failed = fwrite(g_file, 1, len, f) != len;
+        if (fclose(f) != 0) failed = 1;
+    }
+    hal_mutex_unlock(&g_file_lock);
+
+    if (failed) {
+        HAL_ERROR("Cannot write point table %s", path);
+        return -1;
+    }
+    HAL_INFO("Saved point table %s: %d points in %d frames", path, (int)table.n_points, (int)table.n_frames);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef HAL_PTABLE_H
+#define HAL_PTABLE_H
+
+#include "hal_modbus.h"
+#include <stdint.h>
+
+// 預先編譯的量測點表：量測點定義、排程計畫 (frame 與排序) 與每個 frame 的 FC03 請求 (含 CRC)
+// 由 tools/gen_point_table.py 依 cdu_config.yaml 的 FunctionBlocks 產生：
+//   hal_point_table.c   內建表 (hal_ptable_builtin)，與函式庫一起編譯 (make point-table)
+//   二進位檔            現場修改設定時不需重新編譯函式庫 (make point-table-bin)，以 hal_ptable_load 載入
+// 啟動時安裝整張表，不需要逐一註冊後重建計畫；Block 之後以相同定義註冊仍會得到表中的 handle，
+// 表中沒有的量測點照常加入並重建計畫。
+//
+// 二進位檔格式 (版本 HAL_PTABLE_VERSION，欄位為 little endian，與 struct 記憶體配置相同)：
+//   標頭 32 位元組：
+//     u32 magic (HAL_PTABLE_MAGIC)   u32 version   u32 point_size   u32 frame_size
+//     i32 max_gap   i32 n_points   i32 n_frames   u32 reserved
+//   hal_ptable_point_t points[n_points]
+//   i32 order[n_points]
+//   hal_ptable_frame_t frames[n_frames]
+//   u16 CRC16 (Modbus，涵蓋之前的所有位元組)
+
+#define HAL_PTABLE_MAGIC 0x42545048     // "HPTB"
+#define HAL_PTABLE_VERSION 1
+#define HAL_PTABLE_HEADER_SIZE 32
+
+typedef struct {
+    char device[64];        // 串口、"tcp://..." 或 "slmp://..." 端點
+    int32_t slave;          // Modbus slave；DI 點為 HAL_SCHED_SLAVE_UART_DI，PLC 點為裝置代碼
+    int32_t reg;
+    int32_t type;           // hal_value_type_t
+    float scale;            // 工程值 = raw * scale
+    int32_t period_ms;      // 0 表示使用預設週期
+    int32_t priority;
+} hal_ptable_point_t;
+
+// 涵蓋 order[first .. first + n_points) 的 frame，device 為 points[order[first]].device
+typedef struct {
+    int32_t slave;
+    int32_t start;
+    int32_t count;
+    int32_t first;
+    int32_t n_points;
+    int32_t period_ms;
+    int32_t priority;
+    uint8_t request[HAL_MODBUS_FC03_REQUEST_LEN];  // hal_modbus_fc03_request(slave, start, count)，DI 點為 0
+} hal_ptable_frame_t;
+
+typedef struct {
+    int32_t max_gap;        // 產生計畫時的合併門檻 (hal_sched_set_max_gap)
+    int32_t n_points;
+    const hal_ptable_point_t* points;   // handle 0 .. n_points-1
+    const int32_t* order;               // 依 (device, period, slave, reg) 排序後的量測點索引
+    int32_t n_frames;
+    const hal_ptable_frame_t* frames;
+} hal_ptable_t;
+
+// 由 tools/gen_point_table.py 產生的內建表 (hal_point_table.c)
+extern const hal_ptable_t hal_ptable_builtin;
+
+// 安裝 table 取代目前的量測點與計畫 (清除快照表)，必須在啟動背景擷取之前呼叫
+// 表的內容會先完整驗證 (排序、frame 範圍、請求 CRC)，失敗時目前的量測點不受影響
+// 成功返回 0，表無效、無法開啟 device 或背景擷取運作中返回 -1
+int hal_ptable_install(const hal_ptable_t* table);
+
+// 安裝內建表，內建表為空時返回 -1
+int hal_ptable_load_builtin(void);
+
+// 讀取 path 的二進位檔並安裝，檔案格式、版本或 CRC 錯誤返回 -1
+int hal_ptable_load(const char* path);
+
+// 把目前的量測點與計畫寫成二進位檔，成功返回 0，失敗返回 -1
+int hal_ptable_save(const char* path);
+
+// ---- 以下由 HAL 內部使用 ----
+
+// 把目前的量測點與計畫複製到呼叫者的陣列 (各 HAL_MAX_POINTS 個元素)，table 指向這些陣列
+// 返回量測點數量
+int hal_ptable_export(hal_ptable_t* table, hal_ptable_point_t* points, int32_t* order, hal_ptable_frame_t* frames);
+
+#endif // HAL_PTABLE_H
@@ -0,0 +1,680 @@
+#include "hal_sched.h"
+#include "hal_acq.h"
+#include "hal_change.h"
+#include "hal_discover.h"
+#include "hal_filter.h"
+#include "hal_frame.h"
+#include "hal_log.h"
+#include "hal_modbus.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include "hal_ptable.h"
+#include "hal_slmp.h"
+#include "hal_snapshot.h"
+#include "hal_uart.h"
+#include "hal_write.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 量測點與計畫由 g_plan_lock 保護：註冊時取得寫入鎖並立即重建計畫，
+// 輪詢端 (引擎或各串口擷取執行緒) 在讀取鎖內選出到期的 frame 並複製，
+// 匯流排交易期間釋放讀取鎖，完成後重新取得讀取鎖再發布；期間計畫若被重建
+// (g_plan_gen 改變) 則丟棄這批結果，下一次輪詢改用新的計畫。
+// 讀數本身寫入快照表 (hal_snapshot.h)，讀取端不需要任何鎖。
+
+typedef struct {
+    char device[64];
+    hal_port_t* port;
+    int slave;
+    int reg;
+    int type;
+    float scale;
+    int period_ms;      // 0 表示使用預設週期
+    int priority;
+} hal_point_t;
+
+// 一個 FC03 frame：涵蓋 order[first .. first + n_points) 的量測點
+// 只有輪詢週期相同的量測點會併入同一個 frame，priority 取其中最高者
+// request 為預先產生的 RTU 請求 (含 CRC)，輪詢時直接送出
+typedef struct {
+    hal_port_t* port;
+    int slave;
+    int start;
+    int count;
+    int first;
+    int n_points;
+    int period_ms;
+    int priority;
+    uint8_t request[HAL_MODBUS_FC03_REQUEST_LEN];
+} hal_frame_t;
+
+static hal_point_t g_points[HAL_MAX_POINTS];
+static int g_point_count = 0;
+
+static hal_frame_t g_frames[HAL_MAX_POINTS];
+static int g_order[HAL_MAX_POINTS];     // 依 (device, period, slave, reg) 排序後的量測點索引
+static int g_frame_count = 0;
+static int g_max_gap = HAL_SCHED_DEFAULT_MAX_GAP;
+static hal_rwlock_t g_plan_lock = HAL_RWLOCK_INIT;
+static int g_plan_installed = 0;        // 目前的計畫來自 hal_ptable_install，尚未因新的量測點重建
+static uint32_t g_plan_gen = 0;         // 計畫每次變更時遞增 (在寫入鎖內)
+
+// 每個 frame 的下一次截止時間 (hal_time_us)，0 表示立即到期，重建計畫時歸零
+// 只由負責該 port 的輪詢執行緒在讀取鎖內更新
+static uint64_t g_frame_due[HAL_MAX_POINTS];
+
+static void build_plan(void);
+
+static int point_add(const char* device, int slave, int reg, int type, float scale) {
+    hal_port_t* port = hal_port_get(device, 0);
+    if (port == NULL) return -1;
+
+    hal_rwlock_write_lock(&g_plan_lock);
+
+    for (int i = 0; i < g_point_count; i++) {
+        hal_point_t* p = &g_points[i];
+        if (p->slave == slave && p->reg == reg && p->type == type &&
+            p->scale == scale && strcmp(p->device, device) == 0) {
+            hal_rwlock_write_unlock(&g_plan_lock);
+            return i;
+        }
+    }
+
+    if (g_point_count >= HAL_MAX_POINTS) {
+        hal_rwlock_write_unlock(&g_plan_lock);
+        HAL_ERROR("Point table full, cannot register %s slave %d reg %d", device, slave, reg);
+        return -1;
+    }
+
+    hal_point_t* p = &g_points[g_point_count];
+    memset(p, 0, sizeof(*p));
+    strncpy(p->device, device, sizeof(p->device) - 1);
+    p->port = port;
+    p->slave = slave;
+    p->reg = reg;
+    p->type = type;
+    p->scale = scale;
+    int handle = g_point_count++;
+    hal_snapshot_describe(handle, device, slave, reg, type, scale);
+    if (g_plan_installed) {
+        HAL_WARN("Point %s slave %d reg %d is not in the installed point table, rebuilding plan",
+                 device, slave, reg);
+    }
+    build_plan();
+
+    hal_rwlock_write_unlock(&g_plan_lock);
+    return handle;
+}
+
+int hal_point_register(const char* device, int slave, int reg, int type, float scale) {
+    if (device == NULL || slave < 0 || slave > 255 || reg < 0 || reg > 0xFFFF) return -1;
+    return point_add(device, slave, reg, type, scale);
+}
+
+int hal_point_register_di(const char* device) {
+    if (device == NULL) return -1;
+    return point_add(device, HAL_SCHED_SLAVE_UART_DI, 0, HAL_VALUE_U32, 1.0f);
+}
+
+int hal_point_register_plc(const char* endpoint, const char* address, int type, float scale) {
+    int code, number;
+    if (!hal_slmp_is_endpoint(endpoint) || hal_slmp_parse_device(address, &code, &number) != 0) {
+        HAL_ERROR("Invalid PLC point %s %s", endpoint != NULL ? endpoint : "(null)",
+                  address != NULL ? address : "(null)");
+        return -1;
+    }
+    // 裝置代碼當作 slave，排程器因此只合併同一種裝置的相鄰編號
+    return point_add(endpoint, code, number, type, scale);
+}
+
+void hal_point_clear(void) {
+    hal_rwlock_write_lock(&g_plan_lock);
+    // handle 之後會分配給新的量測點，死區設定隨量測點一起移除
+    for (int i = 0; i < g_point_count; i++) hal_point_set_deadband(i, 0, 0);
+    g_point_count = 0;
+    g_frame_count = 0;
+    g_plan_installed = 0;
+    g_plan_gen++;
+    hal_snapshot_reset();
+    hal_filter_reset();
+    hal_rwlock_write_unlock(&g_plan_lock);
+}
+
+int hal_point_count(void) {
+    hal_rwlock_read_lock(&g_plan_lock);
+    int n = g_point_count;
+    hal_rwlock_read_unlock(&g_plan_lock);
+    return n;
+}
+
+int hal_point_set_rate(int handle, int period_ms, int priority) {
+    if (period_ms < 0) return -1;
+    if (period_ms > 0 && period_ms < HAL_SCHED_MIN_PERIOD_MS) period_ms = HAL_SCHED_MIN_PERIOD_MS;
+
+    hal_rwlock_write_lock(&g_plan_lock);
+    if (handle < 0 || handle >= g_point_count) {
+        hal_rwlock_write_unlock(&g_plan_lock);
+        return -1;
+    }
+    hal_point_t* p = &g_points[handle];
+    if (p->period_ms != period_ms || p->priority != priority) {
+        p->period_ms = period_ms;
+        p->priority = priority;
+        build_plan();
+    }
+    hal_rwlock_write_unlock(&g_plan_lock);
+    return 0;
+}
+
+int hal_point_period_ms(int handle) {
+    hal_rwlock_read_lock(&g_plan_lock);
+    int period_ms = handle >= 0 && handle < g_point_count ? g_points[handle].period_ms : -1;
+    hal_rwlock_read_unlock(&g_plan_lock);
+    return period_ms;
+}
+
+int hal_point_read(int handle, float* value) {
+    hal_sample_t sample;
+    if (value == NULL || hal_get_snapshot(handle, &sample) != 0) return -1;
+    if (sample.quality != HAL_QUALITY_GOOD) return -1;
+    *value = sample.value;
+    return 0;
+}
+
+void hal_sched_set_max_gap(int regs) {
+    if (regs < 0) regs = 0;
+    hal_rwlock_write_lock(&g_plan_lock);
+    if (regs != g_max_gap) {
+        g_max_gap = regs;
+        build_plan();
+    }
+    hal_rwlock_write_unlock(&g_plan_lock);
+}
+
+// 產生 frame 的 FC03 請求，DI frame 不使用 Modbus，填 0
+static void frame_request(hal_frame_t* frame) {
+    if (frame->slave < 0) {
+        memset(frame->request, 0, sizeof(frame->request));
+    } else {
+        hal_modbus_fc03_request(frame->request, frame->slave, frame->start, frame->count);
+    }
+}
+
+static int point_compare(const void* a, const void* b) {
+    const hal_point_t* pa = &g_points[*(const int*)a];
+    const hal_point_t* pb = &g_points[*(const int*)b];
+    int c = strcmp(pa->device, pb->device);
+    if (c != 0) return c;
+    if (pa->period_ms != pb->period_ms) return pa->period_ms - pb->period_ms;
+    if (pa->slave != pb->slave) return pa->slave - pb->slave;
+    return pa->reg - pb->reg;
+}
+
+// 依排序後的量測點產生最少的 frame：同一 device/slave/週期、間隔不超過 g_max_gap、
+// 且整個 frame 不超過 125 個暫存器時併入目前的 frame (呼叫者需持有寫入鎖)
+static void build_plan(void) {
+    for (int i = 0; i < g_point_count; i++) g_order[i] = i;
+    qsort(g_order, g_point_count, sizeof(int), point_compare);
+
+    g_frame_count = 0;
+    hal_frame_t* frame = NULL;
+    for (int i = 0; i < g_point_count; i++) {
+        hal_point_t* p = &g_points[g_order[i]];
+        int end = p->reg + hal_value_type_width(p->type);
+
+        if (frame != NULL && frame->port == p->port && frame->slave == p->slave &&
+            frame->period_ms == p->period_ms &&
+            p->reg - (frame->start + frame->count) <= g_max_gap &&
+            end - frame->start <= HAL_MODBUS_MAX_READ_REGISTERS) {
+            if (end > frame->start + frame->count) frame->count = end - frame->start;
+            if (p->priority > frame->priority) frame->priority = p->priority;
+            frame->n_points++;
+            continue;
+        }
+
+        frame = &g_frames[g_frame_count++];
+        frame->port = p->port;
+        frame->slave = p->slave;
+        frame->start = p->reg;
+        frame->count = end - p->reg;
+        frame->first = i;
+        frame->n_points = 1;
+        frame->period_ms = p->period_ms;
+        frame->priority = p->priority;
+    }
+    for (int f = 0; f < g_frame_count; f++) frame_request(&g_frames[f]);
+    memset(g_frame_due, 0, sizeof(g_frame_due));
+    g_plan_installed = 0;
+    g_plan_gen++;
+
+    HAL_INFO("Scheduler plan rebuilt: %d points in %d frames", g_point_count, g_frame_count);
+}
+
+// 與 point_compare 相同的排序 (安裝的表必須已依此排序，同一 device 的 frame 才會相鄰)
+static int table_point_compare(const hal_ptable_point_t* pa, const hal_ptable_point_t* pb) {
+    int c = strcmp(pa->device, pb->device);
+    if (c != 0) return c;
+    if (pa->period_ms != pb->period_ms) return pa->period_ms - pb->period_ms;
+    if (pa->slave != pb->slave) return pa->slave - pb->slave;
+    return pa->reg - pb->reg;
+}
+
+// 檢查表的內容與 build_plan 產生的計畫具有相同的性質：order 為排序後的排列，
+// frame 依序涵蓋所有量測點，每個量測點都在 frame 的暫存器範圍內，請求與 frame 一致
+// 返回 0 表示有效，否則記錄原因並返回 -1
+static int table_validate(const hal_ptable_t* t) {
+    if (t->n_points < 0 || t->n_points > HAL_MAX_POINTS || t->n_frames < 0 || t->n_frames > t->n_points ||
+        t->max_gap < 0 || (t->n_points > 0 && (t->points == NULL || t->order == NULL || t->frames == NULL))) {
+        HAL_ERROR("Point table has invalid size: %d points, %d frames", (int)t->n_points, (int)t->n_frames);
+        return -1;
+    }
+
+    for (int i = 0; i < t->n_points; i++) {
+        const hal_ptable_point_t* p = &t->points[i];
+        if (memchr(p->device, '\0', sizeof(p->device)) == NULL || p->device[0] == '\0' ||
+            p->type < HAL_VALUE_U16 || p->type > HAL_VALUE_F32 || p->period_ms < 0) {
+            HAL_ERROR("Point table entry %d is invalid", i);
+            return -1;
+        }
+    }
+
+    unsigned char seen[HAL_MAX_POINTS];
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < t->n_points; i++) {
+        int o = t->order[i];
+        if (o < 0 || o >= t->n_points || seen[o]) {
+            HAL_ERROR("Point table order is not a permutation at %d", i);
+            return -1;
+        }
+        seen[o] = 1;
+        if (i > 0 && table_point_compare(&t->points[t->order[i - 1]], &t->points[o]) > 0) {
+            HAL_ERROR("Point table order is not sorted at %d", i);
+            return -1;
+        }
+    }
+
+    int next = 0;
+    for (int f = 0; f < t->n_frames; f++) {
+        const hal_ptable_frame_t* frame = &t->frames[f];
+        if (frame->first != next || frame->n_points < 1 || frame->first + frame->n_points > t->n_points ||
+            frame->count < 1 || frame->count > HAL_MODBUS_MAX_READ_REGISTERS) {
+            HAL_ERROR("Point table frame %d is invalid", f);
+            return -1;
+        }
+        const hal_ptable_point_t* head = &t->points[t->order[frame->first]];
+        int priority = head->priority;
+        for (int k = 0; k < frame->n_points; k++) {
+            const hal_ptable_point_t* p = &t->points[t->order[frame->first + k]];
+            if (strcmp(p->device, head->device) != 0 || p->slave != frame->slave ||
+                p->period_ms != frame->period_ms || p->reg < frame->start ||
+                p->reg + hal_value_type_width(p->type) > frame->start + frame->count) {
+                HAL_ERROR("Point table frame %d does not cover point %d", f, (int)t->order[frame->first + k]);
+                return -1;
+            }
+            if (p->priority > priority) priority = p->priority;
+        }
+        hal_frame_t expect;
+        expect.slave = frame->slave;
+        expect.start = frame->start;
+        expect.count = frame->count;
+        frame_request(&expect);
+        if (frame->priority != priority || memcmp(frame->request, expect.request, sizeof(expect.request)) != 0) {
+            HAL_ERROR("Point table frame %d request does not match its registers", f);
+            return -1;
+        }
+        next = frame->first + frame->n_points;
+    }
+    if (next != t->n_points) {
+        HAL_ERROR("Point table frames cover %d of %d points", next, (int)t->n_points);
+        return -1;
+    }
+    return 0;
+}
+
+int hal_ptable_install(const hal_ptable_t* table) {
+    hal_port_t* ports[HAL_MAX_POINTS];
+    if (table == NULL || table_validate(table) != 0) return -1;
+    if (hal_acq_running()) {
+        HAL_ERROR("Cannot install point table while acquisition is running");
+        return -1;
+    }
+    // 先開啟所有 device，失敗時不改變目前的量測點
+    for (int i = 0; i < table->n_points; i++) {
+        ports[i] = hal_port_get(table->points[i].device, 0);
+        if (ports[i] == NULL) {
+            HAL_ERROR("Point table device %s cannot be opened", table->points[i].device);
+            return -1;
+        }
+    }
+
+    hal_rwlock_write_lock(&g_plan_lock);
+    hal_snapshot_reset();
+    hal_filter_reset();
+    for (int i = 0; i < table->n_points; i++) {
+        const hal_ptable_point_t* src = &table->points[i];
+        hal_point_t* p = &g_points[i];
+        memset(p, 0, sizeof(*p));
+        memcpy(p->device, src->device, sizeof(p->device));  // table_validate 已確認以 '\0' 結尾
+        p->port = ports[i];
+        p->slave = src->slave;
+        p->reg = src->reg;
+        p->type = src->type;
+        p->scale = src->scale;
+        p->period_ms = src->period_ms;
+        p->priority = src->priority;
+        g_order[i] = table->order[i];
+        hal_snapshot_describe(i, p->device, p->slave, p->reg, p->type, p->scale);
+    }
+    for (int f = 0; f < table->n_frames; f++) {
+        const hal_ptable_frame_t* src = &table->frames[f];
+        hal_frame_t* frame = &g_frames[f];
+        frame->port = g_points[table->order[src->first]].port;
+        frame->slave = src->slave;
+        frame->start = src->start;
+        frame->count = src->count;
+        frame->first = src->first;
+        frame->n_points = src->n_points;
+        frame->period_ms = src->period_ms;
+        frame->priority = src->priority;
+        memcpy(frame->request, src->request, sizeof(frame->request));
+    }
+    g_point_count = table->n_points;
+    g_frame_count = table->n_frames;
+    g_max_gap = table->max_gap;
+    memset(g_frame_due, 0, sizeof(g_frame_due));
+    g_plan_installed = 1;
+    g_plan_gen++;
+    hal_rwlock_write_unlock(&g_plan_lock);
+
+    HAL_INFO("Scheduler plan installed: %d points in %d frames", (int)table->n_points, (int)table->n_frames);
+    return 0;
+}
+
+int hal_ptable_export(hal_ptable_t* table, hal_ptable_point_t* points, int32_t* order, hal_ptable_frame_t* frames) {
+    hal_rwlock_read_lock(&g_plan_lock);
+    for (int i = 0; i < g_point_count; i++) {
+        const hal_point_t* p = &g_points[i];
+        hal_ptable_point_t* dst = &points[i];
+        memcpy(dst->device, p->device, sizeof(dst->device));
+        dst->slave = p->slave;
+        dst->reg = p->reg;
+        dst->type = p->type;
+        dst->scale = p->scale;
+        dst->period_ms = p->period_ms;
+        dst->priority = p->priority;
+        order[i] = g_order[i];
+    }
+    for (int f = 0; f < g_frame_count; f++) {
+        const hal_frame_t* frame = &g_frames[f];
+        hal_ptable_frame_t* dst = &frames[f];
+        memset(dst, 0, sizeof(*dst));
+        dst->slave = frame->slave;
+        dst->start = frame->start;
+        dst->count = frame->count;
+        dst->first = frame->first;
+        dst->n_points = frame->n_points;
+        dst->period_ms = frame->period_ms;
+        dst->priority = frame->priority;
+        memcpy(dst->request, frame->request, sizeof(dst->request));
+    }
+    table->max_gap = g_max_gap;
+    table->n_points = g_point_count;
+    table->points = points;
+    table->order = order;
+    table->n_frames = g_frame_count;
+    table->frames = frames;
+    int n = g_point_count;
+    hal_rwlock_read_unlock(&g_plan_lock);
+    return n;
+}
+
+int hal_sched_frame_count(void) {
+    hal_rwlock_read_lock(&g_plan_lock);
+    int count = g_frame_count;
+    hal_rwlock_read_unlock(&g_plan_lock);
+    return count;
+}
+
+int hal_sched_ports(hal_port_t** ports, int max_ports) {
+    int n = 0;
+    hal_rwlock_read_lock(&g_plan_lock);
+    for (int f = 0; f < g_frame_count; f++) {
+        int seen = 0;
+        for (int i = 0; i < n; i++) {
+            if (ports[i] == g_frames[f].port) seen = 1;
+        }
+        if (!seen && n < max_ports) ports[n++] = g_frames[f].port;
+    }
+    hal_rwlock_read_unlock(&g_plan_lock);
+    return n;
+}
+
+// 把一個 frame 的讀取結果寫入快照表 (呼叫者需持有讀取鎖)
+// 成功時先解碼整個 frame，交給 hal_filter_apply 一次調理後才寫入
+static void publish_frame(const hal_frame_t* frame, int ok, const uint16_t* regs, uint64_t now) {
+    if (!ok) {
+        for (int k = 0; k < frame->n_points; k++) {
+            hal_snapshot_mark_bad(g_order[frame->first + k]);
+        }
+        return;
+    }
+
+    // 同一暫存器可註冊多個量測點，n_points 可能超過暫存區大小，因此分段處理
+    int handles[HAL_MODBUS_MAX_READ_REGISTERS];
+    float values[HAL_MODBUS_MAX_READ_REGISTERS];
+    uint32_t raws[HAL_MODBUS_MAX_READ_REGISTERS];
+    for (int base = 0; base < frame->n_points; base += HAL_MODBUS_MAX_READ_REGISTERS) {
+        int n = frame->n_points - base;
+        if (n > HAL_MODBUS_MAX_READ_REGISTERS) n = HAL_MODBUS_MAX_READ_REGISTERS;
+        for (int k = 0; k < n; k++) {
+            int handle = g_order[frame->first + base + k];
+            hal_point_t* p = &g_points[handle];
+            const uint16_t* r = &regs[p->reg - frame->start];
+            handles[k] = handle;
+            values[k] = hal_modbus_decode_value(r, p->type, p->scale);
+            raws[k] = hal_value_type_width(p->type) == 2 ? ((uint32_t)r[0] << 16) | r[1] : r[0];
+        }
+        hal_filter_apply(handles, values, n, now);
+        for (int k = 0; k < n; k++) {
+            hal_snapshot_publish(handles[k], values[k], raws[k], now);
+        }
+    }
+}
+
+// 送出 port 佇列中的寫入，期間釋放讀取鎖 (呼叫者需持有讀取鎖，返回時仍持有)
+// 計畫在期間被重建時返回 -1，呼叫者手上的 frame 索引已失效
+static int flush_writes(hal_port_t* port) {
+    uint32_t gen = g_plan_gen;
+    hal_rwlock_read_unlock(&g_plan_lock);
+    hal_write_flush(port);
+    hal_rwlock_read_lock(&g_plan_lock);
+    return g_plan_gen == gen ? 0 : -1;
+}
+
+// 執行 g_frames[idx[0 .. n)] (同一個 port，n 不超過 HAL_MODBUS_TCP_BATCH) 並寫入快照表
+// 各 frame 的暫存器依實際數量從 arena 切出，整批只佔用所需的 cache line
+// frame 先複製到堆疊，交易期間釋放讀取鎖 (呼叫者需持有讀取鎖，返回時仍持有)
+// 返回成功的 frame 數量；計畫在交易期間被重建時丟棄結果並返回 -1
+static int poll_batch(const int* idx, int n) {
+    uint64_t storage[HAL_FRAME_ARENA_SIZE / sizeof(uint64_t)];
+    hal_frame_arena_t arena;
+    hal_frame_t frames[HAL_MODBUS_TCP_BATCH];
+    uint16_t* regs[HAL_MODBUS_TCP_BATCH];
+    hal_modbus_read_t reads[HAL_MODBUS_TCP_BATCH];
+    int status[HAL_MODBUS_TCP_BATCH];
+    int slot[HAL_MODBUS_TCP_BATCH];     // reads[k] 對應的 idx 位置
+    hal_port_t* port = g_frames[idx[0]].port;
+    uint32_t gen = g_plan_gen;
+    int ok_frames = 0;
+
+    for (int i = 0; i < n; i++) frames[i] = g_frames[idx[i]];
+    hal_rwlock_read_unlock(&g_plan_lock);
+
+    // DI 點以 UART 文字協定讀取 bitmap，其餘整批交給 Modbus
+    // 探測確認不存在的 Modbus slave 不送出交易，直接視為超時
+    hal_frame_arena_init(&arena, storage, sizeof(storage));
+    int slmp = hal_tcp_is_slmp(hal_port_tcp(port));
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        const hal_frame_t* frame = &frames[i];
+        regs[i] = (uint16_t*)hal_frame_alloc(&arena, (size_t)frame->count * sizeof(uint16_t));
+        if (frame->slave == HAL_SCHED_SLAVE_UART_DI) {
+            uint32_t bitmap = 0;
+            status[i] = hal_uart_read_di(port, &bitmap);
+            regs[i][0] = (uint16_t)(bitmap >> 16);
+            regs[i][1] = (uint16_t)(bitmap & 0xFFFF);
+            if (status[i] == HAL_MODBUS_OK) ok_frames++;
+            continue;
+        }
+        if (!slmp && hal_discover_skip(port, frame->slave)) {
+            status[i] = HAL_MODBUS_ERR_TIMEOUT;
+            continue;
+        }
+        reads[m].slave = frame->slave;
+        reads[m].reg = frame->start;
+        reads[m].count = frame->count;
+        reads[m].dest = regs[i];
+        reads[m].request = frame->request;
+        slot[m++] = i;
+    }
+    if (m > 0) {
+        ok_frames += slmp ? hal_slmp_read_blocks(port, reads, m) : hal_modbus_read_holding_many(port, reads, m);
+        for (int k = 0; k < m; k++) status[slot[k]] = reads[k].status;
+    }
+
+    uint64_t now = hal_wall_time_us();
+    hal_rwlock_read_lock(&g_plan_lock);
+    if (g_plan_gen != gen) return -1;
+    for (int i = 0; i < n; i++) {
+        publish_frame(&g_frames[idx[i]], status[i] == HAL_MODBUS_OK, regs[i], now);
+    }
+    return ok_frames;
+}
+
+// port 一次可同時在途的 frame 數：TCP 端點整批送出 (SLMP 端點把整批合併成一個 frame)；
+// 串口逐一交易，每個 frame 讀完立即發布以保持時間戳記準確
+static int port_batch(hal_port_t* port) {
+    return hal_port_tcp(port) ? HAL_MODBUS_TCP_BATCH : 1;
+}
+
+// EDF 排序：截止時間早的先執行，相同時取 priority 高者
+static int frame_before(int a, int b) {
+    if (g_frame_due[a] != g_frame_due[b]) return g_frame_due[a] < g_frame_due[b];
+    return g_frames[a].priority > g_frames[b].priority;
+}
+
+// 執行完一個 frame 後排定下一次截止時間；落後超過一個週期時不補跑，從現在起算
+static void frame_reschedule(int f, int period_ms, uint64_t now) {
+    uint64_t period_us = (uint64_t)period_ms * 1000;
+    uint64_t due = g_frame_due[f] + period_us;
+    g_frame_due[f] = (g_frame_due[f] == 0 || due <= now) ? now + period_us : due;
+}
+
+int hal_sched_poll_port(hal_port_t* port) {
+    int ok_frames = 0;
+    int idx[HAL_MODBUS_TCP_BATCH];
+    hal_rwlock_read_lock(&g_plan_lock);
+    // 計畫依 device 排序，同一個 port 的 frame 一定相鄰
+    int f = 0;
+    while (f < g_frame_count) {
+        int end = f + 1;
+        while (end < g_frame_count && g_frames[end].port == g_frames[f].port) end++;
+        if (port == NULL || g_frames[f].port == port) {
+            if (flush_writes(g_frames[f].port) != 0) break;
+            int batch = port_batch(g_frames[f].port);
+            int rc = 0;
+            for (int base = f; base < end && rc >= 0; base += batch) {
+                int m = end - base < batch ? end - base : batch;
+                for (int i = 0; i < m; i++) idx[i] = base + i;
+                rc = poll_batch(idx, m);
+                if (rc > 0) ok_frames += rc;
+            }
+            if (rc < 0) break;  // 計畫已重建
+        }
+        f = end;
+    }
+    hal_rwlock_read_unlock(&g_plan_lock);
+    return ok_frames;
+}
+
+// 對 g_frames[first .. end) (同一個 port) 執行 EDF：每輪選出已到期的 frame 中截止時間最早者
+// (TCP 一次選一整批)，每個 frame 在一次呼叫中最多執行一次，避免匯流排飽和時無法返回
+// next_due 更新為所有 frame 中最早的下一次截止時間
+// 計畫在交易期間被重建時返回 -1 (next_due 不更新)
+static int poll_due_range(int first, int end, int default_period_ms, uint64_t* next_due) {
+    hal_port_t* port = g_frames[first].port;
+    int batch = port_batch(port);
+    int done[HAL_MAX_POINTS];
+    int idx[HAL_MODBUS_TCP_BATCH];
+    int ok_frames = 0;
+
+    memset(done, 0, (size_t)(end - first) * sizeof(int));
+    for (;;) {
+        // 寫入優先：每一輪讀取之前先送出佇列中的設定值
+        if (flush_writes(port) != 0) return -1;
+        uint64_t now = hal_time_us();
+        int m = 0;
+        for (int f = first; f < end; f++) {
+            if (done[f - first] || g_frame_due[f] > now) continue;
+            // 插入排序，只保留最早的 batch 個
+            int pos = m < batch ? m++ : batch;
+            while (pos > 0 && frame_before(f, idx[pos - 1])) {
+                if (pos < batch) idx[pos] = idx[pos - 1];
+                pos--;
+            }
+            if (pos < batch) idx[pos] = f;
+        }
+        if (m == 0) break;
+
+        int rc = poll_batch(idx, m);
+        if (rc < 0) return -1;
+        ok_frames += rc;
+        now = hal_time_us();
+        for (int i = 0; i < m; i++) {
+            int period_ms = g_frames[idx[i]].period_ms > 0 ? g_frames[idx[i]].period_ms : default_period_ms;
+            frame_reschedule(idx[i], period_ms, now);
+            done[idx[i] - first] = 1;
+        }
+    }
+
+    for (int f = first; f < end; f++) {
+        // 預設週期為 0 時 (同步輪詢)，週期為 0 的 frame 每次呼叫都會執行，不列入截止時間
+        if (g_frames[f].period_ms == 0 && default_period_ms == 0) continue;
+        if (*next_due == 0 || g_frame_due[f] < *next_due) *next_due = g_frame_due[f];
+    }
+    return ok_frames;
+}
+
+int hal_sched_poll_due(hal_port_t* port, int default_period_ms, uint64_t* next_due_us) {
+    int ok_frames = 0;
+    uint64_t next_due = 0;
+    if (default_period_ms < 0) default_period_ms = 0;
+
+    hal_rwlock_read_lock(&g_plan_lock);
+    int f = 0;
+    while (f < g_frame_count) {
+        int end = f + 1;
+        while (end < g_frame_count && g_frames[end].port == g_frames[f].port) end++;
+        if (port == NULL || g_frames[f].port == port) {
+            int rc = poll_due_range(f, end, default_period_ms, &next_due);
+            if (rc < 0) {
+                // 計畫已重建，所有 frame 的截止時間歸零，由下一次呼叫重新排定
+                next_due = 0;
+                break;
+            }
+            ok_frames += rc;
+        }
+        f = end;
+    }
+    hal_rwlock_read_unlock(&g_plan_lock);
+
+    if (next_due_us != NULL) *next_due_us = next_due;
+    return ok_frames;
+}
+
+int hal_sched_poll(void) {
+    // 背景擷取執行緒運作中時，由它們負責輪詢
+    if (hal_acq_running()) return 0;
+    return hal_sched_poll_due(NULL, 0, NULL);
+}
@@ -0,0 +1,79 @@
+#ifndef HAL_SCHED_H
+#define HAL_SCHED_H
+
+#include <stdint.h>
+
+// 匯流排交易排程器
+// Block 在啟動時註冊一次量測點 (device, slave, register, type, scale)，
+// 排程器把同一 slave 上相鄰的暫存器合併成最少數量的 FC03 frame，
+// 每個週期執行一次 hal_sched_poll()，再把結果分送回各量測點。
+// 量測點可各自指定輪詢週期與優先權 (hal_point_set_rate)，
+// 排程器以最早截止時間優先 (EDF) 只執行已到期的 frame，匯流排頻寬留給需要高更新率的量測點。
+// 量測點與計畫也可以在啟動時由預先編譯的量測點表一次安裝 (hal_ptable.h)。
+
+#define HAL_MAX_POINTS 256
+#define HAL_SCHED_DEFAULT_MAX_GAP 8 // 兩個量測點之間最多容許多少未使用的暫存器仍合併
+#define HAL_SCHED_MIN_PERIOD_MS 10
+#define HAL_SCHED_SLAVE_UART_DI -1  // DI 點內部使用的 slave 值
+
+// 註冊一個 Modbus 量測點 (slave 0-255)，type 為 hal_value_type_t，工程值 = raw * scale
+// 相同定義的量測點會返回同一個 handle
+// 返回 handle (>= 0)，失敗返回 -1
+int hal_point_register(const char* device, int slave, int reg, int type, float scale);
+
+// 註冊 device 上 UART DI/DO 板的輸入 bitmap (見 hal_uart.h)，每個 device 只有一個 DI 點
+// 快照的 raw 為 bitmap (bit 0 為 pin 1)
+// 返回 handle (>= 0)，失敗返回 -1
+int hal_point_register_di(const char* device);
+
+// 註冊三菱 PLC 的一個 word 裝置，endpoint 為 "slmp://host[:port]"，address 例如 "R10020"、"D100" (見 hal_slmp.h)
+// 同一 endpoint 上相鄰的裝置合併成區塊，每個輪詢批次以一個 SLMP frame 讀回
+// 返回 handle (>= 0)，失敗返回 -1
+int hal_point_register_plc(const char* endpoint, const char* address, int type, float scale);
+
+// 清除所有量測點與排程計畫
+void hal_point_clear(void);
+
+// 已註冊的量測點數量 (handle 為 0 .. count-1)
+int hal_point_count(void);
+
+// 設定量測點的輪詢週期與優先權 (數值越大越優先)，period_ms 為 0 時使用預設週期
+// (背景擷取的 period_ms；同步輪詢時每次 hal_sched_poll() 都會讀取)
+// 成功返回 0，handle 不存在或 period_ms 為負返回 -1
+int hal_point_set_rate(int handle, int period_ms, int priority);
+
+// 量測點以 hal_point_set_rate 設定的輪詢週期，0 表示使用預設週期；handle 不存在返回 -1
+int hal_point_period_ms(int handle);
+
+// 取得量測點最近一次輪詢的工程值 (讀取快照表，不會阻塞)
+// 成功返回 0，量測點不存在或最近一次讀取失敗返回 -1
+int hal_point_read(int handle, float* value);
+
+// 設定合併門檻 (未使用的暫存器數量)，0 表示只合併完全相鄰的暫存器
+void hal_sched_set_max_gap(int regs);
+
+// 目前排程計畫的 frame 數量
+int hal_sched_frame_count(void);
+
+// 執行一個輪詢週期：依計畫送出已到期的 frame 並更新量測點
+// 背景擷取 (hal_acq.h) 運作中時不做任何事
+// 返回成功的 frame 數量
+int hal_sched_poll(void);
+
+struct hal_port;
+
+// 只輪詢計畫中屬於指定串口的 frame (port 為 NULL 時輪詢全部)
+// 返回成功的 frame 數量
+int hal_sched_poll_port(struct hal_port* port);
+
+// 依 EDF 輪詢指定串口 (NULL 為全部) 上已到期的 frame，每個 frame 在一次呼叫中最多執行一次
+// 未指定週期的 frame 使用 default_period_ms；default_period_ms 為 0 時它們每次呼叫都會執行
+// next_due_us 不為 NULL 時輸出最早的下一次截止時間 (hal_time_us)，沒有排定的 frame 時為 0
+// 匯流排交易期間不持有計畫的鎖；期間計畫被重建時提早返回，next_due_us 為 0
+// 返回成功的 frame 數量
+int hal_sched_poll_due(struct hal_port* port, int default_period_ms, uint64_t* next_due_us);
+
+// 列出計畫中用到的串口，返回數量
+int hal_sched_ports(struct hal_port** ports, int max_ports);
+
+#endif // HAL_SCHED_H
@@ -0,0 +1,297 @@
+#include "hal_shm.h"
+#include "hal_acq.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct hal_shm_reader {
+    int in_use;
+    const hal_shm_region_t* region;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+static hal_shm_reader_t g_readers[HAL_SHM_MAX_READERS];
+static hal_mutex_t g_shm_lock = HAL_MUTEX_INIT;
+
+// 擷取程序發布中的區段
+static hal_shm_region_t* g_published = NULL;
+static char g_published_name[HAL_SHM_NAME_MAX + 8];
+#ifdef _WIN32
+static HANDLE g_published_mapping = NULL;
+#endif
+
+// 作業系統層級的物件名稱：Linux 為 "/name"，Windows 為 "Local\name" (同一登入工作階段內共用)
+static int shm_os_name(const char* name, char* out, size_t size) {
+    if (name == NULL) name = HAL_SHM_DEFAULT_NAME;
+    if (name[0] == '\0' || strlen(name) >= HAL_SHM_NAME_MAX || strchr(name, '/') || strchr(name, '\\')) {
+        HAL_ERROR("Invalid shared snapshot name '%s'", name);
+        return -1;
+    }
+#ifdef _WIN32
+    snprintf(out, size, "Local\\%s", name);
+#else
+    snprintf(out, size, "/%s", name);
+#endif
+    return 0;
+}
+
+static uint32_t shm_pid(void) {
+#ifdef _WIN32
+    return (uint32_t)GetCurrentProcessId();
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+int hal_shm_publish(const char* name) {
+    char os_name[HAL_SHM_NAME_MAX + 8];
+    if (shm_os_name(name, os_name, sizeof(os_name)) != 0) return -1;
+    if (hal_acq_running()) {
+        HAL_ERROR("Shared snapshot must be published before acquisition starts");
+        return -1;
+    }
+
+    hal_mutex_lock(&g_shm_lock);
+    if (g_published != NULL) {
+        hal_mutex_unlock(&g_shm_lock);
+        HAL_ERROR("Shared snapshot already published as %s", g_published_name);
+        return -1;
+    }
+
+    hal_shm_region_t* region = NULL;
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                        (DWORD)sizeof(hal_shm_region_t), os_name);
+    if (mapping != NULL) {
+        region = (hal_shm_region_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(hal_shm_region_t));
+        if (region == NULL) CloseHandle(mapping);
+    }
+#else
+    // 不使用 O_EXCL：擷取程序異常結束後重新啟動時沿用同一區段，已映射的讀取程序不需重開
+    int fd = shm_open(os_name, O_CREAT | O_RDWR, 0644);
+    if (fd >= 0) {
+        if (ftruncate(fd, (off_t)sizeof(hal_shm_region_t)) == 0) {
+            void* p = mmap(NULL, sizeof(hal_shm_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) region = (hal_shm_region_t*)p;
+        }
+        close(fd);
+    }
+#endif
+    if (region == NULL) {
+        hal_mutex_unlock(&g_shm_lock);
+        HAL_ERROR("Failed to create shared snapshot %s", os_name);
+        return -1;
+    }
+
+    // 先讓讀取端看到未初始化，再寫入內容，最後才寫 magic
+    atomic_store_explicit(&region->magic, 0, memory_order_relaxed);
+    atomic_store_explicit(&region->active, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memset(region->points, 0, sizeof(region->points));
+    for (int i = 0; i < HAL_MAX_POINTS; i++) {
+        // 沿用舊區段時 seq 保持遞增，讀取端不會把新舊內容誤認為同一版本
+        unsigned seq = atomic_load_explicit(&region->slots[i].seq, memory_order_relaxed);
+        atomic_store_explicit(&region->slots[i].seq, (seq + 2) & ~1u, memory_order_relaxed);
+        memset(&region->slots[i].sample, 0, sizeof(region->slots[i].sample));
+    }
+    region->version = HAL_SHM_VERSION;
+    region->max_points = HAL_MAX_POINTS;
+    region->slot_size = sizeof(hal_shm_slot_t);
+    region->publisher_pid = shm_pid();
+    region->created_us = hal_wall_time_us();
+    hal_snapshot_bind(region);
+
+    atomic_store_explicit(&region->active, 1, memory_order_relaxed);
+    atomic_store_explicit(&region->magic, HAL_SHM_MAGIC, memory_order_release);
+
+    g_published = region;
+    snprintf(g_published_name, sizeof(g_published_name), "%s", os_name);
+#ifdef _WIN32
+    g_published_mapping = mapping;
+#endif
+    hal_mutex_unlock(&g_shm_lock);
+
+    HAL_INFO("Snapshot table published as shared memory %s (%u bytes)", os_name,
+             (unsigned)sizeof(hal_shm_region_t));
+    return 0;
+}
+
+void hal_shm_unpublish(void) {
+    if (hal_acq_running()) {
+        HAL_ERROR("Stop acquisition before unpublishing the shared snapshot");
+        return;
+    }
+    hal_mutex_lock(&g_shm_lock);
+    hal_shm_region_t* region = g_published;
+    if (region == NULL) {
+        hal_mutex_unlock(&g_shm_lock);
+        return;
+    }
+    hal_snapshot_bind(NULL);
+    atomic_store_explicit(&region->active, 0, memory_order_release);
+
+#ifdef _WIN32
+    UnmapViewOfFile(region);
+    CloseHandle(g_published_mapping);
+    g_published_mapping = NULL;
+#else
+    munmap(region, sizeof(hal_shm_region_t));
+    shm_unlink(g_published_name);
+#endif
+    g_published = NULL;
+    HAL_INFO("Shared snapshot %s unpublished", g_published_name);
+    g_published_name[0] = '\0';
+    hal_mutex_unlock(&g_shm_lock);
+}
+
+hal_shm_reader_t* hal_shm_open(const char* name) {
+    char os_name[HAL_SHM_NAME_MAX + 8];
+    if (shm_os_name(name, os_name, sizeof(os_name)) != 0) return NULL;
+
+    const hal_shm_region_t* region = NULL;
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, os_name);
+    if (mapping == NULL) return NULL;
+    region = (const hal_shm_region_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(hal_shm_region_t));
+    if (region == NULL) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+#else
+    int fd = shm_open(os_name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hal_shm_region_t)) {
+        close(fd);
+        HAL_WARN("Shared snapshot %s has unexpected size", os_name);
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(hal_shm_region_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    region = (const hal_shm_region_t*)p;
+#endif
+
+    int valid = atomic_load_explicit(&region->magic, memory_order_acquire) == HAL_SHM_MAGIC &&
+                region->version == HAL_SHM_VERSION && region->max_points == HAL_MAX_POINTS &&
+                region->slot_size == sizeof(hal_shm_slot_t);
+
+    hal_shm_reader_t* reader = NULL;
+    if (valid) {
+        hal_mutex_lock(&g_shm_lock);
+        for (int i = 0; i < HAL_SHM_MAX_READERS; i++) {
+            if (!g_readers[i].in_use) {
+                reader = &g_readers[i];
+                reader->in_use = 1;
+                reader->region = region;
+#ifdef _WIN32
+                reader->mapping = mapping;
+#endif
+                break;
+            }
+        }
+        hal_mutex_unlock(&g_shm_lock);
+        if (reader == NULL) HAL_ERROR("Shared snapshot reader table full, cannot open %s", os_name);
+    }
+
+    if (reader == NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(region);
+        CloseHandle(mapping);
+#else
+        munmap((void*)region, sizeof(hal_shm_region_t));
+#endif
+    }
+    return reader;
+}
+
+void hal_shm_close(hal_shm_reader_t* reader) {
+    if (reader == NULL) return;
+    hal_mutex_lock(&g_shm_lock);
+    if (reader->in_use) {
+#ifdef _WIN32
+        UnmapViewOfFile(reader->region);
+        CloseHandle(reader->mapping);
+#else
+        munmap((void*)reader->region, sizeof(hal_shm_region_t));
+#endif
+        memset(reader, 0, sizeof(*reader));
+    }
+    hal_mutex_unlock(&g_shm_lock);
+}
+
+int hal_shm_is_active(hal_shm_reader_t* reader) {
+    if (reader == NULL) return 0;
+    return atomic_load_explicit(&reader->region->active, memory_order_acquire) != 0;
+}
+
+int hal_shm_point_count(hal_shm_reader_t* reader) {
+    if (reader == NULL) return 0;
+    unsigned n = atomic_load_explicit(&reader->region->point_count, memory_order_acquire);
+    return n > HAL_MAX_POINTS ? HAL_MAX_POINTS : (int)n;
+}
+
+int hal_shm_find(hal_shm_reader_t* reader, const char* device, int slave, int reg, int type, float scale) {
+    if (reader == NULL || device == NULL) return -1;
+    const hal_shm_region_t* region = reader->region;
+
+    for (int attempt = 0; attempt < HAL_SHM_READ_RETRIES; attempt++) {
+        unsigned before = atomic_load_explicit(&region->point_seq, memory_order_acquire);
+        if (before & 1) continue;
+
+        int found = -1;
+        int n = hal_shm_point_count(reader);
+        for (int i = 0; i < n && found < 0; i++) {
+            const hal_shm_point_t* p = &region->points[i];
+            if (p->slave == slave && p->reg == reg && p->type == type && p->scale == scale &&
+                strncmp(p->device, device, sizeof(p->device)) == 0) {
+                found = i;
+            }
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&region->point_seq, memory_order_relaxed) == before) return found;
+    }
+    return -1;
+}
+
+int hal_shm_get(hal_shm_reader_t* reader, int handle, hal_sample_t* out) {
+    if (reader == NULL || handle < 0 || handle >= HAL_MAX_POINTS || out == NULL) return -1;
+    return hal_shm_slot_read(&reader->region->slots[handle], out, HAL_SHM_READ_RETRIES);
+}
+
+int hal_shm_read_all(hal_shm_reader_t* reader, hal_batch_t* batch) {
+    if (reader == NULL || batch == NULL || batch->capacity < 0 || !hal_shm_is_active(reader)) return -1;
+
+    int n = hal_shm_point_count(reader);
+    if (n > batch->capacity) n = batch->capacity;
+
+    hal_sample_t sample;
+    for (int i = 0; i < n; i++) {
+        // 寫入端停在寫入途中 (程序在寫入時結束) 的 slot 視為讀取失敗
+        if (hal_shm_slot_read(&reader->region->slots[i], &sample, HAL_SHM_READ_RETRIES) != 0) {
+            memset(&sample, 0, sizeof(sample));
+            sample.quality = HAL_QUALITY_BAD;
+        }
+        if (batch->value) batch->value[i] = sample.value;
+        if (batch->raw) batch->raw[i] = sample.raw;
+        if (batch->quality) batch->quality[i] = sample.quality;
+        if (batch->timestamp_us) batch->timestamp_us[i] = sample.timestamp_us;
+    }
+    return n;
+}
+
+const hal_shm_region_t* hal_shm_region(hal_shm_reader_t* reader) {
+    return reader != NULL ? reader->region : NULL;
+}
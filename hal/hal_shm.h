@@ -0,0 +1,96 @@
+#ifndef HAL_SHM_H
+#define HAL_SHM_H
+
+#include "hal_sched.h"
+#include "hal_snapshot.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+// 共享記憶體快照表
+// 擷取程序 (唯一開啟串口的程序) 以 hal_shm_publish() 把快照表搬進具名的共享記憶體區段
+// (Linux 為 POSIX shm_open + mmap，Windows 為 CreateFileMapping)，之後擷取執行緒直接寫入區段內的 slot。
+// 其他 API 程序以 hal_shm_open() 唯讀映射同一區段，讀取時不經過 socket 或複製到中介緩衝區，
+// 也不會開啟串口或對 PLC 送出任何請求。
+// 每個 slot 與快照表相同使用 seqlock：寫入前後 seq 各加一，讀取端在 seq 為奇數或前後不一致時重讀。
+// 量測點定義表 (device/slave/reg) 也放在區段內，讀取端以 hal_shm_find() 依定義找到 handle。
+
+#define HAL_SHM_DEFAULT_NAME "cdu_hal_snapshot"
+#define HAL_SHM_NAME_MAX 64
+#define HAL_SHM_MAGIC 0x53484C48u    // "HLHS"
+#define HAL_SHM_VERSION 1
+#define HAL_SHM_MAX_READERS 4        // 單一程序同時映射的區段數
+#define HAL_SHM_READ_RETRIES 100000  // 寫入端在寫入途中結束時，讀取端最多重讀的次數
+
+// 量測點定義 (對應 hal_point_register 的參數；SLMP 點的 slave 為裝置代碼，DI 點為 HAL_SCHED_SLAVE_UART_DI)
+typedef struct {
+    char device[64];
+    int32_t slave;
+    int32_t reg;
+    int32_t type;
+    float scale;
+} hal_shm_point_t;
+
+typedef struct {
+    atomic_uint seq;        // 奇數代表寫入進行中
+    uint32_t reserved;
+    hal_sample_t sample;
+} hal_shm_slot_t;
+
+// 區段配置 (版本 HAL_SHM_VERSION)，其他語言可依此直接解析
+typedef struct hal_shm_region {
+    atomic_uint magic;      // 初始化完成後才寫入 HAL_SHM_MAGIC
+    uint32_t version;
+    uint32_t max_points;
+    uint32_t slot_size;     // sizeof(hal_shm_slot_t)
+    atomic_uint active;     // 擷取程序結束發布時清為 0
+    atomic_uint point_seq;  // 量測點定義表的 seqlock
+    atomic_uint point_count;
+    uint32_t publisher_pid;
+    uint64_t created_us;    // 發布時間 (Unix epoch 微秒)
+    hal_shm_point_t points[HAL_MAX_POINTS];
+    hal_shm_slot_t slots[HAL_MAX_POINTS];
+} hal_shm_region_t;
+
+typedef struct hal_shm_reader hal_shm_reader_t;
+
+// ---- 擷取程序 ----
+
+// 建立 (或重新使用) 名為 name 的區段並把目前的快照表與量測點定義搬進去 (name 為 NULL 時使用預設名稱)
+// 必須在背景擷取啟動前呼叫；同一程序只能發布一個區段
+// 成功返回 0，失敗返回 -1
+int hal_shm_publish(const char* name);
+
+// 停止發布 (需先停止背景擷取)：快照表搬回程序內，區段標記為 inactive 並移除名稱
+void hal_shm_unpublish(void);
+
+// ---- 讀取程序 ----
+
+// 唯讀映射名為 name 的區段，擷取程序尚未發布時返回 NULL
+hal_shm_reader_t* hal_shm_open(const char* name);
+
+void hal_shm_close(hal_shm_reader_t* reader);
+
+// 擷取程序是否仍在發布 (已結束發布時應關閉並重新 hal_shm_open)
+int hal_shm_is_active(hal_shm_reader_t* reader);
+
+// 區段內已登錄的量測點數量
+int hal_shm_point_count(hal_shm_reader_t* reader);
+
+// 依定義尋找量測點，返回 handle，找不到返回 -1
+int hal_shm_find(hal_shm_reader_t* reader, const char* device, int slave, int reg, int type, float scale);
+
+// 讀取一個量測點的最新值，成功返回 0，handle 無效或寫入端停在寫入途中返回 -1
+int hal_shm_get(hal_shm_reader_t* reader, int handle, hal_sample_t* out);
+
+// 與 hal_read_all 相同，一次讀取所有量測點
+// 返回寫入的量測點數量，區段已不在發布或參數無效返回 -1
+int hal_shm_read_all(hal_shm_reader_t* reader, hal_batch_t* batch);
+
+// 直接存取映射的區段 (唯讀)
+const hal_shm_region_t* hal_shm_region(hal_shm_reader_t* reader);
+
+// 以 seqlock 讀取一個 slot，retries 為 0 時一直重讀到成功
+// 成功返回 0，超過 retries 次仍不一致返回 -1
+int hal_shm_slot_read(const hal_shm_slot_t* slot, hal_sample_t* out, int retries);
+
+#endif // HAL_SHM_H
@@ -0,0 +1,246 @@
+#include "hal_slmp.h"
+#include "hal_frame.h"
+#include "hal_log.h"
+#include "hal_port.h"
+#include "hal_stats.h"
+#include "hal_tcp.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLMP_CMD_RANDOM_READ 0x0403
+#define SLMP_CMD_BLOCK_READ  0x0406
+#define SLMP_REQ_FIXED 6            // command(2) + subcommand(2) + 兩個點數/區塊數欄位
+#define SLMP_MAX_DEVICE_NUMBER 0xFFFFFF // subcommand 0x0000 的裝置編號為 3 bytes
+#define SLMP_ROUND_FRAMES 8         // 每輪同時送出的 frame 數
+#define SLMP_ARENA_SIZE 16384       // 8 個最大 frame 的請求與回應
+
+// 4E frame 的 MBAP 以外開銷：請求標頭 + timer，回應標頭 (統計位元組數用)
+#define SLMP_REQ_OVERHEAD 15
+#define SLMP_RESP_OVERHEAD 13
+
+typedef struct {
+    const char* name;
+    int code;
+    int hex;        // 編號為 16 進位
+} slmp_device_t;
+
+// 較長的名稱在前，避免 "SD" 被當成 "D"、"ZR" 被當成 "R"
+static const slmp_device_t g_devices[] = {
+    { "ZR", HAL_SLMP_DEV_ZR, 0 },
+    { "SD", HAL_SLMP_DEV_SD, 0 },
+    { "D",  HAL_SLMP_DEV_D,  0 },
+    { "R",  HAL_SLMP_DEV_R,  0 },
+    { "W",  HAL_SLMP_DEV_W,  1 },
+};
+
+// 一個 frame 涵蓋 reads[first .. end) 中狀態為 OK 的區塊
+typedef struct {
+    int first;
+    int end;
+    int blocks;
+    int points;
+    int random;     // 1 表示以 0x0403 逐點讀取，0 表示 0x0406 區塊讀取
+    uint8_t* req;
+    int req_len;
+} slmp_frame_t;
+
+int hal_slmp_is_endpoint(const char* device) {
+    return device != NULL && strncmp(device, HAL_SLMP_PREFIX, strlen(HAL_SLMP_PREFIX)) == 0;
+}
+
+int hal_slmp_parse_device(const char* address, int* code, int* number) {
+    if (address == NULL || code == NULL || number == NULL) return -1;
+
+    for (size_t i = 0; i < sizeof(g_devices) / sizeof(g_devices[0]); i++) {
+        const slmp_device_t* dev = &g_devices[i];
+        size_t len = strlen(dev->name);
+        size_t k = 0;
+        while (k < len && toupper((unsigned char)address[k]) == dev->name[k]) k++;
+        if (k != len) continue;
+
+        const char* digits = address + len;
+        char* end = NULL;
+        long value = strtol(digits, &end, dev->hex ? 16 : 10);
+        if (end == digits || *end != '\0' || value < 0 || value > SLMP_MAX_DEVICE_NUMBER) return -1;
+        *code = dev->code;
+        *number = (int)value;
+        return 0;
+    }
+    return -1;
+}
+
+static void put_le16(uint8_t* p, int v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+// 裝置編號 (3 bytes little-endian) + 裝置代碼
+static void put_device(uint8_t* p, int code, int number) {
+    p[0] = (uint8_t)(number & 0xFF);
+    p[1] = (uint8_t)((number >> 8) & 0xFF);
+    p[2] = (uint8_t)((number >> 16) & 0xFF);
+    p[3] = (uint8_t)code;
+}
+
+static int slmp_build_request(slmp_frame_t* f, const hal_modbus_read_t* reads) {
+    uint8_t* p = f->req;
+    put_le16(p, f->random ? SLMP_CMD_RANDOM_READ : SLMP_CMD_BLOCK_READ);
+    put_le16(p + 2, 0x0000);       // subcommand：word 單位，3-byte 裝置編號
+    if (f->random) {
+        p[4] = (uint8_t)f->points;  // word 存取點數
+        p[5] = 0;                   // double word 存取點數
+    } else {
+        p[4] = (uint8_t)f->blocks;  // word 區塊數
+        p[5] = 0;                   // bit 區塊數
+    }
+
+    int pos = SLMP_REQ_FIXED;
+    for (int i = f->first; i < f->end; i++) {
+        const hal_modbus_read_t* r = &reads[i];
+        if (r->status != HAL_MODBUS_OK) continue;
+        if (f->random) {
+            for (int k = 0; k < r->count; k++) {
+                put_device(p + pos, r->slave, r->reg + k);
+                pos += 4;
+            }
+        } else {
+            put_device(p + pos, r->slave, r->reg);
+            put_le16(p + pos + 4, r->count);
+            pos += 6;
+        }
+    }
+    return pos;
+}
+
+static void slmp_decode_le16(const uint8_t* src, uint16_t* dest, int count) {
+    for (int i = 0; i < count; i++) {
+        dest[i] = (uint16_t)(src[2 * i] | (src[2 * i + 1] << 8));
+    }
+}
+
+// 驗證回應 (end code + 資料) 並依請求順序把 word 分送回各區塊
+static int slmp_check_response(hal_port_t* port, const slmp_frame_t* f, hal_modbus_read_t* reads,
+                               const uint8_t* resp, int resp_len) {
+    if (resp_len < 0) return HAL_MODBUS_ERR_IO;
+    if (resp_len == 0) return HAL_MODBUS_ERR_TIMEOUT;
+    if (resp_len < 2) return HAL_MODBUS_ERR_SHORT;
+
+    int end_code = resp[0] | (resp[1] << 8);
+    if (end_code != 0) {
+        HAL_WARN("SLMP end code %04X from %s (command %04X, %d blocks)", end_code, hal_port_device(port),
+                 f->random ? SLMP_CMD_RANDOM_READ : SLMP_CMD_BLOCK_READ, f->blocks);
+        return HAL_MODBUS_ERR_EXCEPTION;
+    }
+    if (resp_len != 2 + 2 * f->points) {
+        HAL_WARN("Invalid SLMP data length from %s (expected %d bytes, got %d)",
+                 hal_port_device(port), 2 * f->points, resp_len - 2);
+        return HAL_MODBUS_ERR_MISMATCH;
+    }
+
+    const uint8_t* data = resp + 2;
+    for (int i = f->first; i < f->end; i++) {
+        hal_modbus_read_t* r = &reads[i];
+        if (r->status != HAL_MODBUS_OK) continue;
+        slmp_decode_le16(data, r->dest, r->count);
+        data += 2 * r->count;
+    }
+    return HAL_MODBUS_OK;
+}
+
+int hal_slmp_read_blocks(hal_port_t* port, hal_modbus_read_t* reads, int n) {
+    if (port == NULL || reads == NULL || n <= 0) return 0;
+
+    int valid = 0;
+    for (int i = 0; i < n; i++) {
+        hal_modbus_read_t* r = &reads[i];
+        r->status = (r->dest == NULL || r->count < 1 || r->count > HAL_MODBUS_MAX_READ_REGISTERS ||
+                     r->reg < 0 || r->reg + r->count - 1 > SLMP_MAX_DEVICE_NUMBER)
+                        ? HAL_MODBUS_ERR_MISMATCH : HAL_MODBUS_OK;
+        if (r->status == HAL_MODBUS_OK) valid++;
+    }
+    hal_tcp_t* tcp = hal_port_tcp(port);
+    if (!hal_tcp_is_slmp(tcp)) {
+        HAL_ERROR("%s is not an SLMP endpoint", hal_port_device(port));
+        for (int i = 0; i < n; i++) reads[i].status = HAL_MODBUS_ERR_IO;
+        return 0;
+    }
+    if (valid == 0) return 0;
+
+    slmp_frame_t frames[SLMP_ROUND_FRAMES];
+    hal_tcp_xfer_t xfers[SLMP_ROUND_FRAMES];
+    uint64_t storage[SLMP_ARENA_SIZE / sizeof(uint64_t)];
+    hal_frame_arena_t arena;
+    hal_frame_arena_init(&arena, storage, sizeof(storage));
+
+    int ok = 0;
+    int next = 0;
+    while (next < n) {
+        // 依序把區塊裝進 frame，直到區塊數或點數達到上限
+        hal_frame_arena_reset(&arena);
+        int m = 0;
+        while (next < n && m < SLMP_ROUND_FRAMES) {
+            slmp_frame_t* f = &frames[m];
+            f->first = next;
+            f->blocks = 0;
+            f->points = 0;
+            while (next < n) {
+                const hal_modbus_read_t* r = &reads[next];
+                if (r->status == HAL_MODBUS_OK) {
+                    if (f->blocks == HAL_SLMP_MAX_BLOCKS || f->points + r->count > HAL_SLMP_MAX_FRAME_POINTS) break;
+                    f->blocks++;
+                    f->points += r->count;
+                }
+                next++;
+            }
+            f->end = next;
+            if (f->blocks == 0) break;
+
+            // 回應長度相同，選請求較短的命令：random read 每點 4 bytes，區塊讀取每區塊 6 bytes
+            f->random = f->points <= HAL_SLMP_MAX_RANDOM_POINTS && 4 * f->points < 6 * f->blocks;
+            int req_cap = SLMP_REQ_FIXED + (f->random ? 4 * f->points : 6 * f->blocks);
+            int resp_cap = 2 + 2 * f->points;
+            f->req = (uint8_t*)hal_frame_alloc(&arena, (size_t)req_cap);
+            uint8_t* resp = (uint8_t*)hal_frame_alloc(&arena, (size_t)resp_cap);
+            if (f->req == NULL || resp == NULL) {
+                next = f->first;    // arena 已滿，留到下一輪
+                break;
+            }
+            f->req_len = slmp_build_request(f, reads);
+
+            memset(&xfers[m], 0, sizeof(xfers[m]));
+            xfers[m].pdu = f->req;
+            xfers[m].pdu_len = f->req_len;
+            xfers[m].resp = resp;
+            xfers[m].resp_cap = resp_cap;
+            m++;
+        }
+        if (m == 0) break;
+
+        hal_tcp_transact_many(tcp, xfers, m, HAL_PORT_RESPONSE_TIMEOUT_MS);
+
+        for (int k = 0; k < m; k++) {
+            const slmp_frame_t* f = &frames[k];
+            hal_tcp_xfer_t* x = &xfers[k];
+            int status = slmp_check_response(port, f, reads, x->resp, x->resp_len);
+            for (int i = f->first; i < f->end; i++) {
+                if (reads[i].status != HAL_MODBUS_OK) continue;
+                reads[i].status = status;
+                if (status == HAL_MODBUS_OK) ok++;
+            }
+            // 0x0406/0x0403 一個 frame 涵蓋多個裝置，只計入串口項目
+            hal_stats_record(port, -1, status, x->resp_len < 0 ? 0 : SLMP_REQ_OVERHEAD + x->pdu_len,
+                             x->resp_len > 0 ? SLMP_RESP_OVERHEAD + x->resp_len : x->resp_len, &x->timing);
+        }
+    }
+    return ok;
+}
+
+int hal_slmp_read(const char* endpoint, const char* address, int count, uint16_t* dest) {
+    int code, number;
+    if (!hal_slmp_is_endpoint(endpoint) || dest == NULL || hal_slmp_parse_device(address, &code, &number) != 0) {
+        return -1;
+    }
+    hal_modbus_read_t read = { code, number, count, dest, HAL_MODBUS_OK, NULL };
+    return hal_slmp_read_blocks(hal_port_get(endpoint, 0), &read, 1) == 1 ? 0 : -1;
+}
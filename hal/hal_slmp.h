@@ -0,0 +1,44 @@
+#ifndef HAL_SLMP_H
+#define HAL_SLMP_H
+
+#include "hal_modbus.h"
+#include "hal_tcp.h"
+#include <stdint.h>
+
+// 三菱 MC protocol (SLMP) binary 讀取
+// device 名稱為 "slmp://host[:port]" 的端點 (預設 port 5000) 與 Modbus TCP 一樣由 hal_tcp 的連線承載：
+// 一條持續連線，4E frame 依序號配對，多個請求同時在途。
+// 以 hal_point_register_plc() 註冊的 D/R/W 暫存器交給排程器合併成區塊，
+// 每個輪詢批次以一個 multi-block batch read (0x0406) 讀回全部區塊；
+// 區塊大多只有一個 word 時改用 random read (0x0403)，請求較短。
+// 資料欄位為 little-endian，與 Modbus 的大端序相反。
+
+#define HAL_SLMP_PREFIX HAL_TCP_SLMP_PREFIX
+#define HAL_SLMP_MAX_RANDOM_POINTS 192  // 0x0403 一個 frame 的 word 點數上限
+#define HAL_SLMP_MAX_BLOCKS 120         // 0x0406 一個 frame 的區塊上限
+#define HAL_SLMP_MAX_FRAME_POINTS 480   // 一個 frame 合計的 word 點數 (協定上限 960，這裡限制回應長度)
+
+// 裝置代碼 (binary)
+#define HAL_SLMP_DEV_SD 0xA9    // 特殊暫存器
+#define HAL_SLMP_DEV_D  0xA8    // 資料暫存器
+#define HAL_SLMP_DEV_W  0xB4    // 連結暫存器 (編號為 16 進位)
+#define HAL_SLMP_DEV_R  0xAF    // 檔案暫存器
+#define HAL_SLMP_DEV_ZR 0xB0    // 檔案暫存器 (連續存取)
+
+// device 名稱是否為 SLMP 端點
+int hal_slmp_is_endpoint(const char* device);
+
+// 解析裝置位址，例如 "D100"、"R10020"、"W1A"、"ZR5000"、"SD210" (不分大小寫)
+// 成功返回 0 並輸出裝置代碼與編號，無法辨識返回 -1
+int hal_slmp_parse_device(const char* address, int* code, int* number);
+
+// 以最少的 frame 讀取 n 個 word 區塊：reads[i].slave 為裝置代碼，reg 為起始編號，count 為 word 數 (1-125)
+// 各 frame 以 pipelining 同時送出
+// 返回成功的區塊數量，各區塊結果寫入 reads[i].status (hal_modbus_status_t)
+int hal_slmp_read_blocks(struct hal_port* port, hal_modbus_read_t* reads, int n);
+
+// 立即讀取 endpoint 上從 address 開始的 count 個 word (1-125)，供 API 的單次讀取使用
+// 成功返回 0 並寫入 dest，失敗返回 -1
+int hal_slmp_read(const char* endpoint, const char* address, int count, uint16_t* dest);
+
+#endif // HAL_SLMP_H
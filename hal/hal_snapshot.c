@@ -0,0 +1,187 @@
+#include "hal_snapshot.h"
+#include "hal_change.h"
+#include "hal_history.h"
+#include "hal_platform.h"
+#include "hal_sched.h"
+#include "hal_shm.h"
+#include <stdatomic.h>
+#include <string.h>
+
+// 快照表平時位於程序內；hal_shm_publish() 後 g_table 改指向共享記憶體區段，
+// 寫入路徑與讀取路徑不變，只是寫入的位置換成其他程序也能映射的記憶體
+static hal_shm_region_t g_local;
+static hal_shm_region_t* g_table = &g_local;
+
+// 最後一次成功讀取的單調時鐘，與快照在同一個 seq 區段內寫入；不放在共享記憶體中
+static uint64_t g_sample_mono_us[HAL_MAX_POINTS];
+
+// seq 為奇數代表寫入進行中；讀取端在 seq 前後不一致時重讀
+static unsigned seq_write_begin(atomic_uint* seq) {
+    unsigned v = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, v + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return v + 1;
+}
+
+static void seq_write_end(atomic_uint* seq, unsigned v) {
+    atomic_store_explicit(seq, v + 1, memory_order_release);
+}
+
+int hal_shm_slot_read(const hal_shm_slot_t* slot, hal_sample_t* out, int retries) {
+    unsigned before, after;
+    for (int attempt = 0; retries == 0 || attempt < retries; attempt++) {
+        before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before & 1) continue;
+        memcpy(out, &slot->sample, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        if (before == after) return 0;
+    }
+    return -1;
+}
+
+int hal_get_snapshot(int handle, hal_sample_t* out) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS || out == NULL) return -1;
+    hal_shm_slot_read(&g_table->slots[handle], out, 0);
+    return 0;
+}
+
+int hal_snapshot_read(int handle, hal_sample_t* out, uint64_t* mono_us) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS || out == NULL || mono_us == NULL) return -1;
+    const hal_shm_slot_t* slot = &g_table->slots[handle];
+    for (;;) {
+        unsigned before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before & 1) continue;
+        memcpy(out, &slot->sample, sizeof(*out));
+        *mono_us = g_sample_mono_us[handle];
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == before) return 0;
+    }
+}
+
+int hal_read_all(hal_batch_t* batch) {
+    if (batch == NULL || batch->capacity < 0) return -1;
+
+    int n = hal_point_count();
+    if (n > batch->capacity) n = batch->capacity;
+
+    hal_sample_t sample;
+    for (int i = 0; i < n; i++) {
+        hal_shm_slot_read(&g_table->slots[i], &sample, 0);
+        if (batch->value) batch->value[i] = sample.value;
+        if (batch->raw) batch->raw[i] = sample.raw;
+        if (batch->quality) batch->quality[i] = sample.quality;
+        if (batch->timestamp_us) batch->timestamp_us[i] = sample.timestamp_us;
+    }
+    return n;
+}
+
+void hal_snapshot_publish(int handle, float value, uint32_t raw, uint64_t timestamp_us) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS) return;
+
+    uint64_t mono_us = hal_time_us();
+    hal_shm_slot_t* slot = &g_table->slots[handle];
+    unsigned seq = seq_write_begin(&slot->seq);
+    slot->sample.value = value;
+    slot->sample.raw = raw;
+    slot->sample.quality = HAL_QUALITY_GOOD;
+    slot->sample.error_count = 0;
+    slot->sample.timestamp_us = timestamp_us;
+    g_sample_mono_us[handle] = mono_us;
+    seq_write_end(&slot->seq, seq);
+
+    hal_change_sample(handle, HAL_QUALITY_GOOD, value, raw, timestamp_us);
+    hal_history_sample(handle, HAL_QUALITY_GOOD, value, mono_us);
+}
+
+void hal_snapshot_mark_bad(int handle) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS) return;
+
+    hal_shm_slot_t* slot = &g_table->slots[handle];
+    unsigned seq = seq_write_begin(&slot->seq);
+    slot->sample.quality = HAL_QUALITY_BAD;
+    slot->sample.error_count++;
+    hal_sample_t last = slot->sample;
+    seq_write_end(&slot->seq, seq);
+
+    hal_change_sample(handle, HAL_QUALITY_BAD, last.value, last.raw, last.timestamp_us);
+    // 快照保留最後一次成功的時間，歷史紀錄則記下失敗發生的時間
+    hal_history_sample(handle, HAL_QUALITY_BAD, last.value, hal_time_us());
+}
+
+void hal_snapshot_describe(int handle, const char* device, int slave, int reg, int type, float scale) {
+    if (handle < 0 || handle >= HAL_MAX_POINTS || device == NULL) return;
+
+    unsigned seq = seq_write_begin(&g_table->point_seq);
+    hal_shm_point_t* p = &g_table->points[handle];
+    memset(p, 0, sizeof(*p));
+    strncpy(p->device, device, sizeof(p->device) - 1);
+    p->slave = slave;
+    p->reg = reg;
+    p->type = type;
+    p->scale = scale;
+    if ((unsigned)handle >= atomic_load_explicit(&g_table->point_count, memory_order_relaxed)) {
+        atomic_store_explicit(&g_table->point_count, (unsigned)handle + 1, memory_order_relaxed);
+    }
+    seq_write_end(&g_table->point_seq, seq);
+}
+
+static uint32_t fnv1a(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+uint32_t hal_snapshot_layout_hash(int count) {
+    if (count > HAL_MAX_POINTS) count = HAL_MAX_POINTS;
+    uint32_t h;
+    unsigned before, after;
+    do {
+        before = atomic_load_explicit(&g_table->point_seq, memory_order_acquire);
+        h = 2166136261u;
+        for (int i = 0; i < count; i++) {
+            const hal_shm_point_t* p = &g_table->points[i];
+            h = fnv1a(h, p->device, strlen(p->device));
+            h = fnv1a(h, &p->slave, sizeof(p->slave));
+            h = fnv1a(h, &p->reg, sizeof(p->reg));
+            h = fnv1a(h, &p->type, sizeof(p->type));
+            h = fnv1a(h, &p->scale, sizeof(p->scale));
+        }
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&g_table->point_seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return h;
+}
+
+void hal_snapshot_reset(void) {
+    unsigned pseq = seq_write_begin(&g_table->point_seq);
+    atomic_store_explicit(&g_table->point_count, 0, memory_order_relaxed);
+    memset(g_table->points, 0, sizeof(g_table->points));
+    seq_write_end(&g_table->point_seq, pseq);
+
+    for (int i = 0; i < HAL_MAX_POINTS; i++) {
+        hal_shm_slot_t* slot = &g_table->slots[i];
+        unsigned seq = seq_write_begin(&slot->seq);
+        memset(&slot->sample, 0, sizeof(slot->sample));
+        g_sample_mono_us[i] = 0;
+        seq_write_end(&slot->seq, seq);
+    }
+    hal_change_reset();
+    hal_history_reset();
+}
+
+// 把目前的量測點定義與讀數複製到 table 後切換寫入位置 (table 為 NULL 時切回程序內)
+// 呼叫端保證此時沒有擷取執行緒在寫入
+void hal_snapshot_bind(struct hal_shm_region* table) {
+    hal_shm_region_t* next = table != NULL ? table : &g_local;
+    if (next == g_table) return;
+
+    memcpy(next->points, g_table->points, sizeof(next->points));
+    for (int i = 0; i < HAL_MAX_POINTS; i++) {
+        next->slots[i].sample = g_table->slots[i].sample;
+    }
+    atomic_store_explicit(&next->point_count,
+                          atomic_load_explicit(&g_table->point_count, memory_order_relaxed), memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    g_table = next;
+}
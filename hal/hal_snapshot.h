@@ -0,0 +1,67 @@
+#ifndef HAL_SNAPSHOT_H
+#define HAL_SNAPSHOT_H
+
+#include <stdint.h>
+
+// 量測點最新值快照表
+// 每個量測點只有一個寫入者 (負責該串口的擷取執行緒)，
+// 讀取端以 seqlock 無鎖讀取，不會被匯流排 I/O 阻塞。
+
+// 資料品質
+#define HAL_QUALITY_NONE 0  // 尚未輪詢過
+#define HAL_QUALITY_GOOD 1  // 最近一次讀取成功
+#define HAL_QUALITY_BAD  2  // 最近一次讀取失敗，value 保留最後一次有效值
+
+typedef struct {
+    float value;            // 工程值
+    uint32_t raw;           // 原始暫存器內容 (32 位元型態為高位 word 在前)
+    uint32_t quality;       // HAL_QUALITY_*
+    uint32_t error_count;   // 連續失敗次數
+    uint64_t timestamp_us;  // 最後一次成功讀取的時間 (Unix epoch 微秒)
+} hal_sample_t;
+
+// 非阻塞讀取量測點的最新值 (handle 來自 hal_point_register)
+// 成功返回 0，handle 無效返回 -1
+int hal_get_snapshot(int handle, hal_sample_t* out);
+
+// 呼叫者預先配置的 struct-of-arrays 緩衝區，第 i 個元素對應 handle i
+// 不需要的欄位可設為 NULL
+typedef struct {
+    int capacity;           // 各陣列的元素數量
+    float* value;
+    uint32_t* raw;
+    uint32_t* quality;      // HAL_QUALITY_*
+    uint64_t* timestamp_us;
+} hal_batch_t;
+
+// 一次讀取所有已註冊量測點的最新值 (不配置記憶體、不會阻塞)
+// 返回寫入的量測點數量 (已註冊數量與 capacity 取小者)，參數無效返回 -1
+int hal_read_all(hal_batch_t* batch);
+
+// ---- 以下由 HAL 內部使用 ----
+
+// 與 hal_get_snapshot 相同，另外以 mono_us 返回最後一次成功讀取的單調時鐘 (hal_time_us，尚未讀取為 0)
+// 只在寫入端所在的程序內有效 (hal_ctrl 判斷取樣新舊與計算微分用，不受系統時間調整影響)
+int hal_snapshot_read(int handle, hal_sample_t* out, uint64_t* mono_us);
+
+
+// 寫入一筆成功的讀數
+void hal_snapshot_publish(int handle, float value, uint32_t raw, uint64_t timestamp_us);
+
+// 標記讀取失敗，保留最後一次有效值
+void hal_snapshot_mark_bad(int handle);
+
+// 清空所有量測點的快照與定義
+void hal_snapshot_reset(void);
+
+// 記錄量測點定義，供共享記憶體的讀取端尋找 handle (hal_shm.h)
+void hal_snapshot_describe(int handle, const char* device, int slave, int reg, int type, float scale);
+
+// 量測點定義 handle 0 .. count-1 的 FNV-1a 雜湊 (hal_telemetry 用來確認兩個節點的 handle 對應相同)
+uint32_t hal_snapshot_layout_hash(int count);
+
+// 把快照表搬到 table (共享記憶體區段) 或搬回程序內 (NULL)，由 hal_shm 使用
+struct hal_shm_region;
+void hal_snapshot_bind(struct hal_shm_region* table);
+
+#endif // HAL_SNAPSHOT_H
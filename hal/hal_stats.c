@@ -0,0 +1,188 @@
+#include "hal_stats.h"
+#include "hal_log.h"
+#include "hal_modbus.h"
+#include "hal_platform.h"
+#include <string.h>
+
+#define SUB_COUNT (1 << HAL_STATS_SUB_BITS)
+#define LINEAR_LIMIT (2 * SUB_COUNT) // 小於此值的延遲每微秒一格
+
+typedef struct {
+    uint32_t counts[HAL_STATS_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+    uint32_t min_us;
+    uint32_t max_us;
+} stats_hist_t;
+
+typedef struct {
+    hal_port_t* port;
+    int slave;              // -1 表示串口整體
+    uint64_t requests;
+    uint64_t responses;
+    uint64_t timeouts;
+    uint64_t crc_errors;
+    uint64_t exceptions;
+    uint64_t other_errors;
+    uint64_t bytes_out;
+    uint64_t bytes_in;
+    stats_hist_t hist[HAL_STATS_LAT_KINDS];
+} stats_entry_t;
+
+static stats_entry_t g_entries[HAL_STATS_MAX_ENTRIES];
+static int g_entry_count = 0;
+static int g_full_warned = 0;
+static hal_mutex_t g_stats_lock = HAL_MUTEX_INIT;
+
+static int highest_bit(uint32_t v) {
+    int bit = 0;
+    while (v >>= 1) bit++;
+    return bit;
+}
+
+// log-linear 分格：先依最高位元決定 2 的次方區間，再取其下 SUB_BITS 位元決定區間內的格
+static int stats_bucket(uint32_t us) {
+    if (us > HAL_STATS_MAX_US) us = HAL_STATS_MAX_US;
+    if (us < LINEAR_LIMIT) return (int)us;
+    int exp = highest_bit(us);
+    int sub = (int)(us >> (exp - HAL_STATS_SUB_BITS)) - SUB_COUNT;
+    return LINEAR_LIMIT + (exp - HAL_STATS_SUB_BITS - 1) * SUB_COUNT + sub;
+}
+
+static uint32_t stats_bucket_upper(int bucket) {
+    if (bucket < LINEAR_LIMIT) return (uint32_t)bucket;
+    int exp = (bucket - LINEAR_LIMIT) / SUB_COUNT + HAL_STATS_SUB_BITS + 1;
+    int sub = (bucket - LINEAR_LIMIT) % SUB_COUNT;
+    uint32_t width = 1u << (exp - HAL_STATS_SUB_BITS);
+    return (uint32_t)(SUB_COUNT + sub) * width + width - 1;
+}
+
+static void hist_record(stats_hist_t* h, uint32_t us) {
+    h->counts[stats_bucket(us)]++;
+    if (h->count == 0 || us < h->min_us) h->min_us = us;
+    if (us > h->max_us) h->max_us = us;
+    h->count++;
+    h->sum_us += us;
+}
+
+// 第 permille/1000 個百分位數，以所在格的上界表示 (不超過實際最大值)
+static uint32_t hist_percentile(const stats_hist_t* h, int permille) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (h->count * (uint64_t)permille + 999) / 1000;
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HAL_STATS_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank) {
+            uint32_t upper = stats_bucket_upper(b);
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+static void hist_summary(const stats_hist_t* h, hal_latency_summary_t* out) {
+    out->count = h->count;
+    out->sum_us = h->sum_us;
+    out->min_us = h->min_us;
+    out->max_us = h->max_us;
+    out->p50_us = hist_percentile(h, 500);
+    out->p90_us = hist_percentile(h, 900);
+    out->p99_us = hist_percentile(h, 990);
+    out->p999_us = hist_percentile(h, 999);
+}
+
+// 找到或建立項目 (呼叫者需持有 g_stats_lock)，表已滿時返回 NULL
+static stats_entry_t* stats_entry(hal_port_t* port, int slave) {
+    for (int i = 0; i < g_entry_count; i++) {
+        if (g_entries[i].port == port && g_entries[i].slave == slave) return &g_entries[i];
+    }
+    if (g_entry_count >= HAL_STATS_MAX_ENTRIES) {
+        if (!g_full_warned) {
+            HAL_WARN("Statistics table full, %s slave %d not tracked", hal_port_device(port), slave);
+            g_full_warned = 1;
+        }
+        return NULL;
+    }
+    stats_entry_t* entry = &g_entries[g_entry_count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->port = port;
+    entry->slave = slave;
+    return entry;
+}
+
+static void entry_record(stats_entry_t* entry, int status, int bytes_out, int bytes_in,
+                         const hal_port_timing_t* timing) {
+    entry->requests++;
+    switch (status) {
+        case HAL_MODBUS_OK:            entry->responses++; break;
+        case HAL_MODBUS_ERR_TIMEOUT:   entry->timeouts++; break;
+        case HAL_MODBUS_ERR_CRC:       entry->crc_errors++; break;
+        case HAL_MODBUS_ERR_EXCEPTION: entry->exceptions++; break;
+        default:                       entry->other_errors++; break;
+    }
+    if (bytes_out > 0) entry->bytes_out += (uint64_t)bytes_out;
+    if (bytes_in > 0) entry->bytes_in += (uint64_t)bytes_in;
+
+    if (timing == NULL || bytes_out <= 0) return;
+    hist_record(&entry->hist[HAL_STATS_LAT_WRITE], timing->write_us);
+    if (bytes_in > 0) {
+        hist_record(&entry->hist[HAL_STATS_LAT_FIRST_BYTE], timing->first_byte_us);
+        hist_record(&entry->hist[HAL_STATS_LAT_FRAME], timing->frame_us);
+    }
+}
+
+void hal_stats_record(hal_port_t* port, int slave, int status,
+                      int bytes_out, int bytes_in, const hal_port_timing_t* timing) {
+    if (port == NULL) return;
+
+    hal_mutex_lock(&g_stats_lock);
+    stats_entry_t* port_entry = stats_entry(port, -1);
+    if (port_entry) entry_record(port_entry, status, bytes_out, bytes_in, timing);
+    stats_entry_t* slave_entry = slave >= 0 ? stats_entry(port, slave) : NULL;
+    if (slave_entry) entry_record(slave_entry, status, bytes_out, bytes_in, timing);
+    hal_mutex_unlock(&g_stats_lock);
+}
+
+static void entry_export(const stats_entry_t* entry, hal_stats_t* out) {
+    memset(out, 0, sizeof(*out));
+    strncpy(out->device, hal_port_device(entry->port), sizeof(out->device) - 1);
+    out->slave = entry->slave;
+    out->requests = entry->requests;
+    out->responses = entry->responses;
+    out->timeouts = entry->timeouts;
+    out->crc_errors = entry->crc_errors;
+    out->exceptions = entry->exceptions;
+    out->other_errors = entry->other_errors;
+    out->bytes_out = entry->bytes_out;
+    out->bytes_in = entry->bytes_in;
+    for (int k = 0; k < HAL_STATS_LAT_KINDS; k++) {
+        hist_summary(&entry->hist[k], &out->latency[k]);
+    }
+}
+
+int hal_get_stats(hal_stats_t* out, int max) {
+    if (out == NULL || max <= 0) return 0;
+
+    hal_mutex_lock(&g_stats_lock);
+    int n = 0;
+    // 串口項目在前，其後依序為該串口的 slave 項目
+    for (int i = 0; i < g_entry_count && n < max; i++) {
+        if (g_entries[i].slave != -1) continue;
+        entry_export(&g_entries[i], &out[n++]);
+        for (int j = 0; j < g_entry_count && n < max; j++) {
+            if (g_entries[j].port == g_entries[i].port && g_entries[j].slave != -1) {
+                entry_export(&g_entries[j], &out[n++]);
+            }
+        }
+    }
+    hal_mutex_unlock(&g_stats_lock);
+    return n;
+}
+
+void hal_stats_reset(void) {
+    hal_mutex_lock(&g_stats_lock);
+    g_entry_count = 0;
+    g_full_warned = 0;
+    hal_mutex_unlock(&g_stats_lock);
+}
@@ -0,0 +1,63 @@
+#ifndef HAL_STATS_H
+#define HAL_STATS_H
+
+#include "hal_port.h"
+#include <stdint.h>
+
+// 匯流排統計：每個串口與每個 (串口, slave) 各自累計交易計數，
+// 並以 HDR 風格的 log-linear 直方圖記錄寫入、第一個位元組與整個 frame 的延遲。
+// 直方圖在每個 2 的次方區間內分成 8 格，任何延遲值的相對誤差都在 12.5% 以內，
+// 記錄只是一次陣列遞增，不需要保留原始樣本。
+
+#define HAL_STATS_MAX_ENTRIES 64    // 串口與 slave 項目總數上限
+#define HAL_STATS_SUB_BITS 3        // 每個 2 的次方區間分成 2^3 格
+#define HAL_STATS_MAX_US 0xFFFFFF   // 延遲上限約 16.7 秒，超過者計入最後一格
+#define HAL_STATS_BUCKETS ((2 << HAL_STATS_SUB_BITS) + (24 - HAL_STATS_SUB_BITS - 1) * (1 << HAL_STATS_SUB_BITS))
+
+// 延遲種類
+#define HAL_STATS_LAT_WRITE      0  // 發送請求所需時間
+#define HAL_STATS_LAT_FIRST_BYTE 1  // 請求送出後到第一個回應位元組
+#define HAL_STATS_LAT_FRAME      2  // 請求送出後到整個回應 frame 收完
+#define HAL_STATS_LAT_KINDS      3
+
+// 一種延遲的摘要 (微秒)，百分位數為所在直方圖格的上界
+typedef struct {
+    uint64_t count;
+    uint64_t sum_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t p50_us;
+    uint32_t p90_us;
+    uint32_t p99_us;
+    uint32_t p999_us;
+} hal_latency_summary_t;
+
+// 一個串口 (slave 為 -1) 或一個 slave 的統計
+typedef struct {
+    char device[64];
+    int32_t slave;
+    uint64_t requests;
+    uint64_t responses;     // 通過驗證的回應
+    uint64_t timeouts;
+    uint64_t crc_errors;
+    uint64_t exceptions;
+    uint64_t other_errors;  // 不完整、位址/功能碼不符、長度錯誤與 I/O 錯誤
+    uint64_t bytes_out;
+    uint64_t bytes_in;
+    hal_latency_summary_t latency[HAL_STATS_LAT_KINDS];
+} hal_stats_t;
+
+// 記錄一次交易 (status 為 hal_modbus_status_t)，同時計入串口與 slave 項目
+// slave 為負時 (例如 UART DI/DO 板，沒有 slave 位址) 只計入串口項目
+// timing 可為 NULL (例如串口無法開啟，沒有送出任何位元組)
+void hal_stats_record(hal_port_t* port, int slave, int status,
+                      int bytes_out, int bytes_in, const hal_port_timing_t* timing);
+
+// 複製最多 max 筆統計到 out，返回實際筆數
+// 每個串口的項目排在它所屬的 slave 項目之前
+int hal_get_stats(hal_stats_t* out, int max);
+
+// 清除所有統計
+void hal_stats_reset(void);
+
+#endif // HAL_STATS_H
@@ -0,0 +1,526 @@
+#ifdef _WIN32
+// WSAPoll 需要 Vista 以上的 API；winsock2.h 必須在 windows.h (由 hal_platform.h 引入) 之前
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+
+#include "hal_tcp.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+typedef SOCKET sock_t;
+#define SOCK_INVALID INVALID_SOCKET
+#define sock_close closesocket
+#define sock_poll WSAPoll
+#define sock_error() WSAGetLastError()
+#define SOCK_WOULDBLOCK(e) ((e) == WSAEWOULDBLOCK)
+#define SOCK_INPROGRESS(e) ((e) == WSAEWOULDBLOCK)
+#define SOCK_SEND_FLAGS 0
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int sock_t;
+#define SOCK_INVALID (-1)
+#define sock_close close
+#define sock_poll poll
+#define sock_error() errno
+#define SOCK_WOULDBLOCK(e) ((e) == EAGAIN || (e) == EWOULDBLOCK)
+#define SOCK_INPROGRESS(e) ((e) == EINPROGRESS)
+#define SOCK_SEND_FLAGS MSG_NOSIGNAL // 對方關閉連線時不要產生 SIGPIPE
+#endif
+
+#define MBAP_HEADER_LEN 7                       // tid(2) + protocol(2) + length(2) + unit(1)
+#define TCP_RX_BUF (HAL_TCP_MAX_INFLIGHT * (MBAP_HEADER_LEN + HAL_TCP_MAX_PDU)) // 也足以容納最大的 SLMP 回應
+
+// SLMP 4E binary：subheader(2) + serial(2) + 0000(2) + network(1) + PC(1) + I/O(2) + station(1) + length(2)
+// 請求在 length 之後是 monitoring timer(2)，length 由 timer 算起；回應的 length 由 end code 算起
+#define SLMP_HEADER_LEN 13
+#define SLMP_TIMER_LEN 2
+#define TCP_TX_BUF (SLMP_HEADER_LEN + SLMP_TIMER_LEN + HAL_TCP_SLMP_MAX_DATA)
+
+// 交易狀態
+#define XFER_PENDING  0
+#define XFER_INFLIGHT 1
+#define XFER_DONE     2
+
+struct hal_tcp {
+    int in_use;
+    char host[64];
+    char service[8];
+    sock_t sock;
+    int slmp;                   // 1 表示以 SLMP 4E frame 傳送
+    uint16_t next_tid;          // MBAP transaction ID 或 SLMP 序號
+    uint64_t last_connect_attempt_us;
+    uint8_t rx[TCP_RX_BUF];     // 尚未配對的接收資料 (可能包含前一批超時交易的遲到回應)
+    int rx_len;
+    hal_mutex_t lock;           // 交易期間獨佔連線
+};
+
+static hal_tcp_t g_conns[HAL_MAX_PORTS];
+static hal_mutex_t g_conns_lock = HAL_MUTEX_INIT;
+
+static int sock_startup(void) {
+#ifdef _WIN32
+    static atomic_int started = 0;
+    if (atomic_load(&started)) return 0;
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        HAL_ERROR("WSAStartup failed");
+        return -1;
+    }
+    atomic_store(&started, 1);
+#endif
+    return 0;
+}
+
+static int sock_set_nonblocking(sock_t s) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0 ? 0 : -1;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return (flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0) ? 0 : -1;
+#endif
+}
+
+static int is_slmp_endpoint(const char* device) {
+    return device != NULL && strncmp(device, HAL_TCP_SLMP_PREFIX, strlen(HAL_TCP_SLMP_PREFIX)) == 0;
+}
+
+int hal_tcp_is_endpoint(const char* device) {
+    return device != NULL && (strncmp(device, HAL_TCP_PREFIX, strlen(HAL_TCP_PREFIX)) == 0 ||
+                              is_slmp_endpoint(device));
+}
+
+static const char* tcp_proto_name(const hal_tcp_t* tcp) {
+    return tcp->slmp ? "SLMP" : "Modbus TCP";
+}
+
+// 單一交易請求的長度上限
+static int tcp_max_pdu(const hal_tcp_t* tcp) {
+    return tcp->slmp ? HAL_TCP_SLMP_MAX_DATA : HAL_TCP_MAX_PDU;
+}
+
+// 關閉 socket，保留連線項目以便重新連線 (呼叫者需持有 tcp->lock)
+static void tcp_disconnect(hal_tcp_t* tcp) {
+    if (tcp->sock != SOCK_INVALID) {
+        sock_close(tcp->sock);
+        tcp->sock = SOCK_INVALID;
+    }
+    tcp->rx_len = 0;
+}
+
+// 非阻塞連線，最多等待 HAL_TCP_CONNECT_TIMEOUT_MS (呼叫者需持有 tcp->lock)
+static int tcp_connect(hal_tcp_t* tcp) {
+    tcp->last_connect_attempt_us = hal_time_us();
+    if (sock_startup() != 0) return -1;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = NULL;
+    if (getaddrinfo(tcp->host, tcp->service, &hints, &res) != 0 || res == NULL) {
+        HAL_ERROR("Failed to resolve %s host %s", tcp_proto_name(tcp), tcp->host);
+        return -1;
+    }
+
+    sock_t s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (s == SOCK_INVALID || sock_set_nonblocking(s) != 0) {
+        HAL_ERROR("Failed to create socket for %s:%s, error: %d", tcp->host, tcp->service, sock_error());
+        if (s != SOCK_INVALID) sock_close(s);
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    // 每個請求都是小封包，關閉 Nagle 避免 pipelining 時被延遲合併
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+
+    int rc = connect(s, res->ai_addr, (int)res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc != 0) {
+        int err = sock_error();
+        if (!SOCK_INPROGRESS(err)) {
+            HAL_ERROR("Failed to connect to %s:%s, error: %d", tcp->host, tcp->service, err);
+            sock_close(s);
+            return -1;
+        }
+        struct pollfd pfd = { s, POLLOUT, 0 };
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        if (sock_poll(&pfd, 1, HAL_TCP_CONNECT_TIMEOUT_MS) <= 0 ||
+            getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&so_error, &len) != 0 || so_error != 0) {
+            HAL_ERROR("Failed to connect to %s:%s (timeout or refused, error: %d)",
+                      tcp->host, tcp->service, so_error);
+            sock_close(s);
+            return -1;
+        }
+    }
+
+    tcp->sock = s;
+    tcp->rx_len = 0;
+    HAL_INFO("Connected to %s %s:%s", tcp_proto_name(tcp), tcp->host, tcp->service);
+    return 0;
+}
+
+// 連線中斷時重新連線，距離上次嘗試太近則直接失敗
+static int tcp_ensure_connected(hal_tcp_t* tcp) {
+    if (tcp->sock != SOCK_INVALID) return 0;
+    if (hal_time_us() - tcp->last_connect_attempt_us < (uint64_t)HAL_PORT_REOPEN_INTERVAL_MS * 1000) return -1;
+    HAL_INFO("Reconnecting %s %s:%s", tcp_proto_name(tcp), tcp->host, tcp->service);
+    return tcp_connect(tcp);
+}
+
+hal_tcp_t* hal_tcp_open(const char* endpoint) {
+    if (endpoint == NULL) return NULL;
+    int slmp = is_slmp_endpoint(endpoint);
+    if (slmp) {
+        endpoint += strlen(HAL_TCP_SLMP_PREFIX);
+    } else if (hal_tcp_is_endpoint(endpoint)) {
+        endpoint += strlen(HAL_TCP_PREFIX);
+    }
+
+    hal_mutex_lock(&g_conns_lock);
+    hal_tcp_t* tcp = NULL;
+    for (int i = 0; i < HAL_MAX_PORTS; i++) {
+        if (!g_conns[i].in_use) {
+            tcp = &g_conns[i];
+            break;
+        }
+    }
+    if (tcp == NULL) {
+        hal_mutex_unlock(&g_conns_lock);
+        HAL_ERROR("TCP connection table full, cannot open %s", endpoint);
+        return NULL;
+    }
+
+    // "host:port"，沒有 port 時使用 502 (SLMP 為 5000)；IPv6 位址需寫成 "[addr]:port"
+    memset(tcp->host, 0, sizeof(tcp->host));
+    snprintf(tcp->service, sizeof(tcp->service), "%d", slmp ? HAL_TCP_SLMP_DEFAULT_PORT : HAL_TCP_DEFAULT_PORT);
+    const char* host = endpoint;
+    size_t host_len = strlen(endpoint);
+    const char* colon = strrchr(endpoint, ':');
+    if (endpoint[0] == '[') {
+        const char* close = strchr(endpoint, ']');
+        if (close != NULL) {
+            host = endpoint + 1;
+            host_len = (size_t)(close - host);
+            colon = close[1] == ':' ? close + 1 : NULL;
+        }
+    } else if (colon != NULL) {
+        host_len = (size_t)(colon - endpoint);
+    }
+    if (host_len >= sizeof(tcp->host)) host_len = sizeof(tcp->host) - 1;
+    memcpy(tcp->host, host, host_len);
+    if (colon != NULL && colon[1] != '\0') snprintf(tcp->service, sizeof(tcp->service), "%s", colon + 1);
+
+    tcp->sock = SOCK_INVALID;
+    tcp->slmp = slmp;
+    tcp->next_tid = 1;
+    tcp->rx_len = 0;
+    tcp->last_connect_attempt_us = 0;
+    tcp->in_use = 1;
+
+    // 項目已保留，連線只持有 tcp->lock，不阻塞其他連線的開啟與關閉
+    hal_mutex_lock(&tcp->lock);
+    hal_mutex_unlock(&g_conns_lock);
+    tcp_connect(tcp);
+    hal_mutex_unlock(&tcp->lock);
+    return tcp;
+}
+
+void hal_tcp_close(hal_tcp_t* tcp) {
+    if (tcp == NULL) return;
+    hal_mutex_lock(&g_conns_lock);
+    hal_mutex_lock(&tcp->lock);
+    if (tcp->sock != SOCK_INVALID) {
+        HAL_INFO("Closing %s %s:%s", tcp_proto_name(tcp), tcp->host, tcp->service);
+    }
+    tcp_disconnect(tcp);
+    tcp->in_use = 0;
+    hal_mutex_unlock(&tcp->lock);
+    hal_mutex_unlock(&g_conns_lock);
+}
+
+int hal_tcp_is_open(hal_tcp_t* tcp) {
+    return tcp != NULL && tcp->sock != SOCK_INVALID;
+}
+
+int hal_tcp_is_slmp(hal_tcp_t* tcp) {
+    return tcp != NULL && tcp->slmp;
+}
+
+// 送出完整的 ADU；socket 傳送緩衝區滿時以 poll 等待，最多 1000ms
+static int tcp_send_all(hal_tcp_t* tcp, const uint8_t* buf, int len) {
+    int sent = 0;
+    while (sent < len) {
+        int n = (int)send(tcp->sock, (const char*)buf + sent, len - sent, SOCK_SEND_FLAGS);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        int err = sock_error();
+        if (n < 0 && SOCK_WOULDBLOCK(err)) {
+            struct pollfd pfd = { tcp->sock, POLLOUT, 0 };
+            if (sock_poll(&pfd, 1, 1000) > 0) continue;
+        }
+        HAL_ERROR("Failed to send to %s %s:%s, error: %d", tcp_proto_name(tcp), tcp->host, tcp->service, err);
+        return -1;
+    }
+    return 0;
+}
+
+// MBAP 標頭 + unit + PDU
+static int mbap_encode(hal_tcp_xfer_t* x, uint8_t* adu) {
+    int len = x->pdu_len + 1; // unit + PDU
+
+    adu[0] = (uint8_t)(x->tid >> 8);
+    adu[1] = (uint8_t)(x->tid & 0xFF);
+    adu[2] = 0;                     // protocol identifier (Modbus)
+    adu[3] = 0;
+    adu[4] = (uint8_t)(len >> 8);
+    adu[5] = (uint8_t)(len & 0xFF);
+    adu[6] = (uint8_t)x->unit;
+    memcpy(adu + MBAP_HEADER_LEN, x->pdu, (size_t)x->pdu_len);
+    return MBAP_HEADER_LEN + x->pdu_len;
+}
+
+// SLMP 4E 請求：存取直接連接的本站 (network 0、PC 0xFF、I/O 0x03FF、station 0)，欄位皆為 little-endian
+// monitoring timer 以 250ms 為單位，讓 PLC 在我們放棄等待之前回應逾時錯誤
+static int slmp_encode(hal_tcp_xfer_t* x, uint8_t* adu, int timeout_ms) {
+    int len = SLMP_TIMER_LEN + x->pdu_len;
+    int timer = (timeout_ms + 249) / 250;
+
+    adu[0] = 0x54;                  // subheader (4E 請求)
+    adu[1] = 0x00;
+    adu[2] = (uint8_t)(x->tid & 0xFF);
+    adu[3] = (uint8_t)(x->tid >> 8);
+    adu[4] = 0x00;
+    adu[5] = 0x00;
+    adu[6] = 0x00;                  // network No.
+    adu[7] = 0xFF;                  // PC No.
+    adu[8] = 0xFF;                  // request destination module I/O No. (0x03FF)
+    adu[9] = 0x03;
+    adu[10] = 0x00;                 // request destination module station No.
+    adu[11] = (uint8_t)(len & 0xFF);
+    adu[12] = (uint8_t)(len >> 8);
+    adu[13] = (uint8_t)(timer & 0xFF);
+    adu[14] = (uint8_t)(timer >> 8);
+    memcpy(adu + SLMP_HEADER_LEN + SLMP_TIMER_LEN, x->pdu, (size_t)x->pdu_len);
+    return SLMP_HEADER_LEN + SLMP_TIMER_LEN + x->pdu_len;
+}
+
+static int tcp_send_xfer(hal_tcp_t* tcp, hal_tcp_xfer_t* x, int timeout_ms) {
+    uint8_t adu[TCP_TX_BUF];
+
+    x->tid = tcp->next_tid++;
+    int adu_len = tcp->slmp ? slmp_encode(x, adu, timeout_ms) : mbap_encode(x, adu);
+
+    uint64_t start = hal_time_us();
+    if (tcp_send_all(tcp, adu, adu_len) != 0) return -1;
+    x->timing.write_us = (uint32_t)(hal_time_us() - start);
+    return 0;
+}
+
+// 解析 rx 緩衝區開頭的回應標頭
+// 返回 1 並輸出 ADU 總長度、配對用的 ID 與回應 PDU 的位移/長度；資料不足一個 ADU 返回 0；
+// 標頭不合法返回 -1 (串流已失去同步，需要重新連線)
+static int tcp_parse_header(const hal_tcp_t* tcp, const uint8_t* h, int have,
+                            int* adu_len, uint16_t* tid, int* unit, int* pdu_off, int* pdu_len) {
+    if (tcp->slmp) {
+        if (have < SLMP_HEADER_LEN) return 0;
+        int len = h[11] | (h[12] << 8);
+        if (h[0] != 0xD4 || h[1] != 0x00 || len < 2 || len > HAL_TCP_SLMP_MAX_DATA) {
+            HAL_WARN("Invalid SLMP header from %s:%s (subheader %02X%02X, length %d)",
+                     tcp->host, tcp->service, h[0], h[1], len);
+            return -1;
+        }
+        *adu_len = SLMP_HEADER_LEN + len;
+        *tid = (uint16_t)(h[2] | (h[3] << 8));
+        *unit = -1;
+        *pdu_off = SLMP_HEADER_LEN;
+        *pdu_len = len;
+    } else {
+        if (have < MBAP_HEADER_LEN) return 0;
+        int protocol = (h[2] << 8) | h[3];
+        int len = (h[4] << 8) | h[5];
+        if (protocol != 0 || len < 2 || len > HAL_TCP_MAX_PDU + 1) {
+            HAL_WARN("Invalid MBAP header from %s:%s (protocol %d, length %d)",
+                     tcp->host, tcp->service, protocol, len);
+            return -1;
+        }
+        *adu_len = MBAP_HEADER_LEN - 1 + len;
+        *tid = (uint16_t)((h[0] << 8) | h[1]);
+        *unit = h[6];
+        *pdu_off = MBAP_HEADER_LEN;
+        *pdu_len = len - 1;
+    }
+    return have >= *adu_len ? 1 : 0;
+}
+
+// 從 rx 緩衝區取出完整的 ADU 並配對到在途交易，返回配對完成的數量
+// 標頭不合法時返回 -1 (串流已失去同步，需要重新連線)
+static int tcp_match_responses(hal_tcp_t* tcp, hal_tcp_xfer_t* xfers, int n) {
+    int matched = 0;
+    int pos = 0;
+    uint64_t now = hal_time_us();
+
+    for (;;) {
+        const uint8_t* h = tcp->rx + pos;
+        int adu_len, unit, pdu_off, pdu_len;
+        uint16_t tid;
+        int rc = tcp_parse_header(tcp, h, tcp->rx_len - pos, &adu_len, &tid, &unit, &pdu_off, &pdu_len);
+        if (rc < 0) return -1;
+        if (rc == 0) break;
+
+        int found = 0;
+        for (int i = 0; i < n; i++) {
+            hal_tcp_xfer_t* x = &xfers[i];
+            if (x->state != XFER_INFLIGHT || x->tid != tid) continue;
+            found = 1;
+            x->resp_unit = unit;
+            if (pdu_len > x->resp_cap) pdu_len = x->resp_cap;
+            memcpy(x->resp, h + pdu_off, (size_t)pdu_len);
+            x->resp_len = pdu_len;
+            x->timing.first_byte_us = (uint32_t)(now - x->sent_us);
+            x->timing.frame_us = x->timing.first_byte_us;
+            x->state = XFER_DONE;
+            matched++;
+            break;
+        }
+        if (!found) {
+            HAL_DEBUG("Discarding late response for transaction %u from %s:%s", tid, tcp->host, tcp->service);
+        }
+        pos += adu_len;
+    }
+
+    if (pos > 0) {
+        memmove(tcp->rx, tcp->rx + pos, (size_t)(tcp->rx_len - pos));
+        tcp->rx_len -= pos;
+    }
+    return matched;
+}
+
+int hal_tcp_transact_many(hal_tcp_t* tcp, hal_tcp_xfer_t* xfers, int n, int timeout_ms) {
+    if (tcp == NULL || xfers == NULL || n <= 0) return -1;
+    if (timeout_ms <= 0) timeout_ms = HAL_PORT_RESPONSE_TIMEOUT_MS;
+
+    for (int i = 0; i < n; i++) {
+        xfers[i].resp_len = 0;
+        xfers[i].resp_unit = -1;
+        xfers[i].state = XFER_PENDING;
+        memset(&xfers[i].timing, 0, sizeof(xfers[i].timing));
+    }
+
+    hal_mutex_lock(&tcp->lock);
+    if (tcp_ensure_connected(tcp) != 0) {
+        hal_mutex_unlock(&tcp->lock);
+        for (int i = 0; i < n; i++) xfers[i].resp_len = -1;
+        return -1;
+    }
+
+    int next = 0;       // 下一筆要送出的交易
+    int inflight = 0;
+    int finished = 0;   // 已收到回應或超時的交易
+    int received = 0;
+    int failed = 0;
+
+    while (finished < n && !failed) {
+        // 補滿 window
+        while (next < n && inflight < HAL_TCP_MAX_INFLIGHT) {
+            hal_tcp_xfer_t* x = &xfers[next];
+            if (x->pdu_len <= 0 || x->pdu_len > tcp_max_pdu(tcp)) {
+                x->resp_len = -1;
+                x->state = XFER_DONE;
+                finished++;
+                next++;
+                continue;
+            }
+            if (tcp_send_xfer(tcp, x, timeout_ms) != 0) {
+                failed = 1;
+                break;
+            }
+            x->sent_us = hal_time_us();
+            x->state = XFER_INFLIGHT;
+            inflight++;
+            next++;
+        }
+        if (failed || inflight == 0) continue;
+
+        // 等到最早送出的在途交易超時為止
+        uint64_t now = hal_time_us();
+        uint64_t earliest = UINT64_MAX;
+        for (int i = 0; i < next; i++) {
+            if (xfers[i].state == XFER_INFLIGHT && xfers[i].sent_us < earliest) earliest = xfers[i].sent_us;
+        }
+        uint64_t deadline = earliest + (uint64_t)timeout_ms * 1000;
+        int wait_ms = now >= deadline ? 0 : (int)((deadline - now + 999) / 1000);
+
+        struct pollfd pfd = { tcp->sock, POLLIN, 0 };
+        int ready = sock_poll(&pfd, 1, wait_ms);
+        if (ready > 0) {
+            int r = (int)recv(tcp->sock, (char*)tcp->rx + tcp->rx_len, TCP_RX_BUF - tcp->rx_len, 0);
+            if (r <= 0) {
+                int err = sock_error();
+                if (r < 0 && SOCK_WOULDBLOCK(err)) continue;
+                HAL_ERROR("%s %s:%s connection lost, error: %d", tcp_proto_name(tcp), tcp->host,
+                          tcp->service, err);
+                failed = 1;
+                break;
+            }
+            tcp->rx_len += r;
+            int matched = tcp_match_responses(tcp, xfers, next);
+            if (matched < 0) {
+                failed = 1;
+                break;
+            }
+            received += matched;
+            finished += matched;
+            inflight -= matched;
+        } else if (ready < 0) {
+            HAL_ERROR("poll failed on %s %s:%s, error: %d", tcp_proto_name(tcp), tcp->host, tcp->service,
+                      sock_error());
+            failed = 1;
+            break;
+        }
+
+        // 超時的在途交易結束等待，之後遲到的回應會依 transaction ID 被丟棄
+        now = hal_time_us();
+        for (int i = 0; i < next; i++) {
+            hal_tcp_xfer_t* x = &xfers[i];
+            if (x->state == XFER_INFLIGHT && now - x->sent_us >= (uint64_t)timeout_ms * 1000) {
+                HAL_WARN("Timeout waiting for transaction %u on %s:%s", x->tid, tcp->host, tcp->service);
+                x->state = XFER_DONE;
+                finished++;
+                inflight--;
+            }
+        }
+    }
+
+    if (failed) {
+        tcp_disconnect(tcp);
+        for (int i = 0; i < n; i++) {
+            if (xfers[i].state != XFER_DONE) {
+                xfers[i].resp_len = -1;
+                xfers[i].state = XFER_DONE;
+            }
+        }
+    }
+
+    hal_mutex_unlock(&tcp->lock);
+    return received;
+}
@@ -0,0 +1,63 @@
+#ifndef HAL_TCP_H
+#define HAL_TCP_H
+
+#include "hal_port.h"
+#include <stdint.h>
+
+// Modbus TCP 傳輸 (MBAP 標頭 + PDU)
+// device 名稱為 "tcp://host[:port]" 的串口登錄項目 (hal_port_get) 由這裡的連線承載，
+// 因此排程器、背景擷取與統計不需區分串口或 TCP。
+// 連線使用非阻塞 socket，同一連線上最多 HAL_TCP_MAX_INFLIGHT 筆交易同時在途，
+// 回應依 MBAP transaction ID 配對，可以亂序到達。
+// "slmp://host[:port]" 端點使用同一套連線與 pipelining，但以三菱 SLMP 4E binary frame 傳送
+// (見 hal_slmp.h)，回應依 4E 序號配對。
+
+#define HAL_TCP_PREFIX "tcp://"
+#define HAL_TCP_DEFAULT_PORT 502
+#define HAL_TCP_MAX_INFLIGHT 16         // 單一連線同時在途的交易數
+#define HAL_TCP_MAX_PDU 253             // Modbus PDU 上限 (功能碼 + 資料)
+#define HAL_TCP_CONNECT_TIMEOUT_MS 1000
+
+#define HAL_TCP_SLMP_PREFIX "slmp://"
+#define HAL_TCP_SLMP_DEFAULT_PORT 5000  // PLC 端需在乙太網路設定中開啟此 SLMP (binary) 埠
+#define HAL_TCP_SLMP_MAX_DATA 1024      // SLMP 請求 (command 起) 與回應 (end code 起) 的長度上限
+
+// 一筆交易：請求與回應都是不含 MBAP 標頭的 PDU (從功能碼開始)
+// SLMP 連線的請求為 command + subcommand + 資料，回應為 end code + 資料
+typedef struct {
+    int unit;               // MBAP unit identifier (經由閘道器時為 RTU slave 位址)，SLMP 不使用
+    const uint8_t* pdu;
+    int pdu_len;
+    uint8_t* resp;
+    int resp_cap;
+    int resp_len;           // 輸出：回應 PDU 長度，超時為 0，連線失敗為 -1
+    int resp_unit;          // 輸出：回應的 MBAP unit identifier (SLMP 與沒有回應時為 -1)，由呼叫者比對
+    hal_port_timing_t timing; // 輸出：write_us 為送出時間，first_byte_us/frame_us 為收到回應的時間
+    uint16_t tid;           // 內部使用：本次指派的 transaction ID
+    int state;              // 內部使用
+    uint64_t sent_us;       // 內部使用
+} hal_tcp_xfer_t;
+
+// device 名稱是否為 TCP 端點 ("tcp://" 或 "slmp://")
+int hal_tcp_is_endpoint(const char* device);
+
+// 配置一條連線並嘗試連接 endpoint ("tcp://host[:port]"、"slmp://host[:port]" 或不含前綴的 Modbus TCP)
+// 連線失敗時之後的交易會自動重試
+// 連線表已滿時返回 NULL
+hal_tcp_t* hal_tcp_open(const char* endpoint);
+
+// 關閉並釋放連線
+void hal_tcp_close(hal_tcp_t* tcp);
+
+// 連線是否已建立
+int hal_tcp_is_open(hal_tcp_t* tcp);
+
+// 連線是否以 SLMP frame 傳送 (tcp 為 NULL 時返回 0)
+int hal_tcp_is_slmp(hal_tcp_t* tcp);
+
+// 送出 n 筆交易並收集回應，送出後 timeout_ms 內沒有回應的交易視為超時
+// 交易之間不互相等待：window 內的請求連續送出，回應到達時立即補送下一筆
+// 返回收到回應的交易數，無法連線返回 -1
+int hal_tcp_transact_many(hal_tcp_t* tcp, hal_tcp_xfer_t* xfers, int n, int timeout_ms);
+
+#endif // HAL_TCP_H
@@ -0,0 +1,425 @@
+#include "hal_telemetry.h"
+#include "hal_crc16.h"
+#include "hal_log.h"
+#include "hal_platform.h"
+#include <string.h>
+
+// 傳送端有兩個 frame 緩衝區：一個累積進行中的週期，另一個保存最後完成的 frame 供呼叫端直接讀取，
+// 完成時兩者互換。編碼與解碼都只比較和上一次相同位置的狀態，不做任何動態配置。
+// 接收端先在工作區解碼整個 frame，全部成功後才更新節點狀態，格式錯誤的 frame 不會留下一半的結果。
+
+#define TAG_QUALITY_MASK 0x03
+#define TAG_VALUE 0x04
+#define TAG_TIME 0x08
+#define TAG_SHIFT_POS 4
+
+typedef struct {
+    uint32_t bits[HAL_MAX_POINTS];  // 值的 IEEE 754 位元
+    uint32_t quality[HAL_MAX_POINTS];
+    uint64_t timestamp_us[HAL_MAX_POINTS];
+} telemetry_state_t;
+
+// ---- 傳送端 ----
+
+static hal_mutex_t g_tx_lock = HAL_MUTEX_INIT;
+static hal_telemetry_config_t g_tx_cfg = {0, 1, 30};
+static uint8_t g_tx_buf[2][HAL_TELEMETRY_MAX_FRAME];
+static int g_tx_cur;                // 進行中的緩衝區，另一個為最後完成的 frame
+static uint32_t g_tx_len;           // 進行中的 frame 已寫入的位元組數
+static uint32_t g_tx_ready_len;     // 最後完成的 frame 長度，0 表示沒有
+static int g_tx_cycles;             // 進行中的 frame 已加入的週期數
+static int g_tx_keyframe;           // 進行中的 frame 是否為關鍵 frame
+static int g_tx_count;              // 進行中的 frame 涵蓋的量測點數
+static uint32_t g_tx_hash;
+static uint64_t g_tx_cycle_us;      // 上一個週期的時間
+static uint32_t g_tx_seq;
+static int g_tx_since_key;          // 上一個關鍵 frame 之後完成的 frame 數
+static int g_tx_key_pending = 1;
+static int g_tx_last_count = -1;
+static uint32_t g_tx_last_hash;
+static telemetry_state_t g_tx_prev;
+
+static float g_cur_value[HAL_MAX_POINTS];
+static uint32_t g_cur_quality[HAL_MAX_POINTS];
+static uint64_t g_cur_ts[HAL_MAX_POINTS];
+static int g_changed[HAL_MAX_POINTS];
+
+// ---- 接收端 ----
+
+typedef struct {
+    int in_use;
+    int primed;                     // 已收到關鍵 frame
+    hal_telemetry_info_t info;
+    telemetry_state_t state;
+} telemetry_peer_t;
+
+static hal_mutex_t g_rx_lock = HAL_MUTEX_INIT;
+static telemetry_peer_t g_peers[HAL_TELEMETRY_MAX_PEERS];
+static telemetry_state_t g_rx_work;
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t* put_varint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// 讀取一個 varint，超出 end 或超過 64 位元返回 -1
+static int get_varint(const uint8_t** p, const uint8_t* end, uint64_t* out) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) return -1;
+        uint8_t b = *(*p)++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static uint32_t float_bits(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+// 結尾 0 位元數，取偶數並限制在 tag 的 4 個位元可表示的範圍 (0-30)
+static int xor_shift(uint32_t x) {
+    int shift = 0;
+    while (x != 0 && shift < 30 && (x & 3) == 0) {
+        x >>= 2;
+        shift += 2;
+    }
+    return shift;
+}
+
+void hal_telemetry_default_config(hal_telemetry_config_t* cfg) {
+    if (cfg == NULL) return;
+    cfg->node_id = 0;
+    cfg->batch_cycles = 1;
+    cfg->keyframe_interval = 30;
+}
+
+int hal_telemetry_configure(const hal_telemetry_config_t* cfg) {
+    if (cfg == NULL || cfg->batch_cycles < 1 || cfg->batch_cycles > HAL_TELEMETRY_MAX_BATCH ||
+        cfg->keyframe_interval < 0) {
+        return -1;
+    }
+    hal_mutex_lock(&g_tx_lock);
+    g_tx_cfg = *cfg;
+    g_tx_cycles = 0;
+    g_tx_key_pending = 1;
+    hal_mutex_unlock(&g_tx_lock);
+    HAL_INFO("Telemetry encoder: node %u, %d cycle(s) per frame, keyframe every %d frame(s)",
+             cfg->node_id, cfg->batch_cycles, cfg->keyframe_interval);
+    return 0;
+}
+
+// 開始新的 frame：決定是否為關鍵 frame 並寫入標頭 (cycles 在完成時填入)
+static void tx_begin_frame(void) {
+    int count = hal_point_count();
+    uint32_t hash = hal_snapshot_layout_hash(count);
+
+    // 量測點定義改變時接收端的 handle 對應已失效，必須重新送出全部量測點
+    g_tx_keyframe = g_tx_key_pending || count != g_tx_last_count || hash != g_tx_last_hash ||
+                    (g_tx_cfg.keyframe_interval > 0 && g_tx_since_key >= g_tx_cfg.keyframe_interval);
+    g_tx_count = count;
+    g_tx_hash = hash;
+    g_tx_cycle_us = 0;
+    if (g_tx_keyframe) memset(&g_tx_prev, 0, sizeof(g_tx_prev));
+
+    uint8_t* h = g_tx_buf[g_tx_cur];
+    memset(h, 0, HAL_TELEMETRY_HEADER_SIZE);
+    put_u16(h, HAL_TELEMETRY_MAGIC);
+    h[2] = HAL_TELEMETRY_VERSION;
+    h[3] = g_tx_keyframe ? HAL_TELEMETRY_FLAG_KEYFRAME : 0;
+    put_u16(h + 4, g_tx_cfg.node_id);
+    put_u16(h + 6, (uint16_t)count);
+    put_u32(h + 8, g_tx_seq);
+    put_u32(h + 12, hash);
+    g_tx_len = HAL_TELEMETRY_HEADER_SIZE;
+}
+
+// 把一個週期編碼到進行中的 frame (呼叫者需持有 g_tx_lock)
+static void tx_encode_cycle(uint64_t cycle_us) {
+    int n = g_tx_count;
+    hal_batch_t batch = {n, g_cur_value, NULL, g_cur_quality, g_cur_ts};
+    if (n > 0) hal_read_all(&batch);
+
+    // 只有關鍵 frame 的第一個週期包含全部量測點，之後的週期與前一個週期相比
+    int full = g_tx_keyframe && g_tx_cycles == 0;
+    int changed = 0;
+    for (int i = 0; i < n; i++) {
+        g_changed[i] = full || float_bits(g_cur_value[i]) != g_tx_prev.bits[i] ||
+                       g_cur_quality[i] != g_tx_prev.quality[i] || g_cur_ts[i] != g_tx_prev.timestamp_us[i];
+        changed += g_changed[i];
+    }
+
+    uint8_t* p = g_tx_buf[g_tx_cur] + g_tx_len;
+    p = put_varint(p, zigzag((int64_t)(cycle_us - g_tx_cycle_us)));
+    p = put_varint(p, (uint64_t)changed);
+    g_tx_cycle_us = cycle_us;
+
+    int last = -1;
+    uint64_t last_us = cycle_us;
+    for (int i = 0; i < n; i++) {
+        if (!g_changed[i]) continue;
+        uint32_t bits = float_bits(g_cur_value[i]);
+        uint32_t x = bits ^ g_tx_prev.bits[i];
+        int has_value = full || x != 0;
+        int has_time = full || g_cur_ts[i] != g_tx_prev.timestamp_us[i];
+        int shift = xor_shift(x);
+
+        p = put_varint(p, (uint64_t)(i - last - 1));
+        *p++ = (uint8_t)((g_cur_quality[i] & TAG_QUALITY_MASK) | (has_value ? TAG_VALUE : 0) |
+                         (has_time ? TAG_TIME : 0) | ((shift / 2) << TAG_SHIFT_POS));
+        if (has_value) p = put_varint(p, x >> shift);
+        if (has_time) {
+            p = put_varint(p, zigzag((int64_t)(g_cur_ts[i] - last_us)));
+            last_us = g_cur_ts[i];
+        }
+        last = i;
+
+        g_tx_prev.bits[i] = bits;
+        g_tx_prev.quality[i] = g_cur_quality[i];
+        g_tx_prev.timestamp_us[i] = g_cur_ts[i];
+    }
+    g_tx_len = (uint32_t)(p - g_tx_buf[g_tx_cur]);
+    g_tx_cycles++;
+}
+
+// 填入週期數與 CRC，進行中的緩衝區成為最後完成的 frame (呼叫者需持有 g_tx_lock)
+static int tx_finish_frame(void) {
+    uint8_t* frame = g_tx_buf[g_tx_cur];
+    frame[16] = (uint8_t)g_tx_cycles;
+    put_u16(frame + g_tx_len, hal_crc16(frame, g_tx_len));
+    g_tx_ready_len = g_tx_len + 2;
+    g_tx_cur ^= 1;
+
+    if (g_tx_keyframe) {
+        g_tx_since_key = 0;
+        g_tx_key_pending = 0;
+    }
+    g_tx_since_key++;
+    g_tx_last_count = g_tx_count;
+    g_tx_last_hash = g_tx_hash;
+    g_tx_seq++;
+    g_tx_cycles = 0;
+    return (int)g_tx_ready_len;
+}
+
+int hal_telemetry_capture(uint64_t timestamp_us) {
+    if (timestamp_us == 0) timestamp_us = hal_wall_time_us();
+
+    hal_mutex_lock(&g_tx_lock);
+    if (g_tx_cycles == 0) tx_begin_frame();
+    // 以最壞情況檢查剩餘空間 (含 CRC)，編碼途中不再檢查
+    if (g_tx_len + HAL_TELEMETRY_MAX_CYCLE(g_tx_count) + 2 > HAL_TELEMETRY_MAX_FRAME) {
+        hal_mutex_unlock(&g_tx_lock);
+        HAL_ERROR("Telemetry frame buffer too small for %d point(s) after %d cycle(s)", g_tx_count, g_tx_cycles);
+        return -1;
+    }
+    tx_encode_cycle(timestamp_us);
+    int len = g_tx_cycles >= g_tx_cfg.batch_cycles ? tx_finish_frame() : 0;
+    hal_mutex_unlock(&g_tx_lock);
+    return len;
+}
+
+int hal_telemetry_flush(void) {
+    hal_mutex_lock(&g_tx_lock);
+    int len = g_tx_cycles > 0 ? tx_finish_frame() : 0;
+    hal_mutex_unlock(&g_tx_lock);
+    return len;
+}
+
+const uint8_t* hal_telemetry_frame(uint32_t* len) {
+    hal_mutex_lock(&g_tx_lock);
+    const uint8_t* frame = g_tx_ready_len > 0 ? g_tx_buf[g_tx_cur ^ 1] : NULL;
+    if (len != NULL) *len = g_tx_ready_len;
+    hal_mutex_unlock(&g_tx_lock);
+    return frame;
+}
+
+void hal_telemetry_request_keyframe(void) {
+    hal_mutex_lock(&g_tx_lock);
+    g_tx_key_pending = 1;
+    hal_mutex_unlock(&g_tx_lock);
+}
+
+// ---- 接收端 ----
+
+static telemetry_peer_t* peer_find(int node_id, int create) {
+    telemetry_peer_t* free_slot = NULL;
+    for (int i = 0; i < HAL_TELEMETRY_MAX_PEERS; i++) {
+        if (g_peers[i].in_use && g_peers[i].info.node_id == node_id) return &g_peers[i];
+        if (!g_peers[i].in_use && free_slot == NULL) free_slot = &g_peers[i];
+    }
+    if (!create || free_slot == NULL) return NULL;
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->in_use = 1;
+    free_slot->info.node_id = (uint16_t)node_id;
+    return free_slot;
+}
+
+// 在 g_rx_work 上解碼 frame 的所有週期，成功返回 0 並寫入最後一個週期的時間
+static int rx_decode_cycles(const uint8_t* p, const uint8_t* end, int cycles, int count, uint64_t* last_cycle_us) {
+    uint64_t cycle_us = 0;
+    for (int c = 0; c < cycles; c++) {
+        uint64_t v, n;
+        if (get_varint(&p, end, &v) != 0 || get_varint(&p, end, &n) != 0 || n > (uint64_t)count) return -1;
+        cycle_us += (uint64_t)unzigzag(v);
+
+        int handle = -1;
+        uint64_t last_us = cycle_us;
+        for (uint64_t k = 0; k < n; k++) {
+            uint64_t gap;
+            if (get_varint(&p, end, &gap) != 0 || gap >= (uint64_t)(count - handle - 1) || p >= end) return -1;
+            handle += (int)gap + 1;
+            uint8_t tag = *p++;
+            g_rx_work.quality[handle] = tag & TAG_QUALITY_MASK;
+            if (tag & TAG_VALUE) {
+                if (get_varint(&p, end, &v) != 0) return -1;
+                g_rx_work.bits[handle] ^= (uint32_t)(v << (2 * (tag >> TAG_SHIFT_POS)));
+            }
+            if (tag & TAG_TIME) {
+                if (get_varint(&p, end, &v) != 0) return -1;
+                last_us += (uint64_t)unzigzag(v);
+                g_rx_work.timestamp_us[handle] = last_us;
+            }
+        }
+    }
+    if (p != end) return -1;
+    *last_cycle_us = cycle_us;
+    return 0;
+}
+
+int hal_telemetry_decode(const uint8_t* frame, uint32_t len, hal_telemetry_info_t* info) {
+    if (frame == NULL || len < HAL_TELEMETRY_HEADER_SIZE + 2) return -1;
+    if (get_u16(frame) != HAL_TELEMETRY_MAGIC || frame[2] != HAL_TELEMETRY_VERSION) {
+        HAL_WARN("Telemetry frame rejected: bad magic or version %u", frame[2]);
+        return -1;
+    }
+    if (hal_crc16(frame, len - 2) != get_u16(frame + len - 2)) {
+        HAL_WARN("Telemetry frame rejected: CRC mismatch (%u bytes)", (unsigned)len);
+        return -1;
+    }
+
+    hal_telemetry_info_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.keyframe = (frame[3] & HAL_TELEMETRY_FLAG_KEYFRAME) != 0;
+    hdr.node_id = get_u16(frame + 4);
+    hdr.point_count = get_u16(frame + 6);
+    hdr.seq = get_u32(frame + 8);
+    hdr.layout_hash = get_u32(frame + 12);
+    hdr.cycles = frame[16];
+    if (hdr.point_count > HAL_MAX_POINTS || hdr.cycles < 1 || hdr.cycles > HAL_TELEMETRY_MAX_BATCH) return -1;
+
+    hal_mutex_lock(&g_rx_lock);
+    telemetry_peer_t* peer = peer_find(hdr.node_id, hdr.keyframe);
+    if (peer == NULL) {
+        hal_mutex_unlock(&g_rx_lock);
+        if (hdr.keyframe) {
+            HAL_WARN("Telemetry frame from node %u dropped: more than %d peers", hdr.node_id,
+                     HAL_TELEMETRY_MAX_PEERS);
+            return -1;
+        }
+        return -2;
+    }
+    if (!hdr.keyframe && (!peer->primed || hdr.seq != peer->info.seq + 1 ||
+                          hdr.point_count != peer->info.point_count || hdr.layout_hash != peer->info.layout_hash)) {
+        hal_mutex_unlock(&g_rx_lock);
+        return -2;
+    }
+
+    if (hdr.keyframe) memset(&g_rx_work, 0, sizeof(g_rx_work));
+    else g_rx_work = peer->state;
+
+    uint64_t last_cycle_us;
+    if (rx_decode_cycles(frame + HAL_TELEMETRY_HEADER_SIZE, frame + len - 2, hdr.cycles, hdr.point_count,
+                         &last_cycle_us) != 0) {
+        hal_mutex_unlock(&g_rx_lock);
+        HAL_WARN("Telemetry frame from node %u seq %u is malformed", hdr.node_id, (unsigned)hdr.seq);
+        return -1;
+    }
+    hdr.last_cycle_us = last_cycle_us;
+    peer->state = g_rx_work;
+    peer->info = hdr;
+    peer->primed = 1;
+    if (info != NULL) *info = hdr;
+    hal_mutex_unlock(&g_rx_lock);
+    return hdr.cycles;
+}
+
+int hal_telemetry_peer_read(int node_id, hal_batch_t* batch) {
+    if (batch == NULL || batch->capacity < 0) return -1;
+
+    hal_mutex_lock(&g_rx_lock);
+    telemetry_peer_t* peer = peer_find(node_id, 0);
+    if (peer == NULL || !peer->primed) {
+        hal_mutex_unlock(&g_rx_lock);
+        return -1;
+    }
+    int n = peer->info.point_count;
+    if (n > batch->capacity) n = batch->capacity;
+    for (int i = 0; i < n; i++) {
+        if (batch->value) memcpy(&batch->value[i], &peer->state.bits[i], sizeof(float));
+        if (batch->raw) batch->raw[i] = 0;
+        if (batch->quality) batch->quality[i] = peer->state.quality[i];
+        if (batch->timestamp_us) batch->timestamp_us[i] = peer->state.timestamp_us[i];
+    }
+    hal_mutex_unlock(&g_rx_lock);
+    return n;
+}
+
+int hal_telemetry_peer_info(int node_id, hal_telemetry_info_t* info) {
+    if (info == NULL) return -1;
+    hal_mutex_lock(&g_rx_lock);
+    telemetry_peer_t* peer = peer_find(node_id, 0);
+    if (peer != NULL) *info = peer->info;
+    hal_mutex_unlock(&g_rx_lock);
+    return peer != NULL ? 0 : -1;
+}
+
+void hal_telemetry_reset(void) {
+    hal_mutex_lock(&g_tx_lock);
+    g_tx_cycles = 0;
+    g_tx_ready_len = 0;
+    g_tx_seq = 0;
+    g_tx_since_key = 0;
+    g_tx_key_pending = 1;
+    g_tx_last_count = -1;
+    hal_mutex_unlock(&g_tx_lock);
+
+    hal_mutex_lock(&g_rx_lock);
+    memset(g_peers, 0, sizeof(g_peers));
+    hal_mutex_unlock(&g_rx_lock);
+}
@@ -0,0 +1,96 @@
+#ifndef HAL_TELEMETRY_H
+#define HAL_TELEMETRY_H
+
+#include "hal_sched.h"
+#include "hal_snapshot.h"
+#include <stdint.h>
+
+// 節點間的遙測 frame：把快照表編碼成精簡的二進位格式，取代每個週期由 dict 組成的 JSON。
+// 量測點以 handle 為索引 (叢集各節點載入相同的設定，handle 一致；標頭帶有量測點定義的雜湊供接收端確認)。
+// 關鍵 frame 包含所有量測點；其餘 frame 只包含與上一個週期相比值、品質或時間有變化的量測點，
+// 值以與上一次的位元 XOR 編碼，時間以與前一個量測點的差值編碼 (同一次讀取的量測點時間相同，只佔 1 位元組)。
+// 一個 frame 可以包含連續數個週期 (batch)，frame 直接在 HAL 內部緩衝區產生，呼叫端不需要複製。
+//
+// frame 格式 (版本 HAL_TELEMETRY_VERSION，多位元組欄位為 little endian，varint 為 LEB128)：
+//   標頭 20 位元組：
+//     u16 magic (HAL_TELEMETRY_MAGIC)   u8 version   u8 flags (HAL_TELEMETRY_FLAG_*)
+//     u16 node_id   u16 point_count (handle 0 .. point_count-1)   u32 seq
+//     u32 layout_hash (量測點定義的 FNV-1a)   u8 cycles   u8 reserved[3]
+//   每個週期：
+//     varint 週期時間與前一週期的差 (微秒，zigzag；frame 的第一個週期與 0 相比，即絕對時間)
+//     varint 量測點數量，之後每個量測點：
+//       varint 與前一個 handle 的間隔 (handle - 前一個 handle - 1，第一個以 -1 為前一個)
+//       u8 tag：bit 0-1 品質，bit 2 帶有值，bit 3 帶有時間，bit 4-7 值 XOR 結尾的 0 位元數 / 2
+//       [varint (值的位元 XOR 上一次的位元) >> 結尾 0 位元數]       關鍵 frame 的上一次為 0
+//       [varint 與前一個帶有時間的量測點的差 (微秒，zigzag)]       第一個與週期時間相比
+//   u16 CRC16 (Modbus，涵蓋之前的所有位元組)
+
+#define HAL_TELEMETRY_MAGIC 0x5443      // "CT"
+#define HAL_TELEMETRY_VERSION 1
+#define HAL_TELEMETRY_HEADER_SIZE 20
+#define HAL_TELEMETRY_FLAG_KEYFRAME 0x01
+#define HAL_TELEMETRY_MAX_BATCH 16      // 一個 frame 最多包含的週期數
+#define HAL_TELEMETRY_MAX_PEERS 16      // 接收端同時追蹤的節點數
+// 每個量測點最多 3 + 1 + 5 + 10 位元組，每個週期另有 20 位元組的時間與數量
+#define HAL_TELEMETRY_MAX_CYCLE(points) (20 + (points) * 19)
+#define HAL_TELEMETRY_MAX_FRAME \
+    (HAL_TELEMETRY_HEADER_SIZE + HAL_TELEMETRY_MAX_BATCH * HAL_TELEMETRY_MAX_CYCLE(HAL_MAX_POINTS) + 2)
+
+typedef struct {
+    uint16_t node_id;
+    int batch_cycles;       // 每個 frame 包含的週期數 (1 - HAL_TELEMETRY_MAX_BATCH)，預設 1
+    int keyframe_interval;  // 每隔幾個 frame 送一次關鍵 frame，預設 30；0 表示只在第一個 frame 與要求時送出
+} hal_telemetry_config_t;
+
+typedef struct {
+    uint16_t node_id;
+    uint16_t point_count;
+    uint32_t seq;
+    uint32_t layout_hash;
+    int keyframe;
+    int cycles;
+    uint64_t last_cycle_us; // 最後一個週期的時間 (Unix epoch 微秒)
+} hal_telemetry_info_t;
+
+// ---- 傳送端 ----
+
+// 以預設值填入 cfg
+void hal_telemetry_default_config(hal_telemetry_config_t* cfg);
+
+// 設定傳送端，尚未送出的週期會被捨棄，下一個 frame 為關鍵 frame
+// 成功返回 0，參數無效返回 -1
+int hal_telemetry_configure(const hal_telemetry_config_t* cfg);
+
+// 讀取目前的快照表，加入待送 frame 成為一個週期 (timestamp_us 為 0 時使用目前時間)
+// frame 累積到 batch_cycles 個週期時完成，返回 frame 長度，以 hal_telemetry_frame() 取得；
+// 尚未完成返回 0。frame 緩衝區放不下最壞情況的一個週期時不編碼並返回 -1 (進行中的週期保留，
+// 可先以 hal_telemetry_flush() 送出)；緩衝區依 HAL_MAX_POINTS 與 HAL_TELEMETRY_MAX_BATCH 配置，正常不會發生
+int hal_telemetry_capture(uint64_t timestamp_us);
+
+// 立即完成包含尚未送出週期的 frame，返回 frame 長度，沒有待送週期返回 0
+int hal_telemetry_flush(void);
+
+// 最後完成的 frame (HAL 內部緩衝區，下一個 frame 完成之前有效)，沒有時返回 NULL
+const uint8_t* hal_telemetry_frame(uint32_t* len);
+
+// 下一個 frame 改送關鍵 frame (接收端遺失 frame 或新加入叢集時)
+void hal_telemetry_request_keyframe(void);
+
+// ---- 接收端 ----
+
+// 解碼其他節點的 frame 並更新該節點的量測點狀態，info 可為 NULL
+// 返回解碼的週期數；格式、版本或 CRC 錯誤返回 -1；
+// 差值 frame 的前一個 frame 遺失 (seq 不連續或尚未收到關鍵 frame) 返回 -2，應要求該節點送出關鍵 frame
+int hal_telemetry_decode(const uint8_t* frame, uint32_t len, hal_telemetry_info_t* info);
+
+// 讀取 node_id 最新週期的量測點 (與 hal_read_all 相同的 struct-of-arrays；raw 不在 frame 中，填 0)
+// 返回寫入的量測點數量，尚未收到該節點的關鍵 frame 返回 -1
+int hal_telemetry_peer_read(int node_id, hal_batch_t* batch);
+
+// 讀取 node_id 最後一個 frame 的資訊，成功返回 0，未知的節點返回 -1
+int hal_telemetry_peer_info(int node_id, hal_telemetry_info_t* info);
+
+// 清除傳送端與所有節點的接收狀態
+void hal_telemetry_reset(void);
+
+#endif // HAL_TELEMETRY_H
@@ -1,17 +1,155 @@
 #include "hal_uart.h"
+#include "hal_log.h"
+#include "hal_modbus.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include "hal_sched.h"
+#include "hal_snapshot.h"
+#include "hal_stats.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-// 從一個 USB-to-UART DI/DO 板讀取一個 DI pin
-int uart_read_di_pin(const char* device, int pin_number) {
-    // 在真實世界中，這裡會包含設定 serial port (termios)、
-    // 發送指令到 UART 設備、然後讀取回應的程式碼。
-    //
-    // 例如，可能會發送 "READ PIN 3\r\n" 然後等待 "OK 1\r\n"
+static const char k_read_di[] = "READ DI\r\n";
+
+// 每個串口上 DI 板的讀取方式，依 device 名稱記錄 (登錄表項目釋放後可能分配給其他 device)
+typedef struct {
+    char device[64];
+    int per_pin;            // 板子以 ERR 拒絕 "READ DI"，改以 "READ PIN" 逐一讀取
+    uint32_t watch;         // 逐一讀取時要讀的 pin (bit 0 為 pin 1)，0 表示全部
+} uart_board_t;
+
+static uart_board_t g_boards[HAL_MAX_PORTS];
+static int g_board_count = 0;
+static hal_mutex_t g_board_lock = HAL_MUTEX_INIT;
+
+// 取得 device 的記錄，沒有時新增 (呼叫者需持有 g_board_lock)，登錄表已滿返回 NULL
+static uart_board_t* board_find(const char* device) {
+    for (int i = 0; i < g_board_count; i++) {
+        if (strcmp(g_boards[i].device, device) == 0) return &g_boards[i];
+    }
+    if (g_board_count >= HAL_MAX_PORTS || strlen(device) >= sizeof(g_boards[0].device)) return NULL;
+    uart_board_t* board = &g_boards[g_board_count++];
+    memset(board, 0, sizeof(*board));
+    strcpy(board->device, device);
+    return board;
+}
+
+// 文字回應以換行結束；收到換行前先要求整行長度，讀取會在行尾後的靜默時間返回
+static int uart_line_len(const uint8_t* buf, int have) {
+    for (int i = 0; i < have; i++) {
+        if (buf[i] == '\n') return have;
+    }
+    return HAL_UART_LINE_MAX;
+}
+
+// 送出一行指令並解析 "OK <數值>" 回應 (base 為數值的進位)，記錄統計
+// 返回 hal_modbus_status_t，板子回應 ERR 時返回 HAL_MODBUS_ERR_EXCEPTION
+static int uart_command(hal_port_t* port, const char* cmd, int base, unsigned long* value) {
+    uint8_t line[HAL_UART_LINE_MAX + 1];
+    hal_port_timing_t timing;
+    int req_len = (int)strlen(cmd);
+    int len = hal_port_transact_framed(port, -1, (const uint8_t*)cmd, req_len, line, HAL_UART_LINE_MAX,
+                                       uart_line_len, HAL_PORT_RESPONSE_TIMEOUT_MS, &timing);
+
+    int status;
+    if (len < 0) {
+        status = HAL_MODBUS_ERR_IO;
+    } else if (len == 0) {
+        status = HAL_MODBUS_ERR_TIMEOUT;
+    } else {
+        line[len] = '\0';
+        char* end = NULL;
+        if (strncmp((const char*)line, "OK ", 3) == 0) {
+            *value = strtoul((const char*)line + 3, &end, base);
+            if (end != (char*)line + 3 && (*end == '\r' || *end == '\n')) {
+                status = HAL_MODBUS_OK;
+            } else {
+                HAL_WARN("Malformed DI response on %s: %s", hal_port_device(port), (const char*)line);
+                status = HAL_MODBUS_ERR_MISMATCH;
+            }
+        } else if (strncmp((const char*)line, "ERR", 3) == 0) {
+            HAL_DEBUG("DI command rejected on %s: %s", hal_port_device(port), (const char*)line);
+            status = HAL_MODBUS_ERR_EXCEPTION;
+        } else {
+            status = memchr(line, '\n', (size_t)len) ? HAL_MODBUS_ERR_MISMATCH : HAL_MODBUS_ERR_SHORT;
+            HAL_WARN("Unexpected DI response on %s (%d bytes)", hal_port_device(port), len);
+        }
+    }
 
-    printf("HAL-UART: Reading DI pin %d from device %s\n", pin_number, device);
+    hal_stats_record(port, -1, status, len < 0 ? 0 : req_len, len, &timing);
+    return status;
+}
+
+// 以 "READ PIN" 逐一讀取 watch 中的 pin，任何一個失敗時整次讀取失敗
+static int uart_read_pins(hal_port_t* port, uint32_t watch, uint32_t* bitmap) {
+    uint32_t bits = 0;
+    for (int pin = 1; pin <= HAL_UART_DI_MAX_PINS; pin++) {
+        if (watch != 0 && !(watch & (1u << (pin - 1)))) continue;
+        char cmd[24];
+        snprintf(cmd, sizeof(cmd), "READ PIN %d\r\n", pin);
+        unsigned long state = 0;
+        int status = uart_command(port, cmd, 10, &state);
+        if (status == HAL_MODBUS_OK && state > 1) {
+            HAL_WARN("Invalid state %lu for DI pin %d on %s", state, pin, hal_port_device(port));
+            status = HAL_MODBUS_ERR_MISMATCH;
+        }
+        if (status != HAL_MODBUS_OK) return status;
+        if (state) bits |= 1u << (pin - 1);
+    }
+    *bitmap = bits;
+    return HAL_MODBUS_OK;
+}
+
+int hal_uart_read_di(hal_port_t* port, uint32_t* bitmap) {
+    if (port == NULL || bitmap == NULL) return HAL_MODBUS_ERR_IO;
+
+    hal_mutex_lock(&g_board_lock);
+    uart_board_t* board = board_find(hal_port_device(port));
+    int per_pin = board != NULL && board->per_pin;
+    uint32_t watch = board != NULL ? board->watch : 0;
+    hal_mutex_unlock(&g_board_lock);
+
+    if (!per_pin) {
+        unsigned long value = 0;
+        int status = uart_command(port, k_read_di, 16, &value);
+        if (status == HAL_MODBUS_OK) {
+            *bitmap = (uint32_t)value;
+            return status;
+        }
+        // 只有明確的 ERR 表示不支援；超時或格式錯誤不改變讀取方式
+        if (status != HAL_MODBUS_ERR_EXCEPTION || board == NULL) return status;
+        HAL_INFO("DI board on %s does not support READ DI, reading pins one at a time", hal_port_device(port));
+        hal_mutex_lock(&g_board_lock);
+        board->per_pin = 1;
+        hal_mutex_unlock(&g_board_lock);
+    }
+    return uart_read_pins(port, watch, bitmap);
+}
+
+int hal_uart_watch_pin(const char* device, int pin_number) {
+    if (device == NULL || pin_number < 1 || pin_number > HAL_UART_DI_MAX_PINS) return -1;
+    hal_mutex_lock(&g_board_lock);
+    uart_board_t* board = board_find(device);
+    if (board != NULL) board->watch |= 1u << (pin_number - 1);
+    hal_mutex_unlock(&g_board_lock);
+    return board != NULL ? 0 : -1;
+}
+
+int hal_di_read_pin(int handle, int pin_number) {
+    if (pin_number < 1 || pin_number > HAL_UART_DI_MAX_PINS) return -1;
+
+    hal_sample_t sample;
+    if (hal_get_snapshot(handle, &sample) != 0 || sample.quality != HAL_QUALITY_GOOD) return -1;
+    return (int)((sample.raw >> (pin_number - 1)) & 1u);
+}
+
+int uart_read_di_pin(const char* device, int pin_number) {
+    HAL_TRACE("UART: Reading DI pin %d from device %s", pin_number, device);
+    if (device == NULL || pin_number < 1 || pin_number > HAL_UART_DI_MAX_PINS) return -1;
 
-    // 實際應用中，這裡會有與硬體溝通的程式碼
-    // 當無法讀取硬體時，返回 -1 表示錯誤
-    printf("HAL-UART: No actual hardware connected, returning -1\n");
-    return -1; // 表示無法讀取
+    // 不在呼叫端做串口交易：DI 點由背景擷取或引擎的 hal_sched_poll 輪詢，這裡只讀快照表
+    int handle = hal_point_register_di(device);
+    if (handle < 0 || hal_uart_watch_pin(device, pin_number) != 0) return -1;
+    return hal_di_read_pin(handle, pin_number);
 }
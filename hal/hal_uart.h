@@ -1,8 +1,38 @@
 #ifndef HAL_UART_H
 #define HAL_UART_H
 
-// 模擬讀取一個 DI pin 的狀態
-// 返回值：0 代表 LOW, 1 代表 HIGH
+#include <stdint.h>
+
+// USB-to-UART DI/DO 板驅動 (文字協定，每行以 "\r\n" 結束)，由共用串口登錄表 (hal_port.h) 持有的串口送出
+//   請求 "READ PIN <n>\r\n" 回應 "OK 0\r\n" 或 "OK 1\r\n" (板子文件記載的指令)
+//   請求 "READ DI\r\n"      回應 "OK <十六進位 bitmap>\r\n"，bit 0 為 pin 1
+//   錯誤時回應 "ERR <訊息>\r\n"
+// "READ DI" 不在板子文件中，是假設較新的韌體支援的整板讀取：先嘗試一次讀回所有輸入 pin，
+// 板子以 ERR 拒絕時記住這個串口不支援，之後改為逐一送出 "READ PIN" 讀取登錄過的 pin。
+// 向排程器註冊的 DI 點由擷取執行緒 (或引擎的 hal_sched_poll) 輪詢，bitmap 存放在快照表中，
+// 同一塊板子上的液位、漏液、門禁開關共用一次輪詢。
+
+#define HAL_UART_DI_MAX_PINS 32
+#define HAL_UART_LINE_MAX 64
+
+struct hal_port;
+
+// 讀取 port 上 DI 板的輸入 bitmap：支援 "READ DI" 時一次往返；否則以 "READ PIN" 逐一讀取
+// hal_uart_watch_pin 登錄過的 pin (沒有登錄任何 pin 時讀取全部 32 個)，其餘 bit 為 0
+// 返回 hal_modbus_status_t (成功為 0)，板子回應 ERR 時返回 HAL_MODBUS_ERR_EXCEPTION
+int hal_uart_read_di(struct hal_port* port, uint32_t* bitmap);
+
+// 登錄 device 上需要讀取的 pin (1-32)，板子不支援 "READ DI" 時只逐一讀取登錄過的 pin
+// 成功返回 0，參數無效或登錄表已滿返回 -1
+int hal_uart_watch_pin(const char* device, int pin_number);
+
+// 從快照表讀取 DI 點 (hal_point_register_di) 上一個 pin (1-32) 的狀態，不會阻塞
+// 返回 0 (LOW) 或 1 (HIGH)，尚未讀取成功或參數無效返回 -1
+int hal_di_read_pin(int handle, int pin_number);
+
+// 讀取一個 DI pin 的狀態，不會阻塞
+// 第一次呼叫時為 device 註冊 DI 點並登錄 pin，之後由背景擷取或引擎的 hal_sched_poll 輪詢；
+// 返回最近一次輪詢的結果：0 代表 LOW, 1 代表 HIGH，尚未輪詢成功或無法讀取返回 -1
 int uart_read_di_pin(const char* device, int pin_number);
 
 #endif // HAL_UART_H
@@ -0,0 +1,360 @@
+#include "hal_write.h"
+#include "hal_acq.h"
+#include "hal_log.h"
+#include "hal_modbus.h"
+#include "hal_platform.h"
+#include "hal_port.h"
+#include <string.h>
+
+// 佇列中的每一項是一個暫存器；依排入順序存放，合併同一暫存器時保留原本的位置
+// submit 為排入時的寫入編號，只有編號相同 (同一次多暫存器寫入) 的連續暫存器會合併成 FC16
+typedef struct {
+    hal_port_t* port;
+    int slave;
+    int reg;
+    uint16_t value;
+    uint32_t submit;
+} write_entry_t;
+
+typedef struct {
+    hal_port_t* port;
+    int slave;
+    hal_write_status_t status;
+} write_target_t;
+
+// 送出結果紀錄 (hal_write_wait_done 用)：hal_write_flush 取出一個 frame 時記為送出中，送出後填入結果；
+// 寫入在送出前被完全取代時記下取代它的編號。紀錄為環形，容量大於佇列，等待者來得及讀取
+#define WRITE_RESULT_SIZE (HAL_WRITE_QUEUE_SIZE * 4)
+#define WRITE_RESULT_SENDING 1
+
+typedef struct {
+    uint32_t submit;        // 0 表示未使用
+    uint32_t replaced_by;   // 非 0 時結果以該編號為準
+    int status;             // 0、-1 或 WRITE_RESULT_SENDING
+} write_result_t;
+
+static write_entry_t g_queue[HAL_WRITE_QUEUE_SIZE];
+static int g_queue_count = 0;
+static uint32_t g_next_submit = 1;     // 0 保留給「沒有編號」
+static write_result_t g_results[WRITE_RESULT_SIZE];
+static uint32_t g_result_next = 0;
+static write_target_t g_targets[HAL_WRITE_MAX_TARGETS];
+static int g_target_count = 0;
+static hal_mutex_t g_write_lock = HAL_MUTEX_INIT;
+static hal_cond_t g_write_cond = HAL_COND_INIT;
+
+// 取得 (port, slave) 的統計，表已滿時返回 NULL (呼叫者需持有 g_write_lock)
+static hal_write_status_t* target_status(hal_port_t* port, int slave) {
+    for (int i = 0; i < g_target_count; i++) {
+        if (g_targets[i].port == port && g_targets[i].slave == slave) return &g_targets[i].status;
+    }
+    if (g_target_count >= HAL_WRITE_MAX_TARGETS) return NULL;
+    write_target_t* t = &g_targets[g_target_count++];
+    memset(t, 0, sizeof(*t));
+    t->port = port;
+    t->slave = slave;
+    t->status.last_error_reg = -1;
+    return &t->status;
+}
+
+// 呼叫者需持有 g_write_lock
+static uint32_t next_submit(void) {
+    uint32_t submit = g_next_submit++;
+    if (g_next_submit == 0) g_next_submit = 1;
+    return submit;
+}
+
+// 新增一筆結果紀錄，返回其位置 (呼叫者需持有 g_write_lock)
+static uint32_t record_result(uint32_t submit, uint32_t replaced_by, int status) {
+    uint32_t pos = g_result_next++ % WRITE_RESULT_SIZE;
+    g_results[pos].submit = submit;
+    g_results[pos].replaced_by = replaced_by;
+    g_results[pos].status = status;
+    return pos;
+}
+
+static void record_queued(hal_port_t* port, int slave) {
+    hal_write_status_t* s = target_status(port, slave);
+    if (s != NULL) s->queued++;
+}
+
+// 同步寫入 [reg, reg + count)，count 為 1 時使用 FC06，並記錄結果
+static int write_now(hal_port_t* port, int slave, int reg, int count, const uint16_t* values, int fc16) {
+    int result = fc16 ? hal_modbus_write_multiple(port, slave, reg, count, values)
+                      : hal_modbus_write_single(port, slave, reg, values[0]);
+    hal_mutex_lock(&g_write_lock);
+    hal_write_status_t* s = target_status(port, slave);
+    if (s != NULL) {
+        s->last_status = result == 0 ? 0 : -1;
+        if (result == 0) {
+            s->written++;
+        } else {
+            s->failed++;
+            s->last_error_reg = reg;
+            s->last_error_us = hal_time_us();
+        }
+    }
+    hal_mutex_unlock(&g_write_lock);
+    return result;
+}
+
+// 呼叫者需持有 g_write_lock
+static int queue_count_for(hal_port_t* port) {
+    int n = 0;
+    for (int i = 0; i < g_queue_count; i++) {
+        if (g_queue[i].port == port) n++;
+    }
+    return n;
+}
+
+static int write_args_valid(hal_port_t* port, int reg, int count, const uint16_t* values) {
+    return port != NULL && values != NULL && count >= 1 && count <= HAL_MODBUS_MAX_WRITE_REGISTERS &&
+           reg >= 0 && reg + count <= 0x10000;
+}
+
+// 呼叫者需持有 g_write_lock
+static write_entry_t* queue_find(hal_port_t* port, int slave, int reg) {
+    for (int i = 0; i < g_queue_count; i++) {
+        if (g_queue[i].port == port && g_queue[i].slave == slave && g_queue[i].reg == reg) return &g_queue[i];
+    }
+    return NULL;
+}
+
+// 排入佇列，*ticket 為這筆寫入所在項目的編號 (可為 NULL)
+static int write_enqueue(hal_port_t* port, int slave, int reg, int count, const uint16_t* values, uint32_t* ticket) {
+    if (!write_args_valid(port, reg, count, values)) return -1;
+
+    hal_mutex_lock(&g_write_lock);
+    if (count == 1) {
+        // 單一暫存器：尚未送出的同一暫存器在原位置更新為最新值
+        write_entry_t* e = queue_find(port, slave, reg);
+        if (e == NULL && g_queue_count >= HAL_WRITE_QUEUE_SIZE) {
+            hal_mutex_unlock(&g_write_lock);
+            HAL_ERROR("Write queue full, dropping write to %s slave %d reg 0x%04X",
+                      hal_port_device(port), slave, reg);
+            return -1;
+        }
+        if (e == NULL) {
+            e = &g_queue[g_queue_count++];
+            e->port = port;
+            e->slave = slave;
+            e->reg = reg;
+            e->submit = next_submit();
+        }
+        e->value = values[0];
+        if (ticket != NULL) *ticket = e->submit;
+    } else {
+        // 多暫存器：先確認空間足夠 (整筆寫入要嘛全部排入，要嘛全部拒絕)，
+        // 再移除重疊的舊項目，整段依序排到最後，送出時以一個 FC16 寫入
+        int overlap = 0;
+        for (int i = 0; i < g_queue_count; i++) {
+            const write_entry_t* e = &g_queue[i];
+            if (e->port == port && e->slave == slave && e->reg >= reg && e->reg < reg + count) overlap++;
+        }
+        if (g_queue_count - overlap + count > HAL_WRITE_QUEUE_SIZE) {
+            hal_mutex_unlock(&g_write_lock);
+            HAL_ERROR("Write queue full, dropping write to %s slave %d reg 0x%04X",
+                      hal_port_device(port), slave, reg);
+            return -1;
+        }
+        uint32_t submit = next_submit();
+        uint32_t removed[HAL_MODBUS_MAX_WRITE_REGISTERS];
+        int n_removed = 0;
+        int kept = 0;
+        for (int i = 0; i < g_queue_count; i++) {
+            const write_entry_t* e = &g_queue[i];
+            if (e->port == port && e->slave == slave && e->reg >= reg && e->reg < reg + count) {
+                if (n_removed == 0 || removed[n_removed - 1] != e->submit) removed[n_removed++] = e->submit;
+                continue;
+            }
+            g_queue[kept++] = g_queue[i];
+        }
+        g_queue_count = kept;
+        // 整筆被取代的舊寫入不會再送出，其結果以這筆寫入為準
+        for (int k = 0; k < n_removed; k++) {
+            int remaining = 0;
+            for (int i = 0; i < g_queue_count && !remaining; i++) remaining = g_queue[i].submit == removed[k];
+            if (!remaining) record_result(removed[k], submit, WRITE_RESULT_SENDING);
+        }
+        for (int k = 0; k < count; k++) {
+            write_entry_t* e = &g_queue[g_queue_count++];
+            e->port = port;
+            e->slave = slave;
+            e->reg = reg + k;
+            e->value = values[k];
+            e->submit = submit;
+        }
+        if (ticket != NULL) *ticket = submit;
+    }
+    record_queued(port, slave);
+    hal_cond_broadcast(&g_write_cond);
+    hal_mutex_unlock(&g_write_lock);
+    return 0;
+}
+
+int hal_write_enqueue(hal_port_t* port, int slave, int reg, int count, const uint16_t* values) {
+    return write_enqueue(port, slave, reg, count, values, NULL);
+}
+
+int hal_write_submit_tracked(hal_port_t* port, int slave, int reg, int count, const uint16_t* values,
+                             uint32_t* ticket) {
+    if (ticket != NULL) *ticket = 0;
+    if (!write_args_valid(port, reg, count, values)) return -1;
+
+    // 沒有擷取執行緒送出佇列時直接寫入
+    if (!hal_acq_owns_port(port)) {
+        hal_mutex_lock(&g_write_lock);
+        record_queued(port, slave);
+        hal_mutex_unlock(&g_write_lock);
+        return write_now(port, slave, reg, count, values, count > 1);
+    }
+    return write_enqueue(port, slave, reg, count, values, ticket);
+}
+
+int hal_write_submit(hal_port_t* port, int slave, int reg, int count, const uint16_t* values) {
+    return hal_write_submit_tracked(port, slave, reg, count, values, NULL);
+}
+
+// 查詢 submit 是否已完成 (呼叫者需持有 g_write_lock)
+// 完成返回 0 / -1，仍在佇列或送出中返回 WRITE_RESULT_SENDING，沒有任何紀錄返回 -2
+static int result_state(uint32_t submit) {
+    for (int depth = 0; depth < WRITE_RESULT_SIZE; depth++) {
+        for (int i = 0; i < g_queue_count; i++) {
+            if (g_queue[i].submit == submit) return WRITE_RESULT_SENDING;
+        }
+        int found = 0, sending = 0, failed = 0;
+        uint32_t replaced_by = 0;
+        for (int i = 0; i < WRITE_RESULT_SIZE; i++) {
+            const write_result_t* r = &g_results[i];
+            if (r->submit != submit) continue;
+            found = 1;
+            if (r->replaced_by != 0) replaced_by = r->replaced_by;
+            else if (r->status == WRITE_RESULT_SENDING) sending = 1;
+            else if (r->status != 0) failed = 1;
+        }
+        if (!found) return -2;
+        if (replaced_by == 0 || sending || failed) return sending ? WRITE_RESULT_SENDING : (failed ? -1 : 0);
+        submit = replaced_by;
+    }
+    return -2;
+}
+
+int hal_write_wait_done(uint32_t ticket, int timeout_ms) {
+    if (ticket == 0) return -1;
+    uint64_t deadline = hal_time_us() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000;
+    hal_mutex_lock(&g_write_lock);
+    int state;
+    uint64_t now;
+    while ((state = result_state(ticket)) == WRITE_RESULT_SENDING && (now = hal_time_us()) < deadline) {
+        hal_cond_wait(&g_write_cond, &g_write_lock, (int)((deadline - now + 999) / 1000));
+    }
+    hal_mutex_unlock(&g_write_lock);
+    if (state == WRITE_RESULT_SENDING) return -2;
+    if (state == -2) {
+        HAL_WARN("Write %u result no longer recorded", (unsigned)ticket);
+        return -1;
+    }
+    return state;
+}
+
+int hal_write_get_status(hal_port_t* port, int slave, hal_write_status_t* out) {
+    if (port == NULL || out == NULL) return -1;
+    int found = 0;
+    memset(out, 0, sizeof(*out));
+    out->last_error_reg = -1;
+    hal_mutex_lock(&g_write_lock);
+    for (int i = 0; i < g_target_count; i++) {
+        const write_target_t* t = &g_targets[i];
+        if (t->port != port || (slave >= 0 && t->slave != slave)) continue;
+        found = 1;
+        out->queued += t->status.queued;
+        out->written += t->status.written;
+        out->failed += t->status.failed;
+        if (t->status.last_error_us > out->last_error_us) {
+            out->last_error_us = t->status.last_error_us;
+            out->last_error_reg = t->status.last_error_reg;
+        }
+        // 合計時 last_status 取任一目標最近一次失敗
+        if (t->status.last_status != 0) out->last_status = t->status.last_status;
+    }
+    hal_mutex_unlock(&g_write_lock);
+    return found ? 0 : -1;
+}
+
+// 從 pending[i] 開始可合併成一個 frame 的項目數：同一次多暫存器寫入的相鄰項目合併成一個 FC16 frame，
+// 其餘以 FC06 逐一送出
+static int frame_run(const write_entry_t* pending, int i, int n) {
+    int run = 1;
+    while (i + run < n && run < HAL_MODBUS_MAX_WRITE_REGISTERS &&
+           pending[i + run].submit == pending[i].submit &&
+           pending[i + run].slave == pending[i].slave &&
+           pending[i + run].reg == pending[i].reg + run) {
+        run++;
+    }
+    return run;
+}
+
+int hal_write_flush(hal_port_t* port) {
+    write_entry_t pending[HAL_WRITE_QUEUE_SIZE];
+    uint32_t result_pos[HAL_WRITE_QUEUE_SIZE];
+    int n = 0;
+
+    // 取出 port 的所有項目，其餘項目保持原本順序；每個 frame 先記為送出中，
+    // 等待者在項目離開佇列到結果填入之間不會誤判為完成
+    hal_mutex_lock(&g_write_lock);
+    int kept = 0;
+    for (int i = 0; i < g_queue_count; i++) {
+        if (g_queue[i].port == port) {
+            pending[n++] = g_queue[i];
+        } else {
+            g_queue[kept++] = g_queue[i];
+        }
+    }
+    g_queue_count = kept;
+    for (int i = 0; i < n; i += frame_run(pending, i, n)) {
+        result_pos[i] = record_result(pending[i].submit, 0, WRITE_RESULT_SENDING);
+    }
+    hal_mutex_unlock(&g_write_lock);
+
+    int frames = 0;
+    uint16_t values[HAL_MODBUS_MAX_WRITE_REGISTERS];
+    int i = 0;
+    while (i < n) {
+        int run = frame_run(pending, i, n);
+        for (int k = 0; k < run; k++) values[k] = pending[i + k].value;
+        int result = write_now(port, pending[i].slave, pending[i].reg, run, values, run > 1);
+        if (result != 0) {
+            HAL_WARN("Write to %s slave %d reg 0x%04X (%d register(s)) failed",
+                     hal_port_device(port), pending[i].slave, pending[i].reg, run);
+        }
+        hal_mutex_lock(&g_write_lock);
+        write_result_t* r = &g_results[result_pos[i]];
+        if (r->submit == pending[i].submit) r->status = result == 0 ? 0 : -1;
+        hal_cond_broadcast(&g_write_cond);
+        hal_mutex_unlock(&g_write_lock);
+        frames++;
+        i += run;
+    }
+    return frames;
+}
+
+int hal_write_wait(hal_port_t* port, int timeout_ms) {
+    hal_mutex_lock(&g_write_lock);
+    int n = queue_count_for(port);
+    if (n == 0 && timeout_ms > 0) {
+        uint64_t deadline = hal_time_us() + (uint64_t)timeout_ms * 1000;
+        uint64_t now;
+        while ((n = queue_count_for(port)) == 0 && (now = hal_time_us()) < deadline) {
+            hal_cond_wait(&g_write_cond, &g_write_lock, (int)((deadline - now + 999) / 1000));
+        }
+    }
+    hal_mutex_unlock(&g_write_lock);
+    return n;
+}
+
+int hal_write_pending(void) {
+    hal_mutex_lock(&g_write_lock);
+    int n = g_queue_count;
+    hal_mutex_unlock(&g_write_lock);
+    return n;
+}
@@ -0,0 +1,60 @@
+#ifndef HAL_WRITE_H
+#define HAL_WRITE_H
+
+#include <stdint.h>
+
+// 寫入佇列
+// 設定值寫入先排入佇列，由負責該串口的擷取執行緒在下一次讀取 frame 之前送出，
+// 寫入永遠優先於背景讀取。同一暫存器尚未送出的寫入只保留最新值，
+// UI 或最佳化程式連續下達設定值時匯流排上只會出現最後一次。
+// 佇列依第一次排入的順序送出；只有同一次多暫存器寫入的暫存器會合併成 FC16 frame，
+// 各自排入的單一暫存器即使位址連續仍以 FC06 逐一送出 (部分 VFD 的設定值暫存器只接受 FC06)。
+// 串口沒有擷取執行緒負責時 (背景擷取未啟動)，hal_write_submit 直接同步寫入。
+// 排入後的送出結果記錄在每個 (port, slave) 的統計中，呼叫端以 hal_write_get_status 確認寫入是否到達設備。
+
+#define HAL_WRITE_QUEUE_SIZE 128
+#define HAL_WRITE_MAX_TARGETS 64    // 記錄送出結果的 (port, slave) 數量
+
+struct hal_port;
+
+typedef struct {
+    uint64_t queued;        // 排入佇列 (或同步寫入) 的次數
+    uint64_t written;       // 成功送出的 frame 數
+    uint64_t failed;        // 失敗 (超時、例外回應或 CRC 錯誤) 的 frame 數
+    int32_t last_status;    // 最近一次送出的結果：0 成功，-1 失敗
+    int32_t last_error_reg; // 最近一次失敗的起始暫存器，沒有失敗時為 -1
+    uint64_t last_error_us; // 最近一次失敗的時間 (hal_time_us)，沒有失敗時為 0
+} hal_write_status_t;
+
+// 排入 count 個連續暫存器的寫入 (1-123)
+// 成功排入返回 0；同步寫入時返回寫入結果；佇列已滿或參數無效返回 -1
+// 同一暫存器尚未送出的單一暫存器寫入在原位置更新；多暫存器寫入取代重疊的項目並排到最後，整段以一個 FC16 送出
+int hal_write_submit(struct hal_port* port, int slave, int reg, int count, const uint16_t* values);
+
+// 與 hal_write_submit 相同，但一律排入佇列，不會同步寫入 (控制執行緒使用，不可等待匯流排)
+// 佇列由 port 的擷取執行緒或下一次 hal_sched_poll 送出
+int hal_write_enqueue(struct hal_port* port, int slave, int reg, int count, const uint16_t* values);
+
+// 與 hal_write_submit 相同；排入佇列時以 *ticket 返回這筆寫入的編號 (> 0)，同步寫入或失敗時為 0
+// 排入的寫入以 hal_write_wait_done 等待送出結果
+int hal_write_submit_tracked(struct hal_port* port, int slave, int reg, int count, const uint16_t* values,
+                             uint32_t* ticket);
+
+// 等待 ticket 的寫入從佇列送出，返回 0 (所有 frame 成功)、-1 (任一 frame 失敗或結果已不可考) 或超時 -2
+// 送出之前被較新的寫入完全取代時，以取代它的寫入的結果為準；合併到同一暫存器尚未送出的寫入共用結果
+int hal_write_wait_done(uint32_t ticket, int timeout_ms);
+
+// 讀取 port 上 slave 的寫入結果統計 (slave 為 -1 時合計 port 上所有 slave)
+// 成功返回 0，尚未對該目標寫入過返回 -1
+int hal_write_get_status(struct hal_port* port, int slave, hal_write_status_t* out);
+
+// 送出 port 上所有尚未送出的寫入，返回送出的 frame 數量
+int hal_write_flush(struct hal_port* port);
+
+// 等待 port 出現尚未送出的寫入或超過 timeout_ms，返回等待中的暫存器數量
+int hal_write_wait(struct hal_port* port, int timeout_ms);
+
+// 佇列中尚未送出的暫存器總數
+int hal_write_pending(void);
+
+#endif // HAL_WRITE_H
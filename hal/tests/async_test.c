@@ -0,0 +1,212 @@
+// hal_async 測試：在模擬匯流排上排入讀寫請求，確認完成結果、完成順序與通知物件的狀態，
+// 背景擷取運作時寫入經由寫入佇列送出，閒置的工作執行緒結束後位置可重複使用
+// 用法: make test (不需要硬體；失敗時返回非 0)
+
+#include "../hal_acq.h"
+#include "../hal_async.h"
+#include "../hal_log.h"
+#include "../hal_modbus.h"
+#include "../hal_modbus_sim.h"
+#include "../hal_platform.h"
+#include "../hal_port.h"
+#include "../hal_sched.h"
+#include "../hal_write.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#endif
+
+#define DEV "sim://test-async"
+
+static int g_failed = 0;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            g_failed++;                                                              \
+        }                                                                            \
+    } while (0)
+
+// 通知物件在 timeout_ms 內是否觸發 (eventfd 可讀 / event signaled)
+static int notifier_ready(int timeout_ms) {
+    intptr_t fd = hal_completion_fd();
+    if (fd < 0) return -1;
+#ifdef _WIN32
+    return WaitForSingleObject((HANDLE)fd, (DWORD)timeout_ms) == WAIT_OBJECT_0;
+#else
+    struct pollfd pfd = {.fd = (int)fd, .events = POLLIN};
+    return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN);
+#endif
+}
+
+static void sim_bus(const char* device) {
+    hal_sim_config_t cfg;
+    hal_sim_default_config(&cfg);
+    cfg.realtime = 0;
+    cfg.auto_slaves = 0;
+    CHECK(hal_sim_configure(device, &cfg) == 0);
+    CHECK(hal_sim_add_slave(device, 1, 0, 64) == 0);
+}
+
+static hal_request_t make_request(int kind, const char* device, int reg, int count) {
+    hal_request_t req;
+    memset(&req, 0, sizeof(req));
+    req.kind = kind;
+    snprintf(req.device, sizeof(req.device), "%s", device);
+    req.slave = 1;
+    req.reg = reg;
+    req.count = count;
+    return req;
+}
+
+// 取出 n 筆完成結果 (最多等待 1 秒)，返回實際取出的數量
+static int drain(hal_completion_t* out, int n) {
+    int got = 0;
+    while (got < n && hal_wait_completions(1000) > 0) {
+        got += hal_drain_completions(out + got, n - got);
+    }
+    return got;
+}
+
+static void test_submit_complete(void) {
+    printf("=== 1. 排入、完成與通知 ===\n");
+    sim_bus(DEV);
+    for (int i = 0; i < 4; i++) CHECK(hal_sim_set_register(DEV, 1, i, (uint16_t)(10 + i)) == 0);
+    CHECK(hal_completion_fd() >= 0);
+    CHECK(notifier_ready(0) == 0);
+
+    hal_request_t req = make_request(HAL_REQ_READ, DEV, 0, 4);
+    req.user_data = 7;
+    uint64_t ticket = hal_submit(&req);
+    CHECK(ticket > 0);
+    // 通知物件在完成後觸發，取出前保持觸發
+    CHECK(notifier_ready(1000) == 1);
+    CHECK(notifier_ready(0) == 1);
+    CHECK(hal_wait_completions(0) == 1);
+
+    hal_completion_t done[4];
+    CHECK(hal_drain_completions(done, 4) == 1);
+    CHECK(done[0].ticket == ticket && done[0].user_data == 7 && done[0].kind == HAL_REQ_READ);
+    CHECK(done[0].status == 0 && done[0].count == 4);
+    CHECK(done[0].values[0] == 10 && done[0].values[3] == 13);
+    CHECK(notifier_ready(0) == 0);
+    CHECK(hal_async_pending() == 0);
+
+    // 同一 device 的請求依排入順序執行；單一暫存器 FC06、多暫存器 FC16
+    hal_request_t multi = make_request(HAL_REQ_WRITE, DEV, 8, 2);
+    multi.values[0] = 81;
+    multi.values[1] = 82;
+    hal_request_t single = make_request(HAL_REQ_WRITE, DEV, 20, 1);
+    single.values[0] = 200;
+    hal_request_t missing = make_request(HAL_REQ_READ, DEV, 100, 1);   // 區段之外 -> 例外回應
+    uint64_t t1 = hal_submit(&multi);
+    uint64_t t2 = hal_submit(&single);
+    uint64_t t3 = hal_submit(&missing);
+    CHECK(t1 > 0 && t2 > t1 && t3 > t2);
+    CHECK(drain(done, 3) == 3);
+    CHECK(done[0].ticket == t1 && done[1].ticket == t2 && done[2].ticket == t3);
+    CHECK(done[0].status == 0 && done[1].status == 0 && done[2].status == -1);
+    uint16_t value = 0;
+    CHECK(hal_sim_get_register(DEV, 1, 9, &value) == 0 && value == 82);
+    CHECK(hal_sim_get_register(DEV, 1, 20, &value) == 0 && value == 200);
+    CHECK(notifier_ready(0) == 0);
+
+    // 無效的請求不會排入
+    hal_request_t invalid = make_request(HAL_REQ_READ, DEV, 0, 0);
+    CHECK(hal_submit(&invalid) == 0);
+    invalid = make_request(HAL_REQ_WRITE, "", 0, 1);
+    CHECK(hal_submit(&invalid) == 0);
+    CHECK(hal_async_pending() == 0);
+}
+
+static void test_stop_restart(void) {
+    printf("=== 2. 停止後重新啟動工作執行緒 ===\n");
+    hal_async_stop();
+    hal_request_t req = make_request(HAL_REQ_READ, DEV, 1, 1);
+    CHECK(hal_submit(&req) > 0);
+    hal_completion_t done;
+    CHECK(drain(&done, 1) == 1);
+    CHECK(done.status == 0 && done.values[0] == 11);
+}
+
+static void test_write_queue(void) {
+    printf("=== 3. 背景擷取運作時的寫入 ===\n");
+    CHECK(hal_point_register(DEV, 1, 0, HAL_VALUE_U16, 1.0f) >= 0);
+    CHECK(hal_acq_start(10) == 1);
+    hal_port_t* port = hal_port_get(DEV, 0);
+    CHECK(port != NULL && hal_acq_owns_port(port));
+
+    // 寫入排入佇列並取得編號，擷取執行緒送出後才有結果
+    uint16_t value = 5;
+    uint32_t ticket = 0;
+    CHECK(hal_write_submit_tracked(port, 1, 40, 1, &value, &ticket) == 0 && ticket > 0);
+    CHECK(hal_write_wait_done(ticket, 1000) == 0);
+    CHECK(hal_sim_get_register(DEV, 1, 40, &value) == 0 && value == 5);
+
+    // 非同步寫入的完成結果是送出後的結果：區段之外的寫入收到例外回應
+    hal_request_t multi = make_request(HAL_REQ_WRITE, DEV, 30, 3);
+    for (int i = 0; i < 3; i++) multi.values[i] = (uint16_t)(31 + i);
+    hal_request_t bad = make_request(HAL_REQ_WRITE, DEV, 100, 1);
+    bad.values[0] = 1;
+    uint64_t t1 = hal_submit(&multi);
+    uint64_t t2 = hal_submit(&bad);
+    CHECK(t1 > 0 && t2 > t1);
+    hal_completion_t done[2];
+    CHECK(drain(done, 2) == 2);
+    CHECK(done[0].ticket == t1 && done[0].status == 0);
+    CHECK(done[1].ticket == t2 && done[1].status == -1);
+    CHECK(hal_sim_get_register(DEV, 1, 32, &value) == 0 && value == 33);
+
+    hal_acq_stop();
+    hal_point_clear();
+}
+
+static void test_worker_reuse(void) {
+    printf("=== 4. 閒置的工作執行緒結束後重複使用 ===\n");
+    hal_async_stop();
+    CHECK(hal_async_workers() == 0);
+    // 連不上的 TCP 端點不佔用串口登錄表，但每個 device 仍需要一條工作執行緒
+    hal_log_set_level(HAL_LOG_LEVEL_OFF);
+    hal_completion_t done[HAL_MAX_PORTS];
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < HAL_MAX_PORTS; i++) {
+            char device[32];
+            snprintf(device, sizeof(device), "tcp://127.0.0.1:%d", 1 + round * HAL_MAX_PORTS + i);
+            hal_request_t req = make_request(HAL_REQ_READ, device, 0, 1);
+            CHECK(hal_submit(&req) > 0);
+        }
+        CHECK(drain(done, HAL_MAX_PORTS) == HAL_MAX_PORTS);
+        for (int i = 0; i < HAL_MAX_PORTS; i++) CHECK(done[i].status == -1);
+        CHECK(hal_async_workers() == HAL_MAX_PORTS);
+
+        // 所有位置都有執行緒時新的 device 不會排入
+        hal_request_t extra = make_request(HAL_REQ_READ, DEV, 0, 1);
+        CHECK(hal_submit(&extra) == 0);
+
+        hal_sleep_ms(HAL_ASYNC_IDLE_MS * 2 + 500);
+        CHECK(hal_async_workers() == 0);
+    }
+    hal_log_set_level(HAL_LOG_LEVEL_ERROR);
+
+    hal_request_t req = make_request(HAL_REQ_READ, DEV, 1, 1);
+    CHECK(hal_submit(&req) > 0);
+    CHECK(drain(done, 1) == 1);
+    CHECK(done[0].status == 0 && done[0].values[0] == 11);
+    CHECK(hal_async_workers() == 1);
+}
+
+int main(void) {
+    hal_log_set_level(HAL_LOG_LEVEL_ERROR);
+    test_submit_complete();
+    test_stop_restart();
+    test_write_queue();
+    test_worker_reuse();
+    hal_async_stop();
+    printf("%s (%d failed)\n", g_failed ? "FAILED" : "OK", g_failed);
+    return g_failed ? 1 : 0;
+}
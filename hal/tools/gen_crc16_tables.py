@@ -0,0 +1,46 @@
+"""
+產生 Modbus RTU CRC16 (反射多項式 0xA001) 的查表
+輸出 hal_crc16_tables.h：crc16_table[k][n] 為位元組 n 之後再接 k 個 0x00 的 CRC 貢獻，
+k = 0 為一般逐位元組查表，k = 0..7 供 slice-by-4/8 使用。
+
+用法: python tools/gen_crc16_tables.py > hal_crc16_tables.h  (或 make crc16-tables)
+"""
+
+import sys
+
+POLY = 0xA001
+SLICES = 8
+
+
+def byte_crc(n):
+    crc = n
+    for _ in range(8):
+        crc = (crc >> 1) ^ POLY if crc & 1 else crc >> 1
+    return crc
+
+
+def build_tables():
+    tables = [[byte_crc(n) for n in range(256)]]
+    for k in range(1, SLICES):
+        prev = tables[k - 1]
+        tables.append([(prev[n] >> 8) ^ tables[0][prev[n] & 0xFF] for n in range(256)])
+    return tables
+
+
+def main(out):
+    tables = build_tables()
+    out.write("// 由 tools/gen_crc16_tables.py 產生，請勿手動修改\n")
+    out.write("#ifndef HAL_CRC16_TABLES_H\n#define HAL_CRC16_TABLES_H\n\n")
+    out.write("#include <stdint.h>\n\n")
+    out.write(f"static const uint16_t crc16_table[{SLICES}][256] = {{\n")
+    for table in tables:
+        out.write("    {\n")
+        for row in range(0, 256, 8):
+            values = ", ".join(f"0x{v:04X}" for v in table[row:row + 8])
+            out.write(f"        {values},\n")
+        out.write("    },\n")
+    out.write("};\n\n#endif // HAL_CRC16_TABLES_H\n")
+
+
+if __name__ == "__main__":
+    main(sys.stdout)
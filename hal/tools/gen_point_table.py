@@ -0,0 +1,149 @@
+"""
+把 cdu_config.yaml 的 FunctionBlocks 編譯成量測點表 (hal_ptable.h)
+以模擬匯流排 (不開啟串口、不連線 PLC) 建立與引擎相同的 Block，Block 註冊的量測點與排程器產生的計畫
+寫成二進位量測點表；--output 另外把同一份表輸出成 hal_point_table.c 的內建表 (hal_ptable_builtin)。
+需要已編譯的 lib-cdu-hal (排程計畫、請求與 CRC 都由函式庫產生，與執行時完全相同)。
+
+用法: python tools/gen_point_table.py --config ../cdu_config.yaml --output hal_point_table.c  (或 make point-table)
+      python tools/gen_point_table.py --config ../cdu_config.yaml --bin cdu_point_table.bin   (或 make point-table-bin)
+"""
+
+import argparse
+import os
+import struct
+import sys
+import tempfile
+
+import yaml
+
+PROJECT_ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+sys.path.insert(0, PROJECT_ROOT)
+
+MAGIC = 0x42545048
+VERSION = 1
+HEADER = struct.Struct('<IIIIiiiI')
+POINT = struct.Struct('<64siiifii')
+FRAME = struct.Struct('<iiiiiii8s')
+
+
+def compile_config(config_path, bin_path):
+    """建立 config_path 的所有 Block 並把量測點表寫入 bin_path，返回 Block 數量"""
+    from blocks import hal_bus
+    from engine import load_block_class
+
+    if not hal_bus.available():
+        raise SystemExit(f"HAL library not found: {hal_bus.HAL_LIB_PATH}")
+    with open(config_path, 'r', encoding='utf-8') as f:
+        config = yaml.safe_load(f)
+    # 所有串口接到模擬匯流排，且不等待傳輸時間
+    hal_bus.configure_simulator({'enabled': True, 'realtime': 0})
+    count = 0
+    for block_conf in config.get('FunctionBlocks') or []:
+        if not block_conf.get('id') or not block_conf.get('type'):
+            continue
+        load_block_class(block_conf['type'])(block_conf['id'], block_conf)
+        count += 1
+    hal_bus.forward_log()
+    if not hal_bus.save_point_table(bin_path):
+        raise SystemExit(f"Failed to write point table {bin_path}")
+    return count
+
+
+def parse_table(data):
+    """解析二進位量測點表，返回 (max_gap, points, order, frames)"""
+    magic, version, point_size, frame_size, max_gap, n_points, n_frames, _ = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION or point_size != POINT.size or frame_size != FRAME.size:
+        raise SystemExit("Unsupported point table format")
+    offset = HEADER.size
+    points = [POINT.unpack_from(data, offset + i * POINT.size) for i in range(n_points)]
+    offset += n_points * POINT.size
+    order = list(struct.unpack_from(f'<{n_points}i', data, offset))
+    offset += n_points * 4
+    frames = [FRAME.unpack_from(data, offset + i * FRAME.size) for i in range(n_frames)]
+    return max_gap, points, order, frames
+
+
+def c_string(raw):
+    text = raw.split(b'\0', 1)[0].decode('utf-8')
+    return '"' + text.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def c_float(value):
+    # 能還原成相同 float 的最短表示
+    for digits in range(6, 10):
+        text = f"{value:.{digits}g}"
+        if struct.pack('<f', float(text)) == struct.pack('<f', value):
+            break
+    if '.' not in text and 'e' not in text and 'n' not in text:
+        text += '.0'
+    return text + 'f'
+
+
+def write_c(out, config_path, table):
+    max_gap, points, order, frames = table
+    out.write("// 由 tools/gen_point_table.py 產生，請勿手動修改 (make point-table)\n")
+    out.write(f"// 來源: {os.path.basename(config_path)}\n")
+    out.write('#include "hal_ptable.h"\n#include <stddef.h>\n\n')
+    if not points:
+        out.write(f"const hal_ptable_t hal_ptable_builtin = {{ {max_gap}, 0, NULL, NULL, 0, NULL }};\n")
+        return
+
+    out.write("// device, slave, reg, type, scale, period_ms, priority\n")
+    out.write("static const hal_ptable_point_t point_table_points[] = {\n")
+    for handle, (device, slave, reg, value_type, scale, period_ms, priority) in enumerate(points):
+        out.write(f"    {{ {c_string(device)}, {slave}, {reg}, {value_type}, {c_float(scale)}, "
+                  f"{period_ms}, {priority} }},  // handle {handle}\n")
+    out.write("};\n\n")
+
+    out.write("static const int32_t point_table_order[] = {\n")
+    for row in range(0, len(order), 16):
+        out.write("    " + ", ".join(str(i) for i in order[row:row + 16]) + ",\n")
+    out.write("};\n\n")
+
+    out.write("// slave, start, count, first, n_points, period_ms, priority, FC03 請求 (含 CRC)\n")
+    out.write("static const hal_ptable_frame_t point_table_frames[] = {\n")
+    for slave, start, count, first, n_points, period_ms, priority, request in frames:
+        request_bytes = ", ".join(f"0x{b:02X}" for b in request)
+        out.write(f"    {{ {slave}, {start}, {count}, {first}, {n_points}, {period_ms}, {priority}, "
+                  f"{{ {request_bytes} }} }},\n")
+    out.write("};\n\n")
+
+    out.write("const hal_ptable_t hal_ptable_builtin = {\n")
+    out.write(f"    {max_gap}, {len(points)}, point_table_points, point_table_order,\n")
+    out.write(f"    {len(frames)}, point_table_frames\n")
+    out.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile FunctionBlocks into a HAL point table")
+    parser.add_argument('--config', default=os.path.join(PROJECT_ROOT, 'cdu_config.yaml'))
+    parser.add_argument('--output', help="generated C source (hal_point_table.c)")
+    parser.add_argument('--bin', help="binary point table for HAL.point_table")
+    args = parser.parse_args()
+    if not args.output and not args.bin:
+        parser.error("specify --output and/or --bin")
+
+    config_path = os.path.abspath(args.config)
+    output_path = os.path.abspath(args.output) if args.output else None
+    bin_path = os.path.abspath(args.bin) if args.bin else None
+    # 部分 Block 以專案根目錄為相對路徑的基準 (與引擎相同)
+    os.chdir(PROJECT_ROOT)
+    if bin_path is None:
+        fd, bin_path = tempfile.mkstemp(suffix='.bin')
+        os.close(fd)
+    try:
+        blocks = compile_config(config_path, bin_path)
+        with open(bin_path, 'rb') as f:
+            table = parse_table(f.read())
+    finally:
+        if args.bin is None:
+            os.remove(bin_path)
+
+    if output_path:
+        with open(output_path, 'w', encoding='utf-8', newline='\n') as out:
+            write_c(out, config_path, table)
+    print(f"{blocks} blocks, {len(table[1])} points, {len(table[3])} frames", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
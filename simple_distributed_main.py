@@ -17,6 +17,7 @@ from datetime import datetime
 
 # 導入分散式CDU系統組件
 from distributed_engine import DistributedCDUEngine
+from blocks import hal_bus
 from log_manager import get_log_manager
 from snmp_alarm_manager import SNMPAlarmManager, AlarmLevel, AlarmCategory, AlarmInstance
 from cdu_logging_system import get_logging_system, LogLevel
@@ -855,6 +856,10 @@ class SimplifiedDistributedCDUAPI:
         """更新所有功能塊"""
         while self.running:
             try:
+                # 未啟動背景擷取時，先由 HAL 以合併後的 frame 輪詢所有已註冊的量測點
+                hal_bus.poll()
+                hal_bus.forward_log()
+
                 for block_id, block in self.engine.blocks.items():
                     if hasattr(block, 'update'):
                         block.update()
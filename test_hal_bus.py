@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""
+測試 lib-cdu-hal 匯流排 (以模擬匯流排 sim:// 執行，不需要硬體)
+1. FC03 合併與資料型態解碼
+2. CRC 與例外回應處理
+3. 模擬器的確定性：相同的種子產生相同的錯誤序列
+用法: make -C hal 之後執行 python test_hal_bus.py
+"""
+
+import ctypes
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+
+L = hal_bus.hal_lib
+if L is not None:
+    L.hal_point_clear.restype = None
+    L.hal_point_clear.argtypes = []
+    L.hal_sim_reset.restype = None
+    L.hal_sim_reset.argtypes = []
+    L.hal_sim_get_register.restype = ctypes.c_int
+    L.hal_sim_get_register.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_uint16)]
+    L.hal_sched_frame_count.restype = ctypes.c_int
+    L.hal_sched_frame_count.argtypes = []
+    L.hal_sched_poll_port.restype = ctypes.c_int
+    L.hal_sched_poll_port.argtypes = [ctypes.c_void_p]
+    L.hal_crc16.restype = ctypes.c_uint16
+    L.hal_crc16.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+
+
+def reset():
+    """清除量測點、模擬 slave 與統計，每個測試從空的匯流排開始"""
+    hal_bus.stop_acquisition()
+    L.hal_point_clear()
+    L.hal_sim_reset()
+    hal_bus.reset_stats()
+    hal_bus.set_max_gap(8)
+    hal_bus.set_log_level(hal_bus.HAL_LOG_LEVEL_ERROR)
+
+
+def sim_bus(device, **overrides):
+    """設定 device 的模擬匯流排：不實際等待、不自動建立 slave、預設無錯誤注入"""
+    cfg = hal_bus.HalSimConfig()
+    L.hal_sim_default_config(ctypes.byref(cfg))
+    cfg.realtime = 0
+    cfg.auto_slaves = 0
+    for name, value in overrides.items():
+        setattr(cfg, name, value)
+    assert L.hal_sim_configure(device.encode(), ctypes.byref(cfg)) == 0
+
+
+def poll_all():
+    """輪詢所有 frame (不論是否到期) 並更新讀取緩衝區"""
+    frames = L.hal_sched_poll_port(None)
+    hal_bus.refresh()
+    return frames
+
+
+def sim_register(device, slave, reg):
+    value = ctypes.c_uint16()
+    assert L.hal_sim_get_register(device.encode(), slave, reg, ctypes.byref(value)) == 0
+    return value.value
+
+
+def port_stats(device):
+    return next(s for s in hal_bus.get_stats() if s['device'] == device and s['slave'] == -1)
+
+
+def test_fc03_coalescing_and_decode():
+    """相鄰的暫存器合併成一個 FC03，各資料型態正確解碼 (32 位元為高位 word 在前)"""
+    print("=== 1. FC03 合併與解碼 ===")
+    reset()
+    dev = 'sim://test-decode'
+    sim_bus(dev)
+    assert L.hal_sim_add_slave(dev.encode(), 1, 0, 64) == 0
+
+    f32 = struct.unpack('>HH', struct.pack('>f', -12.5))
+    registers = {0: 253, 1: 0xFFF6, 2: 0x0001, 3: 0x0002, 4: f32[0], 5: f32[1], 40: 7}
+    for reg, value in registers.items():
+        assert hal_bus.set_sim_register(dev, 1, reg, value)
+
+    points = [
+        hal_bus.register_point(dev, 1, 0, hal_bus.HAL_VALUE_U16, 0.1),
+        hal_bus.register_point(dev, 1, 1, hal_bus.HAL_VALUE_S16, 1.0),
+        hal_bus.register_point(dev, 1, 2, hal_bus.HAL_VALUE_U32, 1.0),
+        hal_bus.register_point(dev, 1, 4, hal_bus.HAL_VALUE_F32, 1.0),
+        hal_bus.register_point(dev, 1, 40, hal_bus.HAL_VALUE_U16, 1.0),  # 超過合併門檻，另一個 frame
+    ]
+    assert None not in points
+    frames = L.hal_sched_frame_count()
+    print(f"5 個量測點 -> {frames} 個 frame")
+    assert frames == 2
+
+    assert poll_all() == 2
+    assert port_stats(dev)['requests'] == 2
+    values = [hal_bus.read_point(h) for h in points]
+    print(f"解碼結果: {values}")
+    assert abs(values[0] - 25.3) < 1e-4
+    assert values[1] == -10
+    assert values[2] == 0x00010002
+    assert values[3] == -12.5
+    assert values[4] == 7
+
+    # 合併門檻為 0 時只合併連續的暫存器
+    hal_bus.set_max_gap(0)
+    hal_bus.register_point(dev, 1, 8, hal_bus.HAL_VALUE_U16, 1.0)
+    assert L.hal_sched_frame_count() == 3
+
+
+def test_crc_and_exceptions():
+    """CRC 錯誤與例外回應計入統計，量測點品質變為 BAD，不影響同一匯流排上的其他 frame"""
+    print("=== 2. CRC 與例外回應 ===")
+    reset()
+    frame = bytes([0x01, 0x03, 0x00, 0x00, 0x00, 0x0A])
+    assert L.hal_crc16(frame, len(frame)) == 0xCDC5
+
+    dev = 'sim://test-crc'
+    sim_bus(dev, crc_error_ppm=1000000)
+    assert L.hal_sim_add_slave(dev.encode(), 1, 0, 8) == 0
+    h = hal_bus.register_point(dev, 1, 0)
+    poll_all()
+    stats = port_stats(dev)
+    print(f"CRC 錯誤: requests={stats['requests']} crc_errors={stats['crc_errors']}")
+    assert stats['crc_errors'] >= 1 and stats['responses'] == 0
+    assert hal_bus.read_point(h) is None
+    assert hal_bus.read_sample(h).quality == hal_bus.HAL_QUALITY_BAD
+
+    dev = 'sim://test-exception'
+    sim_bus(dev)
+    assert L.hal_sim_add_slave(dev.encode(), 1, 0, 8) == 0
+    assert hal_bus.set_sim_register(dev, 1, 2, 42)
+    good = hal_bus.register_point(dev, 1, 2)
+    bad = hal_bus.register_point(dev, 1, 100)     # 不在 slave 的暫存器區段內 -> 例外 0x02
+    poll_all()
+    stats = port_stats(dev)
+    print(f"例外回應: exceptions={stats['exceptions']} good={hal_bus.read_point(good)}")
+    assert stats['exceptions'] >= 1
+    assert hal_bus.read_point(good) == 42
+    assert hal_bus.read_sample(bad).quality == hal_bus.HAL_QUALITY_BAD
+
+
+def error_sequence(dev, handle, cycles):
+    """重設模擬器後輪詢 cycles 次，返回每次的 (品質, 原始值)"""
+    L.hal_sim_reset()
+    assert L.hal_sim_add_slave(dev.encode(), 1, 0, 8) == 0
+    sequence = []
+    for _ in range(cycles):
+        poll_all()
+        sample = hal_bus.read_sample(handle)
+        sequence.append((sample.quality, sample.raw if sample.quality == hal_bus.HAL_QUALITY_GOOD else None))
+    return sequence
+
+
+def test_deterministic_errors():
+    """相同的種子與請求序列得到相同的超時、CRC 錯誤與暫存器初始值"""
+    print("=== 3. 確定性錯誤注入 ===")
+    reset()
+    dev = 'sim://test-seed'
+    sim_bus(dev, timeout_ppm=300000, crc_error_ppm=200000, seed=1234)
+    h = hal_bus.register_point(dev, 1, 3)
+    first = error_sequence(dev, h, 40)
+    second = error_sequence(dev, h, 40)
+    bad = sum(1 for quality, _ in first if quality == hal_bus.HAL_QUALITY_BAD)
+    print(f"40 次輪詢中 {bad} 次失敗")
+    assert first == second
+    assert 0 < bad < 40
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_fc03_coalescing_and_decode, test_crc_and_exceptions, test_deterministic_errors]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
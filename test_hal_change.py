@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+測試死區與遲滯的變更事件 (以本機的 Modbus TCP slave 執行緒執行，不需要硬體)
+1. 超出死區才產生事件，反向變化需再多超過遲滯，品質改變一律回報
+2. 背景擷取運作時 wait_changes() 阻塞到下一個事件
+3. 重設快照表 (安裝量測點表) 保留死區設定，清除量測點時一併移除
+用法: make -C hal 之後執行 python test_hal_change.py
+"""
+
+import os
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_tcp import ModbusTcpSlave, poll_all, reset
+
+
+def changes_for(handle, timeout_ms=0):
+    return [(round(value, 3), quality) for h, value, quality, _ in hal_bus.wait_changes(timeout_ms) if h == handle]
+
+
+def test_deadband_events():
+    """超出死區才產生事件，反向變化需再多超過遲滯，品質改變一律回報"""
+    print("=== 1. 死區與遲滯 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,))
+    try:
+        h = hal_bus.register_point(slave.device, 1, 0, deadband=5.0, hysteresis=2.0)
+        hal_bus.wait_changes(0)
+
+        expected = [
+            (100, [(100, hal_bus.HAL_QUALITY_GOOD)]),   # 第一次取樣
+            (103, []),
+            (105, [(105, hal_bus.HAL_QUALITY_GOOD)]),   # +5
+            (102, []),
+            (99, []),                                   # -6，反向需要 7
+            (98, [(98, hal_bus.HAL_QUALITY_GOOD)]),     # -7
+            (93, [(93, hal_bus.HAL_QUALITY_GOOD)]),     # -5，同方向
+        ]
+        for value, events in expected:
+            slave.registers[(1, 0)] = value
+            poll_all()
+            got = changes_for(h)
+            print(f"  {value:4d} -> {got}")
+            assert got == events, (value, got)
+
+        # slave 不再回應 -> BAD 事件帶最後一次有效值，之後不再重複回報
+        slave.units.clear()
+        poll_all()
+        assert changes_for(h) == [(93, hal_bus.HAL_QUALITY_BAD)]
+        poll_all()
+        assert changes_for(h) == []
+    finally:
+        slave.close()
+
+
+def test_wait_blocks_until_change():
+    """背景擷取發布超出死區的取樣時喚醒 wait_changes()"""
+    print("=== 2. 阻塞等待變更 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,))
+    try:
+        h = hal_bus.register_point(slave.device, 1, 3, deadband=1.0)
+        slave.registers[(1, 3)] = 10
+        assert hal_bus.start_acquisition(20)
+        assert changes_for(h, 2000) == [(10, hal_bus.HAL_QUALITY_GOOD)]
+        assert changes_for(h, 100) == []
+
+        slave.registers[(1, 3)] = 12
+        start = time.monotonic()
+        got = changes_for(h, 2000)
+        print(f"  {got} 等待 {(time.monotonic() - start) * 1000:.0f} ms")
+        assert got == [(12, hal_bus.HAL_QUALITY_GOOD)]
+        assert hal_bus.change_overflows() == 0
+    finally:
+        hal_bus.stop_acquisition()
+        slave.close()
+
+
+def test_reset_keeps_deadband():
+    """安裝量測點表重設快照與回報狀態，但 handle 的死區不變；清除量測點後重新註冊的 handle 沒有死區"""
+    print("=== 3. 重設後的死區設定 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,))
+    try:
+        h = hal_bus.register_point(slave.device, 1, 0, deadband=5.0)
+        for value, events in ((100, [(100, hal_bus.HAL_QUALITY_GOOD)]), (103, [])):
+            slave.registers[(1, 0)] = value
+            poll_all()
+            assert changes_for(h) == events, value
+
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, 'points.bin')
+            assert hal_bus.save_point_table(path)
+            assert hal_bus.configure_point_table(path)
+        # 重設後的第一次取樣一律回報，之後仍套用死區 5
+        for value, events in ((103, [(103, hal_bus.HAL_QUALITY_GOOD)]), (106, []),
+                              (108, [(108, hal_bus.HAL_QUALITY_GOOD)])):
+            slave.registers[(1, 0)] = value
+            poll_all()
+            got = changes_for(h)
+            print(f"  {value:4d} -> {got}")
+            assert got == events, (value, got)
+
+        reset()
+        assert hal_bus.register_point(slave.device, 1, 0) == h
+        for value in (110, 111):
+            slave.registers[(1, 0)] = value
+            poll_all()
+            assert changes_for(h) == [(value, hal_bus.HAL_QUALITY_GOOD)], value
+    finally:
+        slave.close()
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_deadband_events, test_wait_blocks_until_change, test_reset_keeps_deadband]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
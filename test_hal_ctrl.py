@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+測試原生 PID 控制迴圈 (以模擬匯流排 sim:// 執行，不需要硬體)
+1. 比例項的步階響應與輸出寫入模擬 VFD 的暫存器
+2. anti-windup：輸出飽和時積分停止累加，目標值反轉後立即離開飽和
+3. 閉迴路：一階受控體收斂到目標值
+4. 無衝擊切換：重新啟用時輸出等於停用前的輸出
+5. 過程值過期時保持輸出且不累加積分
+控制執行緒以實際時間執行，每個測試約 1-3 秒。
+用法: make -C hal 之後執行 python test_hal_ctrl.py
+"""
+
+import os
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, reset, sim_bus, sim_register
+
+DEV = 'sim://test-ctrl'
+VFD_SLAVE = 1
+VFD_REG = 0x1000
+PV_SLAVE = 5
+
+
+def setup_loop(setpoint, **gains):
+    """PV 為 slave 5 reg 0 (scale 0.01)，輸出寫到 slave 1 reg 0x1000，背景擷取負責送出寫入"""
+    hal_bus.stop_control()
+    L.hal_ctrl_clear()
+    reset()
+    sim_bus(DEV)
+    assert L.hal_sim_add_slave(DEV.encode(), VFD_SLAVE, 0, 0x2000) == 0
+    assert L.hal_sim_add_slave(DEV.encode(), PV_SLAVE, 0, 16) == 0
+    pv = hal_bus.register_point(DEV, PV_SLAVE, 0, hal_bus.HAL_VALUE_U16, 0.01, poll_period_ms=10)
+    loop = hal_bus.add_control_loop(DEV, VFD_SLAVE, VFD_REG, pv, setpoint, **gains)
+    assert loop is not None
+    return loop
+
+
+def set_pv(value):
+    assert hal_bus.set_sim_register(DEV, PV_SLAVE, 0, int(round(value * 100)))
+
+
+def run(loop, seconds):
+    assert hal_bus.start_acquisition(10)
+    assert hal_bus.enable_control(loop, True)
+    assert hal_bus.start_control(100)
+    time.sleep(seconds)
+
+
+def stop():
+    hal_bus.stop_control()
+    hal_bus.stop_acquisition()
+
+
+def test_proportional_step():
+    """純比例：輸出 = bias + Kp * (setpoint - pv)，寫入 VFD 暫存器"""
+    print("=== 1. 比例步階響應 ===")
+    loop = setup_loop(2.0, kp=400.0, bias=1000.0, out_max=3000.0)
+    set_pv(1.0)
+    try:
+        run(loop, 0.3)
+        status = hal_bus.control_status(loop)
+        print(f"pv={status['pv']:.2f} output={status['output']:.1f} writes={status['writes']}")
+        assert abs(status['output'] - 1400.0) < 0.5 and not status['saturated']
+        assert sim_register(DEV, VFD_SLAVE, VFD_REG) == 1400
+
+        # 目標值步階
+        assert hal_bus.set_control_target(loop, 2.5)
+        time.sleep(0.2)
+        assert abs(hal_bus.control_status(loop)['output'] - 1600.0) < 0.5
+        assert sim_register(DEV, VFD_SLAVE, VFD_REG) == 1600
+        assert hal_bus.control_status(loop)['write_errors'] == 0
+    finally:
+        stop()
+
+
+def test_anti_windup():
+    """誤差持續往飽和方向時積分保持不變，反向後輸出立即離開上限"""
+    print("=== 2. anti-windup ===")
+    loop = setup_loop(2.0, kp=100.0, ki=500.0, bias=1000.0, out_max=1200.0)
+    set_pv(1.0)
+    try:
+        run(loop, 1.0)
+        status = hal_bus.control_status(loop)
+        print(f"飽和: output={status['output']:.1f} integral={status['integral']:.1f} saturated={status['saturated']}")
+        # 沒有 anti-windup 時 1 秒後積分約為 500
+        assert status['saturated'] and status['output'] == 1200.0
+        assert status['integral'] < 120.0
+        assert sim_register(DEV, VFD_SLAVE, VFD_REG) == 1200
+
+        assert hal_bus.set_control_target(loop, 0.0)
+        time.sleep(0.1)
+        status = hal_bus.control_status(loop)
+        print(f"反向: output={status['output']:.1f} saturated={status['saturated']}")
+        assert not status['saturated'] and status['output'] < 1100.0
+    finally:
+        stop()
+
+
+def test_closed_loop():
+    """一階受控體 (pv = 轉速 / 1000，時間常數約 0.2 秒) 在 PI 控制下收斂到目標值"""
+    print("=== 3. 閉迴路收斂 ===")
+    loop = setup_loop(1.5, kp=400.0, ki=1500.0, bias=1000.0, out_min=600.0, out_max=3000.0)
+    set_pv(0.0)
+    running = True
+
+    def plant():
+        pv = 0.0
+        while running:
+            pv += (sim_register(DEV, VFD_SLAVE, VFD_REG) / 1000.0 - pv) * 0.05
+            set_pv(pv)
+            time.sleep(0.01)
+
+    thread = threading.Thread(target=plant)
+    thread.start()
+    try:
+        run(loop, 3.0)
+        status = hal_bus.control_status(loop)
+        print(f"pv={status['pv']:.3f} output={status['output']:.0f} integral={status['integral']:.0f}")
+        assert abs(status['pv'] - 1.5) < 0.05
+        assert status['bad_pv'] == 0
+    finally:
+        running = False
+        thread.join()
+        stop()
+
+
+def test_bumpless_enable():
+    """停用期間改變目標值與增益，重新啟用後輸出仍等於停用前的輸出"""
+    print("=== 4. 無衝擊切換 ===")
+    loop = setup_loop(2.0, kp=400.0, bias=1000.0, out_max=3000.0)
+    set_pv(1.0)
+    try:
+        run(loop, 0.3)
+        assert sim_register(DEV, VFD_SLAVE, VFD_REG) == 1400
+        assert hal_bus.enable_control(loop, False)
+        assert hal_bus.set_control_target(loop, 2.5)
+        assert hal_bus.set_control_gains(loop, 800.0, 0.0, 0.0)
+        writes = hal_bus.control_status(loop)['writes']
+
+        # 誤差 1.5，比例項 1200；只以基準初始化積分時輸出會跳到 2200
+        assert hal_bus.enable_control(loop, True)
+        time.sleep(0.2)
+        status = hal_bus.control_status(loop)
+        print(f"output={status['output']:.1f} integral={status['integral']:.1f}")
+        assert abs(status['output'] - 1400.0) < 0.5 and abs(status['integral'] + 800.0) < 0.5
+        assert sim_register(DEV, VFD_SLAVE, VFD_REG) == 1400
+        assert status['writes'] == writes and status['write_errors'] == 0
+    finally:
+        stop()
+
+
+def test_stale_pv():
+    """擷取停止後過程值品質仍為 GOOD 但不再更新：計入 bad_pv，積分與輸出保持"""
+    print("=== 5. 過期的過程值 ===")
+    loop = setup_loop(2.0, kp=100.0, ki=200.0, bias=1000.0, out_max=3000.0)
+    set_pv(1.0)
+    try:
+        run(loop, 0.3)
+        L.hal_acq_stop()                # 控制執行緒繼續運作 (hal_bus.stop_acquisition 會一併停止)
+        time.sleep(0.1)
+        before = hal_bus.control_status(loop)
+        time.sleep(0.3)
+        after = hal_bus.control_status(loop)
+        print(f"bad_pv {before['bad_pv']} -> {after['bad_pv']}, integral {before['integral']:.1f} -> {after['integral']:.1f}")
+        assert after['bad_pv'] - before['bad_pv'] >= 20
+        assert after['integral'] == before['integral'] and after['output'] == before['output']
+
+        # 恢復輪詢後積分繼續累加
+        assert hal_bus.start_acquisition(10)
+        time.sleep(0.2)
+        resumed = hal_bus.control_status(loop)
+        assert resumed['integral'] > after['integral']
+        assert resumed['bad_pv'] - after['bad_pv'] < 5
+    finally:
+        stop()
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_proportional_step, test_anti_windup, test_closed_loop, test_bumpless_enable, test_stale_pv]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
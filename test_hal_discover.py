@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+測試匯流排探測與拓樸快取 (以模擬匯流排 sim:// 執行，不需要硬體)
+1. 冷啟動探測找出 slave 與暫存器區段並寫入快取；再次探測以快取驗證，不重新掃描
+2. 快取中的 slave 消失時改為完整掃描；格式錯誤的快取被拒絕
+用法: make -C hal 之後執行 python test_hal_discover.py
+"""
+
+import ctypes
+import os
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, poll_all, reset, sim_bus
+
+if L is not None:
+    L.hal_discover_load.restype = ctypes.c_int
+    L.hal_discover_load.argtypes = [ctypes.c_char_p]
+
+BUSES = {'sim://test-disc-a': (3, 7, 12), 'sim://test-disc-b': (5,)}
+SCAN = {'slave_first': 1, 'slave_last': 20, 'probe_timeout_ms': 20, 'reg_first': 0, 'reg_last': 127, 'reg_block': 8}
+
+
+def setup_buses():
+    reset()
+    for device, slaves in BUSES.items():
+        sim_bus(device)
+        for slave in slaves:
+            assert L.hal_sim_add_slave(device.encode(), slave, 0, 40) == 0
+            assert L.hal_sim_add_slave(device.encode(), slave, 96, 8) == 0
+
+
+def found(topology, device):
+    return [s['slave'] for s in topology[device]['slaves']]
+
+
+def test_cache_verify():
+    """冷啟動探測結果寫入快取，之後的探測只驗證快取中的 slave"""
+    print("=== 1. 探測與快取驗證 ===")
+    setup_buses()
+    with tempfile.TemporaryDirectory() as tmp:
+        cache = os.path.join(tmp, 'topology.cache')
+        topology = hal_bus.discover(list(BUSES), cache, **SCAN)
+        for device, slaves in BUSES.items():
+            print(f"  {device}: {found(topology, device)} from_cache={topology[device]['from_cache']}")
+            assert found(topology, device) == list(slaves)
+            assert not topology[device]['from_cache']
+        assert topology['sim://test-disc-a']['slaves'][0]['ranges'] == [(0, 40), (96, 8)]
+        assert os.path.exists(cache)
+
+        topology = hal_bus.discover(list(BUSES), cache, **SCAN)
+        for device, slaves in BUSES.items():
+            assert topology[device]['from_cache'] and found(topology, device) == list(slaves)
+
+        assert hal_bus.slave_present('sim://test-disc-a', 7)
+        assert hal_bus.slave_present('sim://test-disc-a', 8) is False
+        assert hal_bus.slave_present('sim://test-disc-a', 100) is None
+
+        # 排程器只輪詢存在的 slave，不存在的 slave 直接標為 BAD
+        present = hal_bus.register_point('sim://test-disc-a', 7, 1)
+        missing = hal_bus.register_point('sim://test-disc-a', 9, 1)
+        poll_all()
+        assert hal_bus.read_sample(present).quality == hal_bus.HAL_QUALITY_GOOD
+        assert hal_bus.read_sample(missing).quality == hal_bus.HAL_QUALITY_BAD
+
+
+def test_cache_fallback():
+    """快取與匯流排不符時重新完整掃描並更新快取，格式錯誤的快取被拒絕"""
+    print("=== 2. 快取失效 ===")
+    setup_buses()
+    with tempfile.TemporaryDirectory() as tmp:
+        cache = os.path.join(tmp, 'topology.cache')
+        assert hal_bus.discover(['sim://test-disc-a'], cache, **SCAN) is not None
+
+        # slave 7 與 12 消失
+        L.hal_sim_reset()
+        assert L.hal_sim_add_slave(b'sim://test-disc-a', 3, 0, 40) == 0
+        topology = hal_bus.discover(['sim://test-disc-a'], cache, **SCAN)
+        print(f"  重新掃描: {found(topology, 'sim://test-disc-a')}")
+        assert not topology['sim://test-disc-a']['from_cache']
+        assert found(topology, 'sim://test-disc-a') == [3]
+        topology = hal_bus.discover(['sim://test-disc-a'], cache, **SCAN)
+        assert topology['sim://test-disc-a']['from_cache'] and found(topology, 'sim://test-disc-a') == [3]
+
+        with open(cache, 'w') as f:
+            f.write('version 1\nport sim://test-disc-a 1 x\n')
+        assert L.hal_discover_load(cache.encode()) == -1
+        topology = hal_bus.discover(['sim://test-disc-a'], cache, **SCAN)
+        assert not topology['sim://test-disc-a']['from_cache'] and found(topology, 'sim://test-disc-a') == [3]
+
+        assert hal_bus.discover(['sim://test-disc-a'], None, slave_first=0) is None
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_cache_verify, test_cache_fallback]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+測試量測點訊號調理 (以模擬匯流排 sim:// 執行，不需要硬體)
+1. median-of-3 濾掉單一突波，EMA 平滑，單位換算；raw 仍為原始暫存器內容
+2. 同一 frame 中 4 個以上量測點走 SIMD 路徑，結果與單一量測點 (逐點路徑) 相同
+3. 變化率限制依取樣間隔限制每次的變化量
+4. hal_filter_apply (SIMD) 與 hal_filter_apply_scalar 對隨機輸入、NaN、飽和與 median 暖機位元相同
+用法: make -C hal 之後執行 python test_hal_filter.py
+"""
+
+import ctypes
+import math
+import os
+import random
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, poll_all, reset, sim_bus
+
+if L is not None:
+    for name in ('hal_filter_apply', 'hal_filter_apply_scalar'):
+        getattr(L, name).restype = None
+        getattr(L, name).argtypes = [ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_float),
+                                     ctypes.c_int, ctypes.c_uint64]
+
+DEV = 'sim://test-filter'
+
+
+def setup_bus():
+    reset()
+    sim_bus(DEV)
+    for slave in (1, 2):
+        assert L.hal_sim_add_slave(DEV.encode(), slave, 0, 16) == 0
+
+
+def test_median_ema_gain():
+    """突波被 median 濾掉，EMA 與單位換算依序套用"""
+    print("=== 1. median / EMA / 單位換算 ===")
+    setup_bus()
+    med = hal_bus.register_point(DEV, 1, 0, filter={'median': 3})
+    ema = hal_bus.register_point(DEV, 1, 1, filter={'ema_alpha': 0.5})
+    conv = hal_bus.register_point(DEV, 1, 2, filter={'gain': 2.0, 'offset': 1.0})
+    plain = hal_bus.register_point(DEV, 1, 3)
+
+    seen = []
+    for value in (100, 100, 100, 5000, 100, 100):
+        assert hal_bus.set_sim_register(DEV, 1, 0, value)
+        poll_all()
+        seen.append(hal_bus.read_point(med))
+    print(f"median: {seen}")
+    assert max(seen) == 100.0
+    assert hal_bus.read_sample(med).raw == 100
+
+    # 重新設定後濾波狀態從下一次取樣開始
+    assert hal_bus.set_point_filter(ema, ema_alpha=0.5)
+    outputs = []
+    for value in (0, 100, 100, 100):
+        assert hal_bus.set_sim_register(DEV, 1, 1, value)
+        poll_all()
+        outputs.append(hal_bus.read_point(ema))
+    print(f"EMA: {outputs}")
+    assert outputs == [0.0, 50.0, 75.0, 87.5]
+
+    for reg in (2, 3):
+        assert hal_bus.set_sim_register(DEV, 1, reg, 10)
+    poll_all()
+    assert hal_bus.read_point(conv) == 21.0 and hal_bus.read_sample(conv).raw == 10
+    assert hal_bus.read_point(plain) == 10.0
+
+    # 移除濾波後輸出原始值
+    assert L.hal_point_set_filter(conv, None) == 0
+    poll_all()
+    assert hal_bus.read_point(conv) == 10.0
+
+
+def test_simd_matches_scalar():
+    """slave 1 的 5 個量測點一起調理 (SIMD)，slave 2 只有 1 個 (逐點)，相同輸入得到相同輸出"""
+    print("=== 2. SIMD 與逐點路徑 ===")
+    setup_bus()
+    cfg = {'median': 5, 'ema_alpha': 0.3, 'gain': 0.1, 'offset': -2.0}
+    batch = [hal_bus.register_point(DEV, 1, reg, filter=cfg) for reg in range(5)]
+    single = hal_bus.register_point(DEV, 2, 0, filter=cfg)
+    for step, value in enumerate((10, 900, 12, 15, 3, 3, 700, 700, 700, 20, 0, 65535)):
+        for reg in range(5):
+            assert hal_bus.set_sim_register(DEV, 1, reg, value)
+        assert hal_bus.set_sim_register(DEV, 2, 0, value)
+        poll_all()
+        expected = hal_bus.read_point(single)
+        got = [hal_bus.read_point(h) for h in batch]
+        assert got == [expected] * 5, (step, got, expected)
+    print(f"最後輸出 {expected}")
+
+
+def test_rate_limit():
+    """max_rate 為每秒 100 時，約 0.1 秒後的步階只前進約 10"""
+    print("=== 3. 變化率限制 ===")
+    setup_bus()
+    h = hal_bus.register_point(DEV, 1, 0, filter={'max_rate': 100.0})
+    assert hal_bus.set_sim_register(DEV, 1, 0, 0)
+    poll_all()
+    assert hal_bus.read_point(h) == 0.0
+    time.sleep(0.1)
+    assert hal_bus.set_sim_register(DEV, 1, 0, 1000)
+    poll_all()
+    value = hal_bus.read_point(h)
+    print(f"0.1 秒後: {value:.2f}")
+    assert 5.0 < value < 30.0
+    assert hal_bus.read_sample(h).raw == 1000
+
+
+def bits(values):
+    return [struct.unpack('<I', struct.pack('<f', v))[0] for v in values]
+
+
+def test_scalar_bit_exact():
+    """兩組 handle 設定相同的濾波，分別以 SIMD 與逐點路徑調理相同的輸入，每一步的輸出位元相同"""
+    print("=== 4. SIMD 與逐點路徑位元相同 ===")
+    reset()
+    rng = random.Random(20261014)
+    n = 37                              # 不是 4 的倍數，包含 SIMD 迴圈的尾端
+    simd = (ctypes.c_int * n)(*range(n))
+    scalar = (ctypes.c_int * n)(*range(100, 100 + n))
+    configs = []
+    for i in range(n):
+        cfg = {'median': (1, 3, 5)[i % 3], 'ema_alpha': rng.choice((1.0, 0.5, rng.uniform(0.01, 1.0))),
+               'max_rate': rng.choice((0.0, 0.0, rng.uniform(1.0, 1e4))),
+               'gain': 3e38 if i % 8 == 7 else rng.choice((1.0, rng.uniform(-100.0, 100.0))), 'offset': rng.uniform(-1e3, 1e3)}
+        configs.append(cfg)
+        assert hal_bus.set_point_filter(simd[i], **cfg) and hal_bus.set_point_filter(scalar[i], **cfg)
+
+    specials = (math.nan, -math.nan, math.inf, -math.inf, 3.4e38, -3.4e38, 0.0, -0.0, 1e-45)
+    timestamp = 1_000_000
+    nonfinite = 0
+    for step in range(400):
+        if step in (150, 300):
+            # 重新設定一部分量測點，median 從新的暖機開始
+            for i in range(0, n, 4):
+                assert hal_bus.set_point_filter(simd[i], **configs[i])
+                assert hal_bus.set_point_filter(scalar[i], **configs[i])
+        inputs = [rng.choice(specials) if rng.random() < 0.01 else rng.uniform(-7e4, 7e4) for _ in range(n)]
+        timestamp += rng.randint(0, 20000)
+        a = (ctypes.c_float * n)(*inputs)
+        b = (ctypes.c_float * n)(*inputs)
+        L.hal_filter_apply(simd, a, n, timestamp)
+        L.hal_filter_apply_scalar(scalar, b, n, timestamp)
+        assert bits(a) == bits(b), (step, [i for i in range(n) if bits(a)[i] != bits(b)[i]])
+        nonfinite += sum(1 for v in a if not math.isfinite(v))
+    print(f"400 步 x {n} 個量測點，{nonfinite} 個非有限輸出")
+    assert 0 < nonfinite < 400 * n // 2
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_median_ema_gain, test_simd_matches_scalar, test_rate_limit, test_scalar_bit_exact]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+測試量測點歷史紀錄 (以模擬匯流排 sim:// 執行，不需要硬體)
+1. 原始取樣環形緩衝區：只保留最新的 HAL_HISTORY_RAW_SIZE 筆，依時間排序，BAD 取樣帶最後一次有效值
+2. 1 秒彙總：區間結束後才出現，min / max / avg 只統計品質良好的取樣，讀取失敗計入 bad
+用法: make -C hal 之後執行 python test_hal_history.py
+"""
+
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, poll_all, reset, sim_bus
+
+DEV = 'sim://test-history'
+
+
+def setup_point():
+    reset()
+    sim_bus(DEV)
+    assert L.hal_sim_add_slave(DEV.encode(), 1, 0, 8) == 0
+    return hal_bus.register_point(DEV, 1, 0)
+
+
+def test_raw_ring():
+    """超過容量後只保留最新的取樣，時間範圍查詢與 max_points 限制"""
+    print("=== 1. 原始取樣 ===")
+    h = setup_point()
+    total = hal_bus.HAL_HISTORY_RAW_SIZE + 44
+    for value in range(total):
+        assert hal_bus.set_sim_register(DEV, 1, 0, value)
+        poll_all()
+    samples = hal_bus.read_history(h)
+    print(f"{total} 次輪詢 -> {len(samples)} 筆")
+    assert len(samples) == hal_bus.HAL_HISTORY_RAW_SIZE
+    assert [v for _, v, _ in samples] == list(range(total - hal_bus.HAL_HISTORY_RAW_SIZE, total))
+    stamps = [t for t, _, _ in samples]
+    assert stamps == sorted(stamps)
+    assert abs(stamps[-1] / 1e6 - time.time()) < 5.0    # Unix epoch 微秒
+
+    since = stamps[100]
+    assert hal_bus.read_history(h, since_us=since)[0][0] >= since
+    assert [v for _, v, _ in hal_bus.read_history(h, max_points=3)] == [total - 3, total - 2, total - 1]
+    assert hal_bus.read_history(h, until_us=stamps[0]) == []
+
+    # 讀取失敗 -> BAD 取樣帶最後一次有效值
+    L.hal_sim_reset()
+    poll_all()
+    timestamp, value, quality = hal_bus.read_history(h, max_points=1)[0]
+    assert quality == hal_bus.HAL_QUALITY_BAD and value == total - 1 and timestamp >= stamps[-1]
+
+
+def test_second_buckets():
+    """1 秒區間在下一個區間開始後出現，統計值與取樣一致"""
+    print("=== 2. 1 秒彙總 ===")
+    h = setup_point()
+    assert hal_bus.read_history(h, '1s') == []
+    value = 0
+    start = time.monotonic()
+    while time.monotonic() - start < 2.3:
+        assert hal_bus.set_sim_register(DEV, 1, 0, value % 50)
+        poll_all()
+        value += 1
+        time.sleep(0.02)
+    # 之後約 1 秒讀取失敗
+    L.hal_sim_reset()
+    start = time.monotonic()
+    while time.monotonic() - start < 1.2:
+        poll_all()
+        time.sleep(0.02)
+
+    buckets = hal_bus.read_history(h, '1s')
+    print(f"{len(buckets)} 個完成的區間: {[(b[4], b[5]) for b in buckets]}")
+    assert len(buckets) >= 2
+    for timestamp, lo, hi, avg, good, bad in buckets:
+        if good:
+            assert lo <= avg <= hi and 0 <= lo and hi < 50
+    stamps = [b[0] for b in buckets]
+    assert all((b - a) % 1000000 == 0 and b > a for a, b in zip(stamps, stamps[1:]))
+    assert sum(b[5] for b in buckets) > 0
+    assert all(good + bad <= 60 for _, _, _, _, good, bad in buckets)     # 每 20 ms 一次取樣
+    assert len(hal_bus.read_history(h, '1min')) <= 1      # 測試期間最多跨過一個整分
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_raw_ring, test_second_buckets]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+測試預先編譯的量測點表 (以模擬匯流排 sim:// 執行，不需要硬體)
+1. 儲存 -> 載入後量測點、handle 與 frame 相同，Block 重新註冊得到表中的 handle
+2. 損壞的二進位檔 (CRC 錯誤、CRC 正確但請求 frame 不符) 被拒絕，目前的量測點不受影響
+用法: make -C hal 之後執行 python test_hal_ptable.py
+"""
+
+import ctypes
+import os
+import struct
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, poll_all, reset, sim_bus
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'hal', 'tools'))
+import gen_point_table
+
+if L is not None:
+    L.hal_point_count.restype = ctypes.c_int
+    L.hal_point_count.argtypes = []
+
+DEV = 'sim://test-ptable'
+FRAME_REQUEST_OFFSET = 28   # hal_ptable_frame_t.request
+
+
+def register_points():
+    return [
+        hal_bus.register_point(DEV, 4, 0, hal_bus.HAL_VALUE_U16, 0.1, 1000, 0),
+        hal_bus.register_point(DEV, 4, 1, hal_bus.HAL_VALUE_S16, 1.0, 1000, 0),
+        hal_bus.register_point(DEV, 5, 2, hal_bus.HAL_VALUE_U16, 0.01, 100, 10),
+    ]
+
+
+def setup_table(path):
+    """註冊量測點並存成二進位檔，返回檔案內容"""
+    reset()
+    sim_bus(DEV)
+    for slave in (4, 5):
+        assert L.hal_sim_add_slave(DEV.encode(), slave, 0, 16) == 0
+    assert register_points() == [0, 1, 2]
+    assert hal_bus.save_point_table(path)
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def test_install_round_trip():
+    """載入存檔的表後 handle、frame 與解碼結果相同，重新註冊不會重建計畫"""
+    print("=== 1. 量測點表安裝 ===")
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'points.bin')
+        data = setup_table(path)
+        max_gap, points, order, frames = gen_point_table.parse_table(data)
+        print(f"{len(points)} 個量測點, {len(frames)} 個 frame")
+        assert len(points) == 3 and len(frames) == 2
+        for slave, start, count, _, _, _, _, request in frames:
+            assert request[:2] == bytes([slave, 3]) and struct.unpack('>HH', request[2:6]) == (start, count)
+
+        L.hal_point_clear()
+        assert hal_bus.configure_point_table(path)
+        assert L.hal_point_count() == 3 and L.hal_sched_frame_count() == 2
+        assert register_points() == [0, 1, 2]
+        assert L.hal_sched_frame_count() == 2
+
+        assert hal_bus.set_sim_register(DEV, 4, 0, 253)
+        assert hal_bus.set_sim_register(DEV, 4, 1, 0xFFFE)
+        assert hal_bus.set_sim_register(DEV, 5, 2, 150)
+        assert poll_all() == 2
+        values = [hal_bus.read_point(h) for h in range(3)]
+        print(f"解碼結果: {values}")
+        assert abs(values[0] - 25.3) < 1e-4 and values[1] == -2 and abs(values[2] - 1.5) < 1e-4
+
+        # 安裝後的表再存一次應完全相同
+        again = os.path.join(tmp, 'again.bin')
+        assert hal_bus.save_point_table(again)
+        with open(again, 'rb') as f:
+            assert f.read() == data
+
+        # 表中沒有的量測點照常加入並重建計畫
+        assert hal_bus.register_point(DEV, 4, 9) == 3
+        assert L.hal_sched_frame_count() == 3
+
+
+def test_reject_corrupted_table():
+    """CRC 錯誤、長度錯誤與 CRC 正確但請求 frame 被竄改的檔案都被拒絕"""
+    print("=== 2. 拒絕損壞的量測點表 ===")
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'points.bin')
+        data = setup_table(path)
+        n_points = 3
+        frame0 = gen_point_table.HEADER.size + n_points * (gen_point_table.POINT.size + 4)
+
+        bad_crc = bytearray(data)
+        bad_crc[gen_point_table.HEADER.size + 4] ^= 0x01
+        truncated = data[:-3]
+        bad_request = bytearray(data[:-2])
+        bad_request[frame0 + FRAME_REQUEST_OFFSET + 5] ^= 0x01
+        crc = crc16(bad_request)
+        bad_request += bytes([crc & 0xFF, crc >> 8])
+
+        for name, content in (('CRC', bad_crc), ('length', truncated), ('request', bad_request)):
+            bad_path = os.path.join(tmp, f'bad_{name}.bin')
+            with open(bad_path, 'wb') as f:
+                f.write(content)
+            assert not hal_bus.configure_point_table(bad_path), name
+            assert L.hal_point_count() == 3 and L.hal_sched_frame_count() == 2, name
+            print(f"  {name}: 拒絕")
+
+        # 背景擷取運作中不能安裝
+        assert hal_bus.start_acquisition(100)
+        try:
+            assert not hal_bus.configure_point_table(path)
+        finally:
+            hal_bus.stop_acquisition()
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_install_round_trip, test_reject_corrupted_table]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+測試共享記憶體快照表 (以模擬匯流排 sim:// 執行，不需要硬體)
+1. 另一個程序 attach_snapshot() 後以相同定義註冊得到擷取程序的量測點與最新值，且不開啟匯流排
+2. 停止發布後區段標為 inactive，名稱移除後無法再映射
+用法: make -C hal 之後執行 python test_hal_shm.py
+"""
+
+import ctypes
+import json
+import os
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, poll_all, reset, sim_bus
+
+if L is not None:
+    L.hal_shm_is_active.restype = ctypes.c_int
+    L.hal_shm_is_active.argtypes = [ctypes.c_void_p]
+    L.hal_shm_point_count.restype = ctypes.c_int
+    L.hal_shm_point_count.argtypes = [ctypes.c_void_p]
+
+DEV = 'sim://test-shm'
+SHM_NAME = f'cdu_hal_test_{os.getpid()}'
+POINTS = [(1, 0, hal_bus.HAL_VALUE_U16, 0.1), (1, 1, hal_bus.HAL_VALUE_S16, 1.0), (2, 4, hal_bus.HAL_VALUE_U16, 1.0)]
+
+# 讀取程序：attach 後註冊相同的量測點，輸出讀到的值與本程序的匯流排統計
+READER = '''
+import json, sys
+sys.path.insert(0, {root!r})
+from blocks import hal_bus
+hal_bus.attach_snapshot({name!r})
+handles = [hal_bus.register_point({dev!r}, slave, reg, value_type, scale) for slave, reg, value_type, scale in {points!r}]
+hal_bus.refresh()
+print(json.dumps({{'values': [hal_bus.read_point(h) for h in handles], 'stats': len(hal_bus.get_stats())}}))
+'''
+
+
+def read_in_other_process():
+    script = READER.format(root=os.path.dirname(os.path.abspath(__file__)), name=SHM_NAME, dev=DEV, points=POINTS)
+    out = subprocess.run([sys.executable, '-c', script], capture_output=True, text=True, timeout=30)
+    assert out.returncode == 0, out.stderr
+    return json.loads(out.stdout.strip().splitlines()[-1])
+
+
+def setup_publisher():
+    reset()
+    sim_bus(DEV)
+    for slave in (1, 2):
+        assert L.hal_sim_add_slave(DEV.encode(), slave, 0, 8) == 0
+    handles = [hal_bus.register_point(DEV, slave, reg, value_type, scale) for slave, reg, value_type, scale in POINTS]
+    assert hal_bus.publish_snapshot(SHM_NAME)
+    return handles
+
+
+def test_reader_process():
+    """讀取程序得到與擷取程序相同的值，發布端更新後讀取端看到新值"""
+    print("=== 1. 跨程序讀取 ===")
+    handles = setup_publisher()
+    try:
+        assert hal_bus.set_sim_register(DEV, 1, 0, 253)
+        assert hal_bus.set_sim_register(DEV, 1, 1, 0xFFFE)
+        assert hal_bus.set_sim_register(DEV, 2, 4, 77)
+        poll_all()
+        local = [hal_bus.read_point(h) for h in handles]
+        remote = read_in_other_process()
+        print(f"擷取程序 {local} 讀取程序 {remote['values']}")
+        assert remote['values'] == local
+        assert remote['stats'] == 0                 # 讀取程序沒有開啟匯流排
+
+        assert hal_bus.set_sim_register(DEV, 2, 4, 78)
+        poll_all()
+        assert read_in_other_process()['values'][2] == 78
+
+        # 同一程序內的讀取端
+        reader = L.hal_shm_open(SHM_NAME.encode())
+        assert reader
+        try:
+            assert L.hal_shm_is_active(reader) == 1 and L.hal_shm_point_count(reader) == len(POINTS)
+            assert L.hal_shm_find(reader, DEV.encode(), 2, 4, hal_bus.HAL_VALUE_U16, 1.0) == handles[2]
+            assert L.hal_shm_find(reader, DEV.encode(), 2, 5, hal_bus.HAL_VALUE_U16, 1.0) == -1
+            sample = hal_bus.HalSample()
+            assert L.hal_shm_get(reader, handles[0], ctypes.byref(sample)) == 0
+            assert sample.raw == 253 and sample.quality == hal_bus.HAL_QUALITY_GOOD
+        finally:
+            L.hal_shm_close(reader)
+    finally:
+        L.hal_shm_unpublish()
+
+
+def test_unpublish():
+    """停止發布後已映射的讀取端看到 inactive，新的映射失敗，快照表仍在本程序內更新"""
+    print("=== 2. 停止發布 ===")
+    handles = setup_publisher()
+    reader = L.hal_shm_open(SHM_NAME.encode())
+    assert reader
+    try:
+        L.hal_shm_unpublish()
+        assert L.hal_shm_is_active(reader) == 0
+        assert not L.hal_shm_open(SHM_NAME.encode())
+        assert hal_bus.set_sim_register(DEV, 1, 0, 5)
+        poll_all()
+        assert hal_bus.read_sample(handles[0]).raw == 5
+    finally:
+        L.hal_shm_close(reader)
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_reader_process, test_unpublish]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+"""
+測試 Modbus TCP 傳輸 (以本機的 Modbus TCP slave 執行緒執行，不需要硬體)
+1. 同一連線上的讀取同時在途，slave 以相反順序回應時依 transaction ID 配對
+2. 沒有回應的 unit 超時標為 BAD，不影響同一批的其他交易
+3. transaction ID 相符但 MBAP unit 不符的回應視為協定錯誤
+4. 交易等待回應期間註冊量測點不會被阻塞
+用法: make -C hal 之後執行 python test_hal_tcp.py
+"""
+
+import ctypes
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+
+L = hal_bus.hal_lib
+if L is not None:
+    L.hal_point_clear.restype = None
+    L.hal_point_clear.argtypes = []
+    L.hal_sched_poll_port.restype = ctypes.c_int
+    L.hal_sched_poll_port.argtypes = [ctypes.c_void_p]
+
+
+class ModbusTcpSlave:
+    """本機 Modbus TCP slave：units 中的 unit 回應 FC03/FC06/FC16，暫存器預設為 unit * 1000 + reg
+    收到 hold 筆請求 (或 50 ms 內沒有新的請求) 後才以相反順序回應，記錄同時在途的最大交易數"""
+
+    def __init__(self, units, hold=1, size=0x2000):
+        self.units = set(units)
+        self.hold = hold
+        self.size = size
+        self.registers = {}
+        self.requests = []
+        self.max_inflight = 0
+        self.unit_offset = 0            # 非 0 時回應帶錯誤的 MBAP unit id
+        self._server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self._server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self._server.bind(('127.0.0.1', 0))
+        self._server.listen(4)
+        self._server.settimeout(0.05)
+        self._running = True
+        self._thread = threading.Thread(target=self._serve, daemon=True)
+        self._thread.start()
+
+    @property
+    def device(self):
+        return f'tcp://127.0.0.1:{self._server.getsockname()[1]}'
+
+    def register(self, unit, reg):
+        return self.registers.get((unit, reg), (unit * 1000 + reg) & 0xFFFF)
+
+    def close(self):
+        self._running = False
+        self._thread.join()
+        self._server.close()
+
+    def _serve(self):
+        while self._running:
+            try:
+                conn, _ = self._server.accept()
+            except socket.timeout:
+                continue
+            conn.settimeout(0.05)
+            with conn:
+                self._session(conn)
+
+    def _session(self, conn):
+        buf = b''
+        pending = []
+        while self._running:
+            try:
+                data = conn.recv(4096)
+                if not data:
+                    return
+                buf += data
+            except socket.timeout:
+                data = None
+            while len(buf) >= 7:
+                tid, _, length, unit = struct.unpack('>HHHB', buf[:7])
+                if len(buf) < 6 + length:
+                    break
+                pending.append((tid, unit, buf[7:6 + length]))
+                buf = buf[6 + length:]
+            self.max_inflight = max(self.max_inflight, len(pending))
+            if pending and (len(pending) >= self.hold or data is None):
+                for tid, unit, pdu in reversed(pending):
+                    resp = self._handle(unit, pdu)
+                    if resp is not None:
+                        header = struct.pack('>HHHB', tid, 0, len(resp) + 1, (unit + self.unit_offset) & 0xFF)
+                        conn.sendall(header + resp)
+                pending = []
+
+    def _handle(self, unit, pdu):
+        fc = pdu[0]
+        reg, arg = struct.unpack('>HH', pdu[1:5])
+        self.requests.append((unit, fc, reg, arg))
+        if unit not in self.units:
+            return None
+        if fc == 3:
+            if reg + arg > self.size:
+                return bytes([fc | 0x80, 0x02])
+            values = [self.register(unit, reg + i) for i in range(arg)]
+            return bytes([fc, 2 * arg]) + struct.pack(f'>{arg}H', *values)
+        if fc == 6:
+            if reg >= self.size:
+                return bytes([fc | 0x80, 0x02])
+            self.registers[(unit, reg)] = arg
+            return pdu[:5]
+        if fc == 16:
+            if reg + arg > self.size:
+                return bytes([fc | 0x80, 0x02])
+            for i, value in enumerate(struct.unpack(f'>{arg}H', pdu[6:6 + 2 * arg])):
+                self.registers[(unit, reg + i)] = value
+            return pdu[:5]
+        return bytes([fc | 0x80, 0x01])
+
+
+def reset():
+    """清除量測點與統計，每個測試從空的排程計畫開始"""
+    hal_bus.stop_acquisition()
+    L.hal_point_clear()
+    hal_bus.reset_stats()
+    hal_bus.set_max_gap(8)
+    hal_bus.set_log_level(hal_bus.HAL_LOG_LEVEL_ERROR)
+
+
+def poll_all():
+    """輪詢所有 frame (不論是否到期) 並更新讀取緩衝區"""
+    frames = L.hal_sched_poll_port(None)
+    hal_bus.refresh()
+    return frames
+
+
+def port_stats(device):
+    return next(s for s in hal_bus.get_stats() if s['device'] == device and s['slave'] == -1)
+
+
+def test_pipelined_reads():
+    """4 個 unit 的讀取在同一連線上同時在途，亂序回應仍配對到正確的量測點"""
+    print("=== 1. 同時在途與亂序回應 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1, 2, 3, 4), hold=4)
+    try:
+        points = {(unit, reg): hal_bus.register_point(slave.device, unit, reg)
+                  for unit in (1, 2, 3, 4) for reg in (0, 1)}
+        assert None not in points.values()
+        assert poll_all() == 4
+        print(f"同時在途: {slave.max_inflight} 筆")
+        assert slave.max_inflight == 4
+        for (unit, reg), handle in points.items():
+            assert hal_bus.read_point(handle) == slave.register(unit, reg), (unit, reg)
+        stats = port_stats(slave.device)
+        assert stats['requests'] == 4 and stats['responses'] == 4
+
+        # 第二個週期讀到新的值
+        slave.registers[(3, 1)] = 4242
+        assert poll_all() == 4
+        assert hal_bus.read_point(points[(3, 1)]) == 4242
+    finally:
+        slave.close()
+
+
+def test_timeout_isolated():
+    """沒有回應的 unit 超時標為 BAD，同一批的其他交易照常完成"""
+    print("=== 2. 單一交易超時 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1, 2))
+    try:
+        good = [hal_bus.register_point(slave.device, unit, 5) for unit in (1, 2)]
+        missing = hal_bus.register_point(slave.device, 9, 5)
+        assert poll_all() == 2
+        assert [hal_bus.read_point(h) for h in good] == [1005, 2005]
+        assert hal_bus.read_sample(missing).quality == hal_bus.HAL_QUALITY_BAD
+        stats = port_stats(slave.device)
+        print(f"requests={stats['requests']} responses={stats['responses']} timeouts={stats['timeouts']}")
+        assert stats['timeouts'] >= 1
+    finally:
+        slave.close()
+
+
+def test_unit_mismatch():
+    """回應帶錯誤的 unit id 時不採用其資料，量測點標為 BAD 並計入 other_errors"""
+    print("=== 3. MBAP unit 不符 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,))
+    try:
+        handle = hal_bus.register_point(slave.device, 1, 5)
+        assert poll_all() == 1
+        assert hal_bus.read_point(handle) == 1005
+
+        slave.unit_offset = 1
+        slave.registers[(1, 5)] = 4242
+        poll_all()
+        stats = port_stats(slave.device)
+        print(f"responses={stats['responses']} other_errors={stats['other_errors']}")
+        assert hal_bus.read_sample(handle).quality == hal_bus.HAL_QUALITY_BAD
+        assert hal_bus.read_point(handle) is None
+        assert stats['other_errors'] == 1 and stats['responses'] == 1
+    finally:
+        slave.close()
+
+
+def test_register_during_poll():
+    """排程器在交易期間不持有計畫的鎖：等待超時的輪詢進行中仍可立即註冊量測點"""
+    print("=== 4. 輪詢期間註冊量測點 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,))
+    try:
+        hal_bus.register_point(slave.device, 9, 5)          # 沒有回應，等待 1 秒超時
+        poller = threading.Thread(target=poll_all)
+        poller.start()
+        time.sleep(0.2)
+        start = time.monotonic()
+        handle = hal_bus.register_point(slave.device, 1, 7)
+        elapsed = time.monotonic() - start
+        poller.join()
+        print(f"註冊耗時 {elapsed * 1000:.1f} ms")
+        assert handle is not None and elapsed < 0.3
+
+        # 被重建的計畫丟棄那一批結果，下一次輪詢使用新的計畫
+        poll_all()
+        assert hal_bus.read_point(handle) == 1007
+    finally:
+        slave.close()
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_pipelined_reads, test_timeout_isolated, test_unit_mismatch,
+             test_register_during_poll]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+測試節點間遙測 frame (以模擬匯流排 sim:// 執行，不需要硬體)
+1. 編碼 -> 解碼後接收端的量測點與本機快照表相同 (關鍵 frame 與差異 frame)
+2. frame 遺失時解碼返回 -2，要求關鍵 frame 後重新同步；CRC 錯誤返回 -1
+用法: make -C hal 之後執行 python test_hal_telemetry.py
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, poll_all, reset, sim_bus
+
+DEV = 'sim://test-telemetry'
+NODE_ID = 3
+
+
+def setup_points():
+    reset()
+    sim_bus(DEV)
+    handles = []
+    for slave in (1, 2):
+        assert L.hal_sim_add_slave(DEV.encode(), slave, 0, 16) == 0
+        for reg in (0, 1, 5):
+            handles.append(hal_bus.register_point(DEV, slave, reg, scale=0.1))
+    assert hal_bus.configure_telemetry({'enabled': True, 'batch_cycles': 1, 'keyframe_interval': 0}, NODE_ID)
+    return handles
+
+
+def local_points(handles):
+    samples = [hal_bus.read_sample(h) for h in handles]
+    return [(s.value, s.quality, s.timestamp_us) for s in samples]
+
+
+def cycle(handles, step):
+    """改變一部分暫存器後輪詢並編碼一個週期，返回複製出來的 frame"""
+    for i in range(step % 3 + 1):
+        assert hal_bus.set_sim_register(DEV, 1 + i % 2, (0, 1, 5)[i], 100 * step + i)
+    poll_all()
+    frame = hal_bus.encode_telemetry()
+    assert frame is not None
+    return bytes(frame)
+
+
+def test_round_trip():
+    """關鍵 frame 與差異 frame 解碼後與本機快照表完全相同"""
+    print("=== 1. 遙測編碼與解碼 ===")
+    handles = setup_points()
+    sizes = []
+    for step in range(6):
+        frame = cycle(handles, step)
+        cycles, info = hal_bus.decode_telemetry(frame)
+        assert cycles == 1, cycles
+        assert info['node_id'] == NODE_ID and info['point_count'] == len(handles)
+        assert info['keyframe'] == (step == 0)
+        assert hal_bus.peer_points(NODE_ID) == local_points(handles)
+        sizes.append(len(frame))
+    print(f"frame 大小: {sizes}")
+    assert max(sizes[1:]) < sizes[0]
+
+    # 沒有變化的週期只有標頭與週期時間
+    frame = bytes(hal_bus.encode_telemetry())
+    assert hal_bus.decode_telemetry(frame)[0] == 1
+    assert hal_bus.peer_points(NODE_ID) == local_points(handles)
+
+
+def test_resync_after_loss():
+    """遺失一個 frame 後返回 -2 且不套用，要求關鍵 frame 後重新同步"""
+    print("=== 2. frame 遺失與重新同步 ===")
+    handles = setup_points()
+    frame = cycle(handles, 0)
+    assert hal_bus.decode_telemetry(frame)[0] == 1
+    before = hal_bus.peer_points(NODE_ID)
+
+    cycle(handles, 1)                   # 遺失
+    frame = cycle(handles, 2)
+    assert hal_bus.decode_telemetry(frame) == (-2, None)
+    assert hal_bus.peer_points(NODE_ID) == before
+
+    hal_bus.request_telemetry_keyframe()
+    frame = cycle(handles, 3)
+    cycles, info = hal_bus.decode_telemetry(frame)
+    print(f"重新同步: cycles={cycles} keyframe={info['keyframe']}")
+    assert cycles == 1 and info['keyframe']
+    assert hal_bus.peer_points(NODE_ID) == local_points(handles)
+
+    corrupt = bytearray(cycle(handles, 4))
+    corrupt[len(corrupt) // 2] ^= 0x01
+    assert hal_bus.decode_telemetry(bytes(corrupt)) == (-1, None)
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_round_trip, test_resync_after_loss]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
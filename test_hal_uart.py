@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+測試 UART DI/DO 板驅動 (以 pty 模擬 DI 板，不需要硬體，只適用於 POSIX)
+1. 支援 "READ DI" 的板子每次輪詢只有一次往返，uart_read_di_pin 只讀快照表
+2. 以 ERR 拒絕 "READ DI" 的板子改以 "READ PIN" 逐一讀取登錄過的 pin
+3. 板子沒有回應時 uart_read_di_pin 不會阻塞
+用法: make -C hal 之後執行 python test_hal_uart.py
+"""
+
+import ctypes
+import os
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_bus import L, poll_all, reset
+
+if L is not None:
+    L.uart_read_di_pin.restype = ctypes.c_int
+    L.uart_read_di_pin.argtypes = [ctypes.c_char_p, ctypes.c_int]
+
+
+class DiBoard:
+    """pty 另一端的 DI 板：READ PIN n 回應 OK 0|1；bitmap 為 True 時也接受 READ DI
+    silent 為 True 時不回應任何指令。pty 在整個測試程序中保持開啟，每塊板子的 device 名稱不同"""
+
+    def __init__(self, bitmap, pins=0):
+        self.bitmap = bitmap
+        self.pins = pins
+        self.silent = False
+        self.commands = []
+        self._master, self._slave = os.openpty()
+        self.device = os.ttyname(self._slave)
+        threading.Thread(target=self._serve, daemon=True).start()
+
+    def _serve(self):
+        buf = b''
+        while True:
+            buf += os.read(self._master, 256)
+            while b'\n' in buf:
+                line, buf = buf.split(b'\n', 1)
+                command = line.strip().decode()
+                self.commands.append(command)
+                if not self.silent:
+                    os.write(self._master, self._answer(command).encode())
+
+    def _answer(self, command):
+        if command == 'READ DI' and self.bitmap:
+            return f'OK {self.pins:X}\r\n'
+        if command.startswith('READ PIN '):
+            pin = int(command[9:])
+            return f'OK {(self.pins >> (pin - 1)) & 1}\r\n'
+        return 'ERR unknown command\r\n'
+
+
+def test_bitmap_board():
+    """整板讀取：一次 READ DI 更新所有 pin，讀 pin 時不送出任何指令"""
+    print("=== 1. READ DI 整板讀取 ===")
+    reset()
+    board = DiBoard(bitmap=True, pins=0b1010)
+    h = hal_bus.register_di(board.device)
+    assert poll_all() == 1
+    assert board.commands == ['READ DI']
+    assert [hal_bus.read_di_pin(h, pin) for pin in (1, 2, 3, 4)] == [0, 1, 0, 1]
+
+    board.pins = 0x80000001
+    assert poll_all() == 1
+    assert [L.uart_read_di_pin(board.device.encode(), pin) for pin in (1, 2, 32)] == [1, 0, 1]
+    print(f"  指令: {board.commands}")
+    assert board.commands == ['READ DI', 'READ DI']
+
+
+def test_per_pin_fallback():
+    """READ DI 被拒絕後只以 READ PIN 讀取登錄的 pin，之後的輪詢不再嘗試 READ DI"""
+    print("=== 2. READ PIN 逐一讀取 ===")
+    reset()
+    board = DiBoard(bitmap=False, pins=0b0101)
+    h = hal_bus.register_di(board.device, pins=(1, 2))
+    assert L.uart_read_di_pin(board.device.encode(), 3) == -1     # 尚未輪詢
+    assert poll_all() == 1
+    assert board.commands == ['READ DI', 'READ PIN 1', 'READ PIN 2', 'READ PIN 3']
+    assert [hal_bus.read_di_pin(h, pin) for pin in (1, 2, 3)] == [1, 0, 1]
+
+    board.commands.clear()
+    board.pins = 0b0010
+    assert poll_all() == 1
+    print(f"  指令: {board.commands}")
+    assert board.commands == ['READ PIN 1', 'READ PIN 2', 'READ PIN 3']
+    assert [L.uart_read_di_pin(board.device.encode(), pin) for pin in (1, 2, 3)] == [0, 1, 0]
+
+
+def test_read_pin_does_not_block():
+    """板子沒有回應時 uart_read_di_pin 立即返回，輪詢超時後品質為 BAD"""
+    print("=== 3. 不阻塞的 uart_read_di_pin ===")
+    reset()
+    board = DiBoard(bitmap=True, pins=1)
+    board.silent = True
+    start = time.monotonic()
+    assert L.uart_read_di_pin(board.device.encode(), 1) == -1
+    elapsed = time.monotonic() - start
+    print(f"  耗時 {elapsed * 1000:.1f} ms")
+    assert elapsed < 0.2 and board.commands == []
+
+    assert poll_all() == 0
+    assert board.commands == ['READ DI']
+    assert L.uart_read_di_pin(board.device.encode(), 1) == -1
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    if not hasattr(os, 'openpty'):
+        print("pty not available, skipped")
+        sys.exit(0)
+    tests = [test_bitmap_board, test_per_pin_fallback, test_read_pin_does_not_block]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+測試寫入佇列 (以本機的 Modbus TCP slave 執行緒執行，不需要硬體)
+1. 沒有擷取執行緒時 hal_write_submit 同步寫入：單一暫存器 FC06，多暫存器 FC16，例外回應返回 -1
+2. 背景擷取運作時寫入排入佇列，同一暫存器只送最新值
+3. 佇列的 FC06 / FC16 語意：各自排入的單一暫存器逐一以 FC06 送出，只有同一次多暫存器寫入合併成 FC16
+4. 每個 (port, slave) 的寫入結果
+用法: make -C hal 之後執行 python test_hal_write.py
+"""
+
+import ctypes
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from blocks import hal_bus
+from test_hal_tcp import L, ModbusTcpSlave, reset
+
+if L is not None:
+    L.hal_port_get.restype = ctypes.c_void_p
+    L.hal_port_get.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    L.hal_write_submit.restype = ctypes.c_int
+    L.hal_write_submit.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                   ctypes.POINTER(ctypes.c_uint16)]
+    L.hal_write_pending.restype = ctypes.c_int
+    L.hal_write_pending.argtypes = []
+    L.hal_write_enqueue.restype = ctypes.c_int
+    L.hal_write_enqueue.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                    ctypes.POINTER(ctypes.c_uint16)]
+    L.hal_write_flush.restype = ctypes.c_int
+    L.hal_write_flush.argtypes = [ctypes.c_void_p]
+
+
+def submit(port, slave, reg, values):
+    buf = (ctypes.c_uint16 * len(values))(*values)
+    return L.hal_write_submit(port, slave, reg, len(values), buf)
+
+
+def enqueue(port, slave, reg, values):
+    buf = (ctypes.c_uint16 * len(values))(*values)
+    assert L.hal_write_enqueue(port, slave, reg, len(values), buf) == 0
+
+
+def writes(tcp_slave, reg=None):
+    return [(fc, r, arg) for _, fc, r, arg in tcp_slave.requests if fc in (6, 16) and (reg is None or r == reg)]
+
+
+def wait_until(predicate, timeout_s=2.0):
+    deadline = time.monotonic() + timeout_s
+    while not predicate():
+        if time.monotonic() > deadline:
+            return False
+        time.sleep(0.01)
+    return True
+
+
+def test_sync_writes():
+    """背景擷取未啟動時直接寫入並返回結果"""
+    print("=== 1. 同步寫入 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,), size=0x100)
+    try:
+        port = L.hal_port_get(slave.device.encode(), 9600)
+        assert port
+        assert submit(port, 1, 0x10, [1234]) == 0
+        assert submit(port, 1, 0x20, [7, 8, 9]) == 0
+        print(f"  {writes(slave)}")
+        assert writes(slave) == [(6, 0x10, 1234), (16, 0x20, 3)]
+        assert slave.register(1, 0x10) == 1234
+        assert [slave.register(1, 0x20 + i) for i in range(3)] == [7, 8, 9]
+
+        # 例外回應與無效參數
+        assert submit(port, 1, 0x100, [1]) == -1
+        assert submit(port, 1, 0xFFFF, [1, 2]) == -1
+        assert L.hal_write_pending() == 0
+
+        # 超過登錄表長度的 device 名稱不截斷共用，直接拒絕
+        assert not L.hal_port_get(slave.device.encode() + b'#' * 64, 9600)
+    finally:
+        slave.close()
+
+
+def test_queued_latest_value():
+    """擷取執行緒負責 port 時寫入排入佇列並在讀取之前送出，同一暫存器只送最新值"""
+    print("=== 2. 佇列寫入 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,), size=0x100)
+    try:
+        hal_bus.register_point(slave.device, 1, 0)
+        port = L.hal_port_get(slave.device.encode(), 9600)
+        assert hal_bus.start_acquisition(50)
+        for value in range(20):
+            assert submit(port, 1, 0x10, [100 + value]) == 0
+        assert submit(port, 1, 0x30, [4, 5]) == 0
+        assert wait_until(lambda: L.hal_write_pending() == 0)
+        assert wait_until(lambda: slave.register(1, 0x31) == 5)
+        sent = writes(slave, 0x10)
+        print(f"  20 次排入 -> {len(sent)} 個 frame, 最後值 {slave.register(1, 0x10)}")
+        assert 1 <= len(sent) < 20
+        assert slave.register(1, 0x10) == 119
+        assert writes(slave, 0x30) == [(16, 0x30, 2)]
+    finally:
+        hal_bus.stop_acquisition()
+        slave.close()
+
+
+def test_queue_semantics():
+    """同一暫存器只送最新值；各自排入的單一暫存器以 FC06 逐一送出，多暫存器寫入以一個 FC16 送出"""
+    print("=== 3. 佇列的 FC06 / FC16 語意 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,), size=0x100)
+    try:
+        port = L.hal_port_get(slave.device.encode(), 9600)
+        assert port
+        for value in range(10):
+            enqueue(port, 1, 0x10, [100 + value])
+        assert L.hal_write_flush(port) == 1
+        assert writes(slave) == [(6, 0x10, 109)]
+
+        # 位址連續但各自排入：3 個 FC06
+        for i in range(3):
+            enqueue(port, 1, 0x20 + i, [i + 1])
+        assert L.hal_write_flush(port) == 3
+        assert writes(slave)[1:] == [(6, 0x20, 1), (6, 0x21, 2), (6, 0x22, 3)]
+
+        # 同一次多暫存器寫入：1 個 FC16，取代重疊的單一暫存器寫入
+        enqueue(port, 1, 0x31, [99])
+        enqueue(port, 1, 0x30, [7, 8, 9])
+        assert L.hal_write_flush(port) == 1
+        print(f"  {writes(slave)}")
+        assert writes(slave)[4:] == [(16, 0x30, 3)]
+        assert [slave.register(1, 0x30 + i) for i in range(3)] == [7, 8, 9]
+        assert L.hal_write_flush(port) == 0
+    finally:
+        slave.close()
+
+
+def test_write_status():
+    """送出結果記錄在 (port, slave)，例外回應記錄為失敗並帶起始暫存器"""
+    print("=== 4. 寫入結果 ===")
+    reset()
+    slave = ModbusTcpSlave(units=(1,), size=0x100)
+    try:
+        port = L.hal_port_get(slave.device.encode(), 9600)
+        assert hal_bus.write_status(slave.device, 1) is None
+        enqueue(port, 1, 0x10, [1])
+        enqueue(port, 1, 0x20, [2, 3])
+        L.hal_write_flush(port)
+        status = hal_bus.write_status(slave.device, 1)
+        print(f"  {status}")
+        assert status['written'] == 2 and status['failed'] == 0 and status['last_error_reg'] == -1
+
+        enqueue(port, 1, 0x100, [1])
+        L.hal_write_flush(port)
+        status = hal_bus.write_status(slave.device, 1)
+        assert status['failed'] == 1 and status['last_status'] == -1 and status['last_error_reg'] == 0x100
+        assert hal_bus.write_status(slave.device)['written'] == 2
+        assert hal_bus.write_status(slave.device, 2) is None
+    finally:
+        slave.close()
+
+
+if __name__ == "__main__":
+    if not hal_bus.available():
+        print(f"HAL library not found: {hal_bus.HAL_LIB_PATH} (make -C hal)")
+        sys.exit(1)
+    tests = [test_sync_writes, test_queued_latest_value, test_queue_semantics, test_write_status]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print("  通過\n")
+        except AssertionError as e:
+            failed += 1
+            print(f"  失敗: {e!r}\n")
+    print(f"{len(tests) - failed}/{len(tests)} 通過")
+    sys.exit(1 if failed else 0)